@@ -4,66 +4,260 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 // Local includes
 #include "GUIState.h"
+#include "audio/Playback.h"
+#include "audio/PlaybackClock.h"
+#include "audio/WaveformPyramid.h"
+#include "audiotrip/LibraryIndex.h"
 #include "audiotrip/dtos.h"
+#include "audiotrip/metrics.h"
+#include "audiotrip/overlaps.h"
+#include "audiotrip/trajectory.h"
 #include "raylib_ext/scoped.h"
 #include "raylib_ext/text3d.h"
+#include "rendering/AssetRegistry.h"
+#include "rendering/ChunkStreamer.h"
+#include "rendering/DrawList.h"
+#include "rendering/GpuRibbons.h"
+#include "rendering/RenderQueue.h"
+#include "rendering/RibbonCache.h"
+#include "rendering/RibbonPool.h"
 #include "rendering/SkyBox.h"
+#include "rendering/StartupLoader.h"
+#include "rendering/WaveformStrip.h"
+#include "rendering/vertex_format.h"
+#include "utils/AllocationTracker.h"
+#include "utils/FrameArena.h"
+#include "utils/FrameWorker.h"
+#include "utils/MemoryReport.h"
+#include "utils/ThreadPool.h"
 
 #if defined(PLATFORM_WEB)
 #include <emscripten/emscripten.h>
 #endif
 
-struct hash_tuple {
-  size_t operator()(const std::tuple<int, int, int, int> &x) const {
-    return std::get<0>(x) ^ std::get<1>(x) ^ std::get<2>(x) ^ std::get<3>(x);
-  }
+struct ApplicationOptions {
+  bool debug = false;
+  bool startupReport = false; // Print the time spent in each asset loading stage
+  bool gpuRibbons = false;    // Extrude ribbons in the vertex shader instead of generating their meshes
+  bool quantizedVertices = false; // Start with the compressed vertex format, see vertex_format.h
+  std::optional<std::string> library; // Directory of songs to search in the GUI, see LibraryIndex
+  bool nullAudio = false; // Play songs on a simulated device that makes no sound, see audio::NullPlayback
+  std::optional<double> audioLatency; // Seconds, instead of audio::MusicPlayback::DefaultLatency
+  std::optional<std::string> playbackLog; // CSV file the timing of every frame played is written to
+  bool memReport = false; // Print the memory used by each subsystem once a song is loaded, see MemoryReport
+  bool hiddenWindow = false; // For the rendering checks, which only draw offscreen
 };
 
 class Application {
 private:
-  using RibbonKey = std::tuple<int, int, int, int>; // beat, numerator, denominator, RHS (bool as int)
+  struct RibbonPlacement;
+
+  /// What frame preparation reads from the GUI and the camera, copied so that the worker never touches them
+  struct FrameInputs {
+    const audiotrip::Choreography *choreo;
+    const std::vector<RibbonPlacement> *ribbonPlacements; // Of the choreography above
+    Camera3D camera;
+    Color lhsColor;
+    Color rhsColor;
+  };
 
   std::unique_ptr<raylib::Window> window;
   std::unique_ptr<raylib::Camera> camera;
-  std::unique_ptr<raylib::Shader> shader;
-
-  std::unique_ptr<raylib::Texture2D> floorTexture;
 
-  std::unique_ptr<raylib::Model> barrierModel;
-
-  std::unique_ptr<raylib::Model> gemModel;
-  std::unique_ptr<raylib::Model> gemTrailModel;
-  std::unique_ptr<raylib::Model> drumModel;
-  std::unique_ptr<raylib::Model> dirgemModel;
+  // Must be destroyed before the window, it owns GL resources
+  AssetRegistry assets;
+
+  std::shared_ptr<raylib::Shader> shader;
+  std::shared_ptr<raylib::Shader> unlitShader;
+  vertex_format::ShaderLocations litLocations;
+  vertex_format::ShaderLocations unlitLocations;
+
+  std::shared_ptr<raylib::Texture2D> floorTexture;
+
+  std::shared_ptr<raylib::Model> barrierModel;
+
+  std::shared_ptr<raylib::Model> gemModel;
+  std::shared_ptr<raylib::Model> gemTrailModel;
+  std::shared_ptr<raylib::Model> drumModel;
+  std::shared_ptr<raylib::Model> dirgemModel;
+
+  // Shared by all ribbons
+  std::shared_ptr<Material> ribbonMaterial;
+
+  // CPU copies of the models above, baked into the chart chunks
+  ChunkStreamer::Geometry staticGeometry;
+
+  /// Ribbon bodies of a choreography, placed once
+  struct RibbonPlacement {
+    const audiotrip::ChoreoEvent *event;
+    uint64_t meshKey; // Content hash, see genOrGetRibbon()
+    Matrix transform;
+    float distance;
+  };
+
+  /**
+   * Where the events of a choreography are placed, and its chunks. Kept for all the choreographies of the song, so that
+   * switching back to one doesn't place it again, and prepared for the ones that aren't shown while idle.
+   */
+  struct ChoreoState {
+    std::unique_ptr<ChunkStreamer> chunks;
+    std::vector<RibbonPlacement> ribbonPlacements;
+    std::unordered_map<uint64_t, size_t> ribbonInstances; // Ribbons using each mesh
+    size_t preparedRibbons = 0; // Placements whose mesh was generated ahead of time, in order
+    bool ribbonsReported = false; // Ribbon cache counts logged once all of them were prepared
+    audiotrip::metrics::Metrics metrics;
+    std::unique_ptr<audiotrip::trajectory::Simulation> trajectory; // Simulated the first time the hand paths are shown
+    std::unique_ptr<audiotrip::overlaps::Result> overlaps; // Found the first time they are shown
+  };
+  std::vector<std::unique_ptr<ChoreoState>> choreoStates; // By choreography index, null until placed
+  const audiotrip::Choreography *streamedChoreo = nullptr;
+  ChoreoState *streamedState = nullptr;
+
+  /// Main thread time spent per frame on preparing the choreographies that aren't shown
+  static constexpr float PrewarmSecondsPerFrame = 0.002f;
+  std::future<size_t> prewarmParse; // Events of a choreography that isn't shown, parsed on a worker; its DOM size
+  const audiotrip::Choreography *prewarmParsing = nullptr; // Not touched until the parse is collected
+  size_t prewarmNext = 0; // Choreography to continue prewarming from
+
+  RenderQueue renderQueue;
 
   std::unique_ptr<SkyBox> skybox;
 
+  std::unique_ptr<StartupLoader> startup;
+
   Vector3 beatNumbersSize = { -1, -1, -1 };
 
   std::unique_ptr<audiotrip::AudioTripSong> ats;
   std::vector<audiotrip::Beat> beats;
-  std::unordered_map<RibbonKey, std::pair<raylib::Model, raylib::Vector3>, hash_tuple> ribbons;
+  size_t jsonDomPeak = 0; // Of the parses of this song only, for the memory report
+
+  /// A song parsed in the background, with everything derived from it that doesn't touch the application state
+  struct LoadedSong {
+    std::unique_ptr<audiotrip::AudioTripSong> ats;
+    std::vector<audiotrip::Beat> beats;
+    std::vector<std::string> choreoNames;
+    std::string bpmDuration;
+    size_t jsonDomPeak = 0; // Bytes of the largest JSON DOM parsed, if tracked
+    std::string error; // Set instead of the above if the file couldn't be loaded
+  };
+
+  struct SongLoad {
+    std::string path;
+    std::shared_ptr<std::atomic<float>> progress;
+    std::future<LoadedSong> result;
+  };
+  std::optional<SongLoad> songLoad; // The current song keeps being shown until it's done
+  std::string loadError; // Of the last file that failed to load, shown on the splash screen
+
+  /**
+   * Songs of the library directory. The saved index is loaded first so that it can be searched right away, then it's
+   * refreshed; both on a worker.
+   */
+  std::unique_ptr<audiotrip::LibraryIndex> library;
+  std::future<std::unique_ptr<audiotrip::LibraryIndex>> libraryLoad;
+  bool libraryRefreshed = false;
+  std::string libraryQuery; // Of the results below
+  std::vector<const audiotrip::LibraryIndex::Entry *> libraryResults;
+
+  struct RibbonMesh {
+    std::optional<raylib::Mesh> mesh; // Own vertex array, if the ribbon couldn't be pooled
+    std::optional<RibbonPool::Id> poolId;
+    vertex_format::Format format;
+    vertex_format::Dequantization dequantization;
+    int vertexCount;
+  };
+
+  // Ribbon meshes by content hash, shared by all the identical ribbons of the song
+  std::unordered_map<uint64_t, RibbonMesh> ribbons;
+  std::unique_ptr<RibbonCache> ribbonCache; // Null if there's no cache directory
+
+  /// Waveform of the song audio drawn beside the floor, from its cache or decoded on a worker when a song is opened
+  std::unique_ptr<WaveformStrip> waveform;
+  std::future<audio::WaveformPyramid> waveformLoad;
+  std::shared_ptr<std::atomic<bool>> waveformCancel; // Of the load above, set when the song is closed
+  std::unique_ptr<RibbonPool> ribbonPool; // Null without vertex array objects
+
+  /// The song audio, played with P; the camera follows what is being heard
+  std::string songAudio; // Empty if the song has none
+  std::unique_ptr<audio::Playback> playback; // Created the first time the song is played
+  audio::PlaybackClock playbackClock;
+  bool nullAudio = false;
+  std::optional<double> audioLatency;
+  std::unique_ptr<std::ofstream> playbackLogFile;
+  std::unique_ptr<audio::PlaybackLog> playbackLog; // Null unless enabled, see ApplicationOptions
+  double lastPlaybackFrame = 0;
+
+  /// Timing of the frame being played, logged once it's drawn
+  struct PlaybackFrame {
+    double time; // When the camera was moved
+    double seconds; // Since the previous frame
+    double heard; // Audio time heard at `time`
+  };
+  std::optional<PlaybackFrame> playbackFrame;
+  float drawnCameraZ = 0; // Of the last frame drawn
+
+  std::shared_ptr<raylib::Shader> ribbonShader;
+  std::unique_ptr<GpuRibbons> gpuRibbons; // Null unless enabled, see ApplicationOptions
 
   bool mouseCaptured = true;
+  bool showTrajectories = false;
+  bool showOverlaps = false;
   bool debug = false;
+  bool startupReport = false;
+  bool memReport = false;
+  bool memReportPending = false; // Until the chunks around the camera of the opened song are built
+  bool useGpuRibbons = false;
+  vertex_format::Format initialVertexFormat;
+  vertex_format::Format vertexFormat = vertex_format::FormatFloat; // Of the chunk and ribbon meshes
 
   GUIState gui;
 
+  // One list is drawn while the other one is prepared for the next frame
+  std::array<DrawList, 2> drawLists;
+  size_t preparingList = 0;
+  FrameInputs preparingInputs{};
+  float submitSeconds = 0; // Last frame, for the debug overlay
+  MemoryReport memory; // For the debug overlay, refreshed every second
+  double memoryRefreshed = -1;
+
+  // Scratch memory of the main thread, freed at the start of every frame
+  FrameArena scratch;
+
+  // Declared last so that it's joined before anything the preparation reads is destroyed
+  FrameWorker preparer{ [this]() { prepareFrame(preparingInputs, drawLists[preparingList]); } };
+
   audiotrip::Choreography &choreo() { return ats->choreographies.at(gui.choreoSelectorActive); }
 
 public:
-  Application(bool debug = false);
-
-  ~Application() { ClearDroppedFiles(); }
+  Application(const ApplicationOptions &options = {});
+
+  ~Application() {
+    // The parse references the song
+    if (prewarmParse.valid())
+      prewarmParse.wait();
+    if (waveformCancel != nullptr)
+      *waveformCancel = true;
+    playback.reset();
+    if (IsAudioDeviceReady())
+      CloseAudioDevice();
+    ClearDroppedFiles();
+  }
 
   void main(std::optional<std::string> atsFile) {
     beatNumbersSize = raylib_ext::text3d::MeasureText3D(GetFontDefault(), "1", 8.0f, 1.0f, 0.0f);
@@ -84,6 +278,18 @@ public:
 #endif
   }
 
+  /**
+   * Draws random ribbons extruded on the GPU and their CPU meshes offscreen, from a few views, and compares the images.
+   * Prints a line per ribbon and view, returns the exit status: 1 if any differ by more than a few edge pixels.
+   */
+  int checkGpuRibbons();
+
+  /**
+   * Same for the static models and ribbon meshes in the quantized vertex format vs floats, drawn through the chunks and
+   * meshes they are drawn from in songs. The quantized positions move by up to half a step, so more pixels can differ.
+   */
+  int checkQuantizedVertices();
+
 private:
   void mouseCapture(std::optional<bool> val) {
     mouseCaptured = val.has_value() ? *val : !mouseCaptured;
@@ -93,8 +299,64 @@ private:
       EnableCursor();
   }
 
+  /// Starts loading a song in the background, replacing any load in progress
   void openAts(const std::string &path);
 
+  /// Parses a song and prepares its GUI strings. Runs on a worker, so it must not touch the application.
+  static LoadedSong loadSong(const std::string &path, std::atomic<float> &progress);
+
+  /**
+   * Parses the events of a choreography of a lazily loaded song, logging errors (the choreography is then empty).
+   * Returns false if they were already loaded.
+   */
+  static bool loadEvents(audiotrip::Choreography &choreography);
+
+  /// Swaps in the loaded song once it's ready. Must be called while no frame preparation is in flight.
+  void pollSongLoad();
+
+  void swapSong(const std::string &path, LoadedSong song);
+
+  /// Starts loading the waveform of the song audio, if it's in a supported format
+  void loadWaveform(const std::string &audioPath);
+
+  /// Creates the waveform strip once its load is done
+  void pollWaveform();
+
+  /// Plays the song from where the camera is, seeking if it's already playing
+  void startPlayback();
+
+  /// Moves the camera to what is being heard, called every frame
+  void updatePlayback();
+
+  /// Writes the camera of the frame just drawn vs what was heard to the playback log, if enabled
+  void logPlaybackFrame();
+
+  [[nodiscard]] bool playing() const { return playback != nullptr && playback->playing(); }
+
+  /// Collects the library index when it's loaded or refreshed, searches it and opens the song picked from the results
+  void updateLibrary();
+
+  void searchLibrary();
+
+  /// Fills the chart stats window
+  void showMetrics(const audiotrip::metrics::Metrics &metrics);
+
+  /// Name and progress bar of the song being loaded, centered horizontally
+  void drawLoadProgress(int y, Color color);
+
+  void loadAssets();
+
+  void finishStartup();
+
+  /// Waits for the startup assets and finishes it, for the checks that don't draw the splash screen
+  void finishStartupNow();
+
+  /// Draws what `submit` queues in `renderQueue` from `view` into an offscreen image, for the checks
+  std::vector<Color> renderOffscreen(const Camera3D &view, const std::function<void()> &submit);
+
+  /// Switches the chunk and ribbon meshes to another vertex format, falling back to floats if unsupported
+  void setVertexFormat(vertex_format::Format format);
+
   static void emscriptenMainloop(void *obj) {
     static_cast<Application *>(obj)->drawFrame();
   }
@@ -103,23 +365,94 @@ private:
 
   void drawSplash();
 
-  float getBeatTime(float beatNum) {
-    auto intBeat = static_cast<size_t>(beatNum);
-    audiotrip::Beat beat = beats[intBeat];
-    float beatTime = beat.time;
-    float fraction = beatNum - static_cast<float>(intBeat);
+  FrameInputs frameInputs();
 
-    if (fraction != 1 && fraction != 0) {
-      float secondsPerBeat = 60.0f / beat.bpm;
-      beatTime += secondsPerBeat * fraction;
-    }
+  /**
+   * Computes the draw list of a frame: visible beat labels and ribbons. Runs on the preparation worker, so it must only
+   * read state that is changed while no preparation is in flight (the song, the beats and the ribbon placements).
+   */
+  void prepareFrame(const FrameInputs &inputs, DrawList &list) const;
 
-    return beatTime;
-  }
+  /// Starts preparing the next frame with the current inputs, while the current one is drawn
+  void startPreparing(const FrameInputs &inputs);
+
+  /// Only issues draw calls with the current camera, the labels and ribbons to draw come from the prepared list
+  void drawChoreo(const DrawList &list);
+
+  /// Hand paths of the streamed choreography around the camera, highlighted where they are faster than the threshold
+  void drawTrajectories(const Camera3D &camera);
+
+  /// Boxes around where the volumes of the streamed choreography overlap, see `audiotrip::overlaps`
+  void drawOverlaps(const Camera3D &camera);
+
+  /// Switches to the selected choreography, placing it if it wasn't prepared yet
+  void streamChoreo();
+
+  /// Places the events of a choreography and splits them into chunks for a new streamer
+  std::unique_ptr<ChoreoState> placeChoreo(const audiotrip::Choreography &choreography);
+
+  /**
+   * Generates the ribbon meshes of the shown choreography once its chunks are built, then prepares the ones that
+   * aren't shown: parses their events on a worker, places them, keeps their chunks streamed around the camera and
+   * generates their ribbon meshes, within `PrewarmSecondsPerFrame`. Must be called while no frame preparation is in
+   * flight, it can recompute the beats.
+   */
+  void prewarmChoreos();
+
+  /// Generates the next ribbon meshes of a placed choreography until `deadline`. Returns whether all of them are.
+  bool prepareRibbons(const audiotrip::Choreography &choreography,
+                      ChoreoState &state,
+                      std::chrono::steady_clock::time_point deadline);
+
+  /// Collects the events parsed for prewarming, if done or if `wait`, and extends the beats to them
+  void finishPrewarmParse(bool wait);
+
+  /**
+   * Times of the ribbon gems relative to the first one, rounded so that the same pattern played at different points of
+   * the song gives the same values. Allocated in `scratch`, like the positions and splines below.
+   */
+  FrameArena::Vector<float> ribbonTimes(const audiotrip::ChoreoEvent &event);
+
+  /// Positions of the ribbon gems relative to the first one, from the times above
+  FrameArena::Vector<raylib::Vector3> ribbonPositions(const audiotrip::Choreography &choreography,
+                                                     const audiotrip::ChoreoEvent &event);
+
+  /**
+   * Returns the mesh of a ribbon, generating it if needed. Meshes are keyed by a hash of the ribbon shape relative to
+   * its start and of the generation parameters (`RibbonCache::key()`), so identical ribbons share one mesh, also across
+   * choreographies.
+   */
+  RibbonMesh &genOrGetRibbon(const audiotrip::Choreography &choreography,
+                             const audiotrip::ChoreoEvent &event,
+                             uint64_t meshKey);
+
+  /// Cross-section of the ribbons, before it is tilted for each hand
+  static const std::vector<raylib::Vector3> &ribbonShape();
+
+  /// Splines of a ribbon relative to its first gem, and the texture scale its mesh is generated with
+  std::pair<FrameArena::Vector<splines::Spline3D>, float> ribbonSplines(const audiotrip::Choreography &choreography,
+                                                                        const audiotrip::ChoreoEvent &event);
+
+  /// Generates what a ribbon is drawn from: true if it's extruded on the GPU, otherwise its mesh is in `ribbons`
+  bool prepareRibbon(const audiotrip::Choreography &choreography,
+                     const audiotrip::ChoreoEvent &event,
+                     uint64_t meshKey);
+
+  /// Queues a ribbon prepared with `prepareRibbon()`, which returned `onGpu`
+  void submitRibbon(const DrawList::Ribbon &ribbon, bool onGpu);
+
+  /// Logs how many ribbons of the streamed choreography share a mesh
+  void reportRibbonDedup();
 
-  void drawChoreo();
+  /// Frees the meshes of the ribbons that no placed choreography uses, their pool ranges are reused
+  void evictUnusedRibbons();
 
-  void drawChoreoEventElement(const audiotrip::ChoreoEvent &event, float distance);
+  /// Frees all the ribbon meshes, the pool is recreated in the current vertex format
+  void clearRibbons();
 
-  std::pair<raylib::Model &, Vector3> genOrGetRibbon(const audiotrip::ChoreoEvent &event, float distance);
+  /**
+   * Memory used by the open song and the assets, summed up from the structures holding it. The choreography being
+   * parsed on a worker for prewarming is left out until its parse is collected.
+   */
+  [[nodiscard]] MemoryReport memoryReport() const;
 };
\ No newline at end of file
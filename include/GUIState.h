@@ -8,6 +8,7 @@
 
 // STL includes
 #include <algorithm>
+#include <cstddef>
 
 #include "raylib-cpp.hpp"
 
@@ -22,14 +23,21 @@ public:
   // Define anchors
   raylib::Vector2 atsInfoLocation = { 8, 8 }; // ANCHOR ID:1
   raylib::Vector2 settingsLocation = { 8, 104 }; // ANCHOR ID:2
+  raylib::Vector2 libraryLocation = { 496, 8 }; // ANCHOR ID:3, kept in the top right corner
+  raylib::Vector2 metricsLocation = { 8, 392 }; // ANCHOR ID:4
 
   // Define controls variables
   bool choreoSelectorEditMode = false;
   int choreoSelectorActive = 0; // DropdownBox: choreoSelector
   bool settingsWindowBoxActive = false; // WindowBox: settingsWindowBox
+  bool metricsWindowBoxActive = false; // WindowBox: metricsWindowBox
   raylib::Color lhsColorPickerValue = PURPLE; // ColorPicker: lhsColorPicker
   raylib::Color rhsColorPickerValue = ORANGE; // ColorPicker: rhsColorPicker
   raylib::Color barrierColorPickerValue = RED; // ColorPicker: barrierColorPicker
+  bool librarySearchEditMode = false;
+  char librarySearchText[128] = ""; // TextBox: librarySearch
+  int libraryListScrollIndex = 0;
+  int libraryListActive = -1; // ListView: libraryList
 
   // Custom state variables (depend on development software)
   // NOTE: This variables should be added manually if required
@@ -37,26 +45,69 @@ public:
   std::string atsArtist;
   std::string atsBpmDuration;
   std::string choreoNames;
-  std::vector<std::string> choreoNamesVector;
+  float choreoNamesWidth = 0; // Of the widest name in the selector, measured once per song
+  std::vector<std::string> metricsLines;
+  bool libraryVisible = false; // Only with a library, see `--library`
+  std::string libraryStatus;
+  std::string libraryResults;
 
   void init() { // NOLINT(readability-convert-member-functions-to-static)
     raygui::GuiLoadStyleCyber();
   }
 
   void setChoreoNames(const std::vector<std::string> &names) {
-    choreoNamesVector = names;
     choreoNames.clear();
+    choreoNamesWidth = 0;
 
-    for (std::string &name : choreoNamesVector) {
-      std::replace_if(
-        name.begin(), name.end(), [](std::string::value_type v) { return v == ';'; }, ' ');
+    for (const std::string &name : names) {
+      if (!choreoNames.empty())
+        choreoNames += ";";
+      size_t start = choreoNames.size();
       choreoNames += name;
+      std::replace(choreoNames.begin() + static_cast<std::ptrdiff_t>(start), choreoNames.end(), ';', ' ');
 
-      if (&name != &choreoNamesVector.back())
-        choreoNames += ";";
+      float width = MeasureTextEx(raygui::GuiGetFont(),
+                                  choreoNames.c_str() + start,
+                                  static_cast<float>(raygui::GuiGetStyle(raygui::DROPDOWNBOX, raygui::TEXT_SIZE)),
+                                  1)
+                      .x +
+                    8 * 2 + 10;
+      choreoNamesWidth = std::max(choreoNamesWidth, width);
     }
   }
 
+  void setLibraryResults(const std::vector<std::string> &results) {
+    libraryResults.clear();
+    for (const std::string &result : results) {
+      if (!libraryResults.empty())
+        libraryResults += ";";
+      std::string item = result;
+      std::replace(item.begin(), item.end(), ';', ' ');
+      libraryResults += item;
+    }
+    libraryListScrollIndex = 0;
+    libraryListActive = -1;
+  }
+
+  void DrawLibrary() {
+    if (!libraryVisible)
+      return;
+
+    libraryLocation.x = static_cast<float>(GetScreenWidth()) - 8 - 296;
+
+    raygui::GuiPanel((Rectangle){ libraryLocation.x + 0, libraryLocation.y + 0, 296, 288 });
+    if (raygui::GuiTextBox((Rectangle){ libraryLocation.x + 8, libraryLocation.y + 8, 280, 24 },
+                           librarySearchText,
+                           sizeof(librarySearchText),
+                           librarySearchEditMode))
+      librarySearchEditMode = !librarySearchEditMode;
+    raygui::GuiLabel((Rectangle){ libraryLocation.x + 8, libraryLocation.y + 36, 280, 16 }, libraryStatus.c_str());
+    libraryListActive = raygui::GuiListView((Rectangle){ libraryLocation.x + 8, libraryLocation.y + 56, 280, 224 },
+                                            libraryResults.c_str(),
+                                            &libraryListScrollIndex,
+                                            libraryListActive);
+  }
+
   void Draw() {
     float mainBoxWidth = 296;
     float maxTextWidth = static_cast<float>(
@@ -70,20 +121,9 @@ public:
     }
 
     float choreoSelectorWidth = 176 + expandSize;
-    float maxChoreoSelTextWidth = 0;
-    for (const std::string &name : choreoNamesVector) {
-      float width = MeasureTextEx(raygui::GuiGetFont(),
-                                  name.c_str(),
-                                  static_cast<float>(raygui::GuiGetStyle(raygui::DROPDOWNBOX, raygui::TEXT_SIZE)),
-                                  1)
-                      .x +
-                    8 * 2 + 10;
-      if (width > maxChoreoSelTextWidth)
-        maxChoreoSelTextWidth = width;
-    }
-    if (maxChoreoSelTextWidth > choreoSelectorWidth) {
-      expandSize += maxChoreoSelTextWidth - choreoSelectorWidth;
-      choreoSelectorWidth = maxChoreoSelTextWidth;
+    if (choreoNamesWidth > choreoSelectorWidth) {
+      expandSize += choreoNamesWidth - choreoSelectorWidth;
+      choreoSelectorWidth = choreoNamesWidth;
     }
     mainBoxWidth += expandSize;
 
@@ -95,7 +135,7 @@ public:
       settingsWindowBoxActive = !raygui::GuiWindowBox((Rectangle){ settingsLocation.x + 0,
                                                                    settingsLocation.y + 0,
                                                                    296,
-                                                                   280 },
+                                                                   292 },
                                                       "Settings");
       raygui::GuiGroupBox((Rectangle){ settingsLocation.x + 8, settingsLocation.y + 40, 136, 112 }, "Left hand color");
       lhsColorPickerValue = raygui::GuiColorPicker((Rectangle){ settingsLocation.x + 16,
@@ -116,19 +156,43 @@ public:
                                                                     96,
                                                                     96 },
                                                        barrierColorPickerValue);
-      raygui::GuiGroupBox((Rectangle){ settingsLocation.x + 152, settingsLocation.y + 160, 136, 112 }, "Controls help");
+      raygui::GuiGroupBox((Rectangle){ settingsLocation.x + 152, settingsLocation.y + 160, 136, 124 }, "Controls help");
       raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 176, 120, 10 },
                        "WASD: Move around");
-      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 192, 120, 10 },
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 188, 120, 10 },
                        "Page up/down: prev/");
-      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 202, 120, 10 },
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 196, 120, 10 },
                        "next beat");
-      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 216, 120, 10 },
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 208, 120, 10 },
                        "M: Toggle mouse");
-      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 224, 120, 10 },
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 216, 120, 10 },
                        "capture");
-      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 240, 120, 10 },
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 228, 120, 10 },
                        "Esc: Quit");
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 238, 120, 10 },
+                       "I: Chart stats");
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 248, 120, 10 },
+                       "T: Hand paths");
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 258, 120, 10 },
+                       "O: Overlaps");
+      raygui::GuiLabel((Rectangle){ settingsLocation.x + 160, settingsLocation.y + 268, 120, 10 },
+                       "P: Play/stop the song");
+    }
+
+    if (metricsWindowBoxActive) {
+      float metricsHeight = 32 + 8 + static_cast<float>(metricsLines.size()) * 16;
+      metricsWindowBoxActive = !raygui::GuiWindowBox((Rectangle){ metricsLocation.x + 0,
+                                                                  metricsLocation.y + 0,
+                                                                  352,
+                                                                  metricsHeight },
+                                                     "Chart stats");
+      for (size_t i = 0; i < metricsLines.size(); i++) {
+        raygui::GuiLabel((Rectangle){ metricsLocation.x + 8,
+                                      metricsLocation.y + 32 + static_cast<float>(i) * 16,
+                                      336,
+                                      16 },
+                         metricsLines[i].c_str());
+      }
     }
 
     raygui::GuiPanel((Rectangle){ atsInfoLocation.x + 0, atsInfoLocation.y + 0, mainBoxWidth, 88 });
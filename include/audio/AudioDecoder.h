@@ -0,0 +1,52 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace audio {
+
+/**
+ * Reads an audio file a block at a time, with the decoders compiled into raylib (WAV, OGG Vorbis and MP3, picked by
+ * the extension), so that long songs never have to be decoded in memory as a whole. Unlike raylib's music streams it
+ * doesn't need an audio device.
+ */
+class AudioDecoder {
+public:
+  /// Throws std::runtime_error if the file can't be opened or its format isn't supported
+  explicit AudioDecoder(const std::string &path);
+
+  ~AudioDecoder();
+
+  AudioDecoder(const AudioDecoder &) = delete;
+  AudioDecoder &operator=(const AudioDecoder &) = delete;
+
+  [[nodiscard]] uint32_t sampleRate() const { return rate; }
+
+  [[nodiscard]] uint32_t channels() const { return channelCount; }
+
+  /// Frames in the file, if the format knows without decoding it all
+  [[nodiscard]] std::optional<uint64_t> frameCount() const { return frames; }
+
+  /**
+   * Decodes up to `count` frames into `samples` (interleaved, `count * channels()` floats), returns how many were read.
+   * Less than `count` means the end of the file.
+   */
+  size_t read(float *samples, size_t count);
+
+  /// Whether the extension of `path` is of a supported format
+  static bool supported(const std::string &path);
+
+private:
+  struct Source;
+
+  std::unique_ptr<Source> source;
+  uint32_t rate = 0;
+  uint32_t channelCount = 0;
+  std::optional<uint64_t> frames;
+};
+
+} // namespace audio
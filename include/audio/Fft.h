@@ -0,0 +1,43 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Fast Fourier transform of real signals of a fixed power of two size. The samples are packed into a complex signal of
+ * half the size, transformed with radix-2 butterflies and unpacked. Real and imaginary parts are kept in separate
+ * arrays and every stage is a plain loop over them, like the kernels in `matrix_batch`, so that compilers vectorize it.
+ *
+ * It keeps its scratch buffers, so each thread needs its own.
+ */
+class Fft {
+public:
+  /// Throws std::invalid_argument unless `size` is a power of two, at least 4
+  explicit Fft(size_t size);
+
+  [[nodiscard]] size_t size() const { return length; }
+
+  /// Bins of the spectrum, the DC and Nyquist ones included
+  [[nodiscard]] size_t bins() const { return length / 2 + 1; }
+
+  /// Magnitudes of the spectrum of `size()` samples into `bins()` floats
+  void magnitudes(const float *samples, float *result);
+
+private:
+  size_t length;
+  size_t half; // Of the complex transform
+
+  std::vector<size_t> bitReversed; // Of each index of the complex transform
+  std::vector<float> twiddlesRe; // For the butterflies of each block of every stage, first stage first
+  std::vector<float> twiddlesIm;
+  std::vector<float> unpackRe; // e^(-2πik/size), to unpack the real spectrum
+  std::vector<float> unpackIm;
+
+  std::vector<float> re;
+  std::vector<float> im;
+};
+
+} // namespace audio
@@ -0,0 +1,86 @@
+#pragma once
+
+// STL includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Local includes
+#include "audio/Fft.h"
+
+namespace audio {
+
+/// How strongly new sounds start at each point of a song, sampled every `frameSeconds`
+struct OnsetEnvelope {
+  float frameSeconds = 0;
+  float firstFrameSeconds = 0; // Time of the first value
+  std::vector<float> values; // Non-negative, 1 at the strongest onset
+
+  [[nodiscard]] float duration() const {
+    return firstFrameSeconds + static_cast<float>(values.size()) * frameSeconds;
+  }
+};
+
+/**
+ * Spectral flux onset detection, fed a block of audio at a time. The audio is mixed to mono and decimated to about
+ * `AnalysisRate`, then cut into overlapping Hann-windowed frames; the envelope is how much the log-compressed
+ * magnitude of each frequency bin grows from one frame to the next, summed over the bins, minus its local average.
+ */
+class OnsetDetector {
+public:
+  static constexpr uint32_t AnalysisRate = 11025;
+  static constexpr size_t FrameSize = 512;
+  static constexpr size_t HopSize = 128; // About 11.6 ms at the analysis rate, frames are about 46 ms
+
+  /// Seconds around each value averaged to remove the background level
+  static constexpr float AverageSeconds = 0.5f;
+
+  OnsetDetector(uint32_t sampleRate, uint32_t channels);
+
+  /// Interleaved frames
+  void push(const float *samples, size_t frames);
+
+  /// The envelope of everything pushed. The detector can't be used afterwards.
+  OnsetEnvelope finish();
+
+  /**
+   * Streams the audio file through a detector, so only the envelope is ever held in memory. Returns an empty envelope
+   * if `cancel` is set. Throws std::runtime_error if the file can't be read.
+   */
+  static OnsetEnvelope fromFile(const std::string &audioPath, const std::atomic<bool> *cancel = nullptr);
+
+  // Kernels, public for the benchmark
+
+  /// `values[i] = log(1 + compression * values[i])`
+  static void compress(float *values, size_t count, float compression);
+
+  /// Sum of the positive `current[i] - previous[i]`
+  static float positiveDifference(const float *current, const float *previous, size_t count);
+
+private:
+  uint32_t channels;
+  uint32_t decimation; // Input frames averaged into each analysis sample
+  float analysisRate;
+
+  Fft fft;
+  std::vector<float> window;
+
+  // Samples of the analysis rate not yet consumed by a frame, from `pendingStart`
+  std::vector<float> pending;
+  size_t pendingStart = 0;
+  float partialSum = 0; // Of the input frames of the next analysis sample
+  uint32_t partialCount = 0;
+
+  std::vector<float> frame;
+  std::vector<float> spectrum;
+  std::vector<float> previousSpectrum;
+  bool first = true;
+
+  std::vector<float> flux;
+
+  void analyzeFrames();
+};
+
+} // namespace audio
@@ -0,0 +1,128 @@
+#pragma once
+
+// STL includes
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+// Libraries
+#include "raylib.h"
+
+namespace audio {
+
+/// Plays a song on an audio device, see `PlaybackClock` for turning its position into what is being heard
+class Playback {
+public:
+  virtual ~Playback() = default;
+
+  /// Starts playing from `seconds`, seeking there if already playing
+  virtual void play(double seconds) = 0;
+
+  virtual void stop() = 0;
+
+  /// Keeps the device fed, called every frame while playing
+  virtual void update() {}
+
+  [[nodiscard]] virtual bool playing() const = 0;
+
+  /**
+   * Seconds of the song consumed by the device so far. Devices pull audio a period at a time from their callback, so it
+   * moves in steps.
+   */
+  [[nodiscard]] virtual double position() const = 0;
+
+  [[nodiscard]] virtual double duration() const = 0;
+
+  /// Seconds between the device consuming audio and it being heard
+  [[nodiscard]] virtual double latency() const = 0;
+};
+
+/**
+ * Streams a song file to the default audio device with raylib, which decodes it and feeds the device from its mixing
+ * callback.
+ */
+class MusicPlayback : public Playback {
+public:
+  /**
+   * What miniaudio buffers in the device by default: three periods of 10 ms. Not reported by raylib, so it can be
+   * overridden.
+   */
+  static constexpr double DefaultLatency = 0.03;
+
+  /// Opens the audio device if needed. Throws std::runtime_error if there's none or the file can't be loaded.
+  explicit MusicPlayback(const std::string &path, double latency = DefaultLatency);
+
+  ~MusicPlayback() override;
+
+  MusicPlayback(const MusicPlayback &) = delete;
+  MusicPlayback &operator=(const MusicPlayback &) = delete;
+
+  void play(double seconds) override;
+
+  void stop() override;
+
+  void update() override;
+
+  [[nodiscard]] bool playing() const override;
+
+  [[nodiscard]] double position() const override;
+
+  [[nodiscard]] double duration() const override;
+
+  [[nodiscard]] double latency() const override { return deviceLatency; }
+
+private:
+  Music music;
+  double deviceLatency;
+};
+
+/**
+ * A simulated device that plays nothing: it consumes the song a period at a time on the given clock, like a device
+ * callback would, and knows exactly what would be heard. For checking the sync without an audio device.
+ */
+class NullPlayback : public Playback {
+public:
+  struct Options {
+    uint32_t sampleRate = 48000;
+    uint32_t periodFrames = 480;
+    double latency = 0.02; // Between a period being consumed and starting to be heard
+    double clockSkew = 1.0; // Speed of the device clock relative to `now`, real ones are off by up to 0.1%
+  };
+
+  /// `now` returns the seconds of a monotonic clock
+  NullPlayback(double duration, std::function<double()> now, const Options &options);
+
+  NullPlayback(double duration, std::function<double()> now) : NullPlayback(duration, std::move(now), Options{}) {}
+
+  void play(double seconds) override;
+
+  void stop() override;
+
+  [[nodiscard]] bool playing() const override;
+
+  [[nodiscard]] double position() const override;
+
+  [[nodiscard]] double duration() const override { return length; }
+
+  /// Until the end of a period is heard
+  [[nodiscard]] double latency() const override;
+
+  /// What a real device would make heard now. Nothing before the start is, it holds there while the latency passes.
+  [[nodiscard]] double heard() const;
+
+private:
+  double length;
+  std::function<double()> now;
+  Options options;
+  bool started = false;
+  double startSeconds = 0;
+  double startedAt = 0;
+
+  [[nodiscard]] double period() const;
+
+  /// Seconds of the device clock since play()
+  [[nodiscard]] double elapsed() const;
+};
+
+} // namespace audio
@@ -0,0 +1,98 @@
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <ostream>
+
+namespace audio {
+
+/**
+ * Turns the position reported by an audio device into a smooth clock of what is being heard. Devices only report how
+ * much of the song they have consumed, and it moves in steps, once per callback: between callbacks the clock runs on
+ * the system time, the latency of the device is subtracted, and drift between the two clocks is slewed away instead of
+ * jumped over so that the camera never stutters.
+ */
+class PlaybackClock {
+public:
+  struct Options {
+    double latency = 0.0; // Seconds between the device consuming audio and it being heard
+    double correctionRate = 4.0; // Fraction of the error corrected per second
+    double maxSlew = 0.05; // Most the clock runs faster or slower than real time while correcting
+    double resyncSeconds = 0.1; // Errors larger than this are jumped over, after a stall or a seek
+  };
+
+  PlaybackClock() = default;
+
+  explicit PlaybackClock(const Options &options) : options(options) {}
+
+  /// Starts from `seconds` of the song at `now`, seconds of any monotonic clock
+  void reset(double seconds, double now);
+
+  /**
+   * Takes the seconds of the song consumed by the device so far, returns those heard at `now`. Holds at the start until
+   * the device has played it.
+   */
+  double update(double consumed, double now);
+
+  /// Last value returned by update()
+  [[nodiscard]] double seconds() const { return current; }
+
+  /// What update() tracks: the heard position estimated from the last callback alone
+  [[nodiscard]] double target() const { return estimate; }
+
+  /// Seconds of audio per device callback, estimated from the steps of the reported position; 0 until known
+  [[nodiscard]] double period() const;
+
+  [[nodiscard]] const Options &settings() const { return options; }
+
+  void setLatency(double latency) { options.latency = latency; }
+
+private:
+  /// Steps the period is estimated from; frames can span several callbacks, the smallest step is the period
+  static constexpr size_t StepHistory = 32;
+
+  Options options;
+  double start = 0;
+  double current = 0;
+  double estimate = 0;
+  double lastNow = 0;
+  double lastConsumed = 0;
+  double changedAt = 0; // When the reported position last moved
+  double unseen = 0; // Estimated seconds between that callback and when its position was seen
+  bool moved = false; // Since the reset
+  bool holding = true;
+  std::array<double, StepHistory> steps{};
+  size_t stepCount = 0;
+};
+
+/// Timing of a playback, one CSV line per frame, and the largest errors seen
+class PlaybackLog {
+public:
+  /// `out` can be null to only keep the stats
+  explicit PlaybackLog(std::ostream *out);
+
+  /// A frame of `frameSeconds` ending at `now`, where the camera showed `cameraSeconds` while `audioSeconds` was heard
+  void frame(double now, double frameSeconds, double audioSeconds, double cameraSeconds);
+
+  [[nodiscard]] size_t frames() const { return frameCount; }
+
+  /// Frames whose camera was more than the frame itself away from the audio
+  [[nodiscard]] size_t late() const { return lateCount; }
+
+  [[nodiscard]] double maxError() const { return worstError; }
+
+  [[nodiscard]] double meanError() const { return frameCount > 0 ? errorSum / static_cast<double>(frameCount) : 0; }
+
+  [[nodiscard]] double maxFrameSeconds() const { return longestFrame; }
+
+private:
+  std::ostream *out;
+  size_t frameCount = 0;
+  size_t lateCount = 0;
+  double worstError = 0;
+  double errorSum = 0;
+  double longestFrame = 0;
+};
+
+} // namespace audio
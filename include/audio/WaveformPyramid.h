@@ -0,0 +1,99 @@
+#pragma once
+
+// STL includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Peaks of a song at every zoom level: level 0 has the lowest and highest sample of each `BinFrames` frames (all
+ * channels together), every next level halves the bins of the previous one, down to a single bin.
+ *
+ * Level 0 is cached on disk, one file per song:
+ *
+ *   CacheHeader
+ *   Peak[binCount]
+ *
+ * The file is keyed by the path of the audio and thrown away when its size or modification time changes. Like the
+ * ribbon packs, the least recently written files are deleted when the cache directory grows too large.
+ */
+class WaveformPyramid {
+public:
+  static constexpr uint32_t BinFrames = 256;
+  static constexpr uint32_t CacheVersion = 1;
+  static constexpr size_t MaxCacheBytes = 32 * 1024 * 1024;
+
+  /// Samples scaled to [-127, 127], rounded outwards
+  struct Peak {
+    int8_t min;
+    int8_t max;
+  };
+
+  WaveformPyramid() = default;
+
+  /**
+   * Decodes the audio a block at a time, so only the peaks are ever held in memory. Returns an empty pyramid if
+   * `cancel` is set while decoding. Throws std::runtime_error if the file can't be read.
+   */
+  static WaveformPyramid decode(const std::string &audioPath, const std::atomic<bool> *cancel = nullptr);
+
+  /// From the cache in `directory` if it's up to date, otherwise decoded and written there
+  static WaveformPyramid loadOrDecode(const std::string &audioPath,
+                                      const std::optional<std::filesystem::path> &directory,
+                                      const std::atomic<bool> *cancel = nullptr);
+
+  [[nodiscard]] bool empty() const { return levels.empty(); }
+
+  [[nodiscard]] size_t levelCount() const { return levels.size(); }
+
+  [[nodiscard]] const std::vector<Peak> &level(size_t index) const { return levels[index]; }
+
+  [[nodiscard]] uint32_t sampleRate() const { return rate; }
+
+  /// Length of the audio covered by one bin of `level`
+  [[nodiscard]] float binSeconds(size_t level) const {
+    return static_cast<float>(static_cast<uint64_t>(BinFrames) << level) / static_cast<float>(rate);
+  }
+
+  [[nodiscard]] float duration() const { return static_cast<float>(frames) / static_cast<float>(rate); }
+
+  /// Whether it was read from the cache instead of decoded
+  [[nodiscard]] bool fromCache() const { return cached; }
+
+private:
+  struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t binFrames;
+    uint64_t frameCount;
+    uint64_t sourceSize;
+    int64_t sourceTime; // Modification time, in file clock ticks
+  };
+
+  static_assert(sizeof(CacheHeader) == 40);
+  static_assert(sizeof(Peak) == 2);
+
+  uint32_t rate = 0;
+  uint64_t frames = 0;
+  std::vector<std::vector<Peak>> levels; // Level 0 first
+  bool cached = false;
+
+  /// Fills the levels above the first one
+  void buildLevels();
+
+  /// What the cache of `audioPath` must have been written from to be used, false if the file can't be stat'ed
+  static bool stamp(const std::string &audioPath, CacheHeader &header);
+
+  static std::optional<WaveformPyramid> load(const std::filesystem::path &cachePath, const CacheHeader &expected);
+
+  void save(const std::filesystem::path &cachePath, CacheHeader header) const;
+};
+
+} // namespace audio
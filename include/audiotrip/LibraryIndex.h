@@ -0,0 +1,104 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Local includes
+#include "utils/ThreadPool.h"
+
+namespace audiotrip {
+
+/**
+ * Index of the songs in a directory tree, with just what's needed to find them: the metadata and the names and sizes of
+ * the choreographies. Songs are summarized without parsing their events, and only again when their size or
+ * modification time changes.
+ *
+ * The index is kept in the library itself, in `FileName` (little endian):
+ *
+ *   FileHeader
+ *   for each entry, sorted by path:
+ *     path, mtime (int64), size (uint64), valid (uint8), title, artist, author, avgBpm (float), songEnd (float)
+ *     choreography count (uint32), then name and event count (uint32) of each
+ *
+ * Strings are prefixed with their length as uint32.
+ */
+class LibraryIndex {
+public:
+  static constexpr const char *FileName = ".atlibrary";
+
+  struct Choreography {
+    std::string name;
+    uint32_t eventCount;
+  };
+
+  struct Entry {
+    std::string path; // Relative to the library, with '/' separators
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    bool valid = false; // Unreadable songs are kept too, so that they aren't parsed again until they change
+    std::string title;
+    std::string artist;
+    std::string author;
+    float avgBpm = 0;
+    float songEndTimeInSeconds = 0;
+    std::vector<Choreography> choreographies;
+  };
+
+  struct RefreshStats {
+    size_t files = 0;
+    size_t reused = 0; // Unchanged since the index was written
+    size_t parsed = 0;
+    size_t failed = 0; // Of the parsed ones
+    size_t removed = 0;
+  };
+
+  explicit LibraryIndex(std::filesystem::path root);
+
+  /// Reads the index file. Returns false if there's none, or if it's unreadable or from another version.
+  bool load();
+
+  /// Writes the index file, replacing it atomically
+  bool save(std::ostream &log) const;
+
+  /**
+   * Walks the library, summarizing the new and changed songs in parallel on `pool` and dropping the deleted ones. The
+   * calling thread runs tasks too, so it can be a worker of the same pool.
+   */
+  RefreshStats refresh(ThreadPool &pool, std::ostream &log);
+
+  /// Valid entries whose title, artist, author or choreography names contain every word of `query`, ignoring case
+  [[nodiscard]] std::vector<const Entry *> search(std::string_view query, size_t limit = SIZE_MAX) const;
+
+  [[nodiscard]] const std::vector<Entry> &entries() const { return songs; }
+
+  [[nodiscard]] const std::filesystem::path &root() const { return directory; }
+
+  [[nodiscard]] std::filesystem::path indexPath() const { return directory / FileName; }
+
+  /// Reads the summary of a song. Throws `ParseError` if it can't be read.
+  static void summarize(const std::filesystem::path &file, Entry &entry);
+
+private:
+  struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+  };
+
+  static_assert(sizeof(FileHeader) == 16);
+
+  std::filesystem::path directory;
+  std::vector<Entry> songs;
+  std::vector<std::string> searchText; // Lowercase text matched by search(), by entry
+
+  void updateSearchText();
+};
+
+} // namespace audiotrip
@@ -9,20 +9,33 @@
 #pragma once
 
 #include <cassert>
-#include <fstream>
+#include <functional>
 #include <iostream>
 #include <istream>
+#include <memory>
+#include <stdexcept>
 #include <tuple>
 
 #include "Vector3.hpp"
 #include "json/json.h"
 
+namespace audiotrip {
+
+/// Thrown for files that can't be read or aren't valid songs
+class ParseError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+} // namespace audiotrip
+
 namespace {
 
 template<typename T>
 std::vector<T> fromJsonArray(const Json::Value &j) {
   std::vector<T> result;
-  assert(j.isArray());
+  if (!j.isArray() && !j.isNull())
+    throw audiotrip::ParseError("Expected an array");
   for (const Json::Value &element : j)
     result.push_back(T(element));
   return result;
@@ -109,11 +122,35 @@ public:
   std::string name;
   BeatTime spawnAheadTime;
   int gemSpeed;
-  std::vector<ChoreoEvent> events;
+  std::vector<ChoreoEvent> events; // Empty until `loadEvents()` for choreographies parsed lazily
 
   Choreography(const Json::Value &j);
 
+  /// Only parses the header, the events are parsed from `data` in `json` when they are needed
+  Choreography(const Json::Value &header, std::shared_ptr<const std::string> json, size_t dataBegin, size_t dataEnd);
+
+  [[nodiscard]] bool eventsLoaded() const { return json == nullptr; }
+
+  /**
+   * Parses the events of a lazily parsed choreography, does nothing if they are already loaded. Throws `ParseError` if
+   * they are malformed, the choreography is then left without events.
+   */
+  void loadEvents();
+
+  /// Number of events, counted without parsing them if they aren't loaded. Throws `ParseError` if they are malformed.
+  [[nodiscard]] size_t eventCount() const;
+
+  /// JSON of the whole song the events are parsed from, shared with the other choreographies; null once loaded
+  [[nodiscard]] const std::string *source() const { return json.get(); }
+
   [[nodiscard]] float secondsToMeters(float seconds) const { return seconds * static_cast<float>(gemSpeed); }
+
+  [[nodiscard]] float metersToSeconds(float meters) const { return meters / static_cast<float>(gemSpeed); }
+
+private:
+  std::shared_ptr<const std::string> json; // Whole song, shared by its choreographies until they are loaded
+  size_t dataBegin = 0;
+  size_t dataEnd = 0;
 };
 
 class TempoSection {
@@ -165,17 +202,33 @@ public:
 
   std::vector<Choreography> choreographies;
 
+  /// Past these a song is rejected as malformed, its beats would take more memory than any real song
+  static constexpr float MaxSongSeconds = 24 * 60 * 60;
+  static constexpr float MaxBeatsPerMinute = 1000;
+  static constexpr int MaxBeat = static_cast<int>(MaxSongSeconds / 60 * MaxBeatsPerMinute);
+
   AudioTripSong(const Json::Value &j);
 
+  /// Throws `ParseError` if the JSON is malformed or doesn't describe a song that can be shown
   static AudioTripSong fromJson(std::istream &is);
 
-  static AudioTripSong fromFile(const std::string &path) {
-    std::ifstream is;
-    is.open(path);
-    return fromJson(is);
-  }
-
-  [[nodiscard]] std::vector<Beat> computeBeats() const;
+  /**
+   * Only parses the metadata and the choreography headers, the events of each choreography are left in the JSON until
+   * `Choreography::loadEvents()` is called. Events are most of a song, so this is about as fast as skimming the file.
+   */
+  static AudioTripSong fromJsonLazy(std::string json);
+
+  /// Same as above, `progress` is called with the fraction of the file read so far
+  static AudioTripSong fromFile(const std::string &path,
+                                const std::function<void(float)> &progress = nullptr,
+                                bool lazy = false);
+
+  /**
+   * Beats up to the end of the song, plus one. With `throughEvents` the list also goes on to the last beat of the
+   * events, counting only the choreographies that are loaded: it must be recomputed after loading more. There are never
+   * more than `MaxBeat` + 1 beats.
+   */
+  [[nodiscard]] std::vector<Beat> computeBeats(bool throughEvents = true) const;
 };
 
 } // namespace audiotrip
\ No newline at end of file
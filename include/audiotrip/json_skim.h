@@ -0,0 +1,39 @@
+/**
+ * Finds the byte ranges of JSON values without building a document, so that large parts of a song can be parsed only
+ * when they are needed. It checks just enough of the syntax to find where values end: the slices must still be parsed
+ * to be validated.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace audiotrip::skim {
+
+/// Byte range of a value, end excluded
+struct Slice {
+  size_t begin;
+  size_t end;
+
+  [[nodiscard]] std::string_view of(std::string_view json) const { return json.substr(begin, end - begin); }
+};
+
+/// The whole document, without the surrounding whitespace. Doesn't scan it, the other functions check the values.
+Slice document(std::string_view json);
+
+/// Keys and values of an object, keys are not unescaped. Throws `ParseError` if the slice isn't an object.
+std::vector<std::pair<std::string_view, Slice>> objectMembers(std::string_view json, Slice object);
+
+/// Elements of an array. Throws `ParseError` if the slice isn't an array.
+std::vector<Slice> arrayElements(std::string_view json, Slice array);
+
+/// Value of a key in the members of an object, if present
+std::optional<Slice> member(const std::vector<std::pair<std::string_view, Slice>> &members, std::string_view key);
+
+} // namespace audiotrip::skim
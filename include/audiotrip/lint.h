@@ -0,0 +1,41 @@
+/**
+ * Checks for the mistakes that make songs fail to load or render wrong: the parser only rejects what can't be shown at
+ * all, the rest is reported here.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Local includes
+#include "audiotrip/dtos.h"
+
+namespace audiotrip::lint {
+
+enum Severity {
+  SeverityWarning = 0, // Suspicious, but shown as the author probably meant
+  SeverityError,       // Not shown, shown wrong or crashes the viewer
+};
+
+struct Issue {
+  Severity severity;
+  std::string check; // Stable identifier, for filtering the reports
+  std::string choreography; // Name, empty for issues of the whole song
+  std::optional<size_t> event; // Index in the choreography
+  std::string message;
+};
+
+/// Checks a song, its choreographies must have their events loaded
+std::vector<Issue> check(const AudioTripSong &song);
+
+/// Parses and checks a file. Files that can't be parsed are reported as a single `parse` error.
+std::vector<Issue> checkFile(const std::string &path);
+
+/// One JSON object, without newlines
+std::string toJsonLine(const std::string &path, const Issue &issue);
+
+} // namespace audiotrip::lint
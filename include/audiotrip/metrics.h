@@ -0,0 +1,55 @@
+/**
+ * Difficulty metrics of a choreography: note density, how far the hands travel, how often they cross and how many
+ * barriers there are. Computed in a single pass over the events.
+ */
+
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Libraries
+#include "json/json.h"
+
+// Local includes
+#include "audiotrip/dtos.h"
+
+namespace audiotrip::metrics {
+
+/// Length of the rolling window of the peak density
+constexpr float DefaultWindowSeconds = 2.0f;
+
+struct HandMetrics {
+  size_t notes = 0; // Gems, drums, directional gems and ribbons
+  float travel = 0; // Meters, across the plane the hands move in, between events and along ribbons
+  float ribbonTravel = 0; // Part of the above along ribbons
+};
+
+struct Metrics {
+  size_t notes = 0; // Of both hands
+  size_t barriers = 0;
+  float durationSeconds = 0; // From the first event to the last one
+
+  float averageNps = 0; // Over the duration above
+  float peakNps = 0; // In the densest window
+  float peakNpsTime = 0; // Start of the densest window
+  float windowSeconds = DefaultWindowSeconds;
+
+  std::array<HandMetrics, 2> hands; // Left, right
+
+  size_t crossovers = 0; // Times the left hand moved to the right of the right one
+  size_t handSwitches = 0; // Consecutive notes played with different hands
+
+  float barriersPerMinute = 0;
+};
+
+/// `beats` must cover the events of the choreography, like the ones from `AudioTripSong::computeBeats()`
+Metrics compute(const Choreography &choreography,
+                const std::vector<Beat> &beats,
+                float windowSeconds = DefaultWindowSeconds);
+
+Json::Value toJson(const Metrics &metrics);
+
+} // namespace audiotrip::metrics
@@ -0,0 +1,84 @@
+/**
+ * Things in a choreography that occupy the same space: ribbons or hand paths going through barriers, notes inside
+ * other notes or ribbons. Every event is given a simple volume in world coordinates, the volumes are indexed in a
+ * bounding volume hierarchy and only the ones whose boxes overlap are tested against each other.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Libraries
+#include "json/json.h"
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "audiotrip/dtos.h"
+#include "utils/Bvh.h"
+#include "utils/ThreadPool.h"
+
+namespace audiotrip::overlaps {
+
+enum VolumeKind {
+  VolumeBarrier = 0, // The footprint of the barrier model, a trapezoid 4 cm thick
+  VolumeNote, // Gems, drums and directional gems, as spheres
+  VolumeRibbon, // Capsule between two slices of a ribbon mesh
+  VolumeHandPath, // Capsule along the path of a hand between notes, only tested against barriers
+};
+
+struct Volume {
+  VolumeKind kind;
+  std::optional<size_t> event; // Hand paths don't belong to one
+  int hand; // 0 left, 1 right, -1 for barriers
+
+  // Capsules from `a` to `b`, spheres have them equal. Barriers are placed by their event instead.
+  raylib::Vector3 a;
+  raylib::Vector3 b;
+  float radius;
+
+  BoundingBox bounds;
+};
+
+struct Overlap {
+  size_t first; // Volumes, the first one comes first in the list
+  size_t second;
+  float seconds; // Middle of the boxes overlap
+  BoundingBox bounds; // Where the boxes overlap
+};
+
+struct Options {
+  bool handPaths = true;
+  float handPathStep = 1.0f / 30.0f; // Seconds between the ends of each hand path capsule
+};
+
+struct Result {
+  std::vector<Volume> volumes;
+  std::vector<Overlap> overlaps; // By time
+  size_t candidates = 0; // Pairs of volumes whose boxes overlap
+  double buildSeconds = 0; // Volumes and hierarchy
+  double querySeconds = 0;
+};
+
+/// Volumes of the events of a choreography, and of the paths of the hands unless disabled
+std::vector<Volume> volumes(const Choreography &choreography,
+                            const std::vector<Beat> &beats,
+                            const Options &options = {});
+
+/// Whether two volumes are in each other's way. Volumes of the same event never are.
+bool intersect(const Choreography &choreography, const Volume &a, const Volume &b);
+
+/// Queries run in parallel on `pool`; the calling thread runs some of them, so it can be one of its workers.
+Result find(const Choreography &choreography,
+            const std::vector<Beat> &beats,
+            ThreadPool &pool,
+            const Options &options = {});
+
+/// Without the index, every pair is tested. For the benchmark.
+std::vector<Overlap> findBruteForce(const Choreography &choreography, const std::vector<Volume> &volumes);
+
+Json::Value toJson(const Result &result, const Overlap &overlap);
+
+} // namespace audiotrip::overlaps
@@ -0,0 +1,70 @@
+/**
+ * Checks the tempo sections of a song against its audio: the beat grid of each section is slid and stretched over the
+ * onset envelope of the audio, and the offset and tempo where the beats land on the strongest onsets are reported. Most
+ * charts that drift out of sync with the music have a wrong tempo or a grid that starts early or late.
+ *
+ * Sections are measured independently on the current grid. Beats carry over from one section to the next, so after a
+ * section with a wrong tempo the next ones can be too far off to be measured until it's fixed.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <vector>
+
+// Libraries
+#include "json/json.h"
+
+// Local includes
+#include "audio/OnsetDetector.h"
+#include "audiotrip/dtos.h"
+
+namespace audiotrip::tempo {
+
+struct Options {
+  float maxOffset = 0.1f; // Seconds, either way
+  float maxDrift = 0.01f; // Relative error of the beat length, either way
+  float driftStep = 0.0002f; // Of the first pass, the best drift is then refined down to moving a beat by `resolution`
+  float resolution = 0.001f; // Seconds, of the offsets tried
+  size_t minBeats = 8; // Sections with fewer beats in the audio aren't measured
+  float minConfidence = 6.0f; // Of the best fit, below which nothing is suggested
+  float tolerance = 0.01f; // Seconds the grid can be off anywhere in a section before a correction is suggested
+};
+
+struct Section {
+  size_t index; // In the tempo sections of the song
+  float bpm;
+  size_t beats = 0; // Within the audio
+  float firstBeat = 0; // Seconds, of the first and last of them on the current grid
+  float lastBeat = 0;
+
+  bool measured = false; // False if there are too few beats, nothing below is set then
+  float offset = 0; // Seconds the audio is late on the grid, at the first beat
+  float suggestedBpm = 0;
+  float suggestedFirstBeat = 0; // Where the first beat should be, with the tempo above
+  float maxError = 0; // Seconds, the most the current grid is off in the section
+  float confidence = 0; // Standard deviations of the best fit above the average of all the ones tried
+  float score = 0; // Average onset strength on the beats, best fit
+  float currentScore = 0; // Same, current grid
+  bool atLimit = false; // The best fit is at the edge of the offsets or drifts tried, the real one may be further
+  bool needsCorrection = false; // Confident and off by more than the tolerance
+};
+
+struct Report {
+  float audioSeconds = 0;
+  std::vector<Section> sections;
+};
+
+/// `beats` as computed by `AudioTripSong::computeBeats()`, which is what the events are placed on
+Report check(const AudioTripSong &song,
+             const std::vector<Beat> &beats,
+             const audio::OnsetEnvelope &envelope,
+             const Options &options = {});
+
+/// `scores[i] += envelope[i]`, the cross-correlation kernel. Public for the benchmark.
+void accumulate(float *scores, const float *envelope, size_t count);
+
+Json::Value toJson(const Report &report);
+
+} // namespace audiotrip::tempo
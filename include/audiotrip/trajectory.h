@@ -0,0 +1,120 @@
+/**
+ * Paths the hands have to follow to hit the notes of a choreography: splines through the gems and drums of each hand
+ * and along its ribbons, timed like the song. Sampled at a fixed rate to find where they have to move or change
+ * direction fastest.
+ */
+
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Libraries
+#include "json/json.h"
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "audiotrip/dtos.h"
+#include "splines/spline3d.h"
+#include "utils/ThreadPool.h"
+
+namespace audiotrip::trajectory {
+
+struct Options {
+  float sampleRate = 120; // Samples per second
+  float windowSeconds = 10; // Time sampled by each task
+  float speedThreshold = 4; // m/s, faster samples are part of a hot-spot
+  float accelerationThreshold = 60; // m/s²
+};
+
+/// Where a hand has to be at some time
+struct Keyframe {
+  float time;
+  raylib::Vector3 position;
+};
+
+/// Path of one hand, in the game's coordinates (X isn't inverted) and without the distance along the song
+class HandPath {
+public:
+  HandPath() = default;
+
+  /// Keyframes must be sorted by time, the ones at the same time as the next one are dropped
+  explicit HandPath(const std::vector<Keyframe> &keyframes);
+
+  /// Through the notes of one hand, ribbons are followed through all of their sub-positions
+  static HandPath of(const Choreography &choreography, const std::vector<Beat> &beats, bool rhs);
+
+  /// A path needs at least two keyframes
+  [[nodiscard]] bool empty() const { return splines.empty(); }
+
+  [[nodiscard]] float startTime() const { return times.front(); }
+  [[nodiscard]] float endTime() const { return times.back(); }
+
+  /// Clamped to the ends of the path
+  [[nodiscard]] raylib::Vector3 position(float seconds) const;
+
+  /// In m/s, zero outside of the path
+  [[nodiscard]] raylib::Vector3 velocity(float seconds) const;
+
+  /// Meters, from the arc lengths of the splines
+  [[nodiscard]] float length() const;
+
+  /// Heap bytes of the keyframe times and splines
+  [[nodiscard]] size_t bytes() const {
+    return times.capacity() * sizeof(float) + splines.capacity() * sizeof(splines::Spline3D);
+  }
+
+private:
+  std::vector<float> times; // Of the keyframes, spline i goes from keyframe i to keyframe i + 1
+  std::vector<splines::Spline3D> splines;
+
+  /// Spline at a time, and its parameter
+  [[nodiscard]] std::pair<size_t, float> locate(float seconds) const;
+};
+
+enum Quantity {
+  QuantitySpeed = 0,
+  QuantityAcceleration,
+};
+
+/// Consecutive samples of a hand over one of the thresholds
+struct HotSpot {
+  int hand; // 0 left, 1 right
+  Quantity quantity;
+  float start;
+  float end;
+  float peak;
+  float peakTime;
+};
+
+struct HandStats {
+  float length = 0;
+  float peakSpeed = 0;
+  float peakSpeedTime = 0;
+  float peakAcceleration = 0;
+  float peakAccelerationTime = 0;
+  size_t samples = 0;
+};
+
+struct Simulation {
+  Options options;
+  std::array<HandPath, 2> paths; // Left, right
+  std::array<HandStats, 2> hands;
+  std::vector<HotSpot> hotSpots; // By start time
+};
+
+/**
+ * Builds the paths of both hands and samples them. The time is split into windows that are sampled in parallel on
+ * `pool`; the calling thread runs tasks too, so it can be one of its workers.
+ */
+Simulation simulate(const Choreography &choreography,
+                    const std::vector<Beat> &beats,
+                    ThreadPool &pool,
+                    const Options &options = {});
+
+Json::Value toJson(const Simulation &simulation);
+
+} // namespace audiotrip::trajectory
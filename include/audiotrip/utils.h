@@ -2,4 +2,29 @@
 // Created by depau on 4/26/22.
 //
 
-#pragma once
\ No newline at end of file
+#pragma once
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Local includes
+#include "audiotrip/dtos.h"
+
+namespace audiotrip {
+
+/**
+ * Seconds at a fractional beat number, from the beats computed by `AudioTripSong::computeBeats()`. Beats past the end
+ * of the list keep the tempo of the last one.
+ */
+float beatSeconds(const std::vector<Beat> &beats, float beatNum);
+
+/// Fractional beat number of a time. A zero denominator is taken as no fraction.
+float beatNumber(const BeatTime &time);
+
+float eventSeconds(const std::vector<Beat> &beats, const BeatTime &time);
+
+/// Path of the audio of a song, which is next to its ATS file; empty if it has none
+std::string songAudioPath(const std::string &atsPath, const AudioTripSong &song);
+
+} // namespace audiotrip
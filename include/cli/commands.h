@@ -0,0 +1,51 @@
+/**
+ * Modes that work on songs without opening a window. They return the exit status of the program.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cli {
+
+/// Updates the library index of a directory, see `audiotrip::LibraryIndex`
+int indexLibrary(const std::string &directory);
+
+/// Checks files and directories of songs, printing the issues as JSON lines
+int lint(const std::vector<std::string> &inputs);
+
+/// Prints the difficulty metrics of each choreography of the songs, one JSON line per song
+int metrics(const std::vector<std::string> &inputs);
+
+/// Prints the hand path stats and hot-spots of each choreography of the songs, one JSON line per song
+int trajectories(const std::vector<std::string> &inputs);
+
+/// Prints the overlapping barriers, notes, ribbons and hand paths of the songs as JSON lines
+int overlaps(const std::vector<std::string> &inputs);
+
+/// Checks the tempo sections of the songs against their audio, printing the corrections as JSON lines
+int tempo(const std::vector<std::string> &inputs);
+
+/// Times the difficulty metrics on a generated choreography with `events` events
+int benchmarkMetrics(size_t events);
+
+/// Times building the overlap index and querying it on a generated choreography, against testing every pair
+int benchmarkOverlaps(size_t events);
+
+/// Times the hand path simulation on a generated choreography, and checks the speed of a hand at a constant velocity
+int benchmarkTrajectories(size_t events);
+
+/// Times the onset detection kernels, and checks click tracks of each of `lengths` seconds against a chart off tempo
+int benchmarkOnsets(const std::vector<float> &lengths);
+
+/**
+ * Plays `seconds` of a song on a simulated audio device with frames that jitter and stall, and checks that the camera
+ * clock stays within a frame of what is heard. The timing of every frame is written to `logPath` as CSV, if given.
+ */
+int benchmarkPlayback(float seconds, const std::optional<std::string> &logPath);
+
+} // namespace cli
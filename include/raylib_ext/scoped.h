@@ -23,11 +23,18 @@ public:
 
 class Mode3D {
 public:
-  explicit Mode3D(raylib::Camera &camera) { BeginMode3D(camera); }
+  explicit Mode3D(const Camera3D &camera) { BeginMode3D(camera); }
 
   ~Mode3D() { EndMode3D(); }
 };
 
+class TextureMode {
+public:
+  explicit TextureMode(const RenderTexture2D &target) { BeginTextureMode(target); }
+
+  ~TextureMode() { EndTextureMode(); }
+};
+
 class Matrix {
 public:
   Matrix() { rlgl::rlPushMatrix(); }
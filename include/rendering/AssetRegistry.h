@@ -0,0 +1,124 @@
+#pragma once
+
+// STL includes
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "rendering/binary_mesh.h"
+#include "rendering/obj_loader.h"
+#include "utils/MemoryReport.h"
+
+/**
+ * Loads every model, texture, shader and material exactly once and hands out shared handles to it.
+ *
+ * Assets are cached by path: as long as at least one handle is alive, asking for the same asset again returns the
+ * already loaded one. Once all handles are dropped the asset is unloaded; loading it again afterwards is counted as a
+ * reload so that it shows up in the report.
+ *
+ * Must only be used from the thread that owns the GL context.
+ */
+class AssetRegistry {
+public:
+  enum AssetKind {
+    AssetKindModel = 0,
+    AssetKindTexture,
+    AssetKindShader,
+    AssetKindMaterial,
+    AssetKindCount,
+  };
+
+  struct Stats {
+    size_t loads = 0; // Times the asset was actually loaded from disk
+    size_t hits = 0; // Times an already loaded asset was handed out
+    size_t bytes = 0; // Estimated CPU + GPU bytes of the loaded assets
+  };
+
+  /// Images decoded ahead of time, by path
+  using DecodedImages = std::unordered_map<std::string, raylib::Image>;
+
+  /// Loads an OBJ model, preferring its baked .atmesh version if there is an up-to-date one
+  std::shared_ptr<raylib::Model> model(const std::string &path);
+
+  /**
+   * Uploads an OBJ model that has already been parsed, i.e. on a worker thread. The diffuse maps found in `images` are
+   * uploaded as they are, the others are decoded here.
+   */
+  std::shared_ptr<raylib::Model> model(const std::string &path,
+                                       const obj::ObjData &data,
+                                       const DecodedImages &images = {});
+
+  /// Uploads the baked version of an OBJ model straight from the mapped file, like the above
+  std::shared_ptr<raylib::Model> model(const std::string &path,
+                                       const binmesh::MeshFile &baked,
+                                       const DecodedImages &images = {});
+
+  /// Decodes the diffuse maps of a model's materials. Doesn't touch the registry, so it can run on a worker thread.
+  static DecodedImages decodeMaterialImages(const std::vector<obj::MaterialData> &materials);
+  static DecodedImages decodeMaterialImages(const binmesh::MeshFile &baked);
+
+  std::shared_ptr<raylib::Texture2D> texture(const std::string &path, bool mipmaps = false);
+
+  /// Uploads an image that has already been decoded. `mipmaps` only affects the cache key, generate them beforehand.
+  std::shared_ptr<raylib::Texture2D> texture(const std::string &path, bool mipmaps, const Image &decoded);
+
+  std::shared_ptr<raylib::Shader> shader(const std::string &vsPath, const std::string &fsPath);
+
+  /// Compiles shader sources that have already been read from the given paths
+  std::shared_ptr<raylib::Shader> shader(const std::string &vsPath,
+                                         const std::string &fsPath,
+                                         const std::string &vsCode,
+                                         const std::string &fsCode);
+
+  /**
+   * Returns a material of a model that is loaded only for its materials. The handle keeps the model alive, and the
+   * material must not be modified (other than temporarily, like `DrawModel` does with the tint) since it is shared.
+   */
+  std::shared_ptr<Material> material(const std::string &modelPath, int materialIndex = 0);
+
+  [[nodiscard]] const Stats &stats(AssetKind kind) const { return kindStats[kind]; }
+
+  /// Number of distinct paths that have been loaded more than once
+  [[nodiscard]] size_t duplicateLoads() const;
+
+  void printReport(std::ostream &os) const;
+
+  /**
+   * Memory of the assets of a kind that are still loaded, unlike `Stats::bytes` which counts every load. Materials
+   * belong to a model and shaders are only counted as objects.
+   */
+  [[nodiscard]] MemoryReport::Usage memoryUsage(AssetKind kind) const;
+
+  static size_t textureBytes(const Texture &texture);
+  static size_t meshBytes(const Mesh &mesh);
+  static size_t modelBytes(const Model &model);
+
+  /// Same as `meshBytes()`, split into the arrays kept on the CPU and the uploaded buffers
+  static MemoryReport::Usage meshUsage(const Mesh &mesh);
+
+private:
+  std::unordered_map<std::string, std::weak_ptr<raylib::Model>> models;
+  std::unordered_map<std::string, std::weak_ptr<raylib::Texture2D>> textures;
+  std::unordered_map<std::string, std::weak_ptr<raylib::Shader>> shaders;
+  std::unordered_map<std::string, std::weak_ptr<Material>> materials;
+
+  Stats kindStats[AssetKindCount];
+  std::map<std::string, size_t> loadsPerPath;
+
+  [[nodiscard]] std::shared_ptr<raylib::Model> uploadModel(const obj::ObjData &data, const DecodedImages &images);
+  [[nodiscard]] std::shared_ptr<raylib::Model> uploadModel(const binmesh::MeshFile &baked,
+                                                           const DecodedImages &images);
+
+  [[nodiscard]] std::shared_ptr<raylib::Model> assembleModel(::Model &model,
+                                                             const std::vector<obj::MaterialData> &materials,
+                                                             const DecodedImages &images);
+
+  void recordLoad(AssetKind kind, const std::string &key, size_t bytes);
+  void recordHit(AssetKind kind) { kindStats[kind].hits++; }
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "rendering/event_placement.h"
+#include "rendering/obj_loader.h"
+#include "rendering/RenderQueue.h"
+#include "rendering/vertex_format.h"
+#include "utils/MemoryReport.h"
+#include "utils/ThreadPool.h"
+
+/**
+ * Streams the static geometry of a choreography (gems, drums, dirgems, barriers) in chunks along the track.
+ *
+ * All the models placed in a chunk are baked on a worker thread into a few meshes with per-vertex colors, one per
+ * material and transparency, so that a chunk takes a handful of draw calls no matter how dense it is. Chunks ahead of
+ * the camera are built in advance and the ones left behind are freed, so memory doesn't grow with the song length.
+ *
+ * Vertex colors are derived from a per-vertex tint role, so changing the colors only rewrites the color buffers of the
+ * loaded chunks. The other attributes can be quantized, see vertex_format.h.
+ */
+class ChunkStreamer {
+public:
+  /// Meshes of a chunk, in drawing order
+  enum Layer {
+    LayerLitOpaque = 0,
+    LayerTexturedOpaque,
+    LayerLitTransparent,
+    LayerTexturedTransparent,
+    LayerCount,
+  };
+
+  /// CPU-side geometry of each static model, mesh `i` using material `i` like in the loaded models
+  using Geometry = std::array<std::shared_ptr<const obj::ObjData>, placement::StaticModelCount>;
+  using Palette = std::array<Color, placement::TintRoleCount>;
+
+  struct ChunkSpec {
+    float zBegin = 0; // World Z range covered by the geometry of the chunk
+    float zEnd = 0;
+    std::vector<placement::Placement> placements;
+  };
+
+  struct Stats {
+    size_t chunks = 0; // Chunks in the choreography
+    size_t loaded = 0;
+    size_t building = 0;
+    size_t meshes = 0; // Meshes of the loaded chunks
+    size_t vertices = 0; // Vertices of the loaded chunks
+    size_t bytes = 0; // Estimated GPU bytes of the loaded chunks
+    size_t drawCalls = 0; // Meshes queued last frame
+  };
+
+  /// How far ahead of the visible range chunks are built
+  static constexpr float PrefetchDistance = 60.0f;
+
+  /// Chunks finished by the workers that are uploaded per frame, to avoid stalls when jumping around
+  static constexpr size_t MaxUploadsPerFrame = 4;
+
+  ChunkStreamer(ThreadPool &pool, Geometry geometry) : pool(pool), geometry(std::move(geometry)) {}
+
+  /// Replaces the streamed chunks, i.e. when another choreography is selected. Loaded and pending chunks are dropped.
+  void reset(std::vector<ChunkSpec> specs);
+
+  /**
+   * Switches the vertex format of the chunk meshes, rebuilding the loaded ones. Quantized meshes are drawn with the
+   * dequantization uniforms at the given locations of the lit and textured material shaders.
+   */
+  void setVertexFormat(vertex_format::Format format,
+                       vertex_format::ShaderLocations litLocations,
+                       vertex_format::ShaderLocations texturedLocations);
+
+  /// Recolors the loaded chunks if the palette changed
+  void setPalette(const Palette &newPalette);
+
+  /// Frees the chunks out of range, uploads the ones that are ready and starts building the ones coming up
+  void update(float cameraZ);
+
+  /// Queues the visible chunk meshes, the queue takes care of drawing the transparent layers last and far to near
+  void enqueue(RenderQueue &queue, const Material &lit, const Material &textured);
+
+  [[nodiscard]] Stats stats() const;
+
+  /// Placements of all the chunks and what's kept on the CPU of the loaded ones, and the GPU buffers of the loaded ones
+  [[nodiscard]] MemoryReport::Usage memoryUsage() const;
+
+private:
+  struct BuiltMesh {
+    Layer layer;
+    std::vector<float> vertices;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+    std::vector<uint16_t> indices;
+    std::vector<uint8_t> roles;
+    vertex_format::QuantizedAttributes quantized; // Replaces the float attributes with the quantized format
+  };
+
+  struct LoadedMesh {
+    Layer layer;
+    raylib::Mesh mesh;
+    std::vector<uint8_t> roles;
+    vertex_format::Format format;
+    vertex_format::Dequantization dequantization;
+  };
+
+  struct LoadedChunk {
+    std::vector<LoadedMesh> meshes;
+    size_t bytes = 0;
+  };
+
+  using Built = std::vector<BuiltMesh>;
+
+  ThreadPool &pool;
+  Geometry geometry;
+  Palette palette{};
+  vertex_format::Format format = vertex_format::FormatFloat;
+  std::array<vertex_format::ShaderLocations, 2> locations; // Lit, textured
+
+  std::vector<std::shared_ptr<const ChunkSpec>> specs;
+  std::map<size_t, std::future<Built>> building;
+  std::map<size_t, LoadedChunk> loaded; // Ordered by index, which is also the Z order
+  float visibleBegin = 0;
+  float visibleEnd = 0;
+  size_t drawCalls = 0;
+
+  // Scratch buffers, kept so that the frames that stream chunks in or recolor them don't allocate
+  std::vector<size_t> missing;
+  std::vector<unsigned char> recolored;
+
+  static Built build(const Geometry &geometry, const ChunkSpec &spec, vertex_format::Format format);
+
+  LoadedChunk upload(Built &built) const;
+
+  void colorize(Layer layer, const std::vector<uint8_t> &roles, std::vector<unsigned char> &colors) const;
+};
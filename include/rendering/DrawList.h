@@ -0,0 +1,48 @@
+#pragma once
+
+// STL includes
+#include <cstdint>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "audiotrip/dtos.h"
+
+/**
+ * Everything the render thread needs to draw a choreography frame, computed ahead of time by the frame preparation
+ * stage. Once handed over to the render thread a list is only read from.
+ *
+ * A list is prepared with the camera of the previous frame and drawn with the current one, so it covers a margin
+ * around the render distance for the camera to move into.
+ */
+struct DrawList {
+  struct BeatLabel {
+    int number;
+    float distance;
+  };
+
+  struct Ribbon {
+    const audiotrip::ChoreoEvent *event;
+    uint64_t meshKey;
+    Matrix transform;
+    Vector3 center;
+    Color tint;
+  };
+
+  /// Choreography the list was prepared for, lists for another one must not be drawn
+  const audiotrip::Choreography *choreo = nullptr;
+
+  std::vector<BeatLabel> beatLabels;
+  std::vector<Ribbon> ribbons;
+
+  float prepareSeconds = 0; // Time spent preparing the list, for the debug overlay
+
+  /// Empties the list, keeping the allocated storage
+  void clear() {
+    choreo = nullptr;
+    beatLabels.clear();
+    ribbons.clear();
+  }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "rendering/RenderQueue.h"
+#include "splines/spline3d.h"
+#include "utils/MemoryReport.h"
+
+/**
+ * Ribbons extruded in the vertex shader (ribbon.vs in the shader directories) instead of on the CPU.
+ *
+ * All the ribbons of a hand share one static grid mesh: MaxSegments * SlicesPerSegment + 1 slices of the slice shape,
+ * each vertex carrying its spline parameter and shape texture coordinate, plus the two cap centers. Each ribbon only
+ * uploads the Bezier control points of its spline segments as uniforms, and the shader evaluates the position and the
+ * tangent to sweep the shape along them. Triangles are ordered caps first, then segment by segment, so that only the
+ * segments a ribbon has are drawn.
+ */
+class GpuRibbons {
+public:
+  /// Must match the uniform array sizes in ribbon.vs
+  static constexpr size_t MaxSegments = 32;
+  static constexpr size_t SlicesPerSegment = 16;
+
+  /// `sliceShape` is the unrotated ribbon cross-section, `baseMaterial` provides the texture
+  GpuRibbons(const std::vector<raylib::Vector3> &sliceShape,
+             std::shared_ptr<raylib::Shader> shader,
+             std::shared_ptr<Material> baseMaterial);
+
+  GpuRibbons(const GpuRibbons &) = delete;
+  GpuRibbons &operator=(const GpuRibbons &) = delete;
+
+  /// Stores the splines of a ribbon. Returns false if it has too many segments, in which case it must be drawn from a
+  /// CPU-generated mesh.
+  bool add(uint64_t key, std::span<const splines::Spline3D> splines, bool rhs, float textureScale);
+
+  [[nodiscard]] bool contains(uint64_t key) const { return ribbons.contains(key); }
+
+  /// Queues a ribbon previously added with `add()`
+  void submit(RenderQueue &queue, uint64_t key, const Matrix &transform, Vector3 center, Color tint) const;
+
+  void clear() { ribbons.clear(); }
+
+  [[nodiscard]] size_t count() const { return ribbons.size(); }
+
+  /// Uniform data of the stored ribbons plus the grid meshes
+  [[nodiscard]] size_t bytes() const;
+
+  /// Same as `bytes()`, split into the stored ribbons and the grids on the CPU and the grids on the GPU
+  [[nodiscard]] MemoryReport::Usage memoryUsage() const;
+
+private:
+  struct Ribbon {
+    // Control points of each segment, one vec4 per segment like Spline3D's xb, yb and zb
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::array<float, 4> params; // Segment count, texture scale
+    bool rhs;
+    std::array<RenderQueue::Uniform, 4> uniforms;
+  };
+
+  std::shared_ptr<raylib::Shader> shader;
+  std::shared_ptr<Material> baseMaterial;
+  Material material;
+
+  // Indexed by whether the grid is for the right hand, since the shape is tilted differently
+  std::array<raylib::Mesh, 2> grids;
+  int trianglesPerSegment = 0;
+  int capTriangles = 0;
+
+  int splineXLoc;
+  int splineYLoc;
+  int splineZLoc;
+  int paramsLoc;
+
+  std::unordered_map<uint64_t, Ribbon> ribbons;
+
+  static raylib::Mesh createGrid(const std::vector<raylib::Vector3> &sliceShape);
+};
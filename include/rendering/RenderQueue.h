@@ -0,0 +1,136 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+/**
+ * Per-frame queue of mesh draws, sorted to minimize GPU state changes before being executed.
+ *
+ * Each command gets a packed 64-bit sort key:
+ *
+ *   opaque:      pass (2) | shader (6) | texture (10) | mesh (16) | depth (24)
+ *   transparent: pass (2) | inverted depth (24) | shader (6) | texture (10) | mesh (16)
+ *
+ * so that opaque geometry is grouped by state and drawn front to back within each group (for early-Z), while
+ * transparent geometry is drawn back to front regardless of state. Shaders, textures and meshes get small ids in order
+ * of first use in the frame.
+ *
+ * Execution binds a shader, texture or vertex array only when it differs from the previous command's, instead of once
+ * per draw like `DrawMesh()` does.
+ */
+class RenderQueue {
+public:
+  enum Pass {
+    PassOpaque = 0,
+    PassTransparent,
+  };
+
+  struct Stats {
+    size_t commands = 0;
+    size_t drawCalls = 0;
+    size_t shaderBinds = 0;
+    size_t textureBinds = 0;
+    size_t vertexArrayBinds = 0;
+    size_t stateChanges = 0; // Depth write toggles between passes
+  };
+
+  /// Shader uniform set right before a draw. The value must stay valid until `execute()`.
+  struct Uniform {
+    int location;
+    int type; // ShaderUniformDataType
+    int count;
+    const void *value;
+  };
+
+  /// Part of a mesh to draw, in indices for indexed meshes and in vertices otherwise. A zero count draws everything.
+  struct Range {
+    int first;
+    int count;
+  };
+
+  /// Depth beyond which sort keys saturate
+  static constexpr float MaxDepth = 1000.0f;
+
+  /// Starts a new frame. Depth is measured from `eye`.
+  void begin(Vector3 eye);
+
+  /**
+   * Queues a mesh draw. `center` is the world position used for depth sorting, since meshes may be baked in world
+   * space with an identity transform. The tint multiplies the material diffuse color, like `DrawModel()` does.
+   *
+   * `uniforms` are per-draw shader parameters. `range` selects part of the mesh, for meshes that share a vertex array
+   * (see `RibbonPool`) or that only draw some of their triangles (see `GpuRibbons`); meshes without vertex array
+   * objects are always drawn whole.
+   */
+  void submit(Pass pass,
+              const Mesh &mesh,
+              const Material &material,
+              const Matrix &transform,
+              Vector3 center,
+              Color tint = WHITE,
+              std::span<const Uniform> uniforms = {},
+              Range range = { 0, 0 });
+
+  /// Sorts and draws the queued commands. Must be called in 3D mode.
+  void execute();
+
+  [[nodiscard]] const Stats &stats() const { return lastStats; }
+
+private:
+  struct Command {
+    const Mesh *mesh;
+    const Material *material;
+    Matrix transform;
+    Color tint;
+    uint32_t firstUniform;
+    uint32_t uniformCount;
+    Range range;
+  };
+
+  Vector3 eye{};
+  std::vector<Command> commands;
+  std::vector<Uniform> uniforms;
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> order;
+
+  // Radix sort scratch buffers, kept across frames
+  std::vector<uint64_t> scratchKeys;
+  std::vector<uint32_t> scratchOrder;
+
+  /**
+   * Ids of the shaders, textures or meshes used in the frame. Entries are kept across frames and stamped with the frame
+   * they were last used in, so that a steady frame doesn't allocate map nodes; stale ones are dropped all at once when
+   * they outnumber the used ones by too much.
+   */
+  template<typename K>
+  struct IdTable {
+    struct Entry {
+      uint64_t frame;
+      uint64_t id;
+    };
+    std::unordered_map<K, Entry> entries;
+    uint64_t used = 0; // In the current frame
+
+    uint64_t idFor(const K &key, uint64_t frame, uint64_t max);
+
+    void begin();
+  };
+
+  uint64_t frame = 0;
+  IdTable<unsigned int> shaderIds;
+  IdTable<unsigned int> textureIds;
+  IdTable<const Mesh *> meshIds;
+
+  Stats lastStats;
+
+  void sort();
+
+  void setUniforms(const Command &command) const;
+};
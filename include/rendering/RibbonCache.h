@@ -0,0 +1,115 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+// Local includes
+#include "audiotrip/dtos.h"
+#include "rendering/binary_mesh.h"
+#include "rendering/ribbon_helpers.h"
+#include "utils/MemoryReport.h"
+
+/**
+ * On-disk cache of generated ribbon meshes, so that reopening a song doesn't fit the splines and extrude the ribbons
+ * all over again.
+ *
+ * Each song gets a single pack file, memory-mapped while the song is open:
+ *
+ *   PackHeader
+ *   PackEntry[entryCount]          sorted by key
+ *   for each entry:
+ *     float vertices[vertexCount * 3], normals[vertexCount * 3], texcoords[vertexCount * 2]
+ *
+ * Ribbons generated on a miss are kept in memory and the pack is rewritten with them when the song is closed. Packs
+ * are capped in size, and the least recently written ones are deleted when the cache directory grows too large.
+ */
+class RibbonCache {
+public:
+  /// Bump whenever the generated ribbons change, so that stale packs are thrown away
+  static constexpr uint32_t GeneratorVersion = 2;
+
+  static constexpr size_t MaxPackBytes = 64 * 1024 * 1024;
+  static constexpr size_t MaxCacheBytes = 256 * 1024 * 1024;
+
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t packEntries = 0; // Entries in the pack file when the song was opened
+  };
+
+  /// Opens the pack of the song at `songPath` in `directory`, which is created if needed
+  RibbonCache(std::filesystem::path directory, const std::string &songPath, std::ostream &log);
+
+  /// Writes the pack if ribbons were added
+  ~RibbonCache();
+
+  RibbonCache(const RibbonCache &) = delete;
+  RibbonCache &operator=(const RibbonCache &) = delete;
+
+  /**
+   * Hash of everything a ribbon mesh is generated from. `subTimes` are the times of the sub-positions relative to the
+   * first one, which is what the tempo map contributes.
+   */
+  static uint64_t key(const audiotrip::ChoreoEvent &event, std::span<const float> subTimes, int gemSpeed);
+
+  std::optional<ribbons::RibbonGeometry> find(uint64_t key);
+
+  void store(uint64_t key, const ribbons::RibbonGeometry &geometry);
+
+  [[nodiscard]] const Stats &stats() const { return counters; }
+
+  /// Ribbons waiting to be written and the mapped pack, counted whole although only the pages read are resident
+  [[nodiscard]] MemoryReport::Usage memoryUsage() const;
+
+  /// Per-user cache directory, if the platform has a persistent one
+  static std::optional<std::filesystem::path> defaultDirectory();
+
+private:
+  struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t generatorVersion;
+    uint32_t entryCount;
+  };
+
+  struct PackEntry {
+    uint64_t key;
+    uint64_t offset;
+    uint32_t vertexCount;
+    uint32_t reserved;
+  };
+
+  static_assert(sizeof(PackHeader) == 16);
+  static_assert(sizeof(PackEntry) == 24);
+
+  std::filesystem::path directory;
+  std::filesystem::path packPath;
+  std::ostream &log;
+
+  std::unique_ptr<binmesh::MappedFile> pack;
+  const PackEntry *entries = nullptr;
+  size_t entryCount = 0;
+
+  std::map<uint64_t, ribbons::RibbonGeometry> added;
+  size_t addedBytes = 0;
+  Stats counters;
+
+  void open();
+
+  [[nodiscard]] const PackEntry *findEntry(uint64_t key) const;
+
+  [[nodiscard]] static ribbons::RibbonGeometry read(const uint8_t *data, uint32_t vertexCount);
+
+  void write();
+
+  void cleanup();
+};
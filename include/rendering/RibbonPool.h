@@ -0,0 +1,110 @@
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "rendering/RenderQueue.h"
+#include "rendering/vertex_format.h"
+
+/**
+ * Sub-allocates ribbon meshes in a few large vertex arrays, instead of giving each ribbon its own, so that all the
+ * ribbons in a block are drawn with a single vertex array bind and no per-ribbon buffer objects.
+ *
+ * Ribbon meshes aren't indexed, so a ribbon is just a range of vertices drawn with a first-vertex offset. Each block
+ * keeps a free list of vertex ranges, merged with their neighbors when freed. When no free range is large enough but a
+ * block has enough free space overall, its ranges are moved to the start of the buffers. The blocks keep a CPU copy of
+ * their vertices for that, since rlgl can't copy between buffers.
+ */
+class RibbonPool {
+public:
+  /// Vertices per block, larger ribbons can't be pooled
+  static constexpr int BlockVertices = 1 << 18;
+
+  using Id = uint32_t;
+
+  struct Stats {
+    size_t blocks = 0;
+    size_t capacity = 0; // Vertices
+    size_t used = 0;
+    size_t allocations = 0;
+    size_t freeRanges = 0;
+    size_t largestFreeRange = 0;
+    size_t compactions = 0;
+    size_t bytes = 0; // GPU bytes of the blocks
+
+    [[nodiscard]] float occupancy() const {
+      return capacity > 0 ? static_cast<float>(used) / static_cast<float>(capacity) : 0.0f;
+    }
+
+    /// Share of the free space that is not in the largest free range
+    [[nodiscard]] float fragmentation() const {
+      size_t free = capacity - used;
+      return free > 0 ? 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(free) : 0.0f;
+    }
+  };
+
+  /// Where a pooled ribbon is drawn from
+  struct Draw {
+    const Mesh *mesh;
+    RenderQueue::Range range;
+  };
+
+  explicit RibbonPool(vertex_format::Format format) : format(format) {}
+
+  RibbonPool(const RibbonPool &) = delete;
+  RibbonPool &operator=(const RibbonPool &) = delete;
+
+  /**
+   * Copies a ribbon mesh into the pool. `data` holds the attributes in the order and layout of
+   * `vertex_format::attributes()`. Returns nothing if the ribbon is too large for a block.
+   */
+  std::optional<Id> add(int vertexCount, std::array<const void *, 3> data);
+
+  /// Frees the range of a ribbon, the id can be reused afterwards
+  void remove(Id id);
+
+  [[nodiscard]] Draw draw(Id id) const;
+
+  [[nodiscard]] vertex_format::Format vertexFormat() const { return format; }
+
+  [[nodiscard]] Stats stats() const;
+
+private:
+  struct Block {
+    raylib::Mesh mesh;
+    std::array<std::vector<uint8_t>, 3> vertices; // CPU copy of each attribute buffer
+    std::map<int, int> freeRanges; // First vertex -> vertex count
+    int used = 0;
+  };
+
+  struct Allocation {
+    uint32_t block;
+    int first;
+    int count; // Zero if the id is free
+  };
+
+  vertex_format::Format format;
+  std::vector<std::unique_ptr<Block>> blocks; // Pointers, so that the meshes handed out stay put
+  std::vector<Allocation> allocations;
+  std::vector<Id> freeIds;
+  size_t compactions = 0;
+
+  /// Takes `count` vertices from the smallest free range that fits
+  static std::optional<int> allocate(Block &block, int count);
+
+  static void release(Block &block, int first, int count);
+
+  void compact(uint32_t blockIndex);
+
+  void write(Block &block, int first, int count, std::array<const void *, 3> data) const;
+};
@@ -16,18 +16,39 @@ namespace rlgl {
 
 // Local includes
 #include "common_defs.h"
+#include "utils/MemoryReport.h"
 
 class SkyBox {
 public:
-  raylib::Shader shader{ TextFormat("resources/shaders/glsl%i/skybox.vs", GLSL_VERSION),
-                         TextFormat("resources/shaders/glsl%i/skybox.fs", GLSL_VERSION) };
+  raylib::Shader shader;
   raylib::Model skybox{ raylib::Mesh::Cube(100, 100, 100) };
 
   std::unique_ptr<raylib::TextureCubemap> texture;
 
   SkyBox(const std::string &imagePath);
 
+  /**
+   * @param vsCode vertex shader source
+   * @param fsCode fragment shader source
+   * @param faces cubemap faces, as returned by `ExtractFaces()`
+   */
+  SkyBox(const std::string &vsCode, const std::string &fsCode, const raylib::Image &faces);
+
+  /**
+   * Rearranges the faces of a cubemap image in any of the supported layouts into a vertical line, so that the GPU
+   * upload doesn't need to do any more work. Only touches CPU memory: it is safe to call on a worker thread.
+   */
+  static raylib::Image ExtractFaces(const raylib::Image &image);
+
   void LoadTexture(const std::string &imagePath);
 
+  void LoadTexture(const raylib::Image &faces);
+
   void Draw();
-};
\ No newline at end of file
+
+  /// The cubemap, all six faces, and the cube mesh
+  [[nodiscard]] MemoryReport::Usage MemoryUsage() const;
+
+private:
+  void SetupShader();
+};
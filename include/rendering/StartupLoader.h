@@ -0,0 +1,93 @@
+#pragma once
+
+// STL includes
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Local includes
+#include "utils/ThreadPool.h"
+
+/**
+ * Runs the CPU-side part of the startup asset loading (decoding, parsing...) on a thread pool, while the main thread
+ * keeps drawing the splash screen and only performs the GPU uploads as soon as each asset is ready.
+ *
+ * Each job returns a "finisher" which is run on the main thread by `poll()`.
+ */
+class StartupLoader {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Finisher = std::function<void()>;
+
+  /// Timings of the CPU stages of a job, recorded on the worker thread
+  class Stages {
+  public:
+    template<typename F>
+    auto time(const char *stage, F &&f) {
+      auto start = Clock::now();
+      if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+        f();
+        record(stage, start);
+      } else {
+        auto result = f();
+        record(stage, start);
+        return result;
+      }
+    }
+
+  private:
+    friend class StartupLoader;
+    std::vector<std::pair<std::string, double>> entries;
+
+    void record(const char *stage, Clock::time_point start) {
+      entries.emplace_back(stage, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+  };
+
+  using Work = std::function<Finisher(Stages &)>;
+
+  explicit StartupLoader(ThreadPool &pool) : pool(pool), started(Clock::now()) {}
+
+  /// Waits for the jobs still running, since they reference this loader
+  ~StartupLoader();
+
+  void add(const std::string &asset, Work work);
+
+  /// Runs the finishers of the jobs that are ready. Returns true once every job has been finished.
+  bool poll();
+
+  [[nodiscard]] bool finished() const { return finishedJobs == jobs.size(); }
+
+  [[nodiscard]] float progress() const {
+    return jobs.empty() ? 1.0f : static_cast<float>(finishedJobs) / static_cast<float>(jobs.size());
+  }
+
+  /// Records a stage that ran on the main thread, i.e. window creation
+  void recordMainThreadStage(const std::string &stage, double ms) { mainThreadStages.emplace_back(stage, ms); }
+
+  void printReport(std::ostream &os) const;
+
+private:
+  struct Job {
+    std::string asset;
+    Stages stages;
+    std::future<Finisher> future;
+    double uploadMs = 0;
+    bool done = false;
+  };
+
+  ThreadPool &pool;
+  Clock::time_point started;
+  Clock::time_point completed;
+
+  // Deque so that workers can keep pointers to the jobs while new ones are added
+  std::deque<Job> jobs;
+  size_t finishedJobs = 0;
+  std::vector<std::pair<std::string, double>> mainThreadStages;
+};
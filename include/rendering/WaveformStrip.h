@@ -0,0 +1,79 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "audio/WaveformPyramid.h"
+#include "utils/MemoryReport.h"
+
+/**
+ * Draws the waveform of the song as a strip on the floor, along the track. The strip is split into pieces by their
+ * distance from the camera, and each piece uses the pyramid level whose bins are about one pixel long on screen.
+ *
+ * Levels are uploaded in pages of `PageBins` bins, one texture each, as they become visible; the least recently drawn
+ * ones are freed once there are more than `MaxPages`.
+ */
+class WaveformStrip {
+public:
+  static constexpr size_t PageBins = 1024;
+  static constexpr int PageHeight = 64;
+  static constexpr size_t MaxPages = 64;
+
+  /// Pages uploaded per frame at most, the others are drawn once they are uploaded in the next frames
+  static constexpr size_t UploadsPerFrame = 4;
+
+  explicit WaveformStrip(audio::WaveformPyramid pyramid);
+
+  /// Frees the textures, so it must be destroyed while the GL context is alive
+  ~WaveformStrip();
+
+  WaveformStrip(const WaveformStrip &) = delete;
+  WaveformStrip &operator=(const WaveformStrip &) = delete;
+
+  /**
+   * Draws the strip within the render distance of the camera, between `x` and `x + width` on the floor. Audio time `t`
+   * is at `t * metersPerSecond` along the track, like the events.
+   */
+  void draw(const Camera3D &camera, float metersPerSecond, float x, float width, Color tint);
+
+  [[nodiscard]] const audio::WaveformPyramid &waveform() const { return pyramid; }
+
+  [[nodiscard]] size_t residentPages() const { return pages.size(); }
+
+  /// The pyramid and the scratch buffers on the CPU, the resident pages on the GPU
+  [[nodiscard]] MemoryReport::Usage memoryUsage() const;
+
+private:
+  struct Page {
+    unsigned int texture;
+    uint64_t lastDrawn; // Frame
+  };
+
+  audio::WaveformPyramid pyramid;
+  std::unordered_map<uint64_t, Page> pages; // By level and index, see pageKey()
+  uint64_t frame = 0;
+  size_t uploads = 0; // This frame
+
+  // Scratch buffers of the uploads and evictions, kept across frames
+  std::vector<uint8_t> pixels;
+  std::vector<std::pair<uint64_t, uint64_t>> byAge; // Last drawn, key
+
+  static uint64_t pageKey(size_t level, size_t index) { return static_cast<uint64_t>(level) << 32 | index; }
+
+  /// Finest level whose bins are at least as long as a pixel at `distance` from the camera
+  [[nodiscard]] size_t levelAt(const Camera3D &camera, float metersPerSecond, float distance) const;
+
+  /// Texture of a page, uploaded if there are uploads left this frame; 0 if it isn't available yet
+  unsigned int texture(size_t level, size_t index);
+
+  /// Frees the least recently drawn pages that weren't drawn this frame, down to `MaxPages`
+  void evict();
+};
@@ -0,0 +1,124 @@
+/**
+ * Compact binary mesh format (.atmesh), baked at build time from the OBJ models by `atmesh_bake`.
+ *
+ * Layout (little endian, every section 4-byte aligned so that it can be used straight from a memory-mapped file):
+ *
+ *   FileHeader
+ *   MaterialRecord[materialCount], each followed by its diffuse map path, padded to 4 bytes
+ *   for each mesh:
+ *     MeshRecord
+ *     Vertex[vertexCount]              interleaved position, normal, texcoord
+ *     uint16_t[indexCount]             padded to 4 bytes
+ *
+ * Like `obj::ObjData`, mesh `i` uses material `i`.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Local includes
+#include "rendering/obj_loader.h"
+
+namespace binmesh {
+
+constexpr char Magic[4] = { 'A', 'T', 'M', 'S' };
+constexpr uint32_t Version = 1;
+constexpr const char *Extension = ".atmesh";
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t materialCount;
+  uint32_t meshCount;
+};
+
+struct MaterialRecord {
+  float diffuse[3];
+  uint32_t diffuseMapLength;
+};
+
+struct MeshRecord {
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  float boundsMin[3];
+  float boundsMax[3];
+};
+
+struct Vertex {
+  float position[3];
+  float normal[3];
+  float texcoord[2];
+};
+
+static_assert(sizeof(FileHeader) == 16);
+static_assert(sizeof(MaterialRecord) == 16);
+static_assert(sizeof(MeshRecord) == 32);
+static_assert(sizeof(Vertex) == 32);
+
+/// Read-only view of a file, memory-mapped where supported
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  [[nodiscard]] const uint8_t *data() const { return bytes; }
+  [[nodiscard]] size_t size() const { return length; }
+
+private:
+  const uint8_t *bytes = nullptr;
+  size_t length = 0;
+  bool mapped = false;
+  std::vector<uint8_t> fallback;
+};
+
+struct MeshView {
+  const MeshRecord *record;
+  const Vertex *vertices;
+  const uint16_t *indices;
+};
+
+struct MaterialView {
+  const MaterialRecord *record;
+  std::string diffuseMap;
+};
+
+/// Parsed view over a mapped .atmesh file. Pointers are valid as long as the MeshFile is alive.
+class MeshFile {
+public:
+  /**
+   * Maps the mesh baked from the OBJ model at `objPath`, its diffuse maps are resolved next to that model. Throws
+   * std::runtime_error if the file can't be read or is malformed.
+   */
+  MeshFile(const std::string &path, const std::string &objPath);
+
+  std::vector<MaterialView> materials;
+  std::vector<MeshView> meshes;
+
+  /// Converts the data back to separate arrays, i.e. for code that transforms the vertices on the CPU
+  [[nodiscard]] obj::ObjData toObjData() const;
+
+private:
+  std::unique_ptr<MappedFile> file;
+};
+
+/// Serializes a parsed OBJ model. Diffuse map paths must already be relative to the directory of the OBJ file.
+std::vector<uint8_t> serialize(const obj::ObjData &data);
+
+/**
+ * Returns the path of the baked version of an OBJ model if there is one that isn't older than the OBJ file itself. It
+ * is looked up at the same relative path in the directory the build bakes the models into. The OBJ file may be missing
+ * (the web build only ships the baked ones).
+ */
+std::optional<std::string> bakedPathFor(const std::string &objPath);
+
+} // namespace binmesh
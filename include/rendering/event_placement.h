@@ -0,0 +1,109 @@
+/**
+ * Where the static models of a choreography event (everything but the ribbon bodies) end up in the world. These
+ * models never move, so their transforms can be computed once instead of being re-derived with the rlgl matrix stack
+ * every frame.
+ */
+
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "audiotrip/dtos.h"
+
+namespace placement {
+
+enum StaticModel {
+  StaticModelBarrier = 0,
+  StaticModelGem,
+  StaticModelGemTrail,
+  StaticModelDrum,
+  StaticModelDirGem,
+  StaticModelCount,
+};
+
+/// Which of the user-selectable colors a model is tinted with
+enum TintRole {
+  TintRoleLeft = 0,
+  TintRoleRight,
+  TintRoleBarrier,
+  TintRoleCount,
+};
+
+struct Placement {
+  StaticModel model;
+  TintRole role;
+  bool transparent; // Drawn half transparent, like the gem trails
+  Matrix transform;
+  Matrix normal; // Inverse transpose of the transform, without translation
+};
+
+/**
+ * Translations and rotations making up a transform, applied like the rlgl matrix stack does: each operation is applied
+ * before the ones that came earlier.
+ */
+class TransformOps {
+public:
+  /// Longest chain used by the event models (dirgems)
+  static constexpr size_t MaxOps = 5;
+
+  TransformOps &translate(float x, float y, float z);
+
+  TransformOps &rotate(float angleDeg, float x, float y, float z);
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  /// Matrix of a single operation
+  [[nodiscard]] Matrix op(size_t i) const;
+
+private:
+  struct Op {
+    bool rotation;
+    float angleDeg;
+    Vector3 v;
+  };
+
+  std::array<Op, MaxOps> ops{};
+  uint8_t count = 0;
+};
+
+/**
+ * Collects the static models of many events and then composes all of their transforms at once, with the batched
+ * matrix kernels, instead of one chain of matrix products per model.
+ */
+class PlacementBatch {
+public:
+  /**
+   * Adds the static models making up an event placed at `distance`, with the same transforms that used to be built
+   * with the rlgl matrix stack. `ribbonEnd` is the position of the last ribbon gem relative to the first one, it is
+   * only used for ribbons.
+   */
+  void placeEvent(const audiotrip::ChoreoEvent &event, float distance, Vector3 ribbonEnd);
+
+  /// Number of models placed so far
+  [[nodiscard]] size_t size() const { return pending.size(); }
+
+  /// Composes the transforms and normal matrices of all the models placed so far, in placement order
+  [[nodiscard]] std::vector<Placement> compose() const;
+
+private:
+  struct Pending {
+    StaticModel model;
+    TintRole role;
+    bool transparent;
+    TransformOps ops;
+  };
+
+  std::vector<Pending> pending;
+
+  void placeGem(TransformOps ops, bool rhs, TintRole role);
+};
+
+} // namespace placement
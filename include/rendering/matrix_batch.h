@@ -0,0 +1,53 @@
+/**
+ * Batched 4x4 matrix kernels over structure-of-arrays storage. Each kernel is a set of plain loops over contiguous
+ * float arrays with no aliasing, which compilers turn into SIMD code for the target (SSE/AVX/NEON natively, wasm
+ * SIMD on the web) without intrinsics.
+ */
+
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+namespace matrix_batch {
+
+/**
+ * Array of matrices where element `k` of every matrix is stored contiguously. Elements are numbered like raylib's
+ * `m0`...`m15` fields.
+ */
+class MatrixArray {
+public:
+  explicit MatrixArray(size_t size = 0) { resize(size); }
+
+  void resize(size_t newSize);
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  void set(size_t i, const Matrix &matrix);
+
+  [[nodiscard]] Matrix get(size_t i) const;
+
+  float *operator[](size_t element) { return elements[element].data(); }
+
+  const float *operator[](size_t element) const { return elements[element].data(); }
+
+private:
+  std::array<std::vector<float>, 16> elements;
+  size_t count = 0;
+};
+
+/// `result[i] = MatrixMultiply(left[i], right[i])` for every matrix. `result` must not be one of the inputs.
+void multiply(const MatrixArray &left, const MatrixArray &right, MatrixArray &result);
+
+/**
+ * `result[i] = MatrixTranspose(MatrixInvert(transforms[i]))` restricted to the upper 3x3 part, i.e. the matrix that
+ * transforms normals, with no translation. `result` must not be `transforms`.
+ */
+void normalMatrices(const MatrixArray &transforms, MatrixArray &result);
+
+} // namespace matrix_batch
@@ -0,0 +1,49 @@
+/**
+ * Minimal Wavefront OBJ/MTL parser producing CPU-side mesh data only, so that it can run on worker threads and in
+ * build tools that don't link raylib. It handles exactly what the models in `resources/models` use.
+ */
+
+#pragma once
+
+// STL includes
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace obj {
+
+struct MaterialData {
+  std::string name;
+  float diffuse[3] = { 1.0f, 1.0f, 1.0f };
+  std::string diffuseMap; // Path relative to the working directory, empty if none
+};
+
+/// Indexed mesh. Texture coordinates are already flipped vertically like raylib does.
+struct MeshData {
+  std::vector<float> vertices; // 3 per vertex
+  std::vector<float> normals; // 3 per vertex
+  std::vector<float> texcoords; // 2 per vertex
+  std::vector<uint16_t> indices;
+
+  [[nodiscard]] size_t vertexCount() const { return vertices.size() / 3; }
+  [[nodiscard]] size_t triangleCount() const { return indices.size() / 3; }
+};
+
+/**
+ * Like raylib's own OBJ loader, faces are grouped in one mesh per material of the MTL library: `meshes[i]` uses
+ * `materials[i]`. Without materials there is a single mesh. Meshes may be empty if a material is unused.
+ */
+struct ObjData {
+  std::vector<MeshData> meshes;
+  std::vector<MaterialData> materials;
+};
+
+/// Throws std::runtime_error on I/O or parse errors
+ObjData parseFile(const std::string &path);
+
+ObjData parse(std::string_view text, const std::string &baseDir);
+
+std::vector<MaterialData> parseMtl(std::string_view text, const std::string &baseDir);
+
+} // namespace obj
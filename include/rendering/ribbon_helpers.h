@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include "fmt/format.h"
@@ -15,10 +16,26 @@ namespace ribbons {
 using namespace splines;
 using V3f = raylib::Vector3;
 
+/// CPU-side ribbon mesh, not indexed: every three vertices make a triangle
+struct RibbonGeometry {
+  std::vector<float> vertices;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+
+  [[nodiscard]] size_t vertexCount() const { return vertices.size() / 3; }
+};
+
 std::vector<V3f> rotateShapeAroundZAxis(const std::vector<V3f> &shape, float angleInRadians);
 
-raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
-                              const std::vector<Spline3D> &splines,
+RibbonGeometry generateRibbonGeometry(std::span<const V3f> sliceShape,
+                                      std::span<const Spline3D> splines,
+                                      size_t splineDivisions,
+                                      float textureScale = 1.0f);
+
+raylib::Mesh uploadRibbonMesh(const RibbonGeometry &geometry);
+
+raylib::Mesh createRibbonMesh(std::span<const V3f> sliceShape,
+                              std::span<const Spline3D> splines,
                               size_t splineDivisions,
                               float textureScale = 1.0f);
 
@@ -0,0 +1,108 @@
+/**
+ * Compressed vertex format for the ribbon and chart chunk meshes:
+ *
+ *   position   3 x uint16 (+ 1 padding), normalized to the bounding box of the mesh
+ *   normal     2 x int16, octahedral encoding of the unit vector
+ *   texcoord   2 x uint16, normalized to the texture coordinate range of the mesh
+ *
+ * i.e. 16 bytes per vertex instead of 32 for floats. base_lighting.vs maps the attributes back with per-mesh
+ * uniforms. Vertex colors are the same in both formats.
+ */
+
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "rendering/RenderQueue.h"
+
+namespace vertex_format {
+
+enum Format {
+  FormatFloat = 0,
+  FormatQuantized,
+};
+
+/// Bytes per vertex of the positions, normals and texture coordinates
+constexpr size_t bytesPerVertex(Format format) {
+  return format == FormatFloat ? (3 + 3 + 2) * sizeof(float) : (4 + 2 + 2) * sizeof(uint16_t);
+}
+
+constexpr const char *name(Format format) {
+  return format == FormatFloat ? "float" : "quantized";
+}
+
+/// Maps quantized attributes back to the original values, the last component of each is unused
+struct Dequantization {
+  std::array<float, 4> positionOffset;
+  std::array<float, 4> positionScale;
+  std::array<float, 4> texcoordTransform; // Offset u, v, scale u, v
+};
+
+struct QuantizedAttributes {
+  std::vector<uint16_t> positions; // 4 per vertex
+  std::vector<int16_t> normals; // 2 per vertex
+  std::vector<uint16_t> texcoords; // 2 per vertex
+  Dequantization dequantization;
+};
+
+QuantizedAttributes quantize(size_t vertexCount, const float *positions, const float *normals, const float *texcoords);
+
+std::array<int16_t, 2> encodeNormal(Vector3 normal);
+
+Vector3 decodeNormal(std::array<int16_t, 2> encoded);
+
+/// Whether quantized meshes can be drawn, they need vertex array objects since raylib only binds float attributes
+bool supported();
+
+/// Vertex buffer of an attribute
+struct Attribute {
+  int buffer; // Slot in Mesh::vboId, which is also the shader attribute location
+  int components;
+  int type; // GL type
+  bool normalized;
+  size_t bytesPerVertex;
+};
+
+/// Layout of the attributes in each format, in order: positions, texture coordinates, normals
+std::array<Attribute, 3> attributes(Format format);
+
+/**
+ * Uploads quantized attributes to a new vertex array. `indices` may be empty for non-indexed meshes and `colors` for
+ * meshes without vertex colors. Only the indices are kept on the CPU, like for the float meshes.
+ */
+raylib::Mesh upload(const QuantizedAttributes &attributes,
+                    std::span<const uint16_t> indices,
+                    std::span<const unsigned char> colors);
+
+/**
+ * Creates a vertex array with room for `vertexCount` vertices and no vertex colors. The buffers are filled in later
+ * with `rlUpdateVertexBuffer()`, i.e. to sub-allocate them.
+ */
+raylib::Mesh allocate(Format format, int vertexCount);
+
+/// Locations of the dequantization uniforms of a shader using base_lighting.vs
+struct ShaderLocations {
+  int quantized = -1;
+  int positionOffset = -1;
+  int positionScale = -1;
+  int texcoordTransform = -1;
+
+  static ShaderLocations of(const Shader &shader);
+
+  /// Sets the format of all the meshes drawn with the shader
+  void setFormat(const Shader &shader, Format format) const;
+
+  /// Per-draw uniforms of a quantized mesh, pointing into `dequantization`
+  [[nodiscard]] std::array<RenderQueue::Uniform, 3> uniforms(const Dequantization &dequantization) const;
+};
+
+} // namespace vertex_format
@@ -10,7 +10,9 @@
 #pragma once
 
 #include <optional>
+#include <span>
 #include <tuple>
+#include <vector>
 
 #include "matrix3x3.h"
 #include "raylib-cpp.hpp"
@@ -93,33 +95,36 @@ public:
   ///< 'tension' controls the interpolation -- the default value of 0 specifies Catmull-Rom splines that
   ///< guarantee tangent continuity. With +1 you get straight lines, and -1 gives more of a circular appearance.
   static std::vector<Spline3D> FromPoints(const std::vector<raylib::Vector3> &points, float tension = -1) {
+    std::vector<Spline3D> result;
+    FromPoints(std::span<const raylib::Vector3>(points), result, tension);
+    return result;
+  }
+
+  ///< Same as above, into any vector of splines, e.g. one with its storage in a `FrameArena`
+  template<typename Vector>
+  static void FromPoints(std::span<const raylib::Vector3> points, Vector &result, float tension = -1) {
+    result.clear();
     switch (points.size()) {
     case 0:
-      return {};
+      return;
     case 1:
-      return { splineFromPoints3(points.at(0), points.at(0), points.at(0), points.at(0), tension) };
+      result.push_back(splineFromPoints3(points[0], points[0], points[0], points[0], tension));
+      return;
     case 2:
-      return { splineFromPoints3(points.at(0), points.at(0), points.at(1), points.at(1), tension) };
+      result.push_back(splineFromPoints3(points[0], points[0], points[1], points[1], tension));
+      return;
     }
 
-    std::vector<Spline3D> result;
     result.reserve(NumSplinesForPoints(static_cast<int>(points.size())));
 
-    result.push_back(splineFromPoints3(points.at(0), points.at(0), points.at(1), points.at(2), tension));
+    result.push_back(splineFromPoints3(points[0], points[0], points[1], points[2], tension));
 
-    for (int i = 0; i < points.size() - 3; i++) {
-      result.push_back(
-        splineFromPoints3(points.at(i + 0), points.at(i + 1), points.at(i + 2), points.at(i + 3), tension));
-    }
+    for (size_t i = 0; i < points.size() - 3; i++)
+      result.push_back(splineFromPoints3(points[i + 0], points[i + 1], points[i + 2], points[i + 3], tension));
 
     size_t offset = points.size() - 3;
-    result.push_back(splineFromPoints3(points.at(offset + 0),
-                                       points.at(offset + 1),
-                                       points.at(offset + 2),
-                                       points.at(offset + 2),
-                                       tension));
-
-    return result;
+    result.push_back(
+      splineFromPoints3(points[offset + 0], points[offset + 1], points[offset + 2], points[offset + 2], tension));
   }
 
 private:
@@ -137,6 +142,11 @@ public:
     return Evaluate(BezierWeights(dt4));
   }
 
+  ///< Bezier control point coordinates, i.e. to evaluate the spline on the GPU
+  [[nodiscard]] const raylib::Vector4 &Xb() const { return xb; }
+  [[nodiscard]] const raylib::Vector4 &Yb() const { return yb; }
+  [[nodiscard]] const raylib::Vector4 &Zb() const { return zb; }
+
   [[nodiscard]] std::pair<Spline3D, Spline3D> Split(float t) const;
   [[nodiscard]] std::pair<Spline3D, Spline3D> Split() const;
 
@@ -0,0 +1,80 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+
+/**
+ * Counts the heap allocations made with operator new, per frame and per call site, once enabled with
+ * `--track-allocations`. The global operators are replaced for the whole program: until tracking is enabled they only
+ * check a flag. A call site is the return address of operator new together with the innermost `Scope` of the calling
+ * thread. Allocations made with malloc(), i.e. by raylib and the other C libraries, aren't seen.
+ *
+ * Nothing here allocates while counting, sites are kept in a fixed table.
+ */
+class AllocationTracker {
+public:
+  /// Sites kept, the allocations of any further ones are only counted in the totals
+  static constexpr size_t MaxSites = 4096;
+
+  struct Counts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+  };
+
+  struct Site {
+    uintptr_t address = 0; // Return address of operator new
+    const char *scope = nullptr; // Null outside of any scope
+    uint64_t allocations = 0; // Since tracking was enabled
+    uint64_t bytes = 0;
+    uint64_t lastFrame = 0; // Allocations in the last frame
+  };
+
+  /// Names the allocations made by the current thread until it's destroyed, scopes nest
+  class Scope {
+  public:
+    explicit Scope(const char *name);
+
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    const char *previous;
+  };
+
+  static void enable();
+
+  [[nodiscard]] static bool enabled();
+
+  /// Closes the current frame, its counts become those of lastFrame(). Called once per frame by the main loop.
+  static void endFrame();
+
+  [[nodiscard]] static Counts lastFrame();
+
+  /// Since tracking was enabled
+  [[nodiscard]] static Counts total();
+
+  [[nodiscard]] static uint64_t frames();
+
+  /// Frames that allocated anything
+  [[nodiscard]] static uint64_t framesWithAllocations();
+
+  /**
+   * Fills `result` with the sites that allocated the most, in the last frame or since the start, most first. Returns
+   * how many were filled.
+   */
+  static size_t topSites(std::span<Site> result, bool lastFrameOnly);
+
+  /// Totals and the top `count` sites since the start, with the names of their functions where available
+  static void report(std::ostream &out, size_t count = 20);
+
+  /// Called by the replaced operators
+  static void recordAllocation(const void *caller, size_t bytes) noexcept;
+
+  static void recordFree() noexcept;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+// STL includes
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+
+/**
+ * File that is written next to its destination and renamed over it once complete, so that a crash never leaves a
+ * half-written file behind. The temporary file is removed if it isn't committed.
+ */
+class AtomicFile {
+public:
+  explicit AtomicFile(std::filesystem::path path);
+
+  ~AtomicFile();
+
+  AtomicFile(const AtomicFile &) = delete;
+  AtomicFile &operator=(const AtomicFile &) = delete;
+
+  [[nodiscard]] std::ofstream &stream() { return os; }
+
+  /// Closes the temporary file and replaces the destination with it. Returns what went wrong if that failed.
+  [[nodiscard]] std::optional<std::string> commit();
+
+private:
+  std::filesystem::path path;
+  std::filesystem::path tmpPath;
+  std::ofstream os;
+  bool committed = false;
+};
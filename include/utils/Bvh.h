@@ -0,0 +1,78 @@
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+/**
+ * Bounding volume hierarchy over axis-aligned boxes. Built top-down by splitting the boxes at the median of their
+ * centers along the longest axis, stored as a flat array of nodes: the left child of a node is right after it.
+ */
+class Bvh {
+public:
+  /// Boxes per leaf, at most
+  static constexpr size_t LeafSize = 4;
+
+  Bvh() = default;
+
+  explicit Bvh(const std::vector<BoundingBox> &boxes);
+
+  /// Calls `visit` with the index of every box overlapping `box`, touching ones included
+  template<typename Visit>
+  void query(const BoundingBox &box, Visit visit) const {
+    if (nodes.empty())
+      return;
+
+    // Deep enough for any tree built from median splits of up to 2^60 boxes
+    std::array<uint32_t, 64> stack; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const Node &node = nodes[stack[--top]];
+      if (!overlaps(node.bounds, box))
+        continue;
+
+      if (node.count == 0) {
+        stack[top++] = static_cast<uint32_t>(&node - nodes.data()) + 1;
+        stack[top++] = node.right;
+        continue;
+      }
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (overlaps(boxes[i], box))
+          visit(static_cast<size_t>(indices[i]));
+      }
+    }
+  }
+
+  [[nodiscard]] size_t size() const { return indices.size(); }
+
+  [[nodiscard]] size_t nodeCount() const { return nodes.size(); }
+
+  /// Of everything, empty if there are no boxes
+  [[nodiscard]] BoundingBox bounds() const { return nodes.empty() ? BoundingBox{} : nodes.front().bounds; }
+
+  static bool overlaps(const BoundingBox &a, const BoundingBox &b) {
+    return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y &&
+           a.min.z <= b.max.z && b.min.z <= a.max.z;
+  }
+
+private:
+  struct Node {
+    BoundingBox bounds;
+    uint32_t first; // Of the boxes of a leaf
+    uint32_t count; // Zero for inner nodes
+    uint32_t right; // Child of an inner node, the left one is the next node
+  };
+
+  std::vector<Node> nodes;
+  std::vector<BoundingBox> boxes; // In leaf order, so that leaves read them contiguously
+  std::vector<uint32_t> indices; // Of the boxes above in the input
+
+  /// Builds the subtree over `indices[first, first + count)`, returns its node
+  uint32_t build(const std::vector<BoundingBox> &input, uint32_t first, uint32_t count);
+};
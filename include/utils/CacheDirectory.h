@@ -0,0 +1,16 @@
+#pragma once
+
+// STL includes
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * Deletes the least recently written files with `extension` in `directory` until the rest take at most `maxBytes`.
+ * `keep`, the file just written, is never deleted. Returns the deleted files.
+ */
+std::vector<std::filesystem::path> trimCacheDirectory(const std::filesystem::path &directory,
+                                                      const std::string &extension,
+                                                      uintmax_t maxBytes,
+                                                      const std::filesystem::path &keep);
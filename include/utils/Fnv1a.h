@@ -0,0 +1,30 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// FNV-1a, stable across runs and platforms unlike std::hash
+class Fnv1a {
+  uint64_t state = 0xcbf29ce484222325ull;
+
+public:
+  template<typename T>
+  Fnv1a &add(const T &value) {
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+      state ^= bytes[i];
+      state *= 0x100000001b3ull;
+    }
+    return *this;
+  }
+
+  Fnv1a &add(const std::string &value) {
+    for (char c : value)
+      add(c);
+    return *this;
+  }
+
+  [[nodiscard]] uint64_t digest() const { return state; }
+};
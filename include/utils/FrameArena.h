@@ -0,0 +1,102 @@
+#pragma once
+
+// STL includes
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Bump allocator for scratch memory that doesn't outlive a frame. Everything is freed at once by `reset()`, or back to
+ * a `Scope` when it ends. The blocks are kept: after a reset that needed more than one they are merged into a single
+ * one as large as all of them, so that once the largest frame has been seen nothing is allocated anymore.
+ */
+class FrameArena {
+public:
+  /// Size of the first block
+  static constexpr size_t DefaultBlockSize = 256 * 1024;
+
+  explicit FrameArena(size_t blockSize = DefaultBlockSize) : blockSize(blockSize) {}
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  /// Standard allocator, for containers of scratch data. Deallocating does nothing.
+  template<typename T>
+  class Allocator {
+  public:
+    using value_type = T;
+
+    explicit Allocator(FrameArena &arena) : arena(&arena) {}
+
+    template<typename U>
+    Allocator(const Allocator<U> &other) : arena(other.arena) {} // NOLINT(google-explicit-constructor)
+
+    T *allocate(size_t count) { return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T))); }
+
+    void deallocate(T *, size_t) {}
+
+    template<typename U>
+    bool operator==(const Allocator<U> &other) const {
+      return arena == other.arena;
+    }
+
+  private:
+    template<typename U>
+    friend class Allocator;
+
+    FrameArena *arena;
+  };
+
+  template<typename T>
+  using Vector = std::vector<T, Allocator<T>>;
+
+  /// An empty vector whose storage comes from the arena
+  template<typename T>
+  Vector<T> vector() {
+    return Vector<T>(Allocator<T>(*this));
+  }
+
+  /// Frees what was allocated while it existed when it's destroyed, so that loops can reuse the same memory
+  class Scope {
+  public:
+    explicit Scope(FrameArena &arena) : arena(arena), block(arena.current), offset(arena.offset) {}
+
+    ~Scope() {
+      arena.current = block;
+      arena.offset = offset;
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    FrameArena &arena;
+    size_t block;
+    size_t offset;
+  };
+
+  void *allocate(size_t bytes, size_t alignment);
+
+  /// Frees everything, at the start of a frame
+  void reset();
+
+  /// Bytes allocated since the last reset, at most
+  [[nodiscard]] size_t peak() const { return peakBytes; }
+
+  [[nodiscard]] size_t capacity() const;
+
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  size_t blockSize;
+  std::vector<Block> blocks;
+  size_t current = 0; // Block being allocated from
+  size_t offset = 0; // Into it
+  size_t peakBytes = 0;
+
+  /// Bytes allocated up to the current position, in the blocks before it too
+  [[nodiscard]] size_t used() const;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+// STL includes
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Thread that runs the same job over and over, one run per `start()`, for work that is overlapped with every frame.
+ * Unlike `ThreadPool::submit()` nothing is allocated per run: the job is stored once and there's no future.
+ *
+ * Without threads (see `ThreadPool::threadsAvailable()`) the job runs inline in `start()`.
+ */
+class FrameWorker {
+public:
+  explicit FrameWorker(std::function<void()> job);
+
+  /// Waits for the run in progress, if any
+  ~FrameWorker();
+
+  FrameWorker(const FrameWorker &) = delete;
+  FrameWorker &operator=(const FrameWorker &) = delete;
+
+  /// Starts a run. The previous one must have been waited for.
+  void start();
+
+  /// Waits for the run started last to finish, rethrowing what it threw. Returns immediately if none is in progress.
+  void wait();
+
+  [[nodiscard]] bool threaded() const { return thread.joinable(); }
+
+private:
+  std::function<void()> job;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool pending = false; // Started and not finished yet
+  bool stopping = false;
+  std::exception_ptr error;
+
+  void loop();
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+// STL includes
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+/**
+ * Memory used by a loaded song, per subsystem, in CPU bytes and estimated GPU bytes. Filled on demand from the
+ * structures themselves, see `Application::memoryReport()`, except for the JSON DOM: it only exists while a song is
+ * parsed, so its largest size is recorded then, within a `ParseScope` and if `trackParsing()` was called.
+ *
+ * Sizes are estimates: heap blocks are counted at their requested size plus the usual node overhead of the containers,
+ * GPU buffers and textures at the size of their data, without what the driver adds.
+ */
+class MemoryReport {
+public:
+  enum Subsystem {
+    SubsystemJsonDom = 0, // Largest DOM built while parsing, freed once the song is built from it
+    SubsystemSongJson, // Source of the choreographies whose events aren't parsed yet
+    SubsystemEvents, // Events of the parsed choreographies and their sub-positions
+    SubsystemBeats,
+    SubsystemPlacements, // Ribbon placements, hand paths and overlaps of the placed choreographies
+    SubsystemChunks,
+    SubsystemRibbons, // Ribbon meshes, own and pooled, and the splines of the ribbons extruded on the GPU
+    SubsystemRibbonCache, // Ribbons waiting to be written and the mapped pack file
+    SubsystemModels,
+    SubsystemTextures,
+    SubsystemWaveform,
+    SubsystemCount,
+  };
+
+  struct Usage {
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0;
+    size_t objects = 0; // Heap blocks, meshes or textures, depending on the subsystem
+
+    Usage &operator+=(const Usage &other) {
+      cpuBytes += other.cpuBytes;
+      gpuBytes += other.gpuBytes;
+      objects += other.objects;
+      return *this;
+    }
+  };
+
+  /// Red-black tree node header of the std::map and std::set implementations, added to the size of each element
+  static constexpr size_t MapNodeBytes = 4 * sizeof(void *);
+
+  /// Hash table node header (next pointer and cached hash) plus a bucket pointer per element at full load
+  static constexpr size_t HashNodeBytes = 3 * sizeof(void *);
+
+  template<typename T>
+  static size_t vectorBytes(const std::vector<T> &vector) {
+    return vector.capacity() * sizeof(T);
+  }
+
+  void add(Subsystem subsystem, const Usage &usage) { usages[subsystem] += usage; }
+
+  [[nodiscard]] const Usage &operator[](Subsystem subsystem) const { return usages[subsystem]; }
+
+  /// Of all the subsystems except the JSON DOM, which is gone once the song is loaded
+  [[nodiscard]] Usage total() const;
+
+  [[nodiscard]] static const char *name(Subsystem subsystem);
+
+  /// One line per subsystem, then the total
+  void print(std::ostream &out) const;
+
+  /**
+   * Keeps the largest JSON DOM parsed on the thread that creates it in `peak`, until it's destroyed. Parses outside of
+   * any scope, e.g. the ones of the library index, aren't recorded. Scopes can be nested, the innermost one records.
+   */
+  class ParseScope {
+  public:
+    explicit ParseScope(size_t &peak);
+    ~ParseScope();
+
+    ParseScope(const ParseScope &) = delete;
+    ParseScope &operator=(const ParseScope &) = delete;
+
+  private:
+    size_t *outer;
+  };
+
+  /// Walks the DOM of the parses in a `ParseScope` from now on to record their size, about a tenth of the parse time
+  static void trackParsing();
+
+  /// Whether the parses on this thread are recorded
+  [[nodiscard]] static bool trackingParsing();
+
+  /// Called by the parser with the size of a DOM it built, the largest one is kept in the current scope
+  static void recordJsonDom(size_t bytes);
+
+private:
+  std::array<Usage, SubsystemCount> usages{};
+};
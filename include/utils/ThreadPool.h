@@ -0,0 +1,64 @@
+#pragma once
+
+// STL includes
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed-size pool of worker threads.
+ *
+ * On platforms without threads (the web build is not compiled with pthreads) the pool has no workers: tasks are only
+ * queued, and the owner is expected to call `runPending()` from its main loop to make progress.
+ */
+class ThreadPool {
+public:
+  /// Pass 0 to use one thread per hardware core
+  explicit ThreadPool(size_t threads = 0);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template<typename F>
+  auto submit(F &&task) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+    std::future<R> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.emplace_back([packaged]() { (*packaged)(); });
+    }
+    cv.notify_one();
+    return result;
+  }
+
+  /// Runs up to `maxTasks` queued tasks on the calling thread. Returns the number of tasks that were run.
+  size_t runPending(size_t maxTasks = SIZE_MAX);
+
+  [[nodiscard]] size_t size() const { return workers.size(); }
+
+  [[nodiscard]] static bool threadsAvailable();
+
+  /// Shared pool for background work that doesn't need a dedicated one
+  static ThreadPool &global();
+
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> queue;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+
+  void workerLoop();
+};
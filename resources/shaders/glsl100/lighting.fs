@@ -30,8 +30,10 @@ void main()
     vec3 viewD = normalize(viewPos - fragPosition);
 
     // NOTE: Implement here your fragment shader code
-    vec4 finalColor = texelColor*(colDiffuse*vec4(lightDot, 1.0));
-    finalColor += texelColor*(ambient/10.0)*colDiffuse;
+    // Vertex colors are white unless the mesh has its own, like the baked chart chunks
+    vec4 diffuse = colDiffuse*fragColor;
+    vec4 finalColor = texelColor*(diffuse*vec4(lightDot, 1.0));
+    finalColor += texelColor*(ambient/10.0)*diffuse;
 
     // Gamma correction
     gl_FragColor = pow(finalColor, vec4(1.0/2.2));
@@ -0,0 +1,18 @@
+#version 100
+
+precision mediump float;
+
+// Same as raylib's default fragment shader, for the ribbons and the textured chunk meshes
+
+// Input vertex attributes (from vertex shader)
+varying vec2 fragTexCoord;
+varying vec4 fragColor;
+
+// Input uniform values
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+
+void main()
+{
+    gl_FragColor = texture2D(texture0, fragTexCoord)*colDiffuse*fragColor;
+}
@@ -19,14 +19,38 @@ out vec3 fragNormal;
 
 // NOTE: Add here your custom variables
 
+// Compressed vertex format (see rendering/vertex_format.h): positions and texture coordinates are normalized to the
+// ranges below, normals are octahedral-encoded
+uniform float quantized;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform vec4 texcoordTransform;
+
+vec3 decodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx))*vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
 void main()
 {
+    vec3 position = vertexPosition;
+    vec2 texCoord = vertexTexCoord;
+    vec3 normal = vertexNormal;
+    if (quantized > 0.5)
+    {
+        position = positionOffset + vertexPosition*positionScale;
+        texCoord = texcoordTransform.xy + vertexTexCoord*texcoordTransform.zw;
+        normal = decodeNormal(vertexNormal.xy);
+    }
+
     // Send vertex attributes to fragment shader
-    fragPosition = vec3(matModel*vec4(vertexPosition, 1.0));
-    fragTexCoord = vertexTexCoord;
+    fragPosition = vec3(matModel*vec4(position, 1.0));
+    fragTexCoord = texCoord;
     fragColor = vertexColor;
-    fragNormal = normalize(vec3(matNormal*vec4(vertexNormal, 1.0)));
+    fragNormal = normalize(vec3(matNormal*vec4(normal, 1.0)));
 
     // Calculate final vertex position
-    gl_Position = mvp*vec4(vertexPosition, 1.0);
+    gl_Position = mvp*vec4(position, 1.0);
 }
@@ -34,8 +34,10 @@ void main()
     vec3 viewD = normalize(viewPos - fragPosition);
 
     // NOTE: Implement here your fragment shader code
-    finalColor = texelColor*(colDiffuse*vec4(lightDot, 1.0));
-    finalColor += texelColor*(ambient/10.0)*colDiffuse;
+    // Vertex colors are white unless the mesh has its own, like the baked chart chunks
+    vec4 diffuse = colDiffuse*fragColor;
+    finalColor = texelColor*(diffuse*vec4(lightDot, 1.0));
+    finalColor += texelColor*(ambient/10.0)*diffuse;
 
     // Gamma correction
     finalColor = pow(finalColor, vec4(1.0/2.2));
@@ -0,0 +1,72 @@
+#version 330
+
+// Ribbons extruded on the GPU: the mesh is a parametric grid shared by all the ribbons of a hand, the spline of each
+// ribbon comes from the uniforms below
+
+// Input vertex attributes: vertex of the slice shape, and (spline parameter, shape texture coordinate). The spline
+// parameter is the segment index plus the position in the segment.
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+
+// Input uniform values
+uniform mat4 mvp;
+
+// Output vertex attributes (to fragment shader)
+out vec2 fragTexCoord;
+out vec4 fragColor;
+
+// Bezier control points of each segment, like Spline3D's xb, yb and zb
+uniform vec4 splineX[32];
+uniform vec4 splineY[32];
+uniform vec4 splineZ[32];
+
+// x: number of segments, y: texture scale
+uniform vec4 ribbonParams;
+
+vec4 bezierWeights(float t)
+{
+    float s = 1.0 - t;
+    return vec4(s*s*s, 3.0*s*s*t, 3.0*s*t*t, t*t*t);
+}
+
+vec4 bezierVelocityWeights(float t)
+{
+    vec4 d = vec4(0.0, 1.0, 2.0*t, 3.0*t*t);
+    return vec4(d.x - 3.0*d.y + 3.0*d.z - d.w, 3.0*d.y - 6.0*d.z + 3.0*d.w, 3.0*d.z - 3.0*d.w, d.w);
+}
+
+vec3 evaluate(int segment, vec4 weights)
+{
+    return vec3(dot(splineX[segment], weights), dot(splineY[segment], weights), dot(splineZ[segment], weights));
+}
+
+// Rotates p with the rotation that takes +Z to the unit vector b, same as the CPU extrusion
+vec3 alignToTangent(vec3 p, vec3 b)
+{
+    vec3 v = cross(vec3(0.0, 0.0, 1.0), b);
+    return p + cross(v, p) + cross(v, cross(v, p))/max(1.0 + b.z, 1e-4);
+}
+
+void main()
+{
+    // Parameters past the end of the ribbon collapse onto its last slice. Slices between two segments belong to the
+    // end of the first one, like on the CPU, so the one before the last segment is still aligned to the spline.
+    float segments = ribbonParams.x;
+    float s = min(vertexTexCoord.x, segments);
+    float segmentIndex = clamp(ceil(s) - 1.0, 0.0, segments - 1.0);
+    int segment = int(segmentIndex);
+    float t = s - segmentIndex;
+
+    // The first slice and the whole last segment face the player. The cap centers have a null shape vertex, so they
+    // end up on the spline.
+    vec3 tangent = vec3(0.0, 0.0, 1.0);
+    if ((s > 0.0) && (segmentIndex < segments - 1.0)) tangent = normalize(evaluate(segment, bezierVelocityWeights(t)));
+
+    vec3 position = evaluate(segment, bezierWeights(t)) + alignToTangent(vertexPosition, tangent);
+
+    // Parametric rather than arc length texture coordinate, close enough for the gem spacing of ribbons
+    fragTexCoord = vec2(ribbonParams.y*s/segments, vertexTexCoord.y);
+    fragColor = vec4(1.0);
+
+    gl_Position = mvp*vec4(position, 1.0);
+}
@@ -3,8 +3,13 @@
 //
 
 // STL includes
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <optional>
+#include <sstream>
 
 // Libraries
 #include "raylib-cpp.hpp"
@@ -18,13 +23,46 @@ namespace rlgl {
 
 // Local includes
 #include "Application.h"
+#include "audio/AudioDecoder.h"
 #include "audiotrip/dtos.h"
+#include "audiotrip/utils.h"
 #include "common_defs.h"
 #include "raylib_ext/scoped.h"
 #include "rendering/SkyBox.h"
 
-Application::Application(bool debug) : debug(debug) {
-  SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE);
+static std::string readTextFile(const std::string &path) {
+  std::ifstream is(path, std::ios::binary);
+  if (!is)
+    throw raylib::RaylibException("Unable to open " + path);
+
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+/// Memory of the parsed events of a choreography, with their sub-positions
+static MemoryReport::Usage eventMemory(const audiotrip::Choreography &choreography) {
+  MemoryReport::Usage usage;
+  usage.cpuBytes = MemoryReport::vectorBytes(choreography.events);
+  usage.objects = choreography.events.empty() ? 0 : 1;
+  for (const audiotrip::ChoreoEvent &event : choreography.events) {
+    usage.cpuBytes += MemoryReport::vectorBytes(event.subPositions);
+    if (event.subPositions.capacity() > 0)
+      usage.objects++;
+  }
+  return usage;
+}
+
+Application::Application(const ApplicationOptions &options) :
+  nullAudio(options.nullAudio), audioLatency(options.audioLatency), debug(options.debug),
+  startupReport(options.startupReport), memReport(options.memReport), useGpuRibbons(options.gpuRibbons),
+  initialVertexFormat(options.quantizedVertices ? vertex_format::FormatQuantized : vertex_format::FormatFloat) {
+  auto windowStart = StartupLoader::Clock::now();
+
+  unsigned int flags = FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE;
+  if (options.hiddenWindow)
+    flags |= FLAG_WINDOW_HIDDEN;
+  SetConfigFlags(flags);
   window = std::make_unique<raylib::Window>(800, 600, "Audio Trip Choreography Viewer");
   (void) window; // Silence unused variable
 
@@ -37,20 +75,152 @@ Application::Application(bool debug) : debug(debug) {
   camera->SetMode(CAMERA_FIRST_PERSON);
   mouseCapture(false);
 
-  floorTexture = std::make_unique<raylib::Texture2D>(raylib::Image("resources/floor_texture.png").Mipmaps());
-  rlgl::rlTextureParameters(floorTexture->id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_ANISOTROPIC);
-  rlgl::rlTextureParameters(floorTexture->id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
-  rlgl::rlTextureParameters(floorTexture->id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_REPEAT);
+  gui.init();
+
+  if (options.library.has_value()) {
+    gui.libraryVisible = true;
+    gui.libraryStatus = "Loading the library...";
+    libraryLoad = ThreadPool::global().submit([directory = *options.library]() {
+      auto index = std::make_unique<audiotrip::LibraryIndex>(directory);
+      index->load();
+      return index;
+    });
+  }
+
+  if (options.playbackLog.has_value()) {
+    playbackLogFile = std::make_unique<std::ofstream>(*options.playbackLog);
+    if (*playbackLogFile)
+      playbackLog = std::make_unique<audio::PlaybackLog>(playbackLogFile.get());
+    else
+      std::cerr << "Unable to write the playback log to " << *options.playbackLog << std::endl;
+  }
+
+  if (debug || memReport)
+    MemoryReport::trackParsing();
+
+  startup = std::make_unique<StartupLoader>(ThreadPool::global());
+  startup->recordMainThreadStage(
+    "window creation",
+    std::chrono::duration<double, std::milli>(StartupLoader::Clock::now() - windowStart).count());
+  loadAssets();
+}
+
+void Application::loadAssets() {
+  // CPU work (decoding, parsing) runs on the thread pool. Only the finishers, which upload to the GPU, run on the main
+  // thread. Paths are formatted here since TextFormat() is not thread safe.
+
+  startup->add("resources/floor_texture.png", [this](StartupLoader::Stages &stages) -> StartupLoader::Finisher {
+    static const std::string path = "resources/floor_texture.png";
+    auto image = std::make_shared<raylib::Image>(stages.time("png decode", []() { return raylib::Image(path); }));
+    stages.time("mipmap generation", [&]() { image->Mipmaps(); });
+
+    return [this, image]() {
+      floorTexture = assets.texture(path, true, *image);
+      rlgl::rlTextureParameters(floorTexture->id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_ANISOTROPIC);
+      rlgl::rlTextureParameters(floorTexture->id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
+      rlgl::rlTextureParameters(floorTexture->id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_REPEAT);
+    };
+  });
+
+  struct ModelEntry {
+    std::string path;
+    std::shared_ptr<raylib::Model> *target;
+    placement::StaticModel staticModel; // StaticModelCount if it isn't baked into the chart chunks
+  };
+
+  ModelEntry models[] = {
+    { "resources/models/barrier.obj", &barrierModel, placement::StaticModelBarrier },
+    { "resources/models/gem_trail.obj", &gemTrailModel, placement::StaticModelGemTrail },
+    { "resources/models/gem" MODELS_SUFFIX ".obj", &gemModel, placement::StaticModelGem },
+    { "resources/models/drum" MODELS_SUFFIX ".obj", &drumModel, placement::StaticModelDrum },
+    { "resources/models/dirgem" MODELS_SUFFIX ".obj", &dirgemModel, placement::StaticModelDirGem },
+    // Only needed for its material, see below
+    { "resources/models/ribbon_fake_model.obj", nullptr, placement::StaticModelCount },
+  };
+
+  for (const ModelEntry &entry : models) {
+    std::string path = entry.path;
+    std::shared_ptr<raylib::Model> *target = entry.target;
+    placement::StaticModel staticModel = entry.staticModel;
+
+    startup->add(path, [this, path, target, staticModel](StartupLoader::Stages &stages) -> StartupLoader::Finisher {
+      // Prefer the model baked at build time, the OBJ file is only a fallback
+      std::shared_ptr<binmesh::MeshFile> baked;
+      std::shared_ptr<obj::ObjData> data;
+      if (std::optional<std::string> bakedPath = binmesh::bakedPathFor(path)) {
+        baked = stages.time("atmesh map", [&]() { return std::make_shared<binmesh::MeshFile>(*bakedPath, path); });
+      } else {
+        data = std::make_shared<obj::ObjData>(stages.time("obj parse", [&]() { return obj::parseFile(path); }));
+      }
 
-  barrierModel = std::make_unique<raylib::Model>("resources/models/barrier.obj");
-  gemTrailModel = std::make_unique<raylib::Model>("resources/models/gem_trail.obj");
-  gemModel = std::make_unique<raylib::Model>("resources/models/gem" MODELS_SUFFIX ".obj");
-  drumModel = std::make_unique<raylib::Model>("resources/models/drum" MODELS_SUFFIX ".obj");
-  dirgemModel = std::make_unique<raylib::Model>("resources/models/dirgem" MODELS_SUFFIX ".obj");
+      // Only the upload of the material textures is left to the main thread
+      auto images = std::make_shared<AssetRegistry::DecodedImages>(stages.time("material decode", [&]() {
+        return baked != nullptr ? AssetRegistry::decodeMaterialImages(*baked)
+                                : AssetRegistry::decodeMaterialImages(data->materials);
+      }));
+
+      // The chunk streamer transforms the vertices on the CPU, so it needs its own copy
+      std::shared_ptr<const obj::ObjData> geometry = data;
+      if (staticModel != placement::StaticModelCount && baked != nullptr)
+        geometry = std::make_shared<obj::ObjData>(baked->toObjData());
+
+      return [this, path, target, staticModel, baked, data, geometry, images]() {
+        std::shared_ptr<raylib::Model> model =
+          baked != nullptr ? assets.model(path, *baked, *images) : assets.model(path, *data, *images);
+        if (target != nullptr) {
+          *target = model;
+          staticGeometry[staticModel] = geometry;
+          return;
+        }
+
+        // Since raylib can't load a standalone material from materials.mtl, it is stolen from a fake model. It is
+        // loaded only once and shared by all ribbons.
+        ribbonMaterial = assets.material(path);
+        unsigned int ribbonTextureId = ribbonMaterial->maps[MATERIAL_MAP_DIFFUSE].texture.id;
+        rlgl::rlTextureParameters(ribbonTextureId, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_ANISOTROPIC);
+        rlgl::rlTextureParameters(ribbonTextureId, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_REPEAT);
+        rlgl::rlTextureParameters(ribbonTextureId, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_REPEAT);
+      };
+    });
+  }
 
-  shader = std::make_unique<raylib::Shader>(TextFormat("resources/shaders/glsl%i/base_lighting.vs", GLSL_VERSION),
-                                            TextFormat("resources/shaders/glsl%i/lighting.fs", GLSL_VERSION));
+  auto addShader = [this](const std::string &name,
+                          const char *vsFile,
+                          const char *fsFile,
+                          std::shared_ptr<raylib::Shader> *target) {
+    std::string vsPath = TextFormat("resources/shaders/glsl%i/%s", GLSL_VERSION, vsFile);
+    std::string fsPath = TextFormat("resources/shaders/glsl%i/%s", GLSL_VERSION, fsFile);
+    startup->add(name, [this, vsPath, fsPath, target](StartupLoader::Stages &stages) -> StartupLoader::Finisher {
+      auto sources = std::make_shared<std::pair<std::string, std::string>>(stages.time(
+        "shader read", [&]() { return std::make_pair(readTextFile(vsPath), readTextFile(fsPath)); }));
+
+      return [this, vsPath, fsPath, sources, target]() {
+        *target = assets.shader(vsPath, fsPath, sources->first, sources->second);
+      };
+    });
+  };
+
+  addShader("lighting shader", "base_lighting.vs", "lighting.fs", &shader);
+  // Same as raylib's default shader, but with the vertex dequantization of base_lighting.vs
+  addShader("unlit shader", "base_lighting.vs", "unlit.fs", &unlitShader);
+  if (useGpuRibbons)
+    addShader("ribbon shader", "ribbon.vs", "unlit.fs", &ribbonShader);
+
+  std::string skyboxVsPath = TextFormat("resources/shaders/glsl%i/skybox.vs", GLSL_VERSION);
+  std::string skyboxFsPath = TextFormat("resources/shaders/glsl%i/skybox.fs", GLSL_VERSION);
+  auto loadSkybox = [this, skyboxVsPath, skyboxFsPath](StartupLoader::Stages &stages) -> StartupLoader::Finisher {
+    auto image = stages.time("png decode", []() { return raylib::Image("resources/at-cubemap.png"); });
+    auto faces = std::make_shared<raylib::Image>(
+      stages.time("cubemap face extraction", [&]() { return SkyBox::ExtractFaces(image); }));
+    auto sources = std::make_shared<std::pair<std::string, std::string>>(stages.time(
+      "shader read", [&]() { return std::make_pair(readTextFile(skyboxVsPath), readTextFile(skyboxFsPath)); }));
+
+    return [this, faces, sources]() { skybox = std::make_unique<SkyBox>(sources->first, sources->second, *faces); };
+  };
+  startup->add("resources/at-cubemap.png", loadSkybox);
+}
 
+void Application::finishStartup() {
   shader->locs[SHADER_LOC_VECTOR_VIEW] = shader->GetLocation("viewPos");
   shader->locs[SHADER_LOC_MATRIX_MODEL] = shader->GetLocation("matModel");
   shader->locs[SHADER_LOC_COLOR_AMBIENT] = shader->GetLocation("ambient");
@@ -69,12 +239,51 @@ Application::Application(bool debug) : debug(debug) {
   drumModel->materials[0].shader = *shader;
   dirgemModel->materials[0].shader = *shader;
 
-  skybox = std::make_unique<SkyBox>("resources/at-cubemap.png");
+  // Textured chunk meshes and ribbons
+  unlitShader->locs[SHADER_LOC_MATRIX_MODEL] = unlitShader->GetLocation("matModel");
+  gemModel->materials[1].shader = *unlitShader;
+  ribbonMaterial->shader = *unlitShader;
 
-  gui.init();
+  litLocations = vertex_format::ShaderLocations::of(*shader);
+  unlitLocations = vertex_format::ShaderLocations::of(*unlitShader);
+
+  setVertexFormat(initialVertexFormat);
+
+  if (ribbonShader != nullptr)
+    gpuRibbons = std::make_unique<GpuRibbons>(ribbonShape(), ribbonShader, ribbonMaterial);
+
+  if (startupReport)
+    startup->printReport(std::cout);
+  if (debug)
+    assets.printReport(std::cout);
+
+  startup.reset();
 }
 
 void Application::drawFrame() {
+  AllocationTracker::endFrame();
+  AllocationTracker::Scope frameScope("frame");
+
+  if (startup != nullptr) {
+    if (startup->poll()) {
+      finishStartup();
+    } else {
+      raylib_ext::scoped::Drawing drawing;
+      drawSplash();
+      return;
+    }
+  }
+
+  // Wait for the list prepared while the previous frame was drawn. The worker is then idle until the next one is
+  // started, so from here the song, the beats and the choreography can be changed.
+  preparer.wait();
+  size_t readyList = preparingList;
+  scratch.reset();
+
+  pollSongLoad();
+  pollWaveform();
+  updateLibrary();
+
   if (IsFileDropped()) {
     std::vector<std::string> files = raylib::GetDroppedFiles();
     for (const std::string &path : files) {
@@ -85,69 +294,463 @@ void Application::drawFrame() {
     }
   }
 
-  camera->Update();
+  // Keys go to the search box while it's being edited
+  bool typing = gui.librarySearchEditMode;
+  if (!typing)
+    camera->Update();
 
-  if (IsKeyPressed(KEY_M)) {
+  if (!typing && IsKeyPressed(KEY_M)) {
     mouseCapture(std::nullopt); // Toggle capture
   }
 
+  if (!typing && IsKeyPressed(KEY_I))
+    gui.metricsWindowBoxActive = !gui.metricsWindowBoxActive;
+
+  if (!typing && IsKeyPressed(KEY_T))
+    showTrajectories = !showTrajectories;
+
+  if (!typing && IsKeyPressed(KEY_O))
+    showOverlaps = !showOverlaps;
+
+  if (ats != nullptr && !typing && IsKeyPressed(KEY_P)) {
+    if (playing())
+      playback->stop();
+    else
+      startPlayback();
+  }
+
+  // Compare the quantized meshes to the float ones
+  if (debug && !typing && IsKeyPressed(KEY_V)) {
+    setVertexFormat(vertexFormat == vertex_format::FormatFloat ? vertex_format::FormatQuantized
+                                                               : vertex_format::FormatFloat);
+  }
+
   if (ats != nullptr) {
     bool plusPressed = IsKeyPressed(KEY_PAGE_UP);
     bool minusPressed = IsKeyPressed(KEY_PAGE_DOWN);
     if (plusPressed || minusPressed) {
       camera->position.z += choreo().secondsToMeters(beats.at(1).time) * (minusPressed ? -1.0f : 1.0f);
+      if (playing())
+        startPlayback();
+    }
+    updatePlayback();
+
+    AllocationTracker::Scope streamingScope("streaming");
+    if (streamedChoreo != &choreo())
+      streamChoreo();
+    // Same order as placement::TintRole
+    streamedState->chunks->setPalette(
+      { gui.lhsColorPickerValue, gui.rhsColorPickerValue, gui.barrierColorPickerValue });
+    streamedState->chunks->update(camera->position.z);
+
+    if (memReportPending && streamedState->chunks->stats().building == 0) {
+      memReportPending = false;
+      memoryReport().print(std::cout);
+    }
+
+    if (showTrajectories && streamedState->trajectory == nullptr) {
+      streamedState->trajectory = std::make_unique<audiotrip::trajectory::Simulation>(
+        audiotrip::trajectory::simulate(*streamedChoreo, beats, ThreadPool::global()));
     }
+    if (showOverlaps && streamedState->overlaps == nullptr) {
+      streamedState->overlaps = std::make_unique<audiotrip::overlaps::Result>(
+        audiotrip::overlaps::find(*streamedChoreo, beats, ThreadPool::global()));
+      const audiotrip::overlaps::Result &result = *streamedState->overlaps;
+      std::cout << fmt::format("Overlaps of {}: {} among {} volumes, index built in {:.2f} ms, queried in {:.2f} ms",
+                               streamedChoreo->name,
+                               result.overlaps.size(),
+                               result.volumes.size(),
+                               result.buildSeconds * 1000,
+                               result.querySeconds * 1000)
+                << std::endl;
+    }
+
+    prewarmChoreos();
   }
 
-  float cameraPosValue[] = { camera->position.x, camera->position.y, camera->position.z };
-  SetShaderValue(*shader, shader->locs[SHADER_LOC_VECTOR_VIEW], cameraPosValue, SHADER_UNIFORM_VEC3);
+  if (ats != nullptr) {
+    FrameInputs inputs = frameInputs();
+
+    // Nothing prepared yet, or prepared for a choreography that has since been switched away from
+    if (drawLists[readyList].choreo != inputs.choreo)
+      prepareFrame(inputs, drawLists[readyList]);
 
-  Vector3 pos = camera->position;
-  pos.z += 0.1;
+    preparingList = 1 - readyList;
+    startPreparing(inputs);
+  }
 
+  auto submitStart = std::chrono::steady_clock::now();
   {
+    AllocationTracker::Scope drawScope("draw");
     raylib_ext::scoped::Drawing drawing;
 
     if (ats != nullptr)
-      drawChoreo();
+      drawChoreo(drawLists[readyList]);
     else
       drawSplash();
   }
+  logPlaybackFrame();
+  submitSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - submitStart).count();
+}
+
+void Application::setVertexFormat(vertex_format::Format format) {
+  if (format == vertex_format::FormatQuantized && !vertex_format::supported()) {
+    std::cout << "Quantized vertices need vertex array objects, which are not available: using floats" << std::endl;
+    format = vertex_format::FormatFloat;
+  }
+
+  vertexFormat = format;
+  litLocations.setFormat(*shader, format);
+  unlitLocations.setFormat(*unlitShader, format);
+  for (const std::unique_ptr<ChoreoState> &state : choreoStates) {
+    if (state != nullptr)
+      state->chunks->setVertexFormat(format, litLocations, unlitLocations);
+  }
+
+  // Regenerated in the new format when drawn, from the disk cache if possible
+  clearRibbons();
+
+  std::cout << fmt::format("Vertex format: {}, {} bytes per vertex ({} for floats)",
+                           vertex_format::name(format),
+                           vertex_format::bytesPerVertex(format),
+                           vertex_format::bytesPerVertex(vertex_format::FormatFloat))
+            << std::endl;
+}
+
+void Application::startPreparing(const FrameInputs &inputs) {
+  // Read by the worker until it's waited for, in the next frame
+  preparingInputs = inputs;
+  preparer.start();
 }
 
 void Application::openAts(const std::string &path) {
-  // Load JSON
-  ats = std::make_unique<audiotrip::AudioTripSong>(std::move(audiotrip::AudioTripSong::fromFile(path)));
+  auto progress = std::make_shared<std::atomic<float>>(0.0f);
+  // A load that is still running is abandoned, its result is dropped with its future
+  songLoad = SongLoad{ path, progress, ThreadPool::global().submit([path, progress]() {
+                         return loadSong(path, *progress);
+                       }) };
+  std::cout << "Loading ATS file: " << path << std::endl;
+}
+
+Application::LoadedSong Application::loadSong(const std::string &path, std::atomic<float> &progress) {
+  LoadedSong song;
+  MemoryReport::ParseScope parseScope(song.jsonDomPeak);
+  try {
+    // Reading is reported up to half of the bar, the rest is split between parsing and post processing. Only the
+    // choreography shown first is parsed, the others are parsed when they are selected.
+    song.ats = std::make_unique<audiotrip::AudioTripSong>(
+      audiotrip::AudioTripSong::fromFile(path, [&](float read) { progress = read * 0.5f; }, true));
+    progress = 0.6f;
+    loadEvents(song.ats->choreographies.front());
+    progress = 0.8f;
+    song.beats = song.ats->computeBeats();
+    progress = 0.9f;
+  } catch (const std::exception &e) {
+    // Not only `ParseError`: anything thrown here would otherwise be rethrown on the main thread by the future
+    song.ats.reset();
+    song.error = e.what();
+    progress = 1.0f;
+    return song;
+  }
+
+  const audiotrip::AudioTripSong &ats = *song.ats;
+  song.choreoNames.reserve(ats.choreographies.size());
+  for (const audiotrip::Choreography &choreo : ats.choreographies)
+    song.choreoNames.push_back(fmt::format("{} - {}", ats.authorID.displayName, choreo.name));
+
+  int bpm = 0;
+  for (const audiotrip::TempoSection &tempoSection : ats.tempoSections) {
+    if (static_cast<int>(tempoSection.beatsPerMinute) > bpm)
+      bpm = static_cast<int>(tempoSection.beatsPerMinute);
+  }
+
+  song.bpmDuration = fmt::format("{}bpm - {}:{:>02}",
+                                 static_cast<int>(bpm),
+                                 static_cast<int>(ats.songEndTimeInSeconds) / 60,
+                                 static_cast<int>(ats.songEndTimeInSeconds) % 60);
+  progress = 1.0f;
+  return song;
+}
+
+bool Application::loadEvents(audiotrip::Choreography &choreography) {
+  if (choreography.eventsLoaded())
+    return false;
+
+  auto start = std::chrono::steady_clock::now();
+  try {
+    choreography.loadEvents();
+  } catch (const audiotrip::ParseError &e) {
+    std::cerr << "Unable to parse the events of " << choreography.name << ": " << e.what() << std::endl;
+    return true;
+  }
+
+  std::cout << fmt::format("Parsed {} events of {} in {:.1f} ms",
+                           choreography.events.size(),
+                           choreography.name,
+                           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count())
+            << std::endl;
+  return true;
+}
+
+void Application::pollSongLoad() {
+  if (!songLoad.has_value())
+    return;
+
+  // Without worker threads the load runs here, in one go
+  if (ThreadPool::global().size() == 0) {
+    while (songLoad->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      if (ThreadPool::global().runPending(1) == 0)
+        songLoad->result.wait();
+    }
+  }
+
+  if (songLoad->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+
+  std::string path = std::move(songLoad->path);
+  LoadedSong song = songLoad->result.get();
+  songLoad.reset();
+
+  if (song.ats == nullptr) {
+    std::cerr << "Unable to load ATS file " << path << ": " << song.error << std::endl;
+    loadError = fmt::format("Unable to load {}", std::filesystem::path(path).filename().string());
+    return;
+  }
+
+  swapSong(path, std::move(song));
+}
+
+void Application::swapSong(const std::string &path, LoadedSong song) {
+  // It parses the previous song
+  if (prewarmParse.valid())
+    prewarmParse.wait();
+  prewarmParse = {};
+  prewarmParsing = nullptr;
+
+  ats = std::move(song.ats);
+  beats = std::move(song.beats);
+  jsonDomPeak = song.jsonDomPeak;
+  loadError.clear();
+  playback.reset();
+  songAudio = audiotrip::songAudioPath(path, *ats);
 
-  // Post process
-  beats = ats->computeBeats();
   camera->position.z = INITIAL_DISTANCE; // Go back to the start
   mouseCapture(true);
   std::cout << "Opened ATS file: " << path << std::endl;
 
-  // Clear ribbons cache
-  ribbons.clear();
+  // Clear ribbons cache, writing out the on-disk one of the previous song first
+  clearRibbons();
+  if (gpuRibbons != nullptr)
+    gpuRibbons->clear();
+  ribbonCache.reset();
+  if (std::optional<std::filesystem::path> cacheDir = RibbonCache::defaultDirectory(); cacheDir.has_value())
+    ribbonCache = std::make_unique<RibbonCache>(*cacheDir, path, std::cout);
+  loadWaveform(songAudio);
+  streamedChoreo = nullptr;
+  streamedState = nullptr;
+  choreoStates.clear();
+  choreoStates.resize(ats->choreographies.size());
+  prewarmNext = 0;
+
+  // The prepared lists point into the previous song
+  for (DrawList &list : drawLists)
+    list.clear();
+
+  if (debug)
+    assets.printReport(std::cout);
+  memReportPending = memReport;
 
   // Update GUI
-  std::vector<std::string> choreoNames;
-  choreoNames.reserve(ats->choreographies.size());
-  for (const audiotrip::Choreography &choreo : ats->choreographies)
-    choreoNames.push_back(fmt::format("{} - {}", ats->authorID.displayName, choreo.name));
-
   gui.choreoSelectorActive = 0;
-  gui.setChoreoNames(choreoNames);
+  gui.setChoreoNames(song.choreoNames);
 
   gui.atsTitle = ats->title;
   gui.atsArtist = ats->artist;
+  gui.atsBpmDuration = std::move(song.bpmDuration);
+}
 
-  int bpm = 0;
-  for (const audiotrip::TempoSection &tempoSection : ats->tempoSections) {
-    if (static_cast<int>(tempoSection.beatsPerMinute) > bpm)
-      bpm = static_cast<int>(tempoSection.beatsPerMinute);
+void Application::loadWaveform(const std::string &audioPath) {
+  if (waveformCancel != nullptr)
+    *waveformCancel = true;
+  waveformCancel = nullptr;
+  waveformLoad = {};
+  waveform.reset();
+
+  if (audioPath.empty())
+    return;
+  if (!audio::AudioDecoder::supported(audioPath)) {
+    std::cout << "No waveform for " << audioPath << ": unsupported format" << std::endl;
+    return;
+  }
+
+  // Next to the ribbon packs
+  std::optional<std::filesystem::path> cacheDir = RibbonCache::defaultDirectory();
+  if (cacheDir.has_value())
+    cacheDir = cacheDir->parent_path() / "waveforms";
+
+  waveformCancel = std::make_shared<std::atomic<bool>>(false);
+  waveformLoad = ThreadPool::global().submit([audioPath, cacheDir, cancel = waveformCancel]() {
+    return audio::WaveformPyramid::loadOrDecode(audioPath, cacheDir, cancel.get());
+  });
+}
+
+void Application::pollWaveform() {
+  if (!waveformLoad.valid())
+    return;
+
+  if (ThreadPool::global().size() == 0)
+    ThreadPool::global().runPending(1);
+  if (waveformLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+
+  try {
+    audio::WaveformPyramid pyramid = waveformLoad.get();
+    std::cout << fmt::format("Waveform: {:.1f} s at {} Hz, {} levels, {}",
+                             pyramid.duration(),
+                             pyramid.sampleRate(),
+                             pyramid.levelCount(),
+                             pyramid.fromCache() ? "from the cache" : "decoded")
+              << std::endl;
+    waveform = std::make_unique<WaveformStrip>(std::move(pyramid));
+  } catch (const std::exception &e) {
+    std::cerr << "Unable to load the song audio: " << e.what() << std::endl;
+  }
+  waveformCancel = nullptr;
+}
+
+void Application::startPlayback() {
+  if (playback == nullptr) {
+    try {
+      if (nullAudio) {
+        playback = std::make_unique<audio::NullPlayback>(ats->songEndTimeInSeconds, []() { return GetTime(); });
+      } else if (!songAudio.empty()) {
+        playback = std::make_unique<audio::MusicPlayback>(songAudio,
+                                                          audioLatency.value_or(audio::MusicPlayback::DefaultLatency));
+      } else {
+        std::cerr << "The song has no audio to play" << std::endl;
+        return;
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Unable to play the song audio: " << e.what() << std::endl;
+      return;
+    }
+    playbackClock.setLatency(playback->latency());
+  }
+
+  // The camera starts behind the first beat, at the same distance as when the song is opened
+  double seconds = std::max(0.0f, choreo().metersToSeconds(camera->position.z - INITIAL_DISTANCE));
+  playback->play(seconds);
+  lastPlaybackFrame = GetTime();
+  playbackClock.reset(seconds, lastPlaybackFrame);
+}
+
+void Application::updatePlayback() {
+  if (!playing())
+    return;
+  AllocationTracker::Scope scope("playback");
+
+  playback->update();
+  double now = GetTime();
+  double seconds = playbackClock.update(playback->position(), now);
+
+  // Moved after the camera update, its target has to follow or the view would turn
+  float z = INITIAL_DISTANCE + choreo().secondsToMeters(static_cast<float>(seconds));
+  camera->target.z += z - camera->position.z;
+  camera->position.z = z;
+
+  if (playbackLog != nullptr) {
+    // Only the simulated device knows what is heard, a real one is estimated from its last callback
+    auto *null = dynamic_cast<audio::NullPlayback *>(playback.get());
+    playbackFrame = { now, now - lastPlaybackFrame, null != nullptr ? null->heard() : playbackClock.target() };
   }
+  lastPlaybackFrame = now;
+}
+
+void Application::logPlaybackFrame() {
+  if (!playbackFrame.has_value())
+    return;
+
+  // The camera that was drawn, rather than the one computed above, so that the log measures what is on screen
+  double seconds = choreo().metersToSeconds(drawnCameraZ - INITIAL_DISTANCE);
+  playbackLog->frame(playbackFrame->time, playbackFrame->seconds, playbackFrame->heard, seconds);
+  playbackFrame.reset();
+}
+
+MemoryReport Application::memoryReport() const {
+  MemoryReport report;
+  report.add(MemoryReport::SubsystemJsonDom, { jsonDomPeak, 0, 0 });
 
-  gui.atsBpmDuration = fmt::format("{}bpm - {}:{:>02}",
-                                   static_cast<int>(bpm),
-                                   static_cast<int>(ats->songEndTimeInSeconds) / 60,
-                                   static_cast<int>(ats->songEndTimeInSeconds) % 60);
+  if (ats != nullptr) {
+    const std::vector<audiotrip::Choreography> &choreographies = ats->choreographies;
+    report.add(MemoryReport::SubsystemEvents, { MemoryReport::vectorBytes(choreographies), 0, 0 });
+    for (size_t i = 0; i < choreographies.size(); i++) {
+      // Its events are being written, and its JSON released, on a worker
+      if (&choreographies[i] == prewarmParsing)
+        continue;
+
+      report.add(MemoryReport::SubsystemEvents, eventMemory(choreographies[i]));
+
+      // Choreographies that aren't parsed yet share the JSON of the whole song, count it once
+      const std::string *source = choreographies[i].source();
+      bool counted = std::any_of(choreographies.begin(),
+                                 choreographies.begin() + static_cast<std::ptrdiff_t>(i),
+                                 [&](const audiotrip::Choreography &other) {
+                                   return &other != prewarmParsing && other.source() == source;
+                                 });
+      if (source != nullptr && !counted)
+        report.add(MemoryReport::SubsystemSongJson, { source->capacity() + 1, 0, 1 });
+    }
+    report.add(MemoryReport::SubsystemBeats, { MemoryReport::vectorBytes(beats), 0, beats.size() });
+  }
+
+  for (const std::unique_ptr<ChoreoState> &state : choreoStates) {
+    if (state == nullptr)
+      continue;
+
+    MemoryReport::Usage placements;
+    placements.cpuBytes = sizeof(ChoreoState) + MemoryReport::vectorBytes(state->ribbonPlacements) +
+                          state->ribbonInstances.size() *
+                            (sizeof(std::pair<const uint64_t, size_t>) + MemoryReport::HashNodeBytes);
+    placements.objects = state->ribbonPlacements.size();
+    if (state->trajectory != nullptr) {
+      const audiotrip::trajectory::Simulation &trajectory = *state->trajectory;
+      placements.cpuBytes += sizeof(trajectory) + trajectory.paths[0].bytes() + trajectory.paths[1].bytes() +
+                             MemoryReport::vectorBytes(trajectory.hotSpots);
+    }
+    if (state->overlaps != nullptr) {
+      placements.cpuBytes += sizeof(*state->overlaps) + MemoryReport::vectorBytes(state->overlaps->volumes) +
+                             MemoryReport::vectorBytes(state->overlaps->overlaps);
+    }
+    report.add(MemoryReport::SubsystemPlacements, placements);
+    report.add(MemoryReport::SubsystemChunks, state->chunks->memoryUsage());
+  }
+
+  // Pooled ribbons are counted with their blocks, own meshes keep their float arrays unless they are quantized
+  MemoryReport::Usage ribbonMeshes;
+  for (const auto &[meshKey, ribbon] : ribbons) {
+    ribbonMeshes.cpuBytes += sizeof(std::pair<const uint64_t, RibbonMesh>) + MemoryReport::HashNodeBytes;
+    ribbonMeshes.objects++;
+    if (!ribbon.mesh.has_value())
+      continue;
+    auto vertexCount = static_cast<size_t>(ribbon.vertexCount);
+    if (ribbon.mesh->vertices != nullptr)
+      ribbonMeshes.cpuBytes += vertexCount * (3 + 3 + 2) * sizeof(float);
+    ribbonMeshes.gpuBytes += vertexCount * vertex_format::bytesPerVertex(ribbon.format);
+  }
+  if (ribbonPool != nullptr)
+    ribbonMeshes.gpuBytes += ribbonPool->stats().bytes;
+  report.add(MemoryReport::SubsystemRibbons, ribbonMeshes);
+  if (gpuRibbons != nullptr)
+    report.add(MemoryReport::SubsystemRibbons, gpuRibbons->memoryUsage());
+  if (ribbonCache != nullptr)
+    report.add(MemoryReport::SubsystemRibbonCache, ribbonCache->memoryUsage());
+
+  report.add(MemoryReport::SubsystemModels, assets.memoryUsage(AssetRegistry::AssetKindModel));
+  report.add(MemoryReport::SubsystemTextures, assets.memoryUsage(AssetRegistry::AssetKindTexture));
+  if (skybox != nullptr)
+    report.add(MemoryReport::SubsystemTextures, skybox->MemoryUsage());
+  if (waveform != nullptr)
+    report.add(MemoryReport::SubsystemWaveform, waveform->memoryUsage());
+
+  return report;
 }
@@ -0,0 +1,322 @@
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Libraries
+#include "raylib-cpp.hpp"
+
+// Local includes
+#include "Application.h"
+#include "raylib_ext/scoped.h"
+#include "rendering/event_placement.h"
+#include "rendering/ribbon_helpers.h"
+#include "splines/spline3d.h"
+
+/// Size of the offscreen renders compared by the checks
+static constexpr int CheckWidth = 400;
+static constexpr int CheckHeight = 300;
+
+/// Cleared to before drawing, none of the models and textures use it
+static constexpr Color CheckBackground = { 255, 0, 255, 255 };
+
+/// Channel difference below which two covered pixels are considered the same, for rounding and filtering
+static constexpr int ColorTolerance = 8;
+
+namespace {
+
+/// Ribbon of the checks, relative to its first gem like the ones of a song
+struct CheckRibbon {
+  std::vector<splines::Spline3D> splines;
+  bool rhs;
+  float textureScale;
+  Vector3 center; // Of the gems
+  float extent; // Distance from the center to the farthest gem
+};
+
+/// Pixels of two renders of the same scene that don't match
+struct ImageDiff {
+  size_t covered = 0; // Not the background in either render
+  size_t coverage = 0; // The background in only one of them
+  size_t color = 0; // Covered in both, but a channel is off by more than `ColorTolerance`
+
+  [[nodiscard]] float coverageRatio() const { return covered > 0 ? static_cast<float>(coverage) / covered : 1.0f; }
+  [[nodiscard]] float colorRatio() const { return covered > 0 ? static_cast<float>(color) / covered : 1.0f; }
+};
+
+} // namespace
+
+/// Ribbons of every length up to `maxSegments`, alternating hands, wiggling around like in songs. Always the same ones.
+static std::vector<CheckRibbon> checkRibbons(size_t maxSegments) {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> offset(-0.3f, 0.3f);
+  std::uniform_real_distribution<float> step(0.2f, 0.8f);
+
+  std::vector<CheckRibbon> result;
+  for (size_t segments : { 1, 2, 3, 5, 8, 12, 20, 32 }) {
+    if (segments > maxSegments)
+      break;
+
+    std::vector<raylib::Vector3> points = { { 0, 0, 0 } };
+    for (size_t i = 0; i < segments; i++)
+      points.push_back(raylib::Vector3{ offset(random), offset(random), points.back().z + step(random) });
+
+    raylib::Vector3 center = { 0, 0, 0 };
+    for (const raylib::Vector3 &point : points)
+      center += point / static_cast<float>(points.size());
+    float extent = 0;
+    for (const raylib::Vector3 &point : points)
+      extent = std::max(extent, point.Distance(center));
+
+    bool rhs = result.size() % 2 == 1;
+    result.push_back({ splines::Spline3D::FromPoints(points), rhs, static_cast<float>(segments), center, extent });
+  }
+  return result;
+}
+
+/// Cross-section of the ribbons of a hand, tilted like `genOrGetRibbon()` does
+static const std::vector<raylib::Vector3> &tiltedShape(const std::vector<raylib::Vector3> &shape, bool rhs) {
+  static const std::vector<raylib::Vector3> lhsSliceShape = ribbons::rotateShapeAroundZAxis(shape, PI / 6.0);
+  static const std::vector<raylib::Vector3> rhsSliceShape = ribbons::rotateShapeAroundZAxis(shape, -PI / 6.0);
+  return rhs ? rhsSliceShape : lhsSliceShape;
+}
+
+/// Side, front and top views of what's around `center`, far enough to see all of it
+static std::vector<Camera3D> checkViews(Vector3 center, float extent) {
+  float distance = extent + 1.5f;
+  std::vector<Camera3D> views;
+  for (Vector3 direction : { Vector3{ 1, 0.5f, 0 }, Vector3{ 0.2f, 0.5f, -1 }, Vector3{ 0.1f, 1, 0.3f } }) {
+    Camera3D camera{};
+    camera.position = Vector3Add(center, Vector3Scale(Vector3Normalize(direction), distance));
+    camera.target = center;
+    camera.up = { 0, 1, 0 };
+    camera.fovy = 60;
+    camera.projection = CAMERA_PERSPECTIVE;
+    views.push_back(camera);
+  }
+  return views;
+}
+
+static ImageDiff compareImages(const std::vector<Color> &a, const std::vector<Color> &b) {
+  auto background = [](Color color) {
+    return color.r == CheckBackground.r && color.g == CheckBackground.g && color.b == CheckBackground.b;
+  };
+
+  ImageDiff diff;
+  for (size_t i = 0; i < a.size(); i++) {
+    bool aCovered = !background(a[i]);
+    bool bCovered = !background(b[i]);
+    if (!aCovered && !bCovered)
+      continue;
+
+    diff.covered++;
+    if (aCovered != bCovered) {
+      diff.coverage++;
+      continue;
+    }
+
+    int channelDiff = std::max({ std::abs(a[i].r - b[i].r), std::abs(a[i].g - b[i].g), std::abs(a[i].b - b[i].b) });
+    if (channelDiff > ColorTolerance)
+      diff.color++;
+  }
+  return diff;
+}
+
+/// Two of every static model: barriers, and gems, drums and dirgems of both hands
+static std::vector<audiotrip::ChoreoEvent> checkEvents() {
+  std::vector<audiotrip::ChoreoEvent> events;
+  for (int type : { audiotrip::ChoreoEventTypeBarrier,
+                    audiotrip::ChoreoEventTypeGemL,
+                    audiotrip::ChoreoEventTypeGemR,
+                    audiotrip::ChoreoEventTypeDrumL,
+                    audiotrip::ChoreoEventTypeDrumR,
+                    audiotrip::ChoreoEventTypeDirGemL,
+                    audiotrip::ChoreoEventTypeDirGemR }) {
+    for (float x : { -0.4f, 0.4f }) {
+      Json::Value event;
+      event["type"] = type;
+      event["position"]["x"] = x;
+      event["position"]["y"] = type == audiotrip::ChoreoEventTypeBarrier ? 0.0f : 1.2f;
+      event["position"]["z"] = 0;
+      events.emplace_back(event);
+    }
+  }
+  return events;
+}
+
+/// Prints how a pair of renders compare, returns whether they are within the limits
+static bool reportDiff(const std::string &name, const ImageDiff &diff, float maxCoverage, float maxColor) {
+  bool ok = diff.covered > 0 && diff.coverageRatio() <= maxCoverage && diff.colorRatio() <= maxColor;
+  std::cout << fmt::format("{}: {} pixels, {:.2f}% only drawn in one, {:.2f}% of another color, {}",
+                           name,
+                           diff.covered,
+                           diff.coverageRatio() * 100,
+                           diff.colorRatio() * 100,
+                           diff.covered == 0 ? "NOTHING DRAWN" : (ok ? "ok" : "DIFFERENT"))
+            << std::endl;
+  return ok;
+}
+
+void Application::finishStartupNow() {
+  while (!startup->poll())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  finishStartup();
+}
+
+std::vector<Color> Application::renderOffscreen(const Camera3D &view, const std::function<void()> &submit) {
+  RenderTexture2D target = LoadRenderTexture(CheckWidth, CheckHeight);
+  {
+    raylib_ext::scoped::TextureMode textureMode(target);
+    ClearBackground(CheckBackground);
+
+    float viewPos[] = { view.position.x, view.position.y, view.position.z };
+    SetShaderValue(*shader, shader->locs[SHADER_LOC_VECTOR_VIEW], viewPos, SHADER_UNIFORM_VEC3);
+
+    raylib_ext::scoped::Mode3D mode3d(view);
+    renderQueue.begin(view.position);
+    submit();
+    renderQueue.execute();
+  }
+
+  Image image = LoadImageFromTexture(target.texture);
+  Color *colors = LoadImageColors(image);
+  std::vector<Color> result(colors, colors + static_cast<size_t>(image.width) * image.height);
+  UnloadImageColors(colors);
+  UnloadImage(image);
+  UnloadRenderTexture(target);
+  return result;
+}
+
+int Application::checkGpuRibbons() {
+  finishStartupNow();
+  if (gpuRibbons == nullptr) {
+    std::cerr << "The ribbon shader couldn't be loaded" << std::endl;
+    return 1;
+  }
+  // The CPU meshes are compared in the format the shader output is closest to
+  setVertexFormat(vertex_format::FormatFloat);
+
+  bool ok = true;
+  uint64_t key = 0;
+  for (const CheckRibbon &ribbon : checkRibbons(GpuRibbons::MaxSegments)) {
+    gpuRibbons->add(++key, ribbon.splines, ribbon.rhs, ribbon.textureScale);
+    // Sliced as finely as the shader does, so that only the extrusion is compared
+    raylib::Mesh cpuMesh = ribbons::createRibbonMesh(tiltedShape(ribbonShape(), ribbon.rhs),
+                                                     ribbon.splines,
+                                                     GpuRibbons::SlicesPerSegment,
+                                                     ribbon.textureScale);
+
+    std::vector<Camera3D> views = checkViews(ribbon.center, ribbon.extent);
+    for (size_t i = 0; i < views.size(); i++) {
+      std::vector<Color> gpu = renderOffscreen(views[i], [&]() {
+        gpuRibbons->submit(renderQueue, key, MatrixIdentity(), ribbon.center, WHITE);
+      });
+      std::vector<Color> cpu = renderOffscreen(views[i], [&]() {
+        renderQueue.submit(RenderQueue::PassTransparent, cpuMesh, *ribbonMaterial, MatrixIdentity(), ribbon.center);
+      });
+
+      std::string name = fmt::format("{} segments, {} hand, view {}",
+                                     ribbon.splines.size(),
+                                     ribbon.rhs ? "right" : "left",
+                                     i + 1);
+      // Both are rasterized from the same slices, only rounding differs
+      ok = reportDiff(name, compareImages(gpu, cpu), 0.005f, 0.005f) && ok;
+    }
+  }
+  gpuRibbons->clear();
+
+  std::cout << (ok ? "GPU ribbons match the CPU ones" : "GPU ribbons DIFFER from the CPU ones") << std::endl;
+  return ok ? 0 : 1;
+}
+
+int Application::checkQuantizedVertices() {
+  finishStartupNow();
+  if (!vertex_format::supported()) {
+    std::cerr << "Quantized vertices need vertex array objects, which are not available" << std::endl;
+    return 1;
+  }
+
+  // The shaders are switched between the formats instead of the meshes, both are kept loaded
+  auto useFormat = [&](vertex_format::Format format) {
+    litLocations.setFormat(*shader, format);
+    unlitLocations.setFormat(*unlitShader, format);
+  };
+
+  // The static models, through the chunks they are drawn from in songs, a meter apart
+  placement::PlacementBatch batch;
+  std::vector<audiotrip::ChoreoEvent> events = checkEvents();
+  for (size_t i = 0; i < events.size(); i++)
+    batch.placeEvent(events[i], static_cast<float>(i), { 0, 0, 0 });
+  float length = static_cast<float>(events.size());
+  ChunkStreamer::ChunkSpec spec = { -1.0f, length, batch.compose() };
+  ChunkStreamer::Palette palette = { gui.lhsColorPickerValue, gui.rhsColorPickerValue, gui.barrierColorPickerValue };
+
+  std::array<std::unique_ptr<ChunkStreamer>, 2> chunks; // Float, then quantized
+  for (vertex_format::Format format : { vertex_format::FormatFloat, vertex_format::FormatQuantized }) {
+    std::unique_ptr<ChunkStreamer> &streamer = chunks[format == vertex_format::FormatQuantized ? 1 : 0];
+    streamer = std::make_unique<ChunkStreamer>(ThreadPool::global(), staticGeometry);
+    streamer->setVertexFormat(format, litLocations, unlitLocations);
+    streamer->setPalette(palette);
+    streamer->reset({ spec });
+    while (streamer->stats().loaded == 0) {
+      streamer->update(length / 2);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  bool ok = true;
+  std::vector<Camera3D> views = checkViews({ 0, 1, length / 2 }, length / 2 + 1);
+  for (size_t i = 0; i < views.size(); i++) {
+    std::array<std::vector<Color>, 2> images;
+    for (size_t format = 0; format < 2; format++) {
+      useFormat(format == 1 ? vertex_format::FormatQuantized : vertex_format::FormatFloat);
+      images[format] = renderOffscreen(views[i], [&]() {
+        chunks[format]->enqueue(renderQueue, gemModel->materials[0], gemModel->materials[1]);
+      });
+    }
+    // Positions move by up to half a step of their mesh bounds, which flips pixels along the edges
+    std::string name = fmt::format("Static models, view {}", i + 1);
+    ok = reportDiff(name, compareImages(images[0], images[1]), 0.005f, 0.02f) && ok;
+  }
+
+  // The ribbons, with their own bounds and texture coordinates that go past 1
+  for (const CheckRibbon &ribbon : checkRibbons(GpuRibbons::MaxSegments)) {
+    ribbons::RibbonGeometry geometry = ribbons::generateRibbonGeometry(
+      tiltedShape(ribbonShape(), ribbon.rhs), ribbon.splines, GpuRibbons::SlicesPerSegment, ribbon.textureScale);
+    raylib::Mesh floatMesh = ribbons::uploadRibbonMesh(geometry);
+    vertex_format::QuantizedAttributes quantized = vertex_format::quantize(
+      geometry.vertexCount(), geometry.vertices.data(), geometry.normals.data(), geometry.texcoords.data());
+    raylib::Mesh quantizedMesh = vertex_format::upload(quantized, {}, {});
+    std::array<RenderQueue::Uniform, 3> uniforms = unlitLocations.uniforms(quantized.dequantization);
+
+    std::vector<Camera3D> ribbonViews = checkViews(ribbon.center, ribbon.extent);
+    for (size_t i = 0; i < ribbonViews.size(); i++) {
+      useFormat(vertex_format::FormatFloat);
+      std::vector<Color> floats = renderOffscreen(ribbonViews[i], [&]() {
+        renderQueue.submit(RenderQueue::PassTransparent, floatMesh, *ribbonMaterial, MatrixIdentity(), ribbon.center);
+      });
+      useFormat(vertex_format::FormatQuantized);
+      std::vector<Color> quantizedImage = renderOffscreen(ribbonViews[i], [&]() {
+        renderQueue.submit(RenderQueue::PassTransparent,
+                           quantizedMesh,
+                           *ribbonMaterial,
+                           MatrixIdentity(),
+                           ribbon.center,
+                           WHITE,
+                           uniforms);
+      });
+
+      std::string name = fmt::format("{} segment ribbon, view {}", ribbon.splines.size(), i + 1);
+      ok = reportDiff(name, compareImages(floats, quantizedImage), 0.005f, 0.02f) && ok;
+    }
+  }
+  useFormat(vertexFormat);
+
+  std::cout << (ok ? "Quantized vertices match the float ones" : "Quantized vertices DIFFER from the float ones")
+            << std::endl;
+  return ok ? 0 : 1;
+}
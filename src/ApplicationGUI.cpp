@@ -4,8 +4,93 @@
 
 #include "Application.h"
 
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
 namespace raygui {
 #include "raygui.h"
 }
 
-#include "GUIState.h"
\ No newline at end of file
+#include "GUIState.h"
+
+void Application::updateLibrary() {
+  if (libraryLoad.valid() && libraryLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    library = libraryLoad.get();
+    libraryQuery.clear();
+    libraryResults.clear();
+
+    if (!libraryRefreshed) {
+      // Songs are summarized on a pool of their own, so that they don't hold up loading the one that's picked
+      libraryRefreshed = true;
+      libraryLoad = ThreadPool::global().submit([directory = library->root()]() {
+        auto index = std::make_unique<audiotrip::LibraryIndex>(directory);
+        index->load();
+        ThreadPool pool;
+        audiotrip::LibraryIndex::RefreshStats stats = index->refresh(pool, std::cout);
+        if (stats.parsed > 0 || stats.removed > 0)
+          index->save(std::cout);
+        std::cout << fmt::format("Library: {} songs, {} parsed, {} removed", stats.files, stats.parsed, stats.removed)
+                  << std::endl;
+        return index;
+      });
+    }
+    searchLibrary();
+  }
+
+  if (library == nullptr)
+    return;
+
+  if (libraryQuery != gui.librarySearchText)
+    searchLibrary();
+
+  if (gui.libraryListActive >= 0 && static_cast<size_t>(gui.libraryListActive) < libraryResults.size()) {
+    openAts((library->root() / libraryResults[gui.libraryListActive]->path).string());
+    gui.libraryListActive = -1;
+  }
+}
+
+void Application::searchLibrary() {
+  // More than fit in the list aren't useful, the query is refined instead
+  constexpr size_t maxResults = 200;
+
+  libraryQuery = gui.librarySearchText;
+  libraryResults = library->search(libraryQuery, maxResults);
+
+  std::vector<std::string> items;
+  items.reserve(libraryResults.size());
+  for (const audiotrip::LibraryIndex::Entry *entry : libraryResults) {
+    if (entry->title.empty())
+      items.push_back(entry->path);
+    else
+      items.push_back(entry->artist.empty() ? entry->title : fmt::format("{} - {}", entry->title, entry->artist));
+  }
+  gui.setLibraryResults(items);
+
+  size_t songs = std::count_if(library->entries().begin(),
+                               library->entries().end(),
+                               [](const audiotrip::LibraryIndex::Entry &entry) { return entry.valid; });
+  std::string shown = libraryResults.size() == maxResults ? fmt::format("{}+", maxResults)
+                                                          : std::to_string(libraryResults.size());
+  gui.libraryStatus = fmt::format("{} of {} songs{}", shown, songs, libraryLoad.valid() ? ", indexing..." : "");
+}
+
+void Application::showMetrics(const audiotrip::metrics::Metrics &metrics) {
+  const audiotrip::metrics::HandMetrics &lhs = metrics.hands[0];
+  const audiotrip::metrics::HandMetrics &rhs = metrics.hands[1];
+  auto peakTime = static_cast<int>(metrics.peakNpsTime);
+
+  gui.metricsLines = {
+    fmt::format("Notes: {} (L {}, R {}), barriers: {}", metrics.notes, lhs.notes, rhs.notes, metrics.barriers),
+    fmt::format("Notes per second: {:.2f} average, {:.2f} peak at {}:{:02}",
+                metrics.averageNps,
+                metrics.peakNps,
+                peakTime / 60,
+                peakTime % 60),
+    fmt::format("Hand travel: L {:.1f} m, R {:.1f} m", lhs.travel, rhs.travel),
+    fmt::format("Along ribbons: L {:.1f} m, R {:.1f} m", lhs.ribbonTravel, rhs.ribbonTravel),
+    fmt::format("Crossovers: {}, hand switches: {}", metrics.crossovers, metrics.handSwitches),
+    fmt::format("Barriers per minute: {:.1f}", metrics.barriersPerMinute),
+  };
+}
@@ -4,6 +4,12 @@
 
 // STL includes
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
 #include <optional>
 
 // Library includes
@@ -15,6 +21,7 @@ namespace rlgl {
 
 // Local includes
 #include "Application.h"
+#include "audiotrip/utils.h"
 #include "raylib_ext/text3d.h"
 #include "rendering/ribbon_helpers.h"
 #include "splines/spline3d.h"
@@ -35,40 +42,21 @@ static const std::vector<raylib::Vector3> RibbonShape{
   { 0.06763590399999997f, -0.03723645799999998f, 0.0f }
 };
 
-/**
- * Nasty trick to load a brand new color material from materials.mtl since raylib is partially broken.
- * Load a fake model and then steal the material from it.
- * @return
- */
-static void applyMaterialsMtl(raylib::Model &model) {
-  // Unload old model materials
-  for (int i = 0; i < model.materialCount; i++) {
-    auto &material = reinterpret_cast<raylib::Material &>(model.materials[i]);
-    material.Unload();
-  }
-  RL_FREE(model.materials);
-
-  // Load fake model
-  raylib::Model tempModel("resources/models/ribbon_fake_model.obj");
-
-  // Transfer materials
-  model.materialCount = tempModel.materialCount;
-  model.materials = tempModel.materials;
-
-  // Prevent materials from being unloaded
-  tempModel.materialCount = 0;
-  tempModel.materials = nullptr;
-
-  // Destructor will unload the temp model
-}
-
 /**
  * Draws the choreography floor around the camera. The floor is actually centered around the camera and it follows it.
  * It is made to appear static and infinite with texture trickery.
  * @param texture
  * @param camera
+ * @param waveform of the song audio, drawn beside the floor on the side opposite to the beat numbers, if loaded
+ * @param metersPerSecond gem speed of the choreography, to line the waveform up with the events
  */
-static void drawChoreoFloor(raylib::Texture2D &texture, const raylib::Camera &camera) {
+static void drawChoreoFloor(raylib::Texture2D &texture,
+                            const Camera3D &camera,
+                            WaveformStrip *waveform,
+                            float metersPerSecond) {
+  if (waveform != nullptr)
+    waveform->draw(camera, metersPerSecond, PLAYER_HEIGHT / 2 + 0.05f, 0.5f, { 200, 220, 255, 160 });
+
   rlgl::rlCheckRenderBatchLimit(4);
 
   // NOTE: Plane is always created on XZ ground
@@ -116,7 +104,17 @@ static void drawChoreoFloor(raylib::Texture2D &texture, const raylib::Camera &ca
 void Application::drawSplash() {
   ClearBackground(WHITE);
 
-  const char *text = "Drag and drop an ATS file on this window";
+  // Songs can be picked from the library before any is open
+  if (startup == nullptr)
+    gui.DrawLibrary();
+
+  // The song keeps loading in the background during startup
+  if (startup == nullptr && songLoad.has_value()) {
+    drawLoadProgress(window->GetHeight() / 2 - 10, BLACK);
+    return;
+  }
+
+  const char *text = startup != nullptr ? "Loading..." : "Drag and drop an ATS file on this window";
 
   Vector2 textSize = MeasureTextEx(GetFontDefault(), text, 20, 1);
   int textWidth = static_cast<int>(textSize.x);
@@ -126,180 +124,726 @@ void Application::drawSplash() {
   int posY = window->GetHeight() / 2 - textHeight / 2;
 
   DrawText(text, posX, posY, 20, BLACK);
+
+  if (startup != nullptr) {
+    constexpr int barWidth = 200;
+    constexpr int barHeight = 6;
+    int barX = window->GetWidth() / 2 - barWidth / 2;
+    int barY = posY + textHeight + 12;
+
+    DrawRectangleLines(barX, barY, barWidth, barHeight, BLACK);
+    DrawRectangle(barX, barY, static_cast<int>(barWidth * startup->progress()), barHeight, BLACK);
+  } else if (!loadError.empty()) {
+    int errorWidth = MeasureText(loadError.c_str(), 20);
+    DrawText(loadError.c_str(), window->GetWidth() / 2 - errorWidth / 2, posY + textHeight + 12, 20, RED);
+  }
 }
-void Application::drawChoreo() {
+
+void Application::drawLoadProgress(int y, Color color) {
+  std::string text = fmt::format("Loading {}...", std::filesystem::path(songLoad->path).filename().string());
+  int textWidth = MeasureText(text.c_str(), 20);
+  DrawText(text.c_str(), window->GetWidth() / 2 - textWidth / 2, y, 20, color);
+
+  constexpr int barWidth = 200;
+  constexpr int barHeight = 6;
+  int barX = window->GetWidth() / 2 - barWidth / 2;
+  int barY = y + 20 + 12;
+
+  DrawRectangleLines(barX, barY, barWidth, barHeight, color);
+  DrawRectangle(barX, barY, static_cast<int>(barWidth * songLoad->progress->load()), barHeight, color);
+}
+
+Application::FrameInputs Application::frameInputs() {
+  return {
+    &choreo(), &streamedState->ribbonPlacements, *camera, gui.lhsColorPickerValue, gui.rhsColorPickerValue
+  };
+}
+
+void Application::prepareFrame(const FrameInputs &inputs, DrawList &list) const {
+  AllocationTracker::Scope scope("prepareFrame");
+  auto start = std::chrono::steady_clock::now();
+
+  list.clear();
+  list.choreo = inputs.choreo;
+
+  // The list is drawn in the next frame, with the camera of that frame
+  const audiotrip::Choreography &choreography = *inputs.choreo;
+  float minDistance = inputs.camera.position.z - MAX_RENDER_DISTANCE - ChunkStreamer::PrefetchDistance;
+  float maxDistance = inputs.camera.position.z + MAX_RENDER_DISTANCE + ChunkStreamer::PrefetchDistance;
+
+  for (int beatNum = 1; beatNum <= static_cast<int>(beats.size()); beatNum++) {
+    float beatDistance = choreography.secondsToMeters(beats[beatNum - 1].time);
+    if (beatDistance > maxDistance || beatDistance < minDistance)
+      continue;
+
+    list.beatLabels.push_back({ beatNum, beatDistance });
+  }
+
+  // Ribbon bodies are the only part of the events that isn't baked into the chunks
+  for (const RibbonPlacement &ribbon : *inputs.ribbonPlacements) {
+    if (ribbon.distance > maxDistance || ribbon.distance < minDistance)
+      continue;
+
+    Color tint = ribbon.event->isRHS() ? inputs.rhsColor : inputs.lhsColor;
+    tint.a = 0xA0;
+    Vector3 center = { ribbon.transform.m12, ribbon.transform.m13, ribbon.transform.m14 };
+    list.ribbons.push_back({ ribbon.event, ribbon.meshKey, ribbon.transform, center, tint });
+  }
+
+  list.prepareSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Application::drawChoreo(const DrawList &list) {
   ClearBackground(GRAY);
 
+  float cameraPosValue[] = { camera->position.x, camera->position.y, camera->position.z };
+  SetShaderValue(*shader, shader->locs[SHADER_LOC_VECTOR_VIEW], cameraPosValue, SHADER_UNIFORM_VEC3);
+
   {
     raylib_ext::scoped::Mode3D mode3d(*camera);
+    drawnCameraZ = camera->position.z;
 
     skybox->Draw();
 
-    drawChoreoFloor(*floorTexture, *camera);
+    drawChoreoFloor(*floorTexture, *camera, waveform.get(), list.choreo->secondsToMeters(1.0f));
 
-    float minDistance = camera->position.z - MAX_RENDER_DISTANCE;
-    float maxDistance = camera->position.z + MAX_RENDER_DISTANCE;
+    for (const DrawList::BeatLabel &label : list.beatLabels) {
+      raylib_ext::scoped::Matrix translateM;
+      rlgl::rlTranslatef(-PLAYER_HEIGHT / 2 - 0.1f, 0, label.distance + beatNumbersSize.z / 2.0f);
+      {
+        raylib_ext::scoped::Matrix rotateM;
+        rlgl::rlRotatef(180, 0, 1, 0);
+
+        // Written in place, not to allocate a string per label
+        std::array<char, 16> number{};
+        std::to_chars(number.data(), number.data() + number.size() - 1, label.number);
+        raylib_ext::text3d::DrawText3D(GetFontDefault(),
+                                       number.data(),
+                                       { 0, 0, 0 },
+                                       8,
+                                       1,
+                                       0,
+                                       false,
+                                       BLUE);
+      }
+    }
+
+    // Adding a ribbon to the pool can compact it, moving the ranges of the ribbons already queued: generate them all
+    // before queueing any
+    FrameArena::Vector<uint8_t> onGpu = scratch.vector<uint8_t>();
+    onGpu.reserve(list.ribbons.size());
+    for (const DrawList::Ribbon &ribbon : list.ribbons)
+      onGpu.push_back(prepareRibbon(choreo(), *ribbon.event, ribbon.meshKey) ? 1 : 0);
+
+    renderQueue.begin(camera->position);
+    streamedState->chunks->enqueue(renderQueue, gemModel->materials[0], gemModel->materials[1]);
+
+    for (size_t i = 0; i < list.ribbons.size(); i++)
+      submitRibbon(list.ribbons[i], onGpu[i] != 0);
+
+    renderQueue.execute();
 
-    // Draw beat numbers
-    for (int beatNum = 1; beatNum <= beats.size(); beatNum++) {
-      float beatTime = beats[beatNum - 1].time;
-      float beatDistance = choreo().secondsToMeters(beatTime);
+    if (showTrajectories && streamedState->trajectory != nullptr)
+      drawTrajectories(*camera);
+    if (showOverlaps && streamedState->overlaps != nullptr)
+      drawOverlaps(*camera);
+  }
+
+  {
+    AllocationTracker::Scope scope("gui");
+    gui.Draw();
+    gui.DrawLibrary();
+  }
+
+  // The current song stays up until the new one is swapped in
+  if (songLoad.has_value())
+    drawLoadProgress(8, WHITE);
+
+  if (mouseCaptured) {
+    DrawText("M - Press M to release mouse", 8, window->GetHeight() - 20, 15, WHITE);
+  }
 
-      if (beatDistance > maxDistance || beatDistance < minDistance)
+  if (debug) {
+    ChunkStreamer::Stats stats = streamedState->chunks->stats();
+    DrawText(TextFormat("Chunks: %zu/%zu loaded, %zu building, %zu meshes, %.1f MiB, %zu draw calls",
+                        stats.loaded,
+                        stats.chunks,
+                        stats.building,
+                        stats.meshes,
+                        static_cast<double>(stats.bytes) / (1024.0 * 1024.0),
+                        stats.drawCalls),
+             8,
+             window->GetHeight() - 40,
+             15,
+             WHITE);
+
+    const RenderQueue::Stats &queueStats = renderQueue.stats();
+    DrawText(TextFormat("Render queue: %zu commands, %zu draws, binds: %zu shader, %zu texture, %zu vertex array, "
+                        "%zu state changes",
+                        queueStats.commands,
+                        queueStats.drawCalls,
+                        queueStats.shaderBinds,
+                        queueStats.textureBinds,
+                        queueStats.vertexArrayBinds,
+                        queueStats.stateChanges),
+             8,
+             window->GetHeight() - 60,
+             15,
+             WHITE);
+
+    // Ribbon meshes are not indexed and have positions, normals and texture coordinates
+    size_t uploadedBytes = 0;
+    size_t savedBytes = 0;
+    size_t ribbonVertices = 0;
+    for (const auto &[meshKey, instances] : streamedState->ribbonInstances) {
+      auto it = ribbons.find(meshKey);
+      if (it == ribbons.end())
         continue;
+      const RibbonMesh &ribbon = it->second;
+      size_t bytes = static_cast<size_t>(ribbon.vertexCount) * vertex_format::bytesPerVertex(ribbon.format);
+      uploadedBytes += bytes;
+      savedBytes += bytes * (instances - 1);
+      ribbonVertices += static_cast<size_t>(ribbon.vertexCount);
+    }
+    DrawText(TextFormat("Ribbons: %zu share %zu meshes, %.1f KiB uploaded, %.1f KiB saved, %zu on GPU (%.1f KiB)",
+                        streamedState->ribbonPlacements.size(),
+                        streamedState->ribbonInstances.size(),
+                        static_cast<double>(uploadedBytes) / 1024.0,
+                        static_cast<double>(savedBytes) / 1024.0,
+                        gpuRibbons != nullptr ? gpuRibbons->count() : 0,
+                        static_cast<double>(gpuRibbons != nullptr ? gpuRibbons->bytes() : 0) / 1024.0),
+             8,
+             window->GetHeight() - 100,
+             15,
+             WHITE);
+
+    size_t vertices = stats.vertices + ribbonVertices;
+    DrawText(TextFormat("Vertices (V): %s, %zu B/vertex, %zu vertices, %.1f KiB (%.1f KiB as floats)",
+                        vertex_format::name(vertexFormat),
+                        vertex_format::bytesPerVertex(vertexFormat),
+                        vertices,
+                        static_cast<double>(vertices * vertex_format::bytesPerVertex(vertexFormat)) / 1024.0,
+                        static_cast<double>(vertices * vertex_format::bytesPerVertex(vertex_format::FormatFloat)) /
+                          1024.0),
+             8,
+             window->GetHeight() - 120,
+             15,
+             WHITE);
+
+    if (ribbonPool != nullptr) {
+      RibbonPool::Stats poolStats = ribbonPool->stats();
+      DrawText(TextFormat("Ribbon pool: %zu ribbons in %zu blocks, %.1f%% used, %zu free ranges, %.1f%% fragmented, "
+                          "%zu compactions, %.1f MiB",
+                          poolStats.allocations,
+                          poolStats.blocks,
+                          static_cast<double>(poolStats.occupancy()) * 100.0,
+                          poolStats.freeRanges,
+                          static_cast<double>(poolStats.fragmentation()) * 100.0,
+                          poolStats.compactions,
+                          static_cast<double>(poolStats.bytes) / (1024.0 * 1024.0)),
+               8,
+               window->GetHeight() - 140,
+               15,
+               WHITE);
+    }
 
-      {
-        raylib_ext::scoped::Matrix translateM;
-        rlgl::rlTranslatef(-PLAYER_HEIGHT / 2 - 0.1f, 0, beatDistance + beatNumbersSize.z / 2.0f);
-        {
-          raylib_ext::scoped::Matrix rotateM;
-          rlgl::rlRotatef(180, 0, 1, 0);
-
-          raylib_ext::text3d::DrawText3D(GetFontDefault(),
-                                         std::to_string(beatNum).c_str(),
-                                         { 0, 0, 0 },
-                                         8,
-                                         1,
-                                         0,
-                                         false,
-                                         BLUE);
-        }
+    DrawText(TextFormat("Frame: prepare %.2f ms (worker), submit %.2f ms",
+                        static_cast<double>(list.prepareSeconds) * 1000.0,
+                        static_cast<double>(submitSeconds) * 1000.0),
+             8,
+             window->GetHeight() - 80,
+             15,
+             WHITE);
+
+    if (playing()) {
+      DrawText(TextFormat("Playback (P): %.3f s, %+.2f ms from the last callback, callbacks every %.1f ms, "
+                          "latency %.0f ms",
+                          playbackClock.seconds(),
+                          (playbackClock.seconds() - playbackClock.target()) * 1000.0,
+                          playbackClock.period() * 1000.0,
+                          playbackClock.settings().latency * 1000.0),
+               8,
+               window->GetHeight() - 160,
+               15,
+               WHITE);
+    }
+
+    if (AllocationTracker::enabled()) {
+      AllocationTracker::Counts allocations = AllocationTracker::lastFrame();
+      std::array<AllocationTracker::Site, 1> top{};
+      bool found = AllocationTracker::topSites(top, true) > 0;
+      DrawText(TextFormat("Allocations: %llu last frame (%.1f KiB, %llu frees), %llu of %llu frames allocated, "
+                          "most in %s at %p",
+                          static_cast<unsigned long long>(allocations.allocations),
+                          static_cast<double>(allocations.bytes) / 1024.0,
+                          static_cast<unsigned long long>(allocations.frees),
+                          static_cast<unsigned long long>(AllocationTracker::framesWithAllocations()),
+                          static_cast<unsigned long long>(AllocationTracker::frames()),
+                          found && top[0].scope != nullptr ? top[0].scope : "-",
+                          found ? reinterpret_cast<void *>(top[0].address) : nullptr),
+               8,
+               window->GetHeight() - 180,
+               15,
+               WHITE);
+    }
+
+    if (GetTime() - memoryRefreshed >= 1.0) {
+      memory = memoryReport();
+      memoryRefreshed = GetTime();
+    }
+    // The JSON DOM is gone by now, it's shown on its own
+    auto largest = [this](size_t MemoryReport::Usage::*bytes) {
+      auto subsystem = MemoryReport::SubsystemSongJson;
+      for (int i = MemoryReport::SubsystemSongJson; i < MemoryReport::SubsystemCount; i++) {
+        if (memory[static_cast<MemoryReport::Subsystem>(i)].*bytes > memory[subsystem].*bytes)
+          subsystem = static_cast<MemoryReport::Subsystem>(i);
       }
+      return subsystem;
+    };
+    constexpr double mebibyte = 1024.0 * 1024.0;
+    MemoryReport::Usage total = memory.total();
+    MemoryReport::Subsystem largestCpu = largest(&MemoryReport::Usage::cpuBytes);
+    MemoryReport::Subsystem largestGpu = largest(&MemoryReport::Usage::gpuBytes);
+    DrawText(TextFormat("Memory: %.1f MiB CPU, most in %s (%.1f MiB), %.1f MiB GPU, most in %s (%.1f MiB), "
+                        "JSON DOM peak %.1f MiB",
+                        static_cast<double>(total.cpuBytes) / mebibyte,
+                        MemoryReport::name(largestCpu),
+                        static_cast<double>(memory[largestCpu].cpuBytes) / mebibyte,
+                        static_cast<double>(total.gpuBytes) / mebibyte,
+                        MemoryReport::name(largestGpu),
+                        static_cast<double>(memory[largestGpu].gpuBytes) / mebibyte,
+                        static_cast<double>(memory[MemoryReport::SubsystemJsonDom].cpuBytes) / mebibyte),
+             8,
+             window->GetHeight() - 200,
+             15,
+             WHITE);
+  }
+}
+
+void Application::drawTrajectories(const Camera3D &camera) {
+  // Dense enough for the curves to look smooth at the usual gem speeds
+  constexpr float segmentSeconds = 1.0f / 30.0f;
+
+  const audiotrip::trajectory::Simulation &simulation = *streamedState->trajectory;
+  float gemSpeed = streamedChoreo->secondsToMeters(1.0f);
+  float from = (camera.position.z - MAX_RENDER_DISTANCE) / gemSpeed;
+  float to = (camera.position.z + MAX_RENDER_DISTANCE) / gemSpeed;
+
+  for (size_t hand = 0; hand < simulation.paths.size(); hand++) {
+    const audiotrip::trajectory::HandPath &path = simulation.paths[hand];
+    if (path.empty())
+      continue;
+    Color color = hand == 0 ? gui.lhsColorPickerValue : gui.rhsColorPickerValue;
+
+    auto worldPosition = [&](float seconds) -> Vector3 {
+      raylib::Vector3 position = path.position(seconds);
+      return { -position.x, position.y, streamedChoreo->secondsToMeters(seconds) };
+    };
+
+    float start = std::max(from, path.startTime());
+    float end = std::min(to, path.endTime());
+    Vector3 previous = worldPosition(start);
+    for (float seconds = start + segmentSeconds; seconds < end + segmentSeconds; seconds += segmentSeconds) {
+      float time = std::min(seconds, end);
+      Vector3 current = worldPosition(time);
+      bool fast = Vector3Length(path.velocity(time)) > simulation.options.speedThreshold;
+      DrawLine3D(previous, current, fast ? WHITE : color);
+      previous = current;
     }
-    for (const audiotrip::ChoreoEvent &event : choreo().events) {
-      float beatTime = getBeatTime(static_cast<float>(event.time.beat) + static_cast<float>(event.time.numerator) /
-                                                                           static_cast<float>(event.time.denominator));
-      float beatDistance = choreo().secondsToMeters(beatTime);
+  }
+}
 
-      if (beatDistance > maxDistance || beatDistance < minDistance)
-        continue;
+void Application::drawOverlaps(const Camera3D &camera) {
+  // Boxes of touching volumes can be flat
+  constexpr float margin = 0.05f;
+
+  const std::vector<audiotrip::overlaps::Overlap> &overlaps = streamedState->overlaps->overlaps;
+  float gemSpeed = streamedChoreo->secondsToMeters(1.0f);
+  float from = (camera.position.z - MAX_RENDER_DISTANCE) / gemSpeed;
+  float to = (camera.position.z + MAX_RENDER_DISTANCE) / gemSpeed;
+
+  auto it = std::lower_bound(overlaps.begin(),
+                             overlaps.end(),
+                             from,
+                             [](const audiotrip::overlaps::Overlap &overlap, float seconds) {
+                               return overlap.seconds < seconds;
+                             });
+  for (; it != overlaps.end() && it->seconds <= to; ++it) {
+    const BoundingBox &bounds = it->bounds;
+    DrawBoundingBox({ { bounds.min.x - margin, bounds.min.y - margin, bounds.min.z - margin },
+                      { bounds.max.x + margin, bounds.max.y + margin, bounds.max.z + margin } },
+                    YELLOW);
+  }
+}
+
+void Application::streamChoreo() {
+  // It may be parsing the selected choreography, and the beats must cover it before it's placed
+  finishPrewarmParse(true);
+  MemoryReport::ParseScope parseScope(jsonDomPeak);
+  if (loadEvents(choreo()))
+    beats = ats->computeBeats();
+
+  streamedChoreo = &choreo();
+  std::unique_ptr<ChoreoState> &state = choreoStates.at(gui.choreoSelectorActive);
+  if (state == nullptr)
+    state = placeChoreo(choreo());
+  streamedState = state.get();
+  showMetrics(streamedState->metrics);
+
+  reportRibbonDedup();
+  evictUnusedRibbons();
+}
+
+/**
+ * Measure each beat is in. The beats of a tempo section are the ones from its start time, like `computeBeats()` places
+ * them, and it starts a new measure if it says so; the extra beats past the end keep the last section.
+ */
+static std::vector<size_t> beatMeasures(const audiotrip::AudioTripSong &song,
+                                        const std::vector<audiotrip::Beat> &beats) {
+  std::vector<size_t> result(beats.size());
+  size_t section = 0;
+  size_t measure = 0;
+  int beatInMeasure = 0;
+
+  for (size_t i = 0; i < beats.size(); i++) {
+    bool newMeasure = false;
+    while (section + 1 < song.tempoSections.size() &&
+           beats[i].time >= song.tempoSections[section + 1].startTimeInSeconds) {
+      section++;
+      newMeasure = newMeasure || song.tempoSections[section].doesStartNewMeasure;
+    }
 
-      drawChoreoEventElement(event, beatDistance);
+    const audiotrip::TempoSection &tempo = song.tempoSections[section];
+    int beatsPerMeasure = tempo.beatsPerMeasure > 0 ? tempo.beatsPerMeasure : 4;
+    if (i > 0 && (newMeasure || beatInMeasure >= beatsPerMeasure)) {
+      measure++;
+      beatInMeasure = 0;
     }
+    result[i] = measure;
+    beatInMeasure++;
   }
+  return result;
+}
 
-  gui.Draw();
+std::unique_ptr<Application::ChoreoState> Application::placeChoreo(const audiotrip::Choreography &choreography) {
+  auto state = std::make_unique<ChoreoState>();
+  state->metrics = audiotrip::metrics::compute(choreography, beats);
+  state->chunks = std::make_unique<ChunkStreamer>(ThreadPool::global(), staticGeometry);
+  state->chunks->setVertexFormat(vertexFormat, litLocations, unlitLocations);
 
-  if (mouseCaptured) {
-    DrawText("M - Press M to release mouse", 8, window->GetHeight() - 20, 15, WHITE);
+  // Nothing can be placed without a tempo
+  if (beats.empty())
+    return state;
+
+  // One measure per chunk
+  std::vector<size_t> measures = beatMeasures(*ats, beats);
+  std::vector<ChunkStreamer::ChunkSpec> specs(measures.back() + 1);
+
+  // Transforms are composed for the whole choreography at once, then split into chunks
+  placement::PlacementBatch batch;
+  std::vector<size_t> placementChunks;
+
+  for (const audiotrip::ChoreoEvent &event : choreography.events) {
+    float distance = choreography.secondsToMeters(audiotrip::eventSeconds(beats, event.time));
+
+    Vector3 ribbonEnd = { 0, 0, 0 };
+    if (event.type == audiotrip::ChoreoEventTypeRibbonL || event.type == audiotrip::ChoreoEventTypeRibbonR) {
+      FrameArena::Scope scope(scratch);
+      ribbonEnd = ribbonPositions(choreography, event).back();
+
+      Vector3 v = event.position.vectorWithDistance(distance);
+      uint64_t meshKey = RibbonCache::key(event, ribbonTimes(event), choreography.gemSpeed);
+      state->ribbonPlacements.push_back({ &event, meshKey, MatrixTranslate(v.x, v.y + 0.006f, v.z), distance });
+      state->ribbonInstances[meshKey]++;
+    }
+    size_t chunk = measures[std::min(static_cast<size_t>(std::max(event.time.beat, 0)), measures.size() - 1)];
+    batch.placeEvent(event, distance, ribbonEnd);
+    placementChunks.resize(batch.size(), chunk);
   }
+
+  std::vector<placement::Placement> placements = batch.compose();
+  for (size_t i = 0; i < placements.size(); i++)
+    specs[placementChunks[i]].placements.push_back(placements[i]);
+
+  std::erase_if(specs, [](const ChunkStreamer::ChunkSpec &spec) { return spec.placements.empty(); });
+
+  // The models are all smaller than this around their origin
+  constexpr float modelRadius = 1.0f;
+  for (ChunkStreamer::ChunkSpec &spec : specs) {
+    auto [first, last] = std::minmax_element(
+      spec.placements.begin(), spec.placements.end(), [](const placement::Placement &a, const placement::Placement &b) {
+        return a.transform.m14 < b.transform.m14;
+      });
+    spec.zBegin = first->transform.m14 - modelRadius;
+    spec.zEnd = last->transform.m14 + modelRadius;
+  }
+
+  state->chunks->reset(std::move(specs));
+  return state;
 }
-void Application::drawChoreoEventElement(const audiotrip::ChoreoEvent &event, float distance) {
-  raylib_ext::scoped::Matrix matrix;
-  Vector3 v = event.position.vectorWithDistance(distance);
 
-  if (event.type == audiotrip::ChoreoEventTypeBarrier) {
-    rlgl::rlTranslatef(0, 1.20, v.z);
-    rlgl::rlRotatef(-event.position.z(), 0, 0, 1);
-    rlgl::rlTranslatef(0, 0.45f - v.y, 0);
-    DrawModel(*barrierModel, { 0, 0, 0 }, 1, gui.barrierColorPickerValue);
+void Application::finishPrewarmParse(bool wait) {
+  if (!prewarmParse.valid())
     return;
+
+  if (!wait && ThreadPool::global().size() == 0)
+    ThreadPool::global().runPending(1);
+  if (!wait && prewarmParse.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+
+  jsonDomPeak = std::max(jsonDomPeak, prewarmParse.get());
+  prewarmParsing = nullptr;
+  beats = ats->computeBeats();
+}
+
+void Application::prewarmChoreos() {
+  using Clock = std::chrono::steady_clock;
+  auto budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(PrewarmSecondsPerFrame));
+  auto deadline = Clock::now() + budget;
+  auto pastDeadline = [&]() { return Clock::now() >= deadline; };
+
+  finishPrewarmParse(false);
+
+  // The shown choreography comes first, its chunks and then its ribbons
+  if (streamedState->chunks->stats().building > 0 || !prepareRibbons(*streamedChoreo, *streamedState, deadline))
+    return;
+
+  if (!streamedState->ribbonsReported && ribbonCache != nullptr) {
+    streamedState->ribbonsReported = true;
+    const RibbonCache::Stats &stats = ribbonCache->stats();
+    std::cout << fmt::format("Ribbon cache: {} hits, {} misses once the ribbons of {} are prepared",
+                             stats.hits,
+                             stats.misses,
+                             streamedChoreo->name)
+              << std::endl;
   }
 
-  rlgl::rlTranslatef(v.x, v.y, v.z);
-  {
-    raylib_ext::scoped::Matrix rotation;
-    Color color = event.isRHS() ? gui.rhsColorPickerValue : gui.lhsColorPickerValue;
-
-    switch (event.type) {
-    case audiotrip::ChoreoEventTypeGemL:
-    case audiotrip::ChoreoEventTypeGemR:
-      rlgl::rlRotatef(event.isRHS() ? -30 : 30, 0, 0, 1);
-      rlgl::rlRotatef(180, 0, 1, 0);
-      DrawModel(*gemModel, { 0, 0, 0 }, 1, color);
-      color.a = 0x7f;
-      DrawModel(*gemTrailModel, { 0, 0, 0 }, 1, color);
-      break;
-    case audiotrip::ChoreoEventTypeDrumL:
-    case audiotrip::ChoreoEventTypeDrumR:
-      // Somebody smarter than me please fix the angles, thanks!
-      rlgl::rlRotatef(-event.subPositions.front().y(), 0, 1, 0);
-      rlgl::rlRotatef(event.subPositions.front().x(), 1, 0, 0);
-      rlgl::rlRotatef(180, 0, 1, 0);
-      DrawModel(*drumModel, { 0, 0, 0 }, 1, color);
-      break;
-    case audiotrip::ChoreoEventTypeDirGemL:
-    case audiotrip::ChoreoEventTypeDirGemR:
-      rlgl::rlRotatef(-event.subPositions.front().y(), 0, 1, 0);
-      rlgl::rlRotatef(event.subPositions.front().x(), 1, 0, 0);
-      rlgl::rlRotatef(180, 0, 1, 0);
-      rlgl::rlRotatef(event.isRHS() ? 30 : -30, 0, 0, 1);
-      DrawModel(*dirgemModel, { 0, 0, 0 }, 1, color);
-      break;
-    case audiotrip::ChoreoEventTypeRibbonL:
-    case audiotrip::ChoreoEventTypeRibbonR: {
-      // Ribbon
-      auto [snake, endPosition] = genOrGetRibbon(event, distance);
-      Color snakeColor = color;
-      snakeColor.a = 0xA0;
-      snake.Draw({ 0, 0.006, 0 }, 1, snakeColor);
-      {
-        // Initial gem
-        raylib_ext::scoped::Matrix m;
-        // Move 5cm back so it doesn't intersect the ribbon
-        rlgl::rlTranslatef(0, 0, -0.05);
-        rlgl::rlRotatef(event.isRHS() ? -30 : 30, 0, 0, 1);
-        rlgl::rlRotatef(180, 0, 1, 0);
-        DrawModel(*gemModel, { 0, 0, 0 }, 1, color);
-      }
-      {
-        // Final gem
-        raylib_ext::scoped::Matrix m;
-        rlgl::rlTranslatef(endPosition.x, endPosition.y, endPosition.z);
-        rlgl::rlRotatef(event.isRHS() ? -30 : 30, 0, 0, 1);
-        rlgl::rlRotatef(180, 0, 1, 0);
-        DrawModel(*gemModel, { 0, 0, 0 }, 1, color);
+  ChunkStreamer::Palette palette = { gui.lhsColorPickerValue, gui.rhsColorPickerValue, gui.barrierColorPickerValue };
+  size_t count = ats->choreographies.size();
+  for (size_t step = 0; step < count && !pastDeadline(); step++) {
+    size_t index = (prewarmNext + step) % count;
+    audiotrip::Choreography &choreography = ats->choreographies[index];
+    if (&choreography == streamedChoreo || &choreography == prewarmParsing)
+      continue;
+
+    // Parsed on a worker, one at a time, then placed in a later frame
+    if (!choreography.eventsLoaded()) {
+      if (!prewarmParse.valid()) {
+        prewarmParse = ThreadPool::global().submit([&choreography]() {
+          size_t peak = 0;
+          MemoryReport::ParseScope parseScope(peak);
+          loadEvents(choreography);
+          return peak;
+        });
+        prewarmParsing = &choreography;
       }
-      break;
+      continue;
+    }
+
+    std::unique_ptr<ChoreoState> &state = choreoStates[index];
+    if (state == nullptr) {
+      state = placeChoreo(choreography);
+      prewarmNext = index;
+      return;
     }
-    default:
-      break;
+
+    // Follow the camera, so that the chunks around it are loaded when switching
+    state->chunks->setPalette(palette);
+    state->chunks->update(camera->position.z);
+
+    prepareRibbons(choreography, *state, deadline);
+    prewarmNext = index;
+  }
+}
+
+bool Application::prepareRibbons(const audiotrip::Choreography &choreography,
+                                 ChoreoState &state,
+                                 std::chrono::steady_clock::time_point deadline) {
+  while (state.preparedRibbons < state.ribbonPlacements.size() && std::chrono::steady_clock::now() < deadline) {
+    const RibbonPlacement &ribbon = state.ribbonPlacements[state.preparedRibbons++];
+    prepareRibbon(choreography, *ribbon.event, ribbon.meshKey);
+  }
+  return state.preparedRibbons == state.ribbonPlacements.size();
+}
+
+bool Application::prepareRibbon(const audiotrip::Choreography &choreography,
+                                const audiotrip::ChoreoEvent &event,
+                                uint64_t meshKey) {
+  if (gpuRibbons != nullptr && !ribbons.contains(meshKey)) {
+    if (gpuRibbons->contains(meshKey))
+      return true;
+
+    FrameArena::Scope scope(scratch);
+    auto [splines, textureScale] = ribbonSplines(choreography, event);
+    if (gpuRibbons->add(meshKey, splines, event.isRHS(), textureScale))
+      return true;
+  }
+
+  // Too long for the shader, or GPU extrusion is disabled
+  genOrGetRibbon(choreography, event, meshKey);
+  return false;
+}
+
+void Application::submitRibbon(const DrawList::Ribbon &ribbon, bool onGpu) {
+  if (onGpu) {
+    gpuRibbons->submit(renderQueue, ribbon.meshKey, ribbon.transform, ribbon.center, ribbon.tint);
+    return;
+  }
+
+  const RibbonMesh &mesh = ribbons.at(ribbon.meshKey);
+  std::array<RenderQueue::Uniform, 3> uniforms = unlitLocations.uniforms(mesh.dequantization);
+  std::span<const RenderQueue::Uniform> drawUniforms;
+  if (mesh.format == vertex_format::FormatQuantized)
+    drawUniforms = uniforms;
+
+  // Pooled ribbons share the vertex array of their block, so the queue binds it once for all of them
+  RibbonPool::Draw draw = { mesh.mesh.has_value() ? &*mesh.mesh : nullptr, { 0, 0 } };
+  if (mesh.poolId.has_value())
+    draw = ribbonPool->draw(*mesh.poolId);
+
+  renderQueue.submit(RenderQueue::PassTransparent,
+                     *draw.mesh,
+                     *ribbonMaterial,
+                     ribbon.transform,
+                     ribbon.center,
+                     ribbon.tint,
+                     drawUniforms,
+                     draw.range);
+}
+
+void Application::reportRibbonDedup() {
+  const std::vector<RibbonPlacement> &ribbonPlacements = streamedState->ribbonPlacements;
+  const std::unordered_map<uint64_t, size_t> &ribbonInstances = streamedState->ribbonInstances;
+  if (ribbonPlacements.empty())
+    return;
+
+  std::cout << fmt::format("Ribbons of {}: {} ribbons share {} unique meshes ({:.2f}x dedup)",
+                           choreo().name,
+                           ribbonPlacements.size(),
+                           ribbonInstances.size(),
+                           static_cast<double>(ribbonPlacements.size()) / static_cast<double>(ribbonInstances.size()))
+            << std::endl;
+}
+
+void Application::evictUnusedRibbons() {
+  auto used = [this](uint64_t meshKey) {
+    return std::any_of(choreoStates.begin(), choreoStates.end(), [&](const std::unique_ptr<ChoreoState> &state) {
+      return state != nullptr && state->ribbonInstances.contains(meshKey);
+    });
+  };
+
+  for (auto it = ribbons.begin(); it != ribbons.end();) {
+    if (used(it->first)) {
+      ++it;
+      continue;
     }
+    if (it->second.poolId.has_value())
+      ribbonPool->remove(*it->second.poolId);
+    it = ribbons.erase(it);
   }
 }
 
-std::pair<raylib::Model &, Vector3> Application::genOrGetRibbon(const audiotrip::ChoreoEvent &event, float distance) {
-  RibbonKey key = { event.time.beat, event.time.numerator, event.time.denominator, event.isRHS() };
-  auto it = ribbons.find(key);
-  if (it != ribbons.end())
-    return { it->second.first, it->second.second };
+void Application::clearRibbons() {
+  ribbons.clear();
+  for (const std::unique_ptr<ChoreoState> &state : choreoStates) {
+    if (state != nullptr)
+      state->preparedRibbons = 0;
+  }
+  ribbonPool.reset();
+  if (vertex_format::supported())
+    ribbonPool = std::make_unique<RibbonPool>(vertexFormat);
+}
+
+FrameArena::Vector<float> Application::ribbonTimes(const audiotrip::ChoreoEvent &event) {
+  // Beat times are absolute, so the same relative time comes out slightly different depending on where it is
+  constexpr float resolution = 1e-4f;
 
-  std::vector<raylib::Vector3> positions;
-  float beat = static_cast<float>(event.time.beat) +
-               static_cast<float>(event.time.numerator) / static_cast<float>(event.time.denominator);
+  FrameArena::Vector<float> times = scratch.vector<float>();
+  times.reserve(event.subPositions.size());
+  float beat = audiotrip::beatNumber(event.time);
   float beatIncrement = 1.0f / static_cast<float>(event.beatDivision);
+  float start = audiotrip::beatSeconds(beats, beat);
 
-  for (const audiotrip::Position &p : event.subPositions) {
-    positions.emplace_back(p.vectorWithDistance(choreo().secondsToMeters(getBeatTime(beat)) - distance));
+  for (size_t i = 0; i < event.subPositions.size(); i++) {
+    times.push_back(std::round((audiotrip::beatSeconds(beats, beat) - start) / resolution) * resolution);
     beat += beatIncrement;
   }
 
-  using namespace splines;
-  std::vector<Spline3D> splines = Spline3D::FromPoints(positions);
+  return times;
+}
 
-  std::vector<raylib::Vector3> sliceShape = ribbons::rotateShapeAroundZAxis(RibbonShape,
-                                                                            PI / 6.0 * (event.isRHS() ? -1 : 1));
-  raylib::Mesh mesh = ribbons::createRibbonMesh(sliceShape,
-                                                splines,
-                                                static_cast<size_t>(
-                                                  std::max(2.0f, 128.0f / static_cast<float>(event.beatDivision))),
-                                                static_cast<float>(splines.size()) *
-                                                  (static_cast<float>(choreo().gemSpeed) / 2.5f) /
-                                                  static_cast<float>(event.beatDivision));
-  ribbons.emplace(key, std::pair<raylib::Model, raylib::Vector3>{ raylib::Model{ mesh }, positions.back() });
+FrameArena::Vector<raylib::Vector3> Application::ribbonPositions(const audiotrip::Choreography &choreography,
+                                                                 const audiotrip::ChoreoEvent &event) {
+  FrameArena::Vector<float> times = ribbonTimes(event);
+  FrameArena::Vector<raylib::Vector3> positions = scratch.vector<raylib::Vector3>();
+  positions.reserve(times.size());
 
-  // Prevent the mesh from being unloaded at the end of this scope. It is now owned by the Model.
-  mesh.vboId = nullptr;
+  for (size_t i = 0; i < event.subPositions.size(); i++)
+    positions.emplace_back(event.subPositions[i].vectorWithDistance(choreography.secondsToMeters(times[i])));
 
-  raylib::Model &model = ribbons.at(key).first;
-  applyMaterialsMtl(model);
-  model.meshMaterial[0] = 0;
+  return positions;
+}
 
-  unsigned int textureId = model.materials[0].maps[0].texture.id;
+const std::vector<raylib::Vector3> &Application::ribbonShape() {
+  return RibbonShape;
+}
+
+std::pair<FrameArena::Vector<splines::Spline3D>, float>
+Application::ribbonSplines(const audiotrip::Choreography &choreography, const audiotrip::ChoreoEvent &event) {
+  FrameArena::Vector<splines::Spline3D> splines = scratch.vector<splines::Spline3D>();
+  splines::Spline3D::FromPoints(ribbonPositions(choreography, event), splines);
+  float textureScale = static_cast<float>(splines.size()) * (static_cast<float>(choreography.gemSpeed) / 2.5f) /
+                       static_cast<float>(event.beatDivision);
+  return { std::move(splines), textureScale };
+}
+
+Application::RibbonMesh &Application::genOrGetRibbon(const audiotrip::Choreography &choreography,
+                                                     const audiotrip::ChoreoEvent &event,
+                                                     uint64_t meshKey) {
+  auto it = ribbons.find(meshKey);
+  if (it != ribbons.end())
+    return it->second;
+
+  std::optional<ribbons::RibbonGeometry> geometry;
+  if (ribbonCache != nullptr)
+    geometry = ribbonCache->find(meshKey);
+
+  if (!geometry.has_value()) {
+    FrameArena::Scope scope(scratch);
+    auto [splines, textureScale] = ribbonSplines(choreography, event);
+
+    // Tilted once for each hand, not for every ribbon
+    static const std::vector<raylib::Vector3> lhsSliceShape = ribbons::rotateShapeAroundZAxis(RibbonShape, PI / 6.0);
+    static const std::vector<raylib::Vector3> rhsSliceShape = ribbons::rotateShapeAroundZAxis(RibbonShape, -PI / 6.0);
+    geometry = ribbons::generateRibbonGeometry(event.isRHS() ? rhsSliceShape : lhsSliceShape,
+                                               splines,
+                                               static_cast<size_t>(
+                                                 std::max(2.0f, 128.0f / static_cast<float>(event.beatDivision))),
+                                               textureScale);
+
+    if (ribbonCache != nullptr)
+      ribbonCache->store(meshKey, *geometry);
+  }
 
-  rlgl::rlTextureParameters(textureId, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_ANISOTROPIC);
-  rlgl::rlTextureParameters(textureId, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_REPEAT);
-  rlgl::rlTextureParameters(textureId, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_REPEAT);
+  auto vertexCount = static_cast<int>(geometry->vertexCount());
+  RibbonMesh ribbon = { std::nullopt, std::nullopt, vertexFormat, {}, vertexCount };
+
+  if (vertexFormat == vertex_format::FormatQuantized) {
+    vertex_format::QuantizedAttributes quantized = vertex_format::quantize(
+      geometry->vertexCount(), geometry->vertices.data(), geometry->normals.data(), geometry->texcoords.data());
+    ribbon.dequantization = quantized.dequantization;
+    ribbon.poolId = ribbonPool->add(
+      vertexCount, { quantized.positions.data(), quantized.texcoords.data(), quantized.normals.data() });
+    if (!ribbon.poolId.has_value())
+      ribbon.mesh = vertex_format::upload(quantized, {}, {});
+    return ribbons.emplace(meshKey, std::move(ribbon)).first->second;
+  }
 
-  return { model, positions.back() };
+  if (ribbonPool != nullptr) {
+    ribbon.poolId = ribbonPool->add(
+      vertexCount, { geometry->vertices.data(), geometry->texcoords.data(), geometry->normals.data() });
+  }
+  if (!ribbon.poolId.has_value())
+    ribbon.mesh = ribbons::uploadRibbonMesh(*geometry);
+  return ribbons.emplace(meshKey, std::move(ribbon)).first->second;
 }
@@ -0,0 +1,171 @@
+#include "audio/AudioDecoder.h"
+
+// STL includes
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <filesystem>
+#include <stdexcept>
+
+// Libraries
+#include <fmt/format.h>
+
+// raylib config
+#include "config.h"
+
+// Declarations only, the implementations are compiled into raylib's audio module
+#if defined(SUPPORT_FILEFORMAT_WAV)
+#include "external/dr_wav.h"
+#endif
+#if defined(SUPPORT_FILEFORMAT_OGG)
+#define STB_VORBIS_HEADER_ONLY
+#include "external/stb_vorbis.h"
+#endif
+#if defined(SUPPORT_FILEFORMAT_MP3)
+#include "external/dr_mp3.h"
+#endif
+
+namespace audio {
+
+enum Format {
+  FormatUnknown = 0,
+  FormatWav,
+  FormatOgg,
+  FormatMp3,
+};
+
+static Format formatOf(const std::string &path) {
+  std::string extension = std::filesystem::path(path).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+
+#if defined(SUPPORT_FILEFORMAT_WAV)
+  if (extension == ".wav")
+    return FormatWav;
+#endif
+#if defined(SUPPORT_FILEFORMAT_OGG)
+  if (extension == ".ogg")
+    return FormatOgg;
+#endif
+#if defined(SUPPORT_FILEFORMAT_MP3)
+  if (extension == ".mp3")
+    return FormatMp3;
+#endif
+  return FormatUnknown;
+}
+
+struct AudioDecoder::Source {
+  Format format = FormatUnknown;
+#if defined(SUPPORT_FILEFORMAT_WAV)
+  drwav wav{};
+#endif
+#if defined(SUPPORT_FILEFORMAT_OGG)
+  stb_vorbis *vorbis = nullptr;
+#endif
+#if defined(SUPPORT_FILEFORMAT_MP3)
+  drmp3 mp3{};
+#endif
+};
+
+bool AudioDecoder::supported(const std::string &path) {
+  return formatOf(path) != FormatUnknown;
+}
+
+AudioDecoder::AudioDecoder(const std::string &path) : source(std::make_unique<Source>()) {
+  source->format = formatOf(path);
+
+  switch (source->format) {
+#if defined(SUPPORT_FILEFORMAT_WAV)
+  case FormatWav:
+    if (!drwav_init_file(&source->wav, path.c_str(), nullptr))
+      break;
+    rate = source->wav.sampleRate;
+    channelCount = source->wav.channels;
+    frames = source->wav.totalPCMFrameCount;
+    return;
+#endif
+#if defined(SUPPORT_FILEFORMAT_OGG)
+  case FormatOgg: {
+    int error = 0;
+    source->vorbis = stb_vorbis_open_filename(path.c_str(), &error, nullptr);
+    if (source->vorbis == nullptr)
+      break;
+    stb_vorbis_info info = stb_vorbis_get_info(source->vorbis);
+    rate = info.sample_rate;
+    channelCount = static_cast<uint32_t>(info.channels);
+    frames = stb_vorbis_stream_length_in_samples(source->vorbis);
+    return;
+  }
+#endif
+#if defined(SUPPORT_FILEFORMAT_MP3)
+  case FormatMp3:
+    // The length of an MP3 is only known by decoding it
+    if (!drmp3_init_file(&source->mp3, path.c_str(), nullptr))
+      break;
+    rate = source->mp3.sampleRate;
+    channelCount = source->mp3.channels;
+    return;
+#endif
+  default:
+    throw std::runtime_error(fmt::format("Unsupported audio format: {}", path));
+  }
+
+  throw std::runtime_error(fmt::format("Unable to open audio file {}", path));
+}
+
+AudioDecoder::~AudioDecoder() {
+  switch (source->format) {
+#if defined(SUPPORT_FILEFORMAT_WAV)
+  case FormatWav:
+    drwav_uninit(&source->wav);
+    break;
+#endif
+#if defined(SUPPORT_FILEFORMAT_OGG)
+  case FormatOgg:
+    stb_vorbis_close(source->vorbis);
+    break;
+#endif
+#if defined(SUPPORT_FILEFORMAT_MP3)
+  case FormatMp3:
+    drmp3_uninit(&source->mp3);
+    break;
+#endif
+  default:
+    break;
+  }
+}
+
+size_t AudioDecoder::read(float *samples, size_t count) {
+  switch (source->format) {
+#if defined(SUPPORT_FILEFORMAT_WAV)
+  case FormatWav:
+    return static_cast<size_t>(drwav_read_pcm_frames_f32(&source->wav, count, samples));
+#endif
+#if defined(SUPPORT_FILEFORMAT_OGG)
+  case FormatOgg: {
+    // stb_vorbis counts floats, not frames, in an int
+    size_t read = 0;
+    while (read < count) {
+      size_t block = std::min<size_t>(count - read, INT_MAX / channelCount);
+      int got = stb_vorbis_get_samples_float_interleaved(source->vorbis,
+                                                          static_cast<int>(channelCount),
+                                                          samples + read * channelCount,
+                                                          static_cast<int>(block * channelCount));
+      if (got <= 0)
+        break;
+      read += static_cast<size_t>(got);
+    }
+    return read;
+  }
+#endif
+#if defined(SUPPORT_FILEFORMAT_MP3)
+  case FormatMp3:
+    return static_cast<size_t>(drmp3_read_pcm_frames_f32(&source->mp3, count, samples));
+#endif
+  default:
+    return 0;
+  }
+}
+
+} // namespace audio
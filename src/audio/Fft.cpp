@@ -0,0 +1,103 @@
+#include "audio/Fft.h"
+
+// STL includes
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace audio {
+
+// The kernels below take restrict-qualified parameters so that compilers know the arrays don't overlap, which is what
+// allows them to vectorize the loops without runtime alias checks.
+
+/// Radix-2 butterflies between the halves of a block, `b *= w`, then `a, b = a + b, a - b`
+static void butterflies(float *__restrict aRe,
+                        float *__restrict aIm,
+                        float *__restrict bRe,
+                        float *__restrict bIm,
+                        const float *__restrict wRe,
+                        const float *__restrict wIm,
+                        size_t count) {
+  for (size_t j = 0; j < count; j++) {
+    float tRe = bRe[j] * wRe[j] - bIm[j] * wIm[j];
+    float tIm = bRe[j] * wIm[j] + bIm[j] * wRe[j];
+    bRe[j] = aRe[j] - tRe;
+    bIm[j] = aIm[j] - tIm;
+    aRe[j] += tRe;
+    aIm[j] += tIm;
+  }
+}
+
+Fft::Fft(size_t size) : length(size), half(size / 2) {
+  if (size < 4 || (size & (size - 1)) != 0)
+    throw std::invalid_argument("FFT size must be a power of two, at least 4");
+
+  size_t bits = 0;
+  while ((size_t{ 1 } << bits) < half)
+    bits++;
+  bitReversed.resize(half);
+  for (size_t i = 0; i < half; i++) {
+    size_t reversed = 0;
+    for (size_t bit = 0; bit < bits; bit++)
+      reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+    bitReversed[i] = reversed;
+  }
+
+  // Stage twiddles are every `half / span`-th of the last stage's, but contiguous copies keep the butterflies
+  // vectorizable
+  for (size_t span = 1; span < half; span *= 2) {
+    for (size_t j = 0; j < span; j++) {
+      double angle = -std::numbers::pi * static_cast<double>(j) / static_cast<double>(span);
+      twiddlesRe.push_back(static_cast<float>(std::cos(angle)));
+      twiddlesIm.push_back(static_cast<float>(std::sin(angle)));
+    }
+  }
+
+  unpackRe.resize(half + 1);
+  unpackIm.resize(half + 1);
+  for (size_t k = 0; k <= half; k++) {
+    double angle = -2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(length);
+    unpackRe[k] = static_cast<float>(std::cos(angle));
+    unpackIm[k] = static_cast<float>(std::sin(angle));
+  }
+
+  re.resize(half);
+  im.resize(half);
+}
+
+void Fft::magnitudes(const float *samples, float *result) {
+  // Even samples are the real part and odd ones the imaginary part, in bit-reversed order
+  for (size_t i = 0; i < half; i++) {
+    re[bitReversed[i]] = samples[2 * i];
+    im[bitReversed[i]] = samples[2 * i + 1];
+  }
+
+  size_t twiddle = 0;
+  for (size_t span = 1; span < half; span *= 2) {
+    for (size_t block = 0; block < half; block += 2 * span) {
+      butterflies(&re[block],
+                  &im[block],
+                  &re[block + span],
+                  &im[block + span],
+                  &twiddlesRe[twiddle],
+                  &twiddlesIm[twiddle],
+                  span);
+    }
+    twiddle += span;
+  }
+
+  // X[k] = (Z[k] + conj(Z[half - k])) / 2 - i e^(-2πik/size) (Z[k] - conj(Z[half - k])) / 2
+  for (size_t k = 0; k <= half; k++) {
+    size_t a = k % half;
+    size_t b = (half - k) % half;
+    float evenRe = (re[a] + re[b]) * 0.5f;
+    float evenIm = (im[a] - im[b]) * 0.5f;
+    float oddRe = (im[a] + im[b]) * 0.5f;
+    float oddIm = (re[b] - re[a]) * 0.5f;
+    float xRe = evenRe + oddRe * unpackRe[k] - oddIm * unpackIm[k];
+    float xIm = evenIm + oddRe * unpackIm[k] + oddIm * unpackRe[k];
+    result[k] = std::sqrt(xRe * xRe + xIm * xIm);
+  }
+}
+
+} // namespace audio
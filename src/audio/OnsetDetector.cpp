@@ -0,0 +1,162 @@
+#include "audio/OnsetDetector.h"
+
+// STL includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+// Libraries
+#include <fmt/format.h>
+
+// Local includes
+#include "audio/AudioDecoder.h"
+
+namespace audio {
+
+/// Of the normalized magnitudes, before the logarithm
+static constexpr float Compression = 100.0f;
+
+/// Frames decoded at a time
+static constexpr size_t BlockFrames = 4096;
+
+// The kernels below take restrict-qualified parameters so that compilers know the arrays don't overlap, which is what
+// allows them to vectorize the loops without runtime alias checks.
+
+static void multiply(const float *__restrict a, const float *__restrict b, float *__restrict out, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = a[i] * b[i];
+}
+
+void OnsetDetector::compress(float *values, size_t count, float compression) {
+  for (size_t i = 0; i < count; i++)
+    values[i] = std::log1p(compression * values[i]);
+}
+
+float OnsetDetector::positiveDifference(const float *__restrict current,
+                                        const float *__restrict previous,
+                                        size_t count) {
+  // Float sums are only vectorized if they can be reordered, so keep one per lane
+  constexpr size_t lanes = 8;
+  std::array<float, lanes> sums{};
+  size_t i = 0;
+  for (; i + lanes <= count; i += lanes) {
+    for (size_t lane = 0; lane < lanes; lane++)
+      sums[lane] += std::max(current[i + lane] - previous[i + lane], 0.0f);
+  }
+  for (; i < count; i++)
+    sums[0] += std::max(current[i] - previous[i], 0.0f);
+
+  float result = 0;
+  for (float sum : sums)
+    result += sum;
+  return result;
+}
+
+OnsetDetector::OnsetDetector(uint32_t sampleRate, uint32_t channelCount) :
+  channels(channelCount),
+  decimation(std::max<uint32_t>(1, (sampleRate + AnalysisRate / 2) / AnalysisRate)),
+  analysisRate(static_cast<float>(sampleRate) / static_cast<float>(decimation)),
+  fft(FrameSize),
+  window(FrameSize),
+  frame(FrameSize),
+  spectrum(fft.bins()),
+  previousSpectrum(fft.bins()) {
+  if (sampleRate == 0 || channelCount == 0)
+    throw std::invalid_argument("No audio to detect onsets in");
+
+  // Normalized so that a full scale sine has a magnitude of 1
+  float sum = 0;
+  for (size_t i = 0; i < FrameSize; i++) {
+    window[i] = 0.5f - 0.5f * std::cos(2.0f * std::numbers::pi_v<float> * static_cast<float>(i) / FrameSize);
+    sum += window[i];
+  }
+  for (float &value : window)
+    value *= 2.0f / sum;
+}
+
+void OnsetDetector::push(const float *samples, size_t frames) {
+  for (size_t i = 0; i < frames; i++) {
+    for (uint32_t channel = 0; channel < channels; channel++)
+      partialSum += samples[i * channels + channel];
+
+    if (++partialCount == decimation) {
+      pending.push_back(partialSum / static_cast<float>(decimation * channels));
+      partialSum = 0;
+      partialCount = 0;
+    }
+  }
+  analyzeFrames();
+}
+
+void OnsetDetector::analyzeFrames() {
+  while (pending.size() - pendingStart >= FrameSize) {
+    multiply(&pending[pendingStart], window.data(), frame.data(), FrameSize);
+    fft.magnitudes(frame.data(), spectrum.data());
+    compress(spectrum.data(), spectrum.size(), Compression);
+
+    flux.push_back(first ? 0.0f : positiveDifference(spectrum.data(), previousSpectrum.data(), spectrum.size()));
+    first = false;
+    std::swap(spectrum, previousSpectrum);
+    pendingStart += HopSize;
+  }
+
+  // Drop the consumed samples once in a while, not on every block
+  if (pendingStart >= 8 * FrameSize) {
+    pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(pendingStart));
+    pendingStart = 0;
+  }
+}
+
+OnsetEnvelope OnsetDetector::finish() {
+  OnsetEnvelope result;
+  result.frameSeconds = static_cast<float>(HopSize) / analysisRate;
+  result.firstFrameSeconds = static_cast<float>(FrameSize / 2) / analysisRate; // Frames are placed at their center
+  result.values.resize(flux.size());
+
+  // Running sums of the flux, for the local averages
+  std::vector<double> sums(flux.size() + 1, 0.0);
+  for (size_t i = 0; i < flux.size(); i++)
+    sums[i + 1] = sums[i] + flux[i];
+
+  auto radius = static_cast<size_t>(AverageSeconds / 2 / result.frameSeconds);
+  float peak = 0;
+  for (size_t i = 0; i < flux.size(); i++) {
+    size_t from = i > radius ? i - radius : 0;
+    size_t to = std::min(i + radius + 1, flux.size());
+    auto average = static_cast<float>((sums[to] - sums[from]) / static_cast<double>(to - from));
+    result.values[i] = std::max(flux[i] - average, 0.0f);
+    peak = std::max(peak, result.values[i]);
+  }
+
+  if (peak > 0) {
+    for (float &value : result.values)
+      value /= peak;
+  }
+
+  flux.clear();
+  pending.clear();
+  return result;
+}
+
+OnsetEnvelope OnsetDetector::fromFile(const std::string &audioPath, const std::atomic<bool> *cancel) {
+  AudioDecoder decoder(audioPath);
+  if (decoder.sampleRate() == 0 || decoder.channels() == 0)
+    throw std::runtime_error(fmt::format("No audio in {}", audioPath));
+
+  OnsetDetector detector(decoder.sampleRate(), decoder.channels());
+  std::vector<float> block(BlockFrames * decoder.channels());
+  for (;;) {
+    if (cancel != nullptr && cancel->load(std::memory_order_relaxed))
+      return {};
+
+    size_t read = decoder.read(block.data(), BlockFrames);
+    detector.push(block.data(), read);
+    if (read < BlockFrames)
+      break;
+  }
+  return detector.finish();
+}
+
+} // namespace audio
@@ -0,0 +1,98 @@
+#include "audio/Playback.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace audio {
+
+MusicPlayback::MusicPlayback(const std::string &path, double latency) : deviceLatency(latency) {
+  // Left open for the next song, the application closes it
+  if (!IsAudioDeviceReady())
+    InitAudioDevice();
+  if (!IsAudioDeviceReady())
+    throw std::runtime_error("No audio device");
+
+  music = LoadMusicStream(path.c_str());
+  if (music.stream.buffer == nullptr || music.frameCount == 0)
+    throw std::runtime_error("Unable to load " + path);
+  music.looping = false;
+}
+
+MusicPlayback::~MusicPlayback() {
+  UnloadMusicStream(music);
+}
+
+void MusicPlayback::play(double seconds) {
+  // Stopping drops what was already decoded for the device, seeking alone would play it first
+  StopMusicStream(music);
+  SeekMusicStream(music, static_cast<float>(std::clamp(seconds, 0.0, duration())));
+  PlayMusicStream(music);
+  UpdateMusicStream(music);
+}
+
+void MusicPlayback::stop() {
+  StopMusicStream(music);
+}
+
+void MusicPlayback::update() {
+  UpdateMusicStream(music);
+}
+
+bool MusicPlayback::playing() const {
+  return IsMusicStreamPlaying(music);
+}
+
+double MusicPlayback::position() const {
+  return GetMusicTimePlayed(music);
+}
+
+double MusicPlayback::duration() const {
+  return GetMusicTimeLength(music);
+}
+
+NullPlayback::NullPlayback(double duration, std::function<double()> now, const Options &options) :
+  length(duration), now(std::move(now)), options(options) {}
+
+void NullPlayback::play(double seconds) {
+  started = true;
+  startSeconds = std::clamp(seconds, 0.0, length);
+  startedAt = now();
+}
+
+void NullPlayback::stop() {
+  started = false;
+}
+
+double NullPlayback::elapsed() const {
+  return started ? (now() - startedAt) * options.clockSkew : 0.0;
+}
+
+bool NullPlayback::playing() const {
+  return started && heard() < length;
+}
+
+double NullPlayback::period() const {
+  return static_cast<double>(options.periodFrames) / options.sampleRate;
+}
+
+double NullPlayback::latency() const {
+  return options.latency + period();
+}
+
+double NullPlayback::position() const {
+  if (!started)
+    return startSeconds;
+
+  // The first callback comes right away, then one every period, each consuming a period
+  double period = this->period();
+  double callbacks = std::floor(elapsed() / period) + 1;
+  return std::min(startSeconds + callbacks * period, length);
+}
+
+double NullPlayback::heard() const {
+  return std::max(startSeconds, startSeconds + elapsed() - options.latency);
+}
+
+} // namespace audio
@@ -0,0 +1,103 @@
+#include "audio/PlaybackClock.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+// Libraries
+#include <fmt/format.h>
+
+namespace audio {
+
+void PlaybackClock::reset(double seconds, double now) {
+  start = current = estimate = seconds;
+  lastNow = changedAt = now;
+  lastConsumed = seconds;
+  unseen = 0;
+  moved = false;
+  holding = true;
+  // The steps are kept, the device is the same
+}
+
+double PlaybackClock::period() const {
+  size_t count = std::min(stepCount, StepHistory);
+  if (count == 0)
+    return 0;
+  return *std::min_element(steps.begin(), steps.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+double PlaybackClock::update(double consumed, double now) {
+  double frameSeconds = std::max(0.0, now - lastNow);
+  lastNow = now;
+
+  if (consumed != lastConsumed) {
+    double step = consumed - lastConsumed;
+    if (moved && step > 0 && step < options.resyncSeconds)
+      steps[stepCount++ % StepHistory] = step;
+    lastConsumed = consumed;
+    changedAt = now;
+    moved = true;
+
+    // The callback happened at some point since the previous frame, but no earlier than a period ago
+    double callback = period();
+    unseen = 0.5 * (callback > 0 ? std::min(callback, frameSeconds) : frameSeconds);
+  }
+
+  // The device plays what it consumed until the next callback; if that's late, it has stalled
+  double sinceCallback = 0;
+  if (moved) {
+    sinceCallback = unseen + now - changedAt;
+    if (double callback = period(); callback > 0)
+      sinceCallback = std::min(sinceCallback, 2 * callback);
+  }
+  estimate = consumed + sinceCallback - options.latency;
+
+  // Nothing before the start was played, it's only the latency
+  if (holding) {
+    if (estimate < start)
+      return current = start;
+    holding = false;
+    return current = estimate;
+  }
+
+  current += frameSeconds;
+  double error = estimate - current;
+  if (std::abs(error) > options.resyncSeconds) {
+    current = estimate;
+  } else {
+    double limit = options.maxSlew * frameSeconds;
+    current += std::clamp(error * (1.0 - std::exp(-options.correctionRate * frameSeconds)), -limit, limit);
+  }
+  return current;
+}
+
+PlaybackLog::PlaybackLog(std::ostream *out) : out(out) {
+  if (out != nullptr)
+    *out << "time,frame_ms,audio_s,camera_s,error_ms" << std::endl;
+}
+
+void PlaybackLog::frame(double now, double frameSeconds, double audioSeconds, double cameraSeconds) {
+  double error = cameraSeconds - audioSeconds;
+  frameCount++;
+  errorSum += std::abs(error);
+  worstError = std::max(worstError, std::abs(error));
+  longestFrame = std::max(longestFrame, frameSeconds);
+  if (std::abs(error) > frameSeconds)
+    lateCount++;
+
+  if (out != nullptr) {
+    // Formatted on the stack, a line fits in the inline storage of the buffer
+    fmt::memory_buffer line;
+    fmt::format_to(std::back_inserter(line),
+                   "{:.6f},{:.3f},{:.6f},{:.6f},{:.3f}\n",
+                   now,
+                   frameSeconds * 1000,
+                   audioSeconds,
+                   cameraSeconds,
+                   error * 1000);
+    out->write(line.data(), static_cast<std::streamsize>(line.size()));
+  }
+}
+
+} // namespace audio
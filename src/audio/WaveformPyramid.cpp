@@ -0,0 +1,185 @@
+#include "audio/WaveformPyramid.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+// Libraries
+#include <fmt/format.h>
+
+// Local includes
+#include "audio/AudioDecoder.h"
+#include "utils/AtomicFile.h"
+#include "utils/CacheDirectory.h"
+#include "utils/Fnv1a.h"
+
+namespace audio {
+
+static constexpr char CacheMagic[4] = { 'A', 'T', 'W', 'F' };
+static constexpr const char *CacheExtension = ".atwf";
+
+/// Frames decoded at a time
+static constexpr size_t BlockFrames = 16 * WaveformPyramid::BinFrames;
+
+static int8_t quantize(float sample, bool up) {
+  float scaled = std::clamp(sample, -1.0f, 1.0f) * 127.0f;
+  return static_cast<int8_t>(up ? std::ceil(scaled) : std::floor(scaled));
+}
+
+WaveformPyramid WaveformPyramid::decode(const std::string &audioPath, const std::atomic<bool> *cancel) {
+  AudioDecoder decoder(audioPath);
+  size_t channels = decoder.channels();
+  if (decoder.sampleRate() == 0 || channels == 0)
+    throw std::runtime_error(fmt::format("No audio in {}", audioPath));
+
+  WaveformPyramid result;
+  result.rate = decoder.sampleRate();
+  std::vector<Peak> bins;
+  if (std::optional<uint64_t> frameCount = decoder.frameCount(); frameCount.has_value())
+    bins.reserve((*frameCount + BinFrames - 1) / BinFrames);
+
+  // A partial bin is carried over to the next block
+  std::vector<float> block(BlockFrames * channels);
+  float low = 0;
+  float high = 0;
+  size_t binFill = 0;
+
+  for (;;) {
+    if (cancel != nullptr && cancel->load(std::memory_order_relaxed))
+      return {};
+
+    size_t read = decoder.read(block.data(), BlockFrames);
+    for (size_t frame = 0; frame < read; frame++) {
+      const float *samples = &block[frame * channels];
+      for (size_t channel = 0; channel < channels; channel++) {
+        low = std::min(low, samples[channel]);
+        high = std::max(high, samples[channel]);
+      }
+
+      if (++binFill == BinFrames) {
+        bins.push_back({ quantize(low, false), quantize(high, true) });
+        low = high = 0;
+        binFill = 0;
+      }
+    }
+    result.frames += read;
+
+    if (read < BlockFrames)
+      break;
+  }
+
+  if (binFill > 0)
+    bins.push_back({ quantize(low, false), quantize(high, true) });
+  if (bins.empty())
+    throw std::runtime_error(fmt::format("No audio in {}", audioPath));
+
+  result.levels.push_back(std::move(bins));
+  result.buildLevels();
+  return result;
+}
+
+void WaveformPyramid::buildLevels() {
+  levels.resize(1);
+  while (levels.back().size() > 1) {
+    const std::vector<Peak> &below = levels.back();
+    std::vector<Peak> level((below.size() + 1) / 2);
+    for (size_t i = 0; i < level.size(); i++) {
+      const Peak &a = below[2 * i];
+      const Peak &b = 2 * i + 1 < below.size() ? below[2 * i + 1] : a;
+      level[i] = { std::min(a.min, b.min), std::max(a.max, b.max) };
+    }
+    levels.push_back(std::move(level));
+  }
+}
+
+bool WaveformPyramid::stamp(const std::string &audioPath, CacheHeader &header) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(audioPath, error);
+  if (error)
+    return false;
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(audioPath, error);
+  if (error)
+    return false;
+
+  header = {};
+  std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+  header.version = CacheVersion;
+  header.binFrames = BinFrames;
+  header.sourceSize = size;
+  header.sourceTime = static_cast<int64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+std::optional<WaveformPyramid> WaveformPyramid::load(const std::filesystem::path &cachePath,
+                                                     const CacheHeader &expected) {
+  std::ifstream is(cachePath, std::ios::binary);
+  CacheHeader header{};
+  if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    return std::nullopt;
+
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+      header.binFrames != expected.binFrames || header.sourceSize != expected.sourceSize ||
+      header.sourceTime != expected.sourceTime || header.sampleRate == 0 || header.frameCount == 0)
+    return std::nullopt;
+
+  // The bins are sized from the header, which must not be trusted further than the file actually goes
+  uint64_t binCount = header.frameCount / BinFrames + (header.frameCount % BinFrames != 0 ? 1 : 0);
+  std::error_code error;
+  uintmax_t fileSize = std::filesystem::file_size(cachePath, error);
+  if (error || fileSize < sizeof(CacheHeader) || binCount > (fileSize - sizeof(CacheHeader)) / sizeof(Peak))
+    return std::nullopt;
+
+  WaveformPyramid result;
+  result.rate = header.sampleRate;
+  result.frames = header.frameCount;
+  result.cached = true;
+
+  std::vector<Peak> bins(binCount);
+  if (!is.read(reinterpret_cast<char *>(bins.data()), static_cast<std::streamsize>(bins.size() * sizeof(Peak))))
+    return std::nullopt;
+
+  result.levels.push_back(std::move(bins));
+  result.buildLevels();
+  return result;
+}
+
+void WaveformPyramid::save(const std::filesystem::path &cachePath, CacheHeader header) const {
+  header.sampleRate = rate;
+  header.frameCount = frames;
+
+  // A cache that can't be written is only slower
+  AtomicFile file(cachePath);
+  file.stream().write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.stream().write(reinterpret_cast<const char *>(levels[0].data()),
+                      static_cast<std::streamsize>(levels[0].size() * sizeof(Peak)));
+  (void) file.commit();
+}
+
+WaveformPyramid WaveformPyramid::loadOrDecode(const std::string &audioPath,
+                                              const std::optional<std::filesystem::path> &directory,
+                                              const std::atomic<bool> *cancel) {
+  CacheHeader header{};
+  if (!directory.has_value() || !stamp(audioPath, header))
+    return decode(audioPath, cancel);
+
+  std::error_code error;
+  std::filesystem::path absolute = std::filesystem::absolute(audioPath, error);
+  std::string songId = fmt::format("{:016x}", Fnv1a().add(error ? audioPath : absolute.string()).digest());
+  std::filesystem::path cachePath = *directory / (songId + CacheExtension);
+
+  if (std::optional<WaveformPyramid> cached = load(cachePath, header); cached.has_value())
+    return std::move(*cached);
+
+  WaveformPyramid result = decode(audioPath, cancel);
+  if (!result.empty()) {
+    std::filesystem::create_directories(*directory, error);
+    result.save(cachePath, header);
+    trimCacheDirectory(*directory, CacheExtension, MaxCacheBytes, cachePath);
+  }
+  return result;
+}
+
+} // namespace audio
@@ -0,0 +1,297 @@
+#include "audiotrip/LibraryIndex.h"
+
+// STL includes
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+#include <unordered_map>
+
+// Local includes
+#include "audiotrip/dtos.h"
+#include "utils/AtomicFile.h"
+
+namespace audiotrip {
+
+static constexpr char IndexMagic[4] = { 'A', 'T', 'L', 'I' };
+static constexpr uint32_t IndexVersion = 1;
+
+namespace {
+
+class Writer {
+  std::string buffer;
+
+public:
+  template<typename T>
+  void put(const T &value) {
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void put(const std::string &value) {
+    put(static_cast<uint32_t>(value.size()));
+    buffer += value;
+  }
+
+  [[nodiscard]] const std::string &data() const { return buffer; }
+};
+
+/// Reads until the end of the data, after which every read fails
+class Reader {
+  std::string_view data;
+  bool ok = true;
+
+public:
+  explicit Reader(std::string_view data) : data(data) {}
+
+  template<typename T>
+  T get() {
+    T value{};
+    if (data.size() < sizeof(T)) {
+      ok = false;
+      return value;
+    }
+    std::memcpy(&value, data.data(), sizeof(T));
+    data.remove_prefix(sizeof(T));
+    return value;
+  }
+
+  std::string getString() {
+    auto length = get<uint32_t>();
+    if (data.size() < length) {
+      ok = false;
+      return {};
+    }
+    std::string value(data.substr(0, length));
+    data.remove_prefix(length);
+    return value;
+  }
+
+  [[nodiscard]] bool good() const { return ok; }
+};
+
+} // namespace
+
+static std::string lowercase(std::string_view text) {
+  std::string result(text);
+  std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+  return result;
+}
+
+LibraryIndex::LibraryIndex(std::filesystem::path root) : directory(std::move(root)) {
+}
+
+bool LibraryIndex::load() {
+  std::ifstream is(indexPath(), std::ios::binary);
+  if (!is)
+    return false;
+
+  std::string contents((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+  Reader reader(contents);
+
+  auto header = reader.get<FileHeader>();
+  if (!reader.good() || std::memcmp(header.magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+      header.version != IndexVersion)
+    return false;
+
+  std::vector<Entry> loaded;
+  // Don't trust the count for the allocation, the file could be truncated
+  loaded.reserve(std::min<size_t>(header.entryCount, contents.size() / 32));
+  for (uint32_t i = 0; i < header.entryCount && reader.good(); i++) {
+    Entry entry;
+    entry.path = reader.getString();
+    entry.mtime = reader.get<int64_t>();
+    entry.size = reader.get<uint64_t>();
+    entry.valid = reader.get<uint8_t>() != 0;
+    entry.title = reader.getString();
+    entry.artist = reader.getString();
+    entry.author = reader.getString();
+    entry.avgBpm = reader.get<float>();
+    entry.songEndTimeInSeconds = reader.get<float>();
+
+    auto choreoCount = reader.get<uint32_t>();
+    for (uint32_t j = 0; j < choreoCount && reader.good(); j++) {
+      std::string name = reader.getString();
+      entry.choreographies.push_back({ std::move(name), reader.get<uint32_t>() });
+    }
+    loaded.push_back(std::move(entry));
+  }
+
+  if (!reader.good())
+    return false;
+
+  songs = std::move(loaded);
+  updateSearchText();
+  return true;
+}
+
+bool LibraryIndex::save(std::ostream &log) const {
+  FileHeader header{};
+  std::memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+  header.version = IndexVersion;
+  header.entryCount = static_cast<uint32_t>(songs.size());
+
+  Writer writer;
+  writer.put(header);
+  for (const Entry &entry : songs) {
+    writer.put(entry.path);
+    writer.put(entry.mtime);
+    writer.put(entry.size);
+    writer.put(static_cast<uint8_t>(entry.valid));
+    writer.put(entry.title);
+    writer.put(entry.artist);
+    writer.put(entry.author);
+    writer.put(entry.avgBpm);
+    writer.put(entry.songEndTimeInSeconds);
+    writer.put(static_cast<uint32_t>(entry.choreographies.size()));
+    for (const Choreography &choreography : entry.choreographies) {
+      writer.put(choreography.name);
+      writer.put(choreography.eventCount);
+    }
+  }
+
+  AtomicFile file(indexPath());
+  file.stream().write(writer.data().data(), static_cast<std::streamsize>(writer.data().size()));
+  if (std::optional<std::string> failure = file.commit()) {
+    log << "Library: " << *failure << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void LibraryIndex::summarize(const std::filesystem::path &file, Entry &entry) {
+  std::ifstream is(file, std::ios::binary);
+  if (!is)
+    throw ParseError("Unable to open " + file.string());
+  std::string contents((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+  // The lazy parser only parses the metadata and the headers, the events are just counted
+  AudioTripSong song = AudioTripSong::fromJsonLazy(std::move(contents));
+  entry.title = song.title;
+  entry.artist = song.artist;
+  entry.author = song.authorID.displayName;
+  entry.avgBpm = song.avgBPM;
+  entry.songEndTimeInSeconds = song.songEndTimeInSeconds;
+  entry.choreographies.clear();
+  for (const audiotrip::Choreography &choreography : song.choreographies)
+    entry.choreographies.push_back({ choreography.name, static_cast<uint32_t>(choreography.eventCount()) });
+  entry.valid = true;
+}
+
+LibraryIndex::RefreshStats LibraryIndex::refresh(ThreadPool &pool, std::ostream &log) {
+  RefreshStats stats;
+
+  std::unordered_map<std::string_view, const Entry *> previous;
+  for (const Entry &entry : songs)
+    previous.emplace(entry.path, &entry);
+
+  std::vector<Entry> walked;
+  std::vector<size_t> changed;
+  size_t kept = 0; // Previous entries whose file still exists
+
+  std::error_code error;
+  auto options = std::filesystem::directory_options::skip_permission_denied;
+  for (auto it = std::filesystem::recursive_directory_iterator(directory, options, error);
+       it != std::filesystem::recursive_directory_iterator();
+       it.increment(error)) {
+    if (error)
+      break;
+
+    std::error_code fileError;
+    if (it->path().extension() != ".ats" || !it->is_regular_file(fileError))
+      continue;
+
+    Entry entry;
+    entry.path = it->path().lexically_relative(directory).generic_string();
+    entry.size = it->file_size(fileError);
+    entry.mtime = static_cast<int64_t>(it->last_write_time(fileError).time_since_epoch().count());
+    if (fileError)
+      continue;
+
+    auto found = previous.find(entry.path);
+    if (found != previous.end()) {
+      kept++;
+      if (found->second->size == entry.size && found->second->mtime == entry.mtime) {
+        walked.push_back(*found->second);
+        stats.reused++;
+        continue;
+      }
+    }
+
+    changed.push_back(walked.size());
+    walked.push_back(std::move(entry));
+  }
+  if (error)
+    log << "Library: unable to walk " << directory.string() << ": " << error.message() << std::endl;
+
+  // One task per song, the largest ones take most of the time anyway. `walked` isn't resized from here on.
+  std::vector<std::future<std::string>> results;
+  results.reserve(changed.size());
+  for (size_t index : changed) {
+    Entry *entry = &walked[index];
+    std::filesystem::path file = directory / entry->path;
+    results.push_back(pool.submit([entry, file]() -> std::string {
+      try {
+        summarize(file, *entry);
+        return {};
+      } catch (const std::exception &e) {
+        return e.what();
+      }
+    }));
+  }
+  pool.runPending();
+
+  for (size_t i = 0; i < results.size(); i++) {
+    std::string failure = results[i].get();
+    if (failure.empty())
+      continue;
+    stats.failed++;
+    log << "Library: unable to index " << walked[changed[i]].path << ": " << failure << std::endl;
+  }
+
+  std::sort(walked.begin(), walked.end(), [](const Entry &a, const Entry &b) { return a.path < b.path; });
+
+  stats.files = walked.size();
+  stats.parsed = changed.size();
+  stats.removed = songs.size() - kept;
+  songs = std::move(walked);
+  updateSearchText();
+  return stats;
+}
+
+std::vector<const LibraryIndex::Entry *> LibraryIndex::search(std::string_view query, size_t limit) const {
+  std::vector<std::string> words;
+  std::istringstream stream(lowercase(query));
+  for (std::string word; stream >> word;)
+    words.push_back(std::move(word));
+
+  std::vector<const Entry *> result;
+  for (size_t i = 0; i < songs.size() && result.size() < limit; i++) {
+    if (!songs[i].valid)
+      continue;
+
+    const std::string &text = searchText[i];
+    if (std::all_of(words.begin(), words.end(), [&](const std::string &word) {
+          return text.find(word) != std::string::npos;
+        }))
+      result.push_back(&songs[i]);
+  }
+  return result;
+}
+
+void LibraryIndex::updateSearchText() {
+  searchText.clear();
+  searchText.reserve(songs.size());
+  for (const Entry &entry : songs) {
+    // Separated so that words don't match across fields
+    std::string text = entry.title + '\n' + entry.artist + '\n' + entry.author;
+    for (const Choreography &choreography : entry.choreographies)
+      text += '\n' + choreography.name;
+    searchText.push_back(lowercase(text));
+  }
+}
+
+} // namespace audiotrip
@@ -4,8 +4,67 @@
 
 #include "audiotrip/dtos.h"
 
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+// Local includes
+#include "audiotrip/json_skim.h"
+#include "utils/MemoryReport.h"
+
 namespace audiotrip {
 
+static Json::CharReaderBuilder readerBuilder() {
+  Json::CharReaderBuilder builder;
+  builder.settings_["allowSpecialFloats"] = true;
+  builder.settings_["allowTrailingCommas"] = true;
+  return builder;
+}
+
+/// Estimated heap bytes of a JSON DOM: its values, the maps holding the members and elements, and the strings
+static size_t jsonBytes(const Json::Value &value) {
+  size_t bytes = sizeof(Json::Value);
+
+  const char *begin = nullptr;
+  const char *end = nullptr;
+  // Strings are copied with a length prefix and a terminator
+  if (value.type() == Json::stringValue && value.getString(&begin, &end))
+    return bytes + static_cast<size_t>(end - begin) + sizeof(unsigned) + 1;
+  if (value.type() != Json::arrayValue && value.type() != Json::objectValue)
+    return bytes;
+
+  // Both arrays and objects are maps, keyed by index or by a copy of the member name
+  bytes += sizeof(Json::Value::ObjectValues);
+  for (auto it = value.begin(); it != value.end(); ++it) {
+    bytes += MemoryReport::MapNodeBytes + sizeof(Json::Value::ObjectValues::value_type) - sizeof(Json::Value);
+    if (value.type() == Json::objectValue && (begin = it.memberName(&end)) != nullptr)
+      bytes += static_cast<size_t>(end - begin) + 1;
+    bytes += jsonBytes(*it);
+  }
+  return bytes;
+}
+
+static Json::Value parseSlice(std::string_view json) {
+  std::unique_ptr<Json::CharReader> reader(readerBuilder().newCharReader());
+  Json::Value result;
+  JSONCPP_STRING errs;
+  if (!reader->parse(json.data(), json.data() + json.size(), &result, &errs))
+    throw ParseError(errs);
+  if (MemoryReport::trackingParsing())
+    MemoryReport::recordJsonDom(jsonBytes(result));
+  return result;
+}
+
+/// Beats past `MaxBeat` would make `computeBeats()` allocate one beat for each of them
+static void validateEvents(const std::vector<ChoreoEvent> &events) {
+  for (const ChoreoEvent &event : events) {
+    if (event.time.beat > AudioTripSong::MaxBeat)
+      throw ParseError("An event is past the last beat a song can have");
+  }
+}
+
 BeatTime::BeatTime(const Json::Value &j) :
   beat(j["beat"].asInt()), numerator(j["numerator"].asInt()), denominator(j["denominator"].asInt()) {
 }
@@ -32,6 +91,48 @@ Choreography::Choreography(const Json::Value &j) :
   events(fromJsonArray<ChoreoEvent>(j["data"]["events"])) {
 }
 
+Choreography::Choreography(const Json::Value &header,
+                           std::shared_ptr<const std::string> json,
+                           size_t dataBegin,
+                           size_t dataEnd) :
+  id(header["id"].asString()),
+  name(header["name"].asString()),
+  spawnAheadTime(header["spawnAheadTime"]),
+  gemSpeed(header["gemSpeed"].asInt()),
+  json(std::move(json)),
+  dataBegin(dataBegin),
+  dataEnd(dataEnd) {
+}
+
+void Choreography::loadEvents() {
+  if (json == nullptr)
+    return;
+
+  // Released first, so that a malformed choreography isn't parsed again
+  std::shared_ptr<const std::string> source = std::move(json);
+  json.reset();
+
+  try {
+    Json::Value data = parseSlice(std::string_view(*source).substr(dataBegin, dataEnd - dataBegin));
+    std::vector<ChoreoEvent> parsed = fromJsonArray<ChoreoEvent>(data["events"]);
+    validateEvents(parsed);
+    events = std::move(parsed);
+  } catch (const Json::Exception &e) {
+    throw ParseError(e.what());
+  }
+}
+
+size_t Choreography::eventCount() const {
+  if (json == nullptr)
+    return events.size();
+
+  std::string_view view = *json;
+  std::optional<skim::Slice> list = skim::member(skim::objectMembers(view, { dataBegin, dataEnd }), "events");
+  if (!list.has_value() || list->of(view) == "null")
+    return 0;
+  return skim::arrayElements(view, *list).size();
+}
+
 TempoSection::TempoSection(const Json::Value &j) :
   startTimeInSeconds(j["startTimeInSeconds"].asFloat()),
   beatsPerMeasure(j["beatsPerMeasure"].asInt()),
@@ -65,21 +166,107 @@ AudioTripSong::AudioTripSong(const Json::Value &j) :
   choreographies(fromJsonArray<Choreography>(j["choreographies"]["list"])) {
 }
 
+/// Checks what the viewer relies on
+static void validate(const AudioTripSong &song) {
+  // The beats can't be computed without a positive tempo, and there is nothing to show without choreographies. Special
+  // floats are allowed in the JSON, the comparisons are written so that NaN fails them.
+  if (song.tempoSections.empty())
+    throw ParseError("The song has no tempo sections");
+  for (const TempoSection &section : song.tempoSections) {
+    if (!(section.beatsPerMinute > 0))
+      throw ParseError("The song has a tempo section with a non-positive BPM");
+    if (!(section.beatsPerMinute <= AudioTripSong::MaxBeatsPerMinute))
+      throw ParseError("The song has a tempo section with a BPM that is too high");
+    if (!(std::abs(section.startTimeInSeconds) <= AudioTripSong::MaxSongSeconds))
+      throw ParseError("The song has a tempo section with an invalid start time");
+  }
+  if (!(std::abs(song.songEndTimeInSeconds) <= AudioTripSong::MaxSongSeconds))
+    throw ParseError("The song has an invalid or too long end time");
+  if (song.choreographies.empty())
+    throw ParseError("The song has no choreographies");
+  for (const Choreography &choreography : song.choreographies)
+    validateEvents(choreography.events);
+}
+
 AudioTripSong AudioTripSong::fromJson(std::istream &is) {
-  Json::CharReaderBuilder builder;
   JSONCPP_STRING errs;
+  Json::Value root;
+  if (!Json::parseFromStream(readerBuilder(), is, &root, &errs))
+    throw ParseError(errs);
+  if (MemoryReport::trackingParsing())
+    MemoryReport::recordJsonDom(jsonBytes(root));
 
-  builder.settings_["allowSpecialFloats"] = true;
-  builder.settings_["allowTrailingCommas"] = true;
+  try {
+    AudioTripSong song(root);
+    validate(song);
+    return song;
+  } catch (const Json::Exception &e) {
+    // Fields of the wrong type
+    throw ParseError(e.what());
+  }
+}
 
-  Json::Value root;
-  if (!Json::parseFromStream(builder, is, &root, &errs)) {
-    // TODO: use exceptions maybe
-    std::cerr << errs << std::endl;
-    abort();
+AudioTripSong AudioTripSong::fromJsonLazy(std::string json) {
+  auto source = std::make_shared<const std::string>(std::move(json));
+  std::string_view view = *source;
+
+  try {
+    std::vector<std::pair<std::string_view, skim::Slice>> members = skim::objectMembers(view, skim::document(view));
+    std::optional<skim::Slice> metadata = skim::member(members, "metadata");
+    std::optional<skim::Slice> choreographies = skim::member(members, "choreographies");
+    if (!metadata.has_value() || !choreographies.has_value())
+      throw ParseError("The song has no metadata or no choreographies");
+
+    // The song without its choreographies is small enough to be parsed normally
+    Json::Value root;
+    root["metadata"] = parseSlice(metadata->of(view));
+    AudioTripSong song(root);
+
+    std::optional<skim::Slice> list = skim::member(skim::objectMembers(view, *choreographies), "list");
+    if (list.has_value()) {
+      for (skim::Slice choreography : skim::arrayElements(view, *list)) {
+        members = skim::objectMembers(view, choreography);
+        std::optional<skim::Slice> header = skim::member(members, "header");
+        std::optional<skim::Slice> data = skim::member(members, "data");
+        if (!header.has_value() || !data.has_value())
+          throw ParseError("A choreography has no header or no data");
+
+        song.choreographies.emplace_back(parseSlice(header->of(view)), source, data->begin, data->end);
+      }
+    }
+
+    validate(song);
+    return song;
+  } catch (const Json::Exception &e) {
+    throw ParseError(e.what());
   }
+}
+
+AudioTripSong AudioTripSong::fromFile(const std::string &path, const std::function<void(float)> &progress, bool lazy) {
+  std::ifstream is(path, std::ios::binary | std::ios::ate);
+  if (!is)
+    throw ParseError("Unable to open " + path);
+
+  auto size = static_cast<size_t>(is.tellg());
+  is.seekg(0);
+
+  // Read in chunks to report progress, parsing is only a fraction of the time for large files
+  constexpr size_t chunkSize = 1 << 20;
+  std::string contents(size, '\0');
+  for (size_t offset = 0; offset < size;) {
+    size_t count = std::min(chunkSize, size - offset);
+    if (!is.read(contents.data() + offset, static_cast<std::streamsize>(count)))
+      throw ParseError("Unable to read " + path);
+    offset += count;
+    if (progress)
+      progress(static_cast<float>(offset) / static_cast<float>(size));
+  }
+
+  if (lazy)
+    return fromJsonLazy(std::move(contents));
 
-  return root;
+  std::istringstream contentStream(std::move(contents));
+  return fromJson(contentStream);
 }
 
 } // namespace audiotrip
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "audiotrip/json_skim.h"
+
+// STL includes
+#include <array>
+
+// Local includes
+#include "audiotrip/dtos.h"
+
+namespace audiotrip::skim {
+
+[[noreturn]] static void fail(const char *what, size_t pos) {
+  throw ParseError(std::string(what) + " at byte " + std::to_string(pos));
+}
+
+static size_t skipWhitespace(std::string_view json, size_t pos) {
+  while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\n' || json[pos] == '\r' || json[pos] == '\t'))
+    pos++;
+  return pos;
+}
+
+static void expect(std::string_view json, size_t pos, char c) {
+  if (pos >= json.size() || json[pos] != c)
+    fail((std::string("Expected '") + c + "'").c_str(), pos);
+}
+
+/// `pos` is the opening quote, returns the position after the closing one
+static size_t skipString(std::string_view json, size_t pos) {
+  for (pos++;;) {
+    pos = json.find_first_of("\"\\", pos);
+    if (pos == std::string_view::npos)
+      fail("Unterminated string", json.size());
+    if (json[pos] == '"')
+      return pos + 1;
+    pos += 2; // Escaped character
+  }
+}
+
+/// Returns the position after the value starting at `pos`
+static size_t skipValue(std::string_view json, size_t pos) {
+  if (pos >= json.size())
+    fail("Expected a value", pos);
+
+  if (json[pos] == '"')
+    return skipString(json, pos);
+
+  if (json[pos] == '{' || json[pos] == '[') {
+    // Only brackets and strings matter, which is what makes this faster than parsing
+    static constexpr std::array<bool, 256> structural = []() {
+      std::array<bool, 256> result{};
+      for (unsigned char c : { '"', '{', '}', '[', ']' })
+        result[c] = true;
+      return result;
+    }();
+
+    const char *data = json.data();
+    size_t depth = 0;
+    for (; pos < json.size(); pos++) {
+      auto c = static_cast<unsigned char>(data[pos]);
+      if (!structural[c])
+        continue;
+
+      if (c == '"') {
+        // Strings are short, the loop is faster than find_first_of() for them
+        for (pos++; pos < json.size() && data[pos] != '"'; pos++) {
+          if (data[pos] == '\\')
+            pos++;
+        }
+      } else if (c == '{' || c == '[') {
+        depth++;
+      } else if (--depth == 0) {
+        return pos + 1;
+      }
+    }
+    fail("Unterminated object or array", json.size());
+  }
+
+  // Numbers and literals
+  size_t end = json.find_first_of(",}] \n\r\t", pos);
+  if (end == std::string_view::npos)
+    end = json.size();
+  if (end == pos)
+    fail("Expected a value", pos);
+  return end;
+}
+
+Slice document(std::string_view json) {
+  size_t end = json.find_last_not_of(" \n\r\t");
+  return { skipWhitespace(json, 0), end == std::string_view::npos ? 0 : end + 1 };
+}
+
+std::vector<std::pair<std::string_view, Slice>> objectMembers(std::string_view json, Slice object) {
+  std::vector<std::pair<std::string_view, Slice>> result;
+  expect(json, object.begin, '{');
+
+  size_t pos = object.begin + 1;
+  while (true) {
+    pos = skipWhitespace(json, pos);
+    // Also accepts trailing commas, like the song parser does
+    if (pos < object.end && json[pos] == '}')
+      return result;
+
+    expect(json, pos, '"');
+    size_t keyEnd = skipString(json, pos);
+    std::string_view key = json.substr(pos + 1, keyEnd - pos - 2);
+
+    pos = skipWhitespace(json, keyEnd);
+    expect(json, pos, ':');
+    pos = skipWhitespace(json, pos + 1);
+    size_t valueEnd = skipValue(json, pos);
+    if (valueEnd > object.end)
+      fail("Value past the end of its object", pos);
+    result.emplace_back(key, Slice{ pos, valueEnd });
+
+    pos = skipWhitespace(json, valueEnd);
+    if (pos < object.end && json[pos] == ',') {
+      pos++;
+      continue;
+    }
+    expect(json, pos, '}');
+    return result;
+  }
+}
+
+std::vector<Slice> arrayElements(std::string_view json, Slice array) {
+  std::vector<Slice> result;
+  expect(json, array.begin, '[');
+
+  size_t pos = array.begin + 1;
+  while (true) {
+    pos = skipWhitespace(json, pos);
+    if (pos < array.end && json[pos] == ']')
+      return result;
+
+    size_t valueEnd = skipValue(json, pos);
+    if (valueEnd > array.end)
+      fail("Value past the end of its array", pos);
+    result.push_back({ pos, valueEnd });
+
+    pos = skipWhitespace(json, valueEnd);
+    if (pos < array.end && json[pos] == ',') {
+      pos++;
+      continue;
+    }
+    expect(json, pos, ']');
+    return result;
+  }
+}
+
+std::optional<Slice> member(const std::vector<std::pair<std::string_view, Slice>> &members, std::string_view key) {
+  for (const auto &[name, value] : members) {
+    if (name == key)
+      return value;
+  }
+  return std::nullopt;
+}
+
+} // namespace audiotrip::skim
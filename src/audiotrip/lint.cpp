@@ -0,0 +1,197 @@
+#include "audiotrip/lint.h"
+
+// STL includes
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+
+// Libraries
+#include <fmt/format.h>
+
+// Local includes
+#include "audiotrip/utils.h"
+
+namespace audiotrip::lint {
+
+/// Events closer than this on the same hand can't both be hit
+static constexpr double OverlapSeconds = 1e-3;
+
+static bool isRibbon(const ChoreoEvent &event) {
+  return event.type == ChoreoEventTypeRibbonL || event.type == ChoreoEventTypeRibbonR;
+}
+
+static void checkTempoSections(const AudioTripSong &song, std::vector<Issue> &issues) {
+  for (size_t i = 1; i < song.tempoSections.size(); i++) {
+    float previous = song.tempoSections[i - 1].startTimeInSeconds;
+    float start = song.tempoSections[i].startTimeInSeconds;
+    if (start > previous)
+      continue;
+
+    issues.push_back({ SeverityError,
+                       "tempo-order",
+                       {},
+                       std::nullopt,
+                       fmt::format("Tempo section {} starts at {:.3f} s, not after the previous one at {:.3f} s",
+                                   i,
+                                   start,
+                                   previous) });
+  }
+}
+
+static void checkChoreography(const Choreography &choreography,
+                              const std::vector<Beat> &beats,
+                              float songEnd,
+                              std::vector<Issue> &issues) {
+  auto report = [&](Severity severity, const char *check, size_t event, std::string message) {
+    issues.push_back({ severity, check, choreography.name, event, std::move(message) });
+  };
+
+  // Time spanned by the events of each hand, ribbons last until their last sub-position
+  struct Span {
+    size_t event;
+    double start;
+    double end;
+  };
+  std::array<std::vector<Span>, 2> hands;
+
+  double previousStart = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < choreography.events.size(); i++) {
+    const ChoreoEvent &event = choreography.events[i];
+    const BeatTime &time = event.time;
+
+    if (time.denominator <= 0) {
+      report(SeverityError, "invalid-denominator", i, fmt::format("Beat fraction denominator is {}", time.denominator));
+      continue;
+    }
+    if (time.beat < 0) {
+      report(SeverityError, "negative-beat", i, fmt::format("Event is at beat {}", time.beat));
+      continue;
+    }
+    if (time.numerator < 0 || time.numerator >= time.denominator) {
+      report(SeverityWarning,
+             "fraction-out-of-range",
+             i,
+             fmt::format("Beat fraction {}/{} is outside of its beat", time.numerator, time.denominator));
+    }
+
+    double startBeat = time.beat + static_cast<double>(time.numerator) / time.denominator;
+    double endBeat = startBeat;
+    if (isRibbon(event)) {
+      if (event.beatDivision <= 0) {
+        report(SeverityError,
+               "invalid-beat-division",
+               i,
+               fmt::format("Ribbon beat division is {}", event.beatDivision));
+        continue;
+      }
+      if (event.subPositions.size() < 2) {
+        report(SeverityError,
+               "ribbon-sub-positions",
+               i,
+               fmt::format("Ribbon has {} sub-positions, at least 2 are needed", event.subPositions.size()));
+        continue;
+      }
+      endBeat += static_cast<double>(event.subPositions.size() - 1) / event.beatDivision;
+    }
+
+    double start = beatSeconds(beats, static_cast<float>(startBeat));
+    double end = beatSeconds(beats, static_cast<float>(endBeat));
+
+    if (end > songEnd) {
+      report(SeverityWarning,
+             "after-song-end",
+             i,
+             fmt::format("Event ends at {:.3f} s, after the end of the song at {:.3f} s", end, songEnd));
+    }
+
+    if (start < previousStart) {
+      report(SeverityWarning,
+             "unsorted",
+             i,
+             fmt::format("Event at {:.3f} s comes after one at {:.3f} s", start, previousStart));
+    }
+    previousStart = std::max(previousStart, start);
+
+    if (event.isLHS())
+      hands[0].push_back({ i, start, end });
+    else if (event.isRHS())
+      hands[1].push_back({ i, start, end });
+  }
+
+  for (size_t hand = 0; hand < hands.size(); hand++) {
+    std::vector<Span> &spans = hands[hand];
+    std::stable_sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) { return a.start < b.start; });
+
+    // Compared to the span that ends last among the earlier ones, a ribbon can cover several events
+    const Span *latest = nullptr;
+    for (const Span &span : spans) {
+      if (latest != nullptr && span.start <= latest->end + OverlapSeconds) {
+        report(SeverityWarning,
+               "same-hand-overlap",
+               span.event,
+               fmt::format("{} hand event at {:.3f} s overlaps event {} ({:.3f}-{:.3f} s)",
+                           hand == 0 ? "Left" : "Right",
+                           span.start,
+                           latest->event,
+                           latest->start,
+                           latest->end));
+      }
+      if (latest == nullptr || span.end > latest->end)
+        latest = &span;
+    }
+  }
+}
+
+std::vector<Issue> check(const AudioTripSong &song) {
+  std::vector<Issue> issues;
+  checkTempoSections(song, issues);
+
+  // Beats past the end of the song keep the last tempo, so they aren't listed: corrupt beat numbers would allocate
+  // billions of them
+  std::vector<Beat> beats = song.computeBeats(false);
+  for (const Choreography &choreography : song.choreographies)
+    checkChoreography(choreography, beats, song.songEndTimeInSeconds, issues);
+
+  return issues;
+}
+
+std::vector<Issue> checkFile(const std::string &path) {
+  try {
+    // Lazily, so that a malformed choreography doesn't hide the issues of the others
+    AudioTripSong song = AudioTripSong::fromFile(path, nullptr, true);
+
+    std::vector<Issue> issues;
+    for (Choreography &choreography : song.choreographies) {
+      try {
+        choreography.loadEvents();
+      } catch (const ParseError &e) {
+        issues.push_back({ SeverityError, "parse", choreography.name, std::nullopt, e.what() });
+      }
+    }
+
+    std::vector<Issue> checked = check(song);
+    issues.insert(issues.end(), std::make_move_iterator(checked.begin()), std::make_move_iterator(checked.end()));
+    return issues;
+  } catch (const ParseError &e) {
+    return { { SeverityError, "parse", {}, std::nullopt, e.what() } };
+  }
+}
+
+std::string toJsonLine(const std::string &path, const Issue &issue) {
+  Json::Value line;
+  line["file"] = path;
+  line["severity"] = issue.severity == SeverityError ? "error" : "warning";
+  line["check"] = issue.check;
+  if (!issue.choreography.empty())
+    line["choreography"] = issue.choreography;
+  if (issue.event.has_value())
+    line["event"] = static_cast<Json::UInt64>(*issue.event);
+  line["message"] = issue.message;
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, line);
+}
+
+} // namespace audiotrip::lint
@@ -0,0 +1,142 @@
+#include "audiotrip/metrics.h"
+
+// STL includes
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+// Local includes
+#include "audiotrip/utils.h"
+#include "splines/spline3d.h"
+
+namespace audiotrip::metrics {
+
+/// Where a hand is, in the game's coordinates (X isn't inverted) and ignoring the distance along the song
+static raylib::Vector3 handPosition(const Position &position) {
+  return { position.x(), position.y(), 0 };
+}
+
+static bool isRibbon(const ChoreoEvent &event) {
+  return event.type == ChoreoEventTypeRibbonL || event.type == ChoreoEventTypeRibbonR;
+}
+
+Metrics compute(const Choreography &choreography, const std::vector<Beat> &beats, float windowSeconds) {
+  Metrics result;
+  result.windowSeconds = windowSeconds;
+
+  // Note times are packed for the density window below, the rest is accumulated as the events go by
+  std::vector<float> noteTimes;
+  noteTimes.reserve(choreography.events.size());
+  float firstTime = std::numeric_limits<float>::infinity();
+  float lastTime = -std::numeric_limits<float>::infinity();
+
+  std::array<std::optional<raylib::Vector3>, 2> handPositions; // After the last note of each hand
+  std::vector<raylib::Vector3> ribbonPoints;
+  bool crossed = false;
+  int lastHand = -1;
+
+  for (const ChoreoEvent &event : choreography.events) {
+    float time = eventSeconds(beats, event.time);
+    float endTime = time;
+
+    if (event.type == ChoreoEventTypeBarrier) {
+      result.barriers++;
+    } else if (event.isLHS() || event.isRHS()) {
+      int hand = event.isLHS() ? 0 : 1;
+      HandMetrics &metrics = result.hands[hand];
+      metrics.notes++;
+      noteTimes.push_back(time);
+
+      raylib::Vector3 start = handPosition(event.position);
+      if (handPositions[hand].has_value())
+        metrics.travel += Vector3Distance(*handPositions[hand], start);
+      handPositions[hand] = start;
+
+      if (isRibbon(event) && event.subPositions.size() >= 2) {
+        // Sub-positions are relative to the first gem
+        ribbonPoints.clear();
+        for (const Position &position : event.subPositions)
+          ribbonPoints.push_back(start + handPosition(position));
+
+        float length = 0;
+        for (const splines::Spline3D &spline : splines::Spline3D::FromPoints(ribbonPoints))
+          length += spline.Length();
+        metrics.travel += length;
+        metrics.ribbonTravel += length;
+        handPositions[hand] = ribbonPoints.back();
+
+        if (event.beatDivision > 0) {
+          float ribbonBeats =
+            static_cast<float>(event.subPositions.size() - 1) / static_cast<float>(event.beatDivision);
+          endTime = beatSeconds(beats, beatNumber(event.time) + ribbonBeats);
+        }
+      }
+
+      if (lastHand >= 0 && lastHand != hand)
+        result.handSwitches++;
+      lastHand = hand;
+
+      if (handPositions[0].has_value() && handPositions[1].has_value()) {
+        bool nowCrossed = handPositions[0]->x > handPositions[1]->x;
+        if (nowCrossed && !crossed)
+          result.crossovers++;
+        crossed = nowCrossed;
+      }
+    }
+
+    firstTime = std::min(firstTime, time);
+    lastTime = std::max(lastTime, endTime);
+  }
+
+  result.notes = noteTimes.size();
+  if (firstTime < lastTime)
+    result.durationSeconds = lastTime - firstTime;
+  if (result.durationSeconds > 0) {
+    result.averageNps = static_cast<float>(result.notes) / result.durationSeconds;
+    result.barriersPerMinute = static_cast<float>(result.barriers) * 60.0f / result.durationSeconds;
+  }
+
+  // Densest window, with two indices sliding over the sorted times
+  if (!std::is_sorted(noteTimes.begin(), noteTimes.end()))
+    std::sort(noteTimes.begin(), noteTimes.end());
+
+  size_t windowStart = 0;
+  size_t peak = 0;
+  for (size_t i = 0; i < noteTimes.size(); i++) {
+    while (noteTimes[i] - noteTimes[windowStart] >= windowSeconds)
+      windowStart++;
+
+    if (i - windowStart + 1 > peak) {
+      peak = i - windowStart + 1;
+      result.peakNpsTime = noteTimes[windowStart];
+    }
+  }
+  result.peakNps = static_cast<float>(peak) / windowSeconds;
+
+  return result;
+}
+
+Json::Value toJson(const Metrics &metrics) {
+  Json::Value result;
+  result["notes"] = static_cast<Json::UInt64>(metrics.notes);
+  result["barriers"] = static_cast<Json::UInt64>(metrics.barriers);
+  result["durationSeconds"] = metrics.durationSeconds;
+  result["averageNps"] = metrics.averageNps;
+  result["peakNps"] = metrics.peakNps;
+  result["peakNpsTime"] = metrics.peakNpsTime;
+  result["windowSeconds"] = metrics.windowSeconds;
+  result["crossovers"] = static_cast<Json::UInt64>(metrics.crossovers);
+  result["handSwitches"] = static_cast<Json::UInt64>(metrics.handSwitches);
+  result["barriersPerMinute"] = metrics.barriersPerMinute;
+
+  const char *handNames[] = { "left", "right" };
+  for (size_t i = 0; i < metrics.hands.size(); i++) {
+    Json::Value &hand = result["hands"][handNames[i]];
+    hand["notes"] = static_cast<Json::UInt64>(metrics.hands[i].notes);
+    hand["travel"] = metrics.hands[i].travel;
+    hand["ribbonTravel"] = metrics.hands[i].ribbonTravel;
+  }
+  return result;
+}
+
+} // namespace audiotrip::metrics
@@ -0,0 +1,422 @@
+#include "audiotrip/overlaps.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <set>
+
+// Local includes
+#include "audiotrip/trajectory.h"
+#include "audiotrip/utils.h"
+#include "splines/spline3d.h"
+
+namespace audiotrip::overlaps {
+
+// Footprint of barrier.obj: a trapezoid standing on its long side, centered on X
+static constexpr float BarrierHeight = 0.915f;
+static constexpr float BarrierBottomHalfWidth = 1.0f;
+static constexpr float BarrierTopHalfWidth = 0.506f;
+static constexpr float BarrierDepth = 0.04f;
+
+// Around the origin of the models, a bit smaller than their bounding boxes
+static constexpr float GemRadius = 0.15f;
+static constexpr float DrumRadius = 0.2f;
+
+// The cross-section of the ribbon meshes fits in this
+static constexpr float RibbonRadius = 0.09f;
+
+static constexpr float HandRadius = 0.05f;
+
+/// Barrier capsules are tested at points this far apart where they cross the barrier
+static constexpr float BarrierSampleStep = 0.05f;
+
+/// Volumes queried by each task
+static constexpr size_t QueryChunk = 4096;
+
+using Clock = std::chrono::steady_clock;
+
+static BoundingBox capsuleBounds(const raylib::Vector3 &a, const raylib::Vector3 &b, float radius) {
+  return { { std::min(a.x, b.x) - radius, std::min(a.y, b.y) - radius, std::min(a.z, b.z) - radius },
+           { std::max(a.x, b.x) + radius, std::max(a.y, b.y) + radius, std::max(a.z, b.z) + radius } };
+}
+
+static bool isRibbon(const ChoreoEvent &event) {
+  return event.type == ChoreoEventTypeRibbonL || event.type == ChoreoEventTypeRibbonR;
+}
+
+/**
+ * Barriers are placed with translate(0, 1.20, distance), rotate(-angle, Z), translate(0, 0.45 - y, 0), see
+ * `placement::PlacementBatch::placeEvent()`. These go from the model to the world and back.
+ */
+struct BarrierFrame {
+  float distance;
+  float sin;
+  float cos;
+  float offset;
+
+  BarrierFrame(const ChoreoEvent &event, float distance)
+      : distance(distance),
+        sin(std::sin(event.position.z() * DEG2RAD)),
+        cos(std::cos(event.position.z() * DEG2RAD)),
+        offset(0.45f - event.position.y()) {}
+
+  [[nodiscard]] raylib::Vector3 toWorld(const raylib::Vector3 &local) const {
+    float y = local.y + offset;
+    return { local.x * cos + y * sin, -local.x * sin + y * cos + 1.20f, local.z + distance };
+  }
+
+  [[nodiscard]] raylib::Vector3 toLocal(const raylib::Vector3 &world) const {
+    float y = world.y - 1.20f;
+    return { world.x * cos - y * sin, world.x * sin + y * cos - offset, world.z - distance };
+  }
+};
+
+static BoundingBox barrierBounds(const BarrierFrame &frame) {
+  BoundingBox bounds = { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+  for (float x : { -1.0f, 1.0f }) {
+    for (float y : { 0.0f, BarrierHeight }) {
+      for (float z : { 0.0f, BarrierDepth }) {
+        float halfWidth = y == 0 ? BarrierBottomHalfWidth : BarrierTopHalfWidth;
+        raylib::Vector3 corner = frame.toWorld({ x * halfWidth, y, z });
+        bounds = { { std::min(bounds.min.x, corner.x),
+                     std::min(bounds.min.y, corner.y),
+                     std::min(bounds.min.z, corner.z) },
+                   { std::max(bounds.max.x, corner.x),
+                     std::max(bounds.max.y, corner.y),
+                     std::max(bounds.max.z, corner.z) } };
+      }
+    }
+  }
+  return bounds;
+}
+
+/// Whether a point of the model space is within `radius` of the barrier, roughly: its footprint is grown by `radius`
+static bool insideBarrier(const raylib::Vector3 &local, float radius) {
+  if (local.y < -radius || local.y > BarrierHeight + radius || local.z < -radius || local.z > BarrierDepth + radius)
+    return false;
+  float y = std::clamp(local.y, 0.0f, BarrierHeight);
+  float halfWidth = BarrierBottomHalfWidth + (BarrierTopHalfWidth - BarrierBottomHalfWidth) * y / BarrierHeight;
+  return std::abs(local.x) <= halfWidth + radius;
+}
+
+static bool capsuleHitsBarrier(const BarrierFrame &frame, const Volume &capsule) {
+  raylib::Vector3 a = frame.toLocal(capsule.a);
+  raylib::Vector3 b = frame.toLocal(capsule.b);
+
+  // Part of the capsule axis between the planes of the barrier, grown by the radius
+  float t0 = 0;
+  float t1 = 1;
+  float minZ = -capsule.radius;
+  float maxZ = BarrierDepth + capsule.radius;
+  float dz = b.z - a.z;
+  if (std::abs(dz) < 1e-6f) {
+    if (a.z < minZ || a.z > maxZ)
+      return false;
+  } else {
+    float enter = (minZ - a.z) / dz;
+    float exit = (maxZ - a.z) / dz;
+    t0 = std::max(t0, std::min(enter, exit));
+    t1 = std::min(t1, std::max(enter, exit));
+    if (t0 > t1)
+      return false;
+  }
+
+  raylib::Vector3 first = Vector3Lerp(a, b, t0);
+  raylib::Vector3 last = Vector3Lerp(a, b, t1);
+  auto samples = static_cast<int>(std::ceil(Vector3Distance(first, last) / BarrierSampleStep));
+  for (int i = 0; i <= samples; i++) {
+    float t = samples == 0 ? 0.0f : static_cast<float>(i) / static_cast<float>(samples);
+    if (insideBarrier(Vector3Lerp(first, last, t), capsule.radius))
+      return true;
+  }
+  return false;
+}
+
+/// Squared distance between two segments, from Ericson's Real-Time Collision Detection, 5.1.9
+static float segmentDistanceSquared(const raylib::Vector3 &p1,
+                                    const raylib::Vector3 &q1,
+                                    const raylib::Vector3 &p2,
+                                    const raylib::Vector3 &q2) {
+  constexpr float epsilon = 1e-9f;
+  raylib::Vector3 d1 = Vector3Subtract(q1, p1);
+  raylib::Vector3 d2 = Vector3Subtract(q2, p2);
+  raylib::Vector3 r = Vector3Subtract(p1, p2);
+  float a = Vector3DotProduct(d1, d1);
+  float e = Vector3DotProduct(d2, d2);
+  float f = Vector3DotProduct(d2, r);
+
+  float s = 0;
+  float t = 0;
+  if (a <= epsilon && e <= epsilon) {
+    // Both are points
+  } else if (a <= epsilon) {
+    t = std::clamp(f / e, 0.0f, 1.0f);
+  } else {
+    float c = Vector3DotProduct(d1, r);
+    if (e <= epsilon) {
+      s = std::clamp(-c / a, 0.0f, 1.0f);
+    } else {
+      float b = Vector3DotProduct(d1, d2);
+      float denominator = a * e - b * b;
+      s = denominator > epsilon ? std::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+      t = (b * s + f) / e;
+      if (t < 0) {
+        t = 0;
+        s = std::clamp(-c / a, 0.0f, 1.0f);
+      } else if (t > 1) {
+        t = 1;
+        s = std::clamp((b - c) / a, 0.0f, 1.0f);
+      }
+    }
+  }
+
+  raylib::Vector3 closest1 = Vector3Add(p1, Vector3Scale(d1, s));
+  raylib::Vector3 closest2 = Vector3Add(p2, Vector3Scale(d2, t));
+  raylib::Vector3 difference = Vector3Subtract(closest1, closest2);
+  return Vector3DotProduct(difference, difference);
+}
+
+static void addRibbon(const Choreography &choreography,
+                      const std::vector<Beat> &beats,
+                      size_t index,
+                      float distance,
+                      std::vector<Volume> &volumes) {
+  const ChoreoEvent &event = choreography.events[index];
+  int hand = event.isRHS() ? 1 : 0;
+
+  // Same points, splines and slices as the ribbon meshes, see `Application::ribbonSplines()`
+  float beat = beatNumber(event.time);
+  float start = beatSeconds(beats, beat);
+  std::vector<raylib::Vector3> points;
+  for (size_t i = 0; i < event.subPositions.size(); i++) {
+    float seconds = beatSeconds(beats, beat + static_cast<float>(i) / static_cast<float>(event.beatDivision));
+    points.emplace_back(event.subPositions[i].vectorWithDistance(choreography.secondsToMeters(seconds - start)));
+  }
+  auto divisions = static_cast<size_t>(std::max(2.0f, 128.0f / static_cast<float>(event.beatDivision)));
+
+  raylib::Vector3 origin = event.position.vectorWithDistance(distance);
+  std::vector<splines::Spline3D> splines = splines::Spline3D::FromPoints(points);
+  raylib::Vector3 previous = Vector3Add(origin, splines.front().Position(0));
+  for (const splines::Spline3D &spline : splines) {
+    bool isLast = &spline == &splines.back();
+    for (size_t i = 1; i <= divisions; i++) {
+      float t = static_cast<float>(i) / static_cast<float>(divisions);
+
+      // Like the mesh, no slice where the ribbon goes straight ahead
+      raylib::Vector3 tangent = Vector3Normalize(spline.Velocity(t));
+      if (!isLast && Vector3Distance(tangent, { 0, 0, 1 }) < 0.005f)
+        continue;
+
+      raylib::Vector3 slice = Vector3Add(origin, spline.Position(t));
+      volumes.push_back(
+        { VolumeRibbon, index, hand, previous, slice, RibbonRadius, capsuleBounds(previous, slice, RibbonRadius) });
+      previous = slice;
+    }
+  }
+}
+
+static void addHandPath(const Choreography &choreography,
+                        const std::vector<Beat> &beats,
+                        int hand,
+                        float step,
+                        std::vector<Volume> &volumes) {
+  trajectory::HandPath path = trajectory::HandPath::of(choreography, beats, hand == 1);
+  if (path.empty() || step <= 0)
+    return;
+
+  auto worldPosition = [&](float seconds) -> raylib::Vector3 {
+    raylib::Vector3 position = path.position(seconds);
+    return { -position.x, position.y, choreography.secondsToMeters(seconds) };
+  };
+
+  raylib::Vector3 previous = worldPosition(path.startTime());
+  auto steps = static_cast<size_t>(std::ceil((path.endTime() - path.startTime()) / step));
+  for (size_t i = 1; i <= steps; i++) {
+    raylib::Vector3 current = worldPosition(std::min(path.startTime() + static_cast<float>(i) * step, path.endTime()));
+    volumes.push_back({ VolumeHandPath,
+                        std::nullopt,
+                        hand,
+                        previous,
+                        current,
+                        HandRadius,
+                        capsuleBounds(previous, current, HandRadius) });
+    previous = current;
+  }
+}
+
+std::vector<Volume> volumes(const Choreography &choreography,
+                            const std::vector<Beat> &beats,
+                            const Options &options) {
+  std::vector<Volume> result;
+  for (size_t i = 0; i < choreography.events.size(); i++) {
+    const ChoreoEvent &event = choreography.events[i];
+    float distance = choreography.secondsToMeters(eventSeconds(beats, event.time));
+
+    if (event.type == ChoreoEventTypeBarrier) {
+      BarrierFrame frame(event, distance);
+      raylib::Vector3 origin = { 0, 1.20f, distance };
+      result.push_back({ VolumeBarrier, i, -1, origin, origin, 0, barrierBounds(frame) });
+      continue;
+    }
+    if (!event.isLHS() && !event.isRHS())
+      continue;
+
+    // Broken ribbons are reported by the linter, only their first gem is kept
+    if (isRibbon(event) && event.subPositions.size() >= 2 && event.beatDivision > 0) {
+      addRibbon(choreography, beats, i, distance, result);
+      continue;
+    }
+
+    bool drum = event.type == ChoreoEventTypeDrumL || event.type == ChoreoEventTypeDrumR ||
+                event.type == ChoreoEventTypeDirGemL || event.type == ChoreoEventTypeDirGemR;
+    float radius = drum ? DrumRadius : GemRadius;
+    raylib::Vector3 center = event.position.vectorWithDistance(distance);
+    result.push_back(
+      { VolumeNote, i, event.isRHS() ? 1 : 0, center, center, radius, capsuleBounds(center, center, radius) });
+  }
+
+  if (options.handPaths) {
+    for (int hand = 0; hand < 2; hand++)
+      addHandPath(choreography, beats, hand, options.handPathStep, result);
+  }
+  return result;
+}
+
+bool intersect(const Choreography &choreography, const Volume &a, const Volume &b) {
+  if (a.event.has_value() && a.event == b.event)
+    return false;
+  if (a.kind == VolumeBarrier && b.kind == VolumeBarrier)
+    return false;
+
+  if (a.kind == VolumeBarrier || b.kind == VolumeBarrier) {
+    const Volume &barrier = a.kind == VolumeBarrier ? a : b;
+    const Volume &other = a.kind == VolumeBarrier ? b : a;
+    return capsuleHitsBarrier(BarrierFrame(choreography.events[*barrier.event], barrier.a.z), other);
+  }
+
+  // The hand paths go through all the notes of their hand
+  if (a.kind == VolumeHandPath || b.kind == VolumeHandPath)
+    return false;
+
+  float reach = a.radius + b.radius;
+  return segmentDistanceSquared(a.a, a.b, b.a, b.b) < reach * reach;
+}
+
+static Overlap overlapOf(const Choreography &choreography, const std::vector<Volume> &volumes, size_t i, size_t j) {
+  const BoundingBox &a = volumes[i].bounds;
+  const BoundingBox &b = volumes[j].bounds;
+  BoundingBox bounds = { { std::max(a.min.x, b.min.x), std::max(a.min.y, b.min.y), std::max(a.min.z, b.min.z) },
+                         { std::min(a.max.x, b.max.x), std::min(a.max.y, b.max.y), std::min(a.max.z, b.max.z) } };
+  float meters = (bounds.min.z + bounds.max.z) / 2;
+  float seconds = choreography.gemSpeed > 0 ? meters / static_cast<float>(choreography.gemSpeed) : 0.0f;
+  return { std::min(i, j), std::max(i, j), seconds, bounds };
+}
+
+/// Sorts by time and keeps only the first overlap of each pair of events, or of hand and barrier
+static void sortOverlaps(const std::vector<Volume> &volumes, std::vector<Overlap> &overlaps) {
+  std::sort(overlaps.begin(), overlaps.end(), [](const Overlap &a, const Overlap &b) {
+    if (a.seconds != b.seconds)
+      return a.seconds < b.seconds;
+    return a.first != b.first ? a.first < b.first : a.second < b.second;
+  });
+
+  // Events are numbered after the hands
+  auto owner = [&](size_t volume) {
+    const Volume &v = volumes[volume];
+    return v.event.has_value() ? *v.event + 2 : static_cast<size_t>(v.hand);
+  };
+  std::set<std::pair<size_t, size_t>> seen;
+  std::erase_if(overlaps, [&](const Overlap &overlap) {
+    size_t a = owner(overlap.first);
+    size_t b = owner(overlap.second);
+    return !seen.insert({ std::min(a, b), std::max(a, b) }).second;
+  });
+}
+
+Result find(const Choreography &choreography,
+            const std::vector<Beat> &beats,
+            ThreadPool &pool,
+            const Options &options) {
+  Result result;
+  auto start = Clock::now();
+  result.volumes = volumes(choreography, beats, options);
+
+  std::vector<BoundingBox> boxes;
+  boxes.reserve(result.volumes.size());
+  for (const Volume &volume : result.volumes)
+    boxes.push_back(volume.bounds);
+  Bvh bvh(boxes);
+  result.buildSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  // Each pair is tested by the volume that comes first
+  struct Chunk {
+    std::vector<Overlap> overlaps;
+    size_t candidates = 0;
+  };
+  start = Clock::now();
+  std::vector<std::future<Chunk>> chunks;
+  const std::vector<Volume> &volumes = result.volumes;
+  for (size_t first = 0; first < volumes.size(); first += QueryChunk) {
+    size_t last = std::min(first + QueryChunk, volumes.size());
+    chunks.push_back(pool.submit([&choreography, &volumes, &bvh, first, last]() {
+      Chunk chunk;
+      for (size_t i = first; i < last; i++) {
+        bvh.query(volumes[i].bounds, [&](size_t j) {
+          if (j <= i)
+            return;
+          chunk.candidates++;
+          if (intersect(choreography, volumes[i], volumes[j]))
+            chunk.overlaps.push_back(overlapOf(choreography, volumes, i, j));
+        });
+      }
+      return chunk;
+    }));
+  }
+  pool.runPending();
+
+  for (std::future<Chunk> &future : chunks) {
+    Chunk chunk = future.get();
+    result.candidates += chunk.candidates;
+    result.overlaps.insert(result.overlaps.end(), chunk.overlaps.begin(), chunk.overlaps.end());
+  }
+  sortOverlaps(result.volumes, result.overlaps);
+  result.querySeconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return result;
+}
+
+std::vector<Overlap> findBruteForce(const Choreography &choreography, const std::vector<Volume> &volumes) {
+  std::vector<Overlap> overlaps;
+  for (size_t i = 0; i < volumes.size(); i++) {
+    for (size_t j = i + 1; j < volumes.size(); j++) {
+      if (Bvh::overlaps(volumes[i].bounds, volumes[j].bounds) && intersect(choreography, volumes[i], volumes[j]))
+        overlaps.push_back(overlapOf(choreography, volumes, i, j));
+    }
+  }
+  sortOverlaps(volumes, overlaps);
+  return overlaps;
+}
+
+Json::Value toJson(const Result &result, const Overlap &overlap) {
+  const char *kindNames[] = { "barrier", "note", "ribbon", "hand-path" };
+  const char *handNames[] = { "left", "right" };
+
+  auto volumeJson = [&](const Volume &volume) {
+    Json::Value value;
+    value["kind"] = kindNames[volume.kind];
+    if (volume.event.has_value())
+      value["event"] = static_cast<Json::UInt64>(*volume.event);
+    if (volume.hand >= 0)
+      value["hand"] = handNames[volume.hand];
+    return value;
+  };
+
+  Json::Value value;
+  value["time"] = overlap.seconds;
+  value["first"] = volumeJson(result.volumes[overlap.first]);
+  value["second"] = volumeJson(result.volumes[overlap.second]);
+  return value;
+}
+
+} // namespace audiotrip::overlaps
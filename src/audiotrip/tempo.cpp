@@ -0,0 +1,190 @@
+#include "audiotrip/tempo.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+namespace audiotrip::tempo {
+
+void accumulate(float *__restrict scores, const float *__restrict envelope, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    scores[i] += envelope[i];
+}
+
+/// The envelope at every `resolution` seconds from 0, linearly interpolated
+static std::vector<float> resample(const audio::OnsetEnvelope &envelope, float resolution) {
+  std::vector<float> result(static_cast<size_t>(envelope.duration() / resolution) + 1, 0.0f);
+  if (envelope.values.empty())
+    return result;
+
+  for (size_t i = 0; i < result.size(); i++) {
+    float position = (static_cast<float>(i) * resolution - envelope.firstFrameSeconds) / envelope.frameSeconds;
+    if (position < 0)
+      continue;
+    auto frame = static_cast<size_t>(position);
+    if (frame + 1 >= envelope.values.size())
+      break;
+    float fraction = position - static_cast<float>(frame);
+    result[i] = envelope.values[frame] * (1 - fraction) + envelope.values[frame + 1] * fraction;
+  }
+  return result;
+}
+
+/// Slides and stretches the beats of a section over the envelope, see `Section`
+static void measure(Section &section,
+                    const std::vector<float> &beatTimes,
+                    const std::vector<float> &onsets,
+                    const Options &options) {
+  auto offsets = static_cast<size_t>(std::lround(options.maxOffset / options.resolution));
+  auto drifts = static_cast<long>(std::lround(options.maxDrift / options.driftStep));
+  size_t width = 2 * offsets + 1;
+
+  // Scores of every offset for a drift, one row at a time
+  std::vector<float> scores(width);
+  auto scoreRow = [&](float drift) {
+    std::fill(scores.begin(), scores.end(), 0.0f);
+    for (float time : beatTimes) {
+      // Beats were only kept if every offset and drift tried stays within the audio
+      auto center = static_cast<size_t>(std::lround((time + drift * (time - section.firstBeat)) / options.resolution));
+      accumulate(scores.data(), &onsets[center - offsets], width);
+    }
+    for (float &score : scores)
+      score /= static_cast<float>(beatTimes.size());
+  };
+
+  double sum = 0;
+  double squares = 0;
+  size_t candidates = 0;
+  float best = -1;
+  long bestStep = 0;
+  size_t bestOffset = offsets;
+
+  for (long step = -drifts; step <= drifts; step++) {
+    scoreRow(static_cast<float>(step) * options.driftStep);
+    for (size_t offset = 0; offset < width; offset++) {
+      sum += scores[offset];
+      squares += static_cast<double>(scores[offset]) * scores[offset];
+      candidates++;
+      if (scores[offset] > best) {
+        best = scores[offset];
+        bestStep = step;
+        bestOffset = offset;
+      }
+    }
+    if (step == 0)
+      section.currentScore = scores[offsets];
+  }
+
+  // On long sections a drift step moves the last beats by more than the resolution, so the drifts between the
+  // neighbours of the best one are tried too, with steps that move the last beat by at most the resolution. The
+  // confidence is still measured on the first pass, whose drifts are spread evenly.
+  float drift = static_cast<float>(bestStep) * options.driftStep;
+  float coarseDrift = drift;
+  auto refinements = static_cast<long>(std::ceil(options.driftStep * (section.lastBeat - section.firstBeat) /
+                                                 options.resolution));
+  for (long step = -refinements + 1; step < refinements; step++) {
+    float candidate = coarseDrift + static_cast<float>(step) * options.driftStep / static_cast<float>(refinements);
+    if (step == 0 || std::abs(candidate) > static_cast<float>(drifts) * options.driftStep)
+      continue;
+    scoreRow(candidate);
+    for (size_t offset = 0; offset < width; offset++) {
+      if (scores[offset] > best) {
+        best = scores[offset];
+        drift = candidate;
+        bestOffset = offset;
+      }
+    }
+  }
+
+  double mean = sum / static_cast<double>(candidates);
+  double deviation = std::sqrt(std::max(squares / static_cast<double>(candidates) - mean * mean, 0.0));
+
+  section.measured = true;
+  section.score = best;
+  section.confidence = deviation > 0 ? static_cast<float>((best - mean) / deviation) : 0.0f;
+  section.offset = (static_cast<float>(bestOffset) - static_cast<float>(offsets)) * options.resolution;
+  section.suggestedBpm = section.bpm / (1 + drift);
+  section.suggestedFirstBeat = section.firstBeat + section.offset;
+  section.maxError =
+    std::max(std::abs(section.offset), std::abs(section.offset + drift * (section.lastBeat - section.firstBeat)));
+  section.atLimit = bestOffset == 0 || bestOffset == width - 1 || std::abs(bestStep) == drifts;
+  section.needsCorrection = section.confidence >= options.minConfidence && section.maxError > options.tolerance;
+}
+
+Report check(const AudioTripSong &song,
+             const std::vector<Beat> &beats,
+             const audio::OnsetEnvelope &envelope,
+             const Options &options) {
+  Report report;
+  report.audioSeconds = envelope.duration();
+  std::vector<float> onsets = resample(envelope, options.resolution);
+
+  // Beats belong to the last section started at or before them, those before the first one to the first one
+  std::vector<std::vector<float>> sectionBeats(song.tempoSections.size());
+  for (const Beat &beat : beats) {
+    auto it = std::upper_bound(song.tempoSections.begin(),
+                               song.tempoSections.end(),
+                               beat.time,
+                               [](float time, const TempoSection &section) {
+                                 return time < section.startTimeInSeconds;
+                               });
+    size_t section = it == song.tempoSections.begin() ? 0 : it - song.tempoSections.begin() - 1;
+    sectionBeats[section].push_back(beat.time);
+  }
+
+  for (size_t i = 0; i < song.tempoSections.size(); i++) {
+    Section section{ i, song.tempoSections[i].beatsPerMinute };
+
+    // Only the beats that every offset and drift tried keep within the audio
+    std::vector<float> &times = sectionBeats[i];
+    if (!times.empty()) {
+      // The grid is stretched from the first beat
+      float spread = options.maxDrift * (times.back() - times.front());
+      float margin = options.maxOffset + 2 * options.resolution;
+      float end = static_cast<float>(onsets.size()) * options.resolution - margin - spread;
+      times.erase(std::remove_if(times.begin(),
+                                 times.end(),
+                                 [&](float time) { return time < margin || time > end; }),
+                  times.end());
+    }
+
+    section.beats = times.size();
+    if (!times.empty()) {
+      section.firstBeat = times.front();
+      section.lastBeat = times.back();
+    }
+    if (times.size() >= options.minBeats)
+      measure(section, times, onsets, options);
+    report.sections.push_back(section);
+  }
+  return report;
+}
+
+Json::Value toJson(const Report &report) {
+  Json::Value result;
+  result["audioSeconds"] = report.audioSeconds;
+  result["sections"] = Json::Value(Json::arrayValue);
+  for (const Section &section : report.sections) {
+    Json::Value value;
+    value["index"] = static_cast<Json::UInt64>(section.index);
+    value["bpm"] = section.bpm;
+    value["beats"] = static_cast<Json::UInt64>(section.beats);
+    value["measured"] = section.measured;
+    if (section.measured) {
+      value["firstBeat"] = section.firstBeat;
+      value["offset"] = section.offset;
+      value["suggestedBpm"] = section.suggestedBpm;
+      value["suggestedFirstBeat"] = section.suggestedFirstBeat;
+      value["maxError"] = section.maxError;
+      value["confidence"] = section.confidence;
+      value["score"] = section.score;
+      value["currentScore"] = section.currentScore;
+      value["atLimit"] = section.atLimit;
+      value["needsCorrection"] = section.needsCorrection;
+    }
+    result["sections"].append(value);
+  }
+  return result;
+}
+
+} // namespace audiotrip::tempo
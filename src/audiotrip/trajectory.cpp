@@ -0,0 +1,303 @@
+#include "audiotrip/trajectory.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <optional>
+
+// Local includes
+#include "audiotrip/utils.h"
+
+namespace audiotrip::trajectory {
+
+/// Keyframes closer than this are merged, the path can't go anywhere in between
+static constexpr float MinKeyframeSeconds = 1e-4f;
+
+static raylib::Vector3 handPosition(const Position &position) {
+  return { position.x(), position.y(), 0 };
+}
+
+HandPath::HandPath(const std::vector<Keyframe> &keyframes) {
+  std::vector<raylib::Vector3> points;
+  for (size_t i = 0; i < keyframes.size(); i++) {
+    if (i + 1 < keyframes.size() && keyframes[i + 1].time - keyframes[i].time < MinKeyframeSeconds)
+      continue;
+    times.push_back(keyframes[i].time);
+    points.push_back(keyframes[i].position);
+  }
+
+  if (points.size() < 2) {
+    times.clear();
+    return;
+  }
+
+  // Catmull-Rom with the tangents scaled by the time around each keyframe, instead of assuming it's the same between
+  // every keyframe: the velocity through a keyframe is then where the neighbouring ones are over the time between them,
+  // and a hand moving at a constant velocity keeps it. The ends use the velocity towards their only neighbour.
+  auto velocityAt = [&](size_t i) {
+    size_t previous = i > 0 ? i - 1 : i;
+    size_t next = std::min(i + 1, points.size() - 1);
+    return (points[next] - points[previous]) / (times[next] - times[previous]);
+  };
+
+  splines.reserve(points.size() - 1);
+  raylib::Vector3 startVelocity = velocityAt(0);
+  for (size_t i = 0; i + 1 < points.size(); i++) {
+    raylib::Vector3 endVelocity = velocityAt(i + 1);
+    float third = (times[i + 1] - times[i]) / 3;
+    splines.push_back(splines::Spline3D::Bezier(points[i],
+                                                points[i] + startVelocity * third,
+                                                points[i + 1] - endVelocity * third,
+                                                points[i + 1]));
+    startVelocity = endVelocity;
+  }
+}
+
+HandPath HandPath::of(const Choreography &choreography, const std::vector<Beat> &beats, bool rhs) {
+  std::vector<Keyframe> keyframes;
+  for (const ChoreoEvent &event : choreography.events) {
+    if (rhs ? !event.isRHS() : !event.isLHS())
+      continue;
+
+    raylib::Vector3 start = handPosition(event.position);
+    bool ribbon = event.type == ChoreoEventTypeRibbonL || event.type == ChoreoEventTypeRibbonR;
+    if (!ribbon || event.subPositions.size() < 2 || event.beatDivision <= 0) {
+      keyframes.push_back({ eventSeconds(beats, event.time), start });
+      continue;
+    }
+
+    // Sub-positions are relative to the first gem, one every 1/beatDivision beats
+    float beat = beatNumber(event.time);
+    for (size_t i = 0; i < event.subPositions.size(); i++) {
+      float subBeat = beat + static_cast<float>(i) / static_cast<float>(event.beatDivision);
+      keyframes.push_back({ beatSeconds(beats, subBeat), start + handPosition(event.subPositions[i]) });
+    }
+  }
+
+  std::stable_sort(keyframes.begin(), keyframes.end(), [](const Keyframe &a, const Keyframe &b) {
+    return a.time < b.time;
+  });
+  return HandPath(keyframes);
+}
+
+std::pair<size_t, float> HandPath::locate(float seconds) const {
+  auto next = std::upper_bound(times.begin(), times.end(), seconds);
+  size_t spline = std::clamp<size_t>(next - times.begin(), 1, splines.size()) - 1;
+  float t = (seconds - times[spline]) / (times[spline + 1] - times[spline]);
+  return { spline, std::clamp(t, 0.0f, 1.0f) };
+}
+
+raylib::Vector3 HandPath::position(float seconds) const {
+  if (empty())
+    return { 0, 0, 0 };
+  auto [spline, t] = locate(seconds);
+  return splines[spline].Position(t);
+}
+
+raylib::Vector3 HandPath::velocity(float seconds) const {
+  if (empty() || seconds < startTime() || seconds > endTime())
+    return { 0, 0, 0 };
+  auto [spline, t] = locate(seconds);
+  // The splines are parametrized from 0 to 1 over the time between their keyframes
+  return splines[spline].Velocity(t) / (times[spline + 1] - times[spline]);
+}
+
+float HandPath::length() const {
+  float result = 0;
+  for (const splines::Spline3D &spline : splines)
+    result += spline.Length();
+  return result;
+}
+
+namespace {
+
+/// Samples over a threshold, by index
+struct Run {
+  Quantity quantity;
+  size_t first;
+  size_t last;
+  float peak;
+  size_t peakSample;
+};
+
+struct WindowResult {
+  HandStats stats;
+  std::vector<Run> runs;
+};
+
+} // namespace
+
+/// Samples `first` to `last` (excluded) of a path. Doesn't depend on the other windows, the velocity of the sample
+/// before the first one is computed again.
+static WindowResult sampleWindow(const HandPath &path, size_t first, size_t last, const Options &options) {
+  WindowResult result;
+  float step = 1.0f / options.sampleRate;
+  auto timeOf = [&](size_t sample) { return path.startTime() + static_cast<float>(sample) * step; };
+
+  std::array<std::optional<Run>, 2> open; // By quantity
+  auto track = [&](Quantity quantity, float value, float threshold, size_t sample) {
+    std::optional<Run> &run = open[quantity];
+    if (value <= threshold) {
+      if (run.has_value())
+        result.runs.push_back(*run);
+      run.reset();
+      return;
+    }
+
+    if (!run.has_value())
+      run = Run{ quantity, sample, sample, value, sample };
+    run->last = sample;
+    if (value > run->peak) {
+      run->peak = value;
+      run->peakSample = sample;
+    }
+  };
+
+  raylib::Vector3 previous = first > 0 ? path.velocity(timeOf(first - 1)) : path.velocity(timeOf(0));
+  for (size_t sample = first; sample < last; sample++) {
+    float time = timeOf(sample);
+    raylib::Vector3 velocity = path.velocity(time);
+    float speed = Vector3Length(velocity);
+    float acceleration = sample > 0 ? Vector3Length(Vector3Subtract(velocity, previous)) / step : 0.0f;
+    previous = velocity;
+
+    if (speed > result.stats.peakSpeed) {
+      result.stats.peakSpeed = speed;
+      result.stats.peakSpeedTime = time;
+    }
+    if (acceleration > result.stats.peakAcceleration) {
+      result.stats.peakAcceleration = acceleration;
+      result.stats.peakAccelerationTime = time;
+    }
+    track(QuantitySpeed, speed, options.speedThreshold, sample);
+    track(QuantityAcceleration, acceleration, options.accelerationThreshold, sample);
+  }
+
+  for (const std::optional<Run> &run : open) {
+    if (run.has_value())
+      result.runs.push_back(*run);
+  }
+  result.stats.samples = last - first;
+  return result;
+}
+
+Simulation simulate(const Choreography &choreography,
+                    const std::vector<Beat> &beats,
+                    ThreadPool &pool,
+                    const Options &options) {
+  Simulation simulation;
+  simulation.options = options;
+
+  struct Window {
+    int hand;
+    std::future<WindowResult> result;
+  };
+  std::vector<Window> windows;
+
+  auto samplesPerWindow = static_cast<size_t>(std::max(1.0f, options.windowSeconds * options.sampleRate));
+  for (int hand = 0; hand < 2; hand++) {
+    HandPath &path = simulation.paths[hand];
+    path = HandPath::of(choreography, beats, hand == 1);
+    if (path.empty())
+      continue;
+
+    auto samples = static_cast<size_t>((path.endTime() - path.startTime()) * options.sampleRate) + 1;
+    for (size_t first = 0; first < samples; first += samplesPerWindow) {
+      size_t last = std::min(first + samplesPerWindow, samples);
+      windows.push_back({ hand, pool.submit([&path, first, last, &options]() {
+                           return sampleWindow(path, first, last, options);
+                         }) });
+    }
+  }
+  pool.runPending();
+
+  // Windows are in sample order for each hand, so a run can only continue the last one of its quantity
+  std::array<std::vector<Run>, 2> runs;
+  std::array<std::array<std::optional<size_t>, 2>, 2> lastRun; // By hand, then quantity
+  for (Window &window : windows) {
+    WindowResult result = window.result.get();
+    HandStats &stats = simulation.hands[window.hand];
+    if (result.stats.peakSpeed > stats.peakSpeed) {
+      stats.peakSpeed = result.stats.peakSpeed;
+      stats.peakSpeedTime = result.stats.peakSpeedTime;
+    }
+    if (result.stats.peakAcceleration > stats.peakAcceleration) {
+      stats.peakAcceleration = result.stats.peakAcceleration;
+      stats.peakAccelerationTime = result.stats.peakAccelerationTime;
+    }
+    stats.samples += result.stats.samples;
+
+    std::vector<Run> &handRuns = runs[window.hand];
+    for (const Run &run : result.runs) {
+      std::optional<size_t> &last = lastRun[window.hand][run.quantity];
+      if (!last.has_value() || handRuns[*last].last + 1 != run.first) {
+        last = handRuns.size();
+        handRuns.push_back(run);
+        continue;
+      }
+
+      Run *continued = &handRuns[*last];
+      continued->last = run.last;
+      if (run.peak > continued->peak) {
+        continued->peak = run.peak;
+        continued->peakSample = run.peakSample;
+      }
+    }
+  }
+
+  float step = 1.0f / options.sampleRate;
+  for (int hand = 0; hand < 2; hand++) {
+    const HandPath &path = simulation.paths[hand];
+    if (path.empty())
+      continue;
+
+    simulation.hands[hand].length = path.length();
+    auto timeOf = [&](size_t sample) { return path.startTime() + static_cast<float>(sample) * step; };
+    for (const Run &run : runs[hand]) {
+      simulation.hotSpots.push_back(
+        { hand, run.quantity, timeOf(run.first), timeOf(run.last) + step, run.peak, timeOf(run.peakSample) });
+    }
+  }
+
+  std::sort(simulation.hotSpots.begin(), simulation.hotSpots.end(), [](const HotSpot &a, const HotSpot &b) {
+    return a.start < b.start;
+  });
+  return simulation;
+}
+
+Json::Value toJson(const Simulation &simulation) {
+  const char *handNames[] = { "left", "right" };
+  const char *quantityNames[] = { "speed", "acceleration" };
+
+  Json::Value result;
+  result["sampleRate"] = simulation.options.sampleRate;
+  result["speedThreshold"] = simulation.options.speedThreshold;
+  result["accelerationThreshold"] = simulation.options.accelerationThreshold;
+
+  for (size_t i = 0; i < simulation.hands.size(); i++) {
+    const HandStats &stats = simulation.hands[i];
+    Json::Value &hand = result["hands"][handNames[i]];
+    hand["length"] = stats.length;
+    hand["peakSpeed"] = stats.peakSpeed;
+    hand["peakSpeedTime"] = stats.peakSpeedTime;
+    hand["peakAcceleration"] = stats.peakAcceleration;
+    hand["peakAccelerationTime"] = stats.peakAccelerationTime;
+    hand["samples"] = static_cast<Json::UInt64>(stats.samples);
+  }
+
+  result["hotSpots"] = Json::Value(Json::arrayValue);
+  for (const HotSpot &hotSpot : simulation.hotSpots) {
+    Json::Value spot;
+    spot["hand"] = handNames[hotSpot.hand];
+    spot["quantity"] = quantityNames[hotSpot.quantity];
+    spot["start"] = hotSpot.start;
+    spot["end"] = hotSpot.end;
+    spot["peak"] = hotSpot.peak;
+    spot["peakTime"] = hotSpot.peakTime;
+    result["hotSpots"].append(spot);
+  }
+  return result;
+}
+
+} // namespace audiotrip::trajectory
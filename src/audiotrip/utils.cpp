@@ -5,17 +5,25 @@
 #include "audiotrip/dtos.h"
 #include "audiotrip/utils.h"
 
+// STL includes
+#include <algorithm>
+#include <filesystem>
+
 namespace audiotrip {
 
-std::vector<Beat> AudioTripSong::computeBeats() const {
+std::vector<Beat> AudioTripSong::computeBeats(bool throughEvents) const {
   // Find the max beat used in the actual choreo since some choreos have out-of-bounds beats
   ssize_t maxBeat = 0;
-  for (const Choreography &choreo : choreographies) {
-    for (const ChoreoEvent &event : choreo.events) {
-      if (event.time.beat > maxBeat)
-        maxBeat = event.time.beat;
+  if (throughEvents) {
+    for (const Choreography &choreo : choreographies) {
+      for (const ChoreoEvent &event : choreo.events) {
+        if (event.time.beat > maxBeat)
+          maxBeat = event.time.beat;
+      }
     }
   }
+  // Songs are validated when they are parsed, this only bounds the ones that are built some other way
+  maxBeat = std::min<ssize_t>(maxBeat, MaxBeat);
 
   assert(!tempoSections.empty());
   std::vector<Beat> result;
@@ -29,7 +37,7 @@ std::vector<Beat> AudioTripSong::computeBeats() const {
     float sectionEndTime = it == tempoSections.end() ? songEndTimeInSeconds : it->startTimeInSeconds;
     float secondsPerBeat = 60.0f / ts->beatsPerMinute;
 
-    while (accumulator < sectionEndTime) {
+    while (accumulator < sectionEndTime && result.size() <= static_cast<size_t>(MaxBeat)) {
       result.emplace_back(accumulator, ts->beatsPerMinute);
       accumulator += secondsPerBeat;
     }
@@ -47,4 +55,29 @@ std::vector<Beat> AudioTripSong::computeBeats() const {
   return result;
 }
 
+float beatSeconds(const std::vector<Beat> &beats, float beatNum) {
+  if (beats.empty() || beatNum < 0)
+    return 0;
+
+  size_t intBeat = std::min(static_cast<size_t>(beatNum), beats.size() - 1);
+  const Beat &beat = beats[intBeat];
+  return beat.time + (beatNum - static_cast<float>(intBeat)) * 60.0f / beat.bpm;
+}
+
+float beatNumber(const BeatTime &time) {
+  float fraction =
+    time.denominator != 0 ? static_cast<float>(time.numerator) / static_cast<float>(time.denominator) : 0.0f;
+  return static_cast<float>(time.beat) + fraction;
+}
+
+float eventSeconds(const std::vector<Beat> &beats, const BeatTime &time) {
+  return beatSeconds(beats, beatNumber(time));
+}
+
+std::string songAudioPath(const std::string &atsPath, const AudioTripSong &song) {
+  if (song.songFilename.empty())
+    return {};
+  return (std::filesystem::path(atsPath).parent_path() / song.songFilename).string();
+}
+
 } // namespace audiotrip
@@ -0,0 +1,699 @@
+#include "cli/commands.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <random>
+#include <type_traits>
+
+// Libraries
+#include <fmt/format.h>
+
+// Local includes
+#include "audio/Fft.h"
+#include "audio/OnsetDetector.h"
+#include "audio/Playback.h"
+#include "audio/PlaybackClock.h"
+#include "audiotrip/LibraryIndex.h"
+#include "audiotrip/dtos.h"
+#include "audiotrip/lint.h"
+#include "audiotrip/metrics.h"
+#include "audiotrip/overlaps.h"
+#include "audiotrip/tempo.h"
+#include "audiotrip/trajectory.h"
+#include "audiotrip/utils.h"
+#include "utils/ThreadPool.h"
+
+namespace cli {
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// The files given, and the .ats files in the directories given, sorted
+static std::vector<std::string> collectSongs(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files;
+  for (const std::string &input : inputs) {
+    if (!std::filesystem::is_directory(input)) {
+      files.push_back(input);
+      continue;
+    }
+
+    std::error_code error;
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (auto it = std::filesystem::recursive_directory_iterator(input, options, error);
+         it != std::filesystem::recursive_directory_iterator();
+         it.increment(error)) {
+      if (error)
+        break;
+      if (it->path().extension() == ".ats" && it->is_regular_file(error))
+        files.push_back(it->path().string());
+    }
+    if (error)
+      std::cerr << "Unable to walk " << input << ": " << error.message() << std::endl;
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+/**
+ * Runs `process` on each file on the global pool, and `report` on the results in file order, each as soon as it and
+ * the ones before it are done
+ */
+template<typename Process, typename Report>
+static void processSongs(const std::vector<std::string> &files, Process process, Report report) {
+  using Result = std::invoke_result_t<Process, const std::string &>;
+
+  std::vector<std::future<Result>> results;
+  results.reserve(files.size());
+  for (const std::string &file : files)
+    results.push_back(ThreadPool::global().submit([process, file]() { return process(file); }));
+
+  for (std::future<Result> &result : results) {
+    // Without worker threads the files are processed here
+    while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      if (ThreadPool::global().runPending(1) == 0)
+        result.wait();
+    }
+    report(result.get());
+  }
+}
+
+static std::string jsonLine(const Json::Value &value) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, value) + '\n';
+}
+
+int indexLibrary(const std::string &directory) {
+  if (!std::filesystem::is_directory(directory)) {
+    std::cerr << "Not a directory: " << directory << std::endl;
+    return 1;
+  }
+
+  auto start = Clock::now();
+  audiotrip::LibraryIndex index(directory);
+  bool loaded = index.load();
+  audiotrip::LibraryIndex::RefreshStats stats = index.refresh(ThreadPool::global(), std::cerr);
+  bool saved = index.save(std::cerr);
+
+  std::cout << fmt::format("{} songs in {:.2f} s: {} unchanged, {} parsed ({} failed), {} removed{}",
+                           stats.files,
+                           secondsSince(start),
+                           stats.reused,
+                           stats.parsed,
+                           stats.failed,
+                           stats.removed,
+                           loaded ? "" : ", new index")
+            << std::endl;
+  if (saved)
+    std::cout << "Index written to " << index.indexPath().string() << std::endl;
+  return saved ? 0 : 1;
+}
+
+int lint(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files = collectSongs(inputs);
+  auto start = Clock::now();
+
+  // Formatted on the workers
+  struct Report {
+    std::string lines;
+    size_t errors = 0;
+    size_t warnings = 0;
+  };
+
+  size_t errors = 0;
+  size_t warnings = 0;
+  processSongs(
+    files,
+    [](const std::string &file) {
+      Report report;
+      for (const audiotrip::lint::Issue &issue : audiotrip::lint::checkFile(file)) {
+        report.lines += audiotrip::lint::toJsonLine(file, issue);
+        report.lines += '\n';
+        (issue.severity == audiotrip::lint::SeverityError ? report.errors : report.warnings)++;
+      }
+      return report;
+    },
+    [&](const Report &report) {
+      std::cout << report.lines << std::flush;
+      errors += report.errors;
+      warnings += report.warnings;
+    });
+
+  std::cerr << fmt::format("{} files checked in {:.2f} s: {} errors, {} warnings",
+                           files.size(),
+                           secondsSince(start),
+                           errors,
+                           warnings)
+            << std::endl;
+  return errors > 0 ? 1 : 0;
+}
+
+int metrics(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files = collectSongs(inputs);
+  auto start = Clock::now();
+
+  size_t failed = 0;
+  processSongs(
+    files,
+    [](const std::string &file) -> std::pair<std::string, bool> {
+      Json::Value line;
+      line["file"] = file;
+      try {
+        audiotrip::AudioTripSong song = audiotrip::AudioTripSong::fromFile(file);
+        std::vector<audiotrip::Beat> beats = song.computeBeats();
+
+        line["title"] = song.title;
+        line["artist"] = song.artist;
+        line["choreographies"] = Json::Value(Json::arrayValue);
+        for (const audiotrip::Choreography &choreography : song.choreographies) {
+          Json::Value metrics = audiotrip::metrics::toJson(audiotrip::metrics::compute(choreography, beats));
+          metrics["name"] = choreography.name;
+          line["choreographies"].append(metrics);
+        }
+        return { jsonLine(line), true };
+      } catch (const std::exception &e) {
+        line["error"] = e.what();
+        return { jsonLine(line), false };
+      }
+    },
+    [&](const std::pair<std::string, bool> &result) {
+      std::cout << result.first << std::flush;
+      failed += result.second ? 0 : 1;
+    });
+
+  std::cerr << fmt::format("{} files measured in {:.2f} s, {} failed", files.size(), secondsSince(start), failed)
+            << std::endl;
+  return failed > 0 ? 1 : 0;
+}
+
+int trajectories(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files = collectSongs(inputs);
+  auto start = Clock::now();
+
+  size_t failed = 0;
+  processSongs(
+    files,
+    [](const std::string &file) -> std::pair<std::string, bool> {
+      Json::Value line;
+      line["file"] = file;
+      try {
+        audiotrip::AudioTripSong song = audiotrip::AudioTripSong::fromFile(file);
+        std::vector<audiotrip::Beat> beats = song.computeBeats();
+
+        line["title"] = song.title;
+        line["artist"] = song.artist;
+        line["choreographies"] = Json::Value(Json::arrayValue);
+        for (const audiotrip::Choreography &choreography : song.choreographies) {
+          // The windows of each choreography are spread over the pool too, this task runs some of them
+          Json::Value simulation = audiotrip::trajectory::toJson(
+            audiotrip::trajectory::simulate(choreography, beats, ThreadPool::global()));
+          simulation["name"] = choreography.name;
+          line["choreographies"].append(simulation);
+        }
+        return { jsonLine(line), true };
+      } catch (const std::exception &e) {
+        line["error"] = e.what();
+        return { jsonLine(line), false };
+      }
+    },
+    [&](const std::pair<std::string, bool> &result) {
+      std::cout << result.first << std::flush;
+      failed += result.second ? 0 : 1;
+    });
+
+  std::cerr << fmt::format("{} files simulated in {:.2f} s, {} failed", files.size(), secondsSince(start), failed)
+            << std::endl;
+  return failed > 0 ? 1 : 0;
+}
+
+int overlaps(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files = collectSongs(inputs);
+  auto start = Clock::now();
+
+  // Formatted on the workers
+  struct Report {
+    std::string lines;
+    size_t overlaps = 0;
+    bool failed = false;
+  };
+
+  size_t found = 0;
+  size_t failed = 0;
+  processSongs(
+    files,
+    [](const std::string &file) {
+      Report report;
+      try {
+        audiotrip::AudioTripSong song = audiotrip::AudioTripSong::fromFile(file);
+        std::vector<audiotrip::Beat> beats = song.computeBeats();
+        for (const audiotrip::Choreography &choreography : song.choreographies) {
+          audiotrip::overlaps::Result result = audiotrip::overlaps::find(choreography, beats, ThreadPool::global());
+          for (const audiotrip::overlaps::Overlap &overlap : result.overlaps) {
+            Json::Value line = audiotrip::overlaps::toJson(result, overlap);
+            line["file"] = file;
+            line["choreography"] = choreography.name;
+            report.lines += jsonLine(line);
+          }
+          report.overlaps += result.overlaps.size();
+        }
+      } catch (const std::exception &e) {
+        Json::Value line;
+        line["file"] = file;
+        line["error"] = e.what();
+        report.lines += jsonLine(line);
+        report.failed = true;
+      }
+      return report;
+    },
+    [&](const Report &report) {
+      std::cout << report.lines << std::flush;
+      found += report.overlaps;
+      failed += report.failed ? 1 : 0;
+    });
+
+  std::cerr << fmt::format("{} files checked in {:.2f} s: {} overlaps, {} failed",
+                           files.size(),
+                           secondsSince(start),
+                           found,
+                           failed)
+            << std::endl;
+  return found > 0 || failed > 0 ? 1 : 0;
+}
+
+int tempo(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files = collectSongs(inputs);
+  auto start = Clock::now();
+
+  // Formatted on the workers
+  struct Report {
+    std::string line;
+    size_t corrections = 0;
+    bool failed = false;
+  };
+
+  size_t corrections = 0;
+  size_t failed = 0;
+  processSongs(
+    files,
+    [](const std::string &file) {
+      Report report;
+      Json::Value line;
+      line["file"] = file;
+      try {
+        // The events are only needed for the beats past the end of the song
+        audiotrip::AudioTripSong song = audiotrip::AudioTripSong::fromFile(file, nullptr, true);
+        line["title"] = song.title;
+        line["artist"] = song.artist;
+
+        std::string audioPath = audiotrip::songAudioPath(file, song);
+        if (audioPath.empty())
+          throw std::runtime_error("The song has no audio file");
+        line["audio"] = audioPath;
+
+        auto analysisStart = Clock::now();
+        audio::OnsetEnvelope envelope = audio::OnsetDetector::fromFile(audioPath);
+        audiotrip::tempo::Report result = audiotrip::tempo::check(song, song.computeBeats(), envelope);
+
+        Json::Value json = audiotrip::tempo::toJson(result);
+        line["audioSeconds"] = json["audioSeconds"];
+        line["sections"] = json["sections"];
+        line["analysisSeconds"] = secondsSince(analysisStart);
+        for (const audiotrip::tempo::Section &section : result.sections)
+          report.corrections += section.needsCorrection ? 1 : 0;
+      } catch (const std::exception &e) {
+        line["error"] = e.what();
+        report.failed = true;
+      }
+      report.line = jsonLine(line);
+      return report;
+    },
+    [&](const Report &report) {
+      std::cout << report.line << std::flush;
+      corrections += report.corrections;
+      failed += report.failed ? 1 : 0;
+    });
+
+  std::cerr << fmt::format("{} files checked in {:.2f} s: {} sections to correct, {} failed",
+                           files.size(),
+                           secondsSince(start),
+                           corrections,
+                           failed)
+            << std::endl;
+  return corrections > 0 || failed > 0 ? 1 : 0;
+}
+
+/// Four events per beat at 120 BPM, a barrier every 16 and random gems, drums and ribbons in between
+static audiotrip::AudioTripSong syntheticSong(size_t events) {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> noteType(audiotrip::ChoreoEventTypeGemL, audiotrip::ChoreoEventTypeDirGemR);
+  std::uniform_int_distribution<int> ribbonLength(2, 8);
+
+  auto position = [&]() {
+    Json::Value result;
+    result["x"] = coordinate(random);
+    result["y"] = coordinate(random) + 1.0f;
+    result["z"] = 0;
+    return result;
+  };
+
+  Json::Value root;
+  Json::Value &metadata = root["metadata"];
+  metadata["title"] = "Synthetic";
+  Json::Value section;
+  section["startTimeInSeconds"] = 0;
+  section["beatsPerMeasure"] = 4;
+  section["beatsPerMinute"] = 120;
+  metadata["tempoSections"].append(section);
+  metadata["songEndTimeInSeconds"] = static_cast<double>(events) / 4 * 0.5 + 1;
+
+  Json::Value choreography;
+  choreography["header"]["name"] = "Synthetic";
+  choreography["header"]["gemSpeed"] = 10;
+  Json::Value &list = choreography["data"]["events"];
+  for (size_t i = 0; i < events; i++) {
+    Json::Value event;
+    int type = i % 16 == 0 ? audiotrip::ChoreoEventTypeBarrier : noteType(random);
+    event["type"] = type;
+    event["time"]["beat"] = static_cast<Json::UInt64>(i / 4);
+    event["time"]["numerator"] = static_cast<int>(i % 4);
+    event["time"]["denominator"] = 4;
+    event["beatDivision"] = 4;
+    event["position"] = position();
+    if (type == audiotrip::ChoreoEventTypeRibbonL || type == audiotrip::ChoreoEventTypeRibbonR) {
+      for (int j = ribbonLength(random); j > 0; j--)
+        event["subPositions"].append(position());
+    }
+    list.append(event);
+  }
+  root["choreographies"]["list"].append(choreography);
+
+  return audiotrip::AudioTripSong(root);
+}
+
+int benchmarkMetrics(size_t events) {
+  auto start = Clock::now();
+  audiotrip::AudioTripSong song = syntheticSong(events);
+  std::vector<audiotrip::Beat> beats = song.computeBeats();
+  std::cout << fmt::format("Generated {} events in {:.2f} s", events, secondsSince(start)) << std::endl;
+
+  constexpr int runs = 10;
+  std::vector<double> times;
+  audiotrip::metrics::Metrics result;
+  for (int i = 0; i < runs; i++) {
+    auto runStart = Clock::now();
+    result = audiotrip::metrics::compute(song.choreographies.front(), beats);
+    times.push_back(secondsSince(runStart));
+  }
+  std::sort(times.begin(), times.end());
+
+  double median = times[runs / 2];
+  std::cout << fmt::format("Metrics: {:.2f} ms median, {:.2f} ms best over {} runs, {:.1f} M events/s",
+                           median * 1000,
+                           times.front() * 1000,
+                           runs,
+                           static_cast<double>(events) / median / 1e6)
+            << std::endl;
+  std::cout << jsonLine(audiotrip::metrics::toJson(result)) << std::flush;
+  return 0;
+}
+
+int benchmarkOverlaps(size_t events) {
+  // Every pair is only tested on the start of the chart, it's quadratic
+  constexpr size_t bruteForceEvents = 1000;
+
+  auto start = Clock::now();
+  audiotrip::AudioTripSong song = syntheticSong(events);
+  std::vector<audiotrip::Beat> beats = song.computeBeats();
+  const audiotrip::Choreography &choreography = song.choreographies.front();
+  std::cout << fmt::format("Generated {} events in {:.2f} s", events, secondsSince(start)) << std::endl;
+
+  audiotrip::overlaps::Result result = audiotrip::overlaps::find(choreography, beats, ThreadPool::global());
+  std::cout << fmt::format("Index: {} volumes, built in {:.2f} ms, queried in {:.2f} ms on {} threads, "
+                           "{} candidate pairs, {} overlaps",
+                           result.volumes.size(),
+                           result.buildSeconds * 1000,
+                           result.querySeconds * 1000,
+                           std::max<size_t>(ThreadPool::global().size(), 1),
+                           result.candidates,
+                           result.overlaps.size())
+            << std::endl;
+
+  audiotrip::Choreography prefix = choreography;
+  if (prefix.events.size() > bruteForceEvents)
+    prefix.events.erase(prefix.events.begin() + bruteForceEvents, prefix.events.end());
+  audiotrip::overlaps::Result indexed = audiotrip::overlaps::find(prefix, beats, ThreadPool::global());
+
+  auto bruteForceStart = Clock::now();
+  std::vector<audiotrip::overlaps::Overlap> bruteForce = audiotrip::overlaps::findBruteForce(prefix, indexed.volumes);
+  double bruteForceSeconds = secondsSince(bruteForceStart);
+  bool same = std::equal(bruteForce.begin(),
+                         bruteForce.end(),
+                         indexed.overlaps.begin(),
+                         indexed.overlaps.end(),
+                         [](const audiotrip::overlaps::Overlap &a, const audiotrip::overlaps::Overlap &b) {
+                           return a.first == b.first && a.second == b.second;
+                         });
+  std::cout << fmt::format("First {} events, {} volumes: every pair in {:.2f} ms, index in {:.2f} ms, {}",
+                           prefix.events.size(),
+                           indexed.volumes.size(),
+                           bruteForceSeconds * 1000,
+                           (indexed.buildSeconds + indexed.querySeconds) * 1000,
+                           same ? "same overlaps" : "DIFFERENT OVERLAPS")
+            << std::endl;
+  return same ? 0 : 1;
+}
+
+int benchmarkTrajectories(size_t events) {
+  auto start = Clock::now();
+  audiotrip::AudioTripSong song = syntheticSong(events);
+  std::vector<audiotrip::Beat> beats = song.computeBeats();
+  std::cout << fmt::format("Generated {} events in {:.2f} s", events, secondsSince(start)) << std::endl;
+
+  start = Clock::now();
+  audiotrip::trajectory::Simulation simulation =
+    audiotrip::trajectory::simulate(song.choreographies.front(), beats, ThreadPool::global());
+  std::cout << fmt::format("Simulation: {} samples in {:.2f} ms on {} threads, {} hot-spots",
+                           simulation.hands[0].samples + simulation.hands[1].samples,
+                           secondsSince(start) * 1000,
+                           std::max<size_t>(ThreadPool::global().size(), 1),
+                           simulation.hotSpots.size())
+            << std::endl;
+
+  // A hand going in a straight line at a constant velocity, through keyframes unevenly spaced in time
+  const raylib::Vector3 velocity(1.5f, -0.5f, 0.0f);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> interval(0.05f, 0.5f);
+  std::vector<audiotrip::trajectory::Keyframe> keyframes;
+  for (float time = 0; keyframes.size() < 32; time += interval(random))
+    keyframes.push_back({ time, velocity * time });
+  audiotrip::trajectory::HandPath path(keyframes);
+
+  float maxError = 0;
+  for (float time = path.startTime(); time <= path.endTime(); time += 0.01f)
+    maxError = std::max(maxError, std::abs(path.velocity(time).Length() - velocity.Length()));
+  bool correct = maxError < 0.01f;
+  std::cout << fmt::format("Constant {:.3f} m/s path: speed off by up to {:.4f} m/s, {}",
+                           velocity.Length(),
+                           maxError,
+                           correct ? "correct" : "WRONG")
+            << std::endl;
+  return correct ? 0 : 1;
+}
+
+int benchmarkOnsets(const std::vector<float> &lengths) {
+  // Click tracks slightly slower than the 120 BPM of the synthetic chart and starting late, over some noise
+  constexpr uint32_t sampleRate = 44100;
+  constexpr float audioBpm = 119.8f;
+  constexpr float firstClick = 0.023f;
+  constexpr size_t blockFrames = 4096;
+  float clickSeconds = 60.0f / audioBpm;
+
+  std::mt19937 random(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  auto block = [&](size_t first, std::vector<float> &samples) {
+    for (size_t i = 0; i < samples.size() / 2; i++) {
+      float time = static_cast<float>(first + i) / sampleRate;
+      float sinceClick = std::fmod(time - firstClick + clickSeconds, clickSeconds);
+      float value = 0.02f * noise(random);
+      if (time >= firstClick && sinceClick < 0.05f)
+        value += 0.5f * noise(random) * std::exp(-sinceClick / 0.01f);
+      samples[2 * i] = samples[2 * i + 1] = value;
+    }
+  };
+
+  // Kernels, on the first frames of the track
+  audio::Fft fft(audio::OnsetDetector::FrameSize);
+  std::vector<float> samples(2 * blockFrames);
+  block(0, samples);
+  std::vector<float> magnitudes(fft.bins());
+  std::vector<float> spectrum(fft.bins());
+  std::vector<float> previous(fft.bins(), 0.0f);
+  constexpr int kernelRuns = 20000;
+
+  auto kernelStart = Clock::now();
+  for (int i = 0; i < kernelRuns; i++)
+    fft.magnitudes(&samples[(i % 8) * 2], magnitudes.data());
+  double fftSeconds = secondsSince(kernelStart) / kernelRuns;
+
+  kernelStart = Clock::now();
+  for (int i = 0; i < kernelRuns; i++) {
+    std::copy(magnitudes.begin(), magnitudes.end(), spectrum.begin());
+    audio::OnsetDetector::compress(spectrum.data(), spectrum.size(), 100.0f);
+    previous[i % previous.size()] = audio::OnsetDetector::positiveDifference(spectrum.data(),
+                                                                             previous.data(),
+                                                                             spectrum.size());
+  }
+  double fluxSeconds = secondsSince(kernelStart) / kernelRuns;
+
+  std::vector<float> scores(201, 0.0f);
+  kernelStart = Clock::now();
+  for (int i = 0; i < kernelRuns; i++)
+    audiotrip::tempo::accumulate(scores.data(), &samples[i % 64], scores.size());
+  double accumulateSeconds = secondsSince(kernelStart) / kernelRuns;
+
+  std::cout << fmt::format("Kernels: {}-point FFT {:.2f} us, compression and flux {:.2f} us per frame, "
+                           "correlation {:.1f} ns per beat",
+                           fft.size(),
+                           fftSeconds * 1e6,
+                           fluxSeconds * 1e6,
+                           accumulateSeconds * 1e9)
+            << std::endl;
+
+  // Whole analysis, streamed like a song would be. Long tracks need the finest drifts to find where the beats start.
+  bool correct = true;
+  for (float seconds : lengths) {
+    auto totalFrames = static_cast<size_t>(seconds * sampleRate);
+    auto start = Clock::now();
+    audio::OnsetDetector detector(sampleRate, 2);
+    for (size_t first = 0; first < totalFrames; first += blockFrames) {
+      samples.resize(2 * std::min(blockFrames, totalFrames - first));
+      block(first, samples);
+      detector.push(samples.data(), samples.size() / 2);
+    }
+    audio::OnsetEnvelope envelope = detector.finish();
+    double envelopeSeconds = secondsSince(start);
+
+    audiotrip::AudioTripSong song = syntheticSong(static_cast<size_t>(seconds) * 8);
+    std::vector<audiotrip::Beat> beats = song.computeBeats();
+    start = Clock::now();
+    audiotrip::tempo::Options options;
+    audiotrip::tempo::Report report = audiotrip::tempo::check(song, beats, envelope, options);
+    double checkSeconds = secondsSince(start);
+
+    std::cout << fmt::format("{:.0f} s of audio: envelope in {:.2f} ms ({:.0f}x real time), checked in {:.2f} ms",
+                             seconds,
+                             envelopeSeconds * 1000,
+                             seconds / envelopeSeconds,
+                             checkSeconds * 1000)
+              << std::endl;
+
+    const audiotrip::tempo::Section &section = report.sections.front();
+    if (!section.measured) {
+      std::cout << "The section couldn't be measured" << std::endl;
+      correct = false;
+      continue;
+    }
+
+    // The click closest to the first beat measured
+    float click = firstClick + std::round((section.firstBeat - firstClick) / clickSeconds) * clickSeconds;
+    bool found = section.needsCorrection && std::abs(section.suggestedBpm - audioBpm) < 0.02f &&
+                 std::abs(section.suggestedFirstBeat - click) < options.tolerance;
+    std::cout << fmt::format("Suggested {:.3f} BPM (audio {:.3f}), first beat at {:.4f} s (audio {:.4f}), {}",
+                             section.suggestedBpm,
+                             audioBpm,
+                             section.suggestedFirstBeat,
+                             click,
+                             found ? "correct" : "WRONG")
+              << std::endl;
+    correct = correct && found;
+  }
+  return correct ? 0 : 1;
+}
+
+int benchmarkPlayback(float seconds, const std::optional<std::string> &logPath) {
+  // A device with callbacks less frequent than the frames and a clock 0.05% fast, frames that jitter by up to 2 ms and
+  // a 50 ms hitch every 7 s, and a seek halfway through
+  constexpr double frameSeconds = 1.0 / 60.0;
+  constexpr double jitterSeconds = 0.002;
+  constexpr double hitchSeconds = 0.05;
+  constexpr double hitchEvery = 7.0;
+  audio::NullPlayback::Options device;
+  device.sampleRate = 44100;
+  device.periodFrames = 1024;
+  device.latency = 0.02;
+  device.clockSkew = 1.0005;
+
+  std::ofstream logFile;
+  if (logPath.has_value()) {
+    logFile.open(*logPath);
+    if (!logFile) {
+      std::cerr << "Unable to write " << *logPath << std::endl;
+      return 1;
+    }
+  }
+
+  double now = 0;
+  audio::NullPlayback playback(seconds, [&now]() { return now; }, device);
+  audio::PlaybackClock::Options clockOptions;
+  clockOptions.latency = playback.latency();
+  audio::PlaybackClock clock(clockOptions);
+  audio::PlaybackLog log(logFile.is_open() ? &logFile : nullptr);
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> jitter(-jitterSeconds, jitterSeconds);
+  double start = 0;
+  double nextHitch = hitchEvery;
+  bool seeked = false;
+  auto runStart = Clock::now();
+
+  playback.play(start);
+  clock.reset(start, now);
+  while (playback.playing()) {
+    double frame = frameSeconds + jitter(random);
+    if (now >= nextHitch) {
+      frame = hitchSeconds;
+      nextHitch += hitchEvery;
+    }
+    now += frame;
+
+    if (!seeked && playback.heard() >= seconds / 2) {
+      start = 0.75 * seconds;
+      playback.play(start);
+      clock.reset(start, now);
+      seeked = true;
+    }
+
+    // The viewer draws the camera moved in the same frame, see Application::logPlaybackFrame()
+    double camera = clock.update(playback.position(), now);
+    log.frame(now, frame, playback.heard(), camera);
+  }
+
+  std::cout << fmt::format("{} frames over {:.0f} s of playback simulated in {:.2f} ms, callbacks every {:.1f} ms "
+                           "(estimated {:.1f} ms), device clock {:+.2f}%",
+                           log.frames(),
+                           now,
+                           secondsSince(runStart) * 1000,
+                           1000.0 * device.periodFrames / device.sampleRate,
+                           clock.period() * 1000,
+                           (device.clockSkew - 1.0) * 100)
+            << std::endl;
+  std::cout << fmt::format("Camera vs audio: mean {:.2f} ms, max {:.2f} ms; longest frame {:.1f} ms, "
+                           "{} frames off by more than their own length",
+                           log.meanError() * 1000,
+                           log.maxError() * 1000,
+                           log.maxFrameSeconds() * 1000,
+                           log.late())
+            << std::endl;
+  return log.late() == 0 && log.frames() > 0 ? 0 : 1;
+}
+
+} // namespace cli
@@ -1,12 +1,16 @@
 // STL includes
 #include <iostream>
 #include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <vector>
 
 
 // Local includes
 // Libraries
 #include "Application.h"
+#include "cli/commands.h"
 
 /*
  * Note: Y is UP! The song extends parallel to Z, arms point parallel to X
@@ -20,23 +24,180 @@
 // - => reference point is in the middle, 55cm below the bottom side
 // - Y position is subtracted, not added
 
+static void printUsage(const char *argv0) {
+  std::cout << "Usage: " << argv0 << " [ats file] [options]" << std::endl;
+  std::cout << "       " << argv0 << " --lint|--metrics|--trajectories|--overlaps|--tempo <ats files or directories...>"
+            << std::endl;
+  std::cout << std::endl;
+  std::cout << "  --debug               Do not capture the mouse, print debug information" << std::endl;
+  std::cout << "  --startup-report      Print the time spent in each asset loading stage" << std::endl;
+  std::cout << "  --gpu-ribbons         Extrude ribbons in the vertex shader instead of on the CPU" << std::endl;
+  std::cout << "  --quantize-vertices   Use 16-bit vertex attributes, V toggles them in debug mode" << std::endl;
+  std::cout << "  --library <dir>       Search the songs in a directory from the GUI" << std::endl;
+  std::cout << "  --null-audio          Play songs on a simulated audio device that makes no sound" << std::endl;
+  std::cout << "  --audio-latency <ms>  Latency of the audio device, if the camera is ahead of or behind the music"
+            << std::endl;
+  std::cout << "  --playback-log <file> Write the camera vs audio timing of every frame played as CSV" << std::endl;
+  std::cout << "  --track-allocations   Count the heap allocations of every frame, shown with --debug and on exit"
+            << std::endl;
+  std::cout << "  --mem-report          Print the memory used by each subsystem once a song is loaded" << std::endl;
+  std::cout << "  --index <dir>         Update the library index of a directory and exit" << std::endl;
+  std::cout << "  --lint                Check the songs and print their issues as JSON lines, then exit" << std::endl;
+  std::cout << "  --metrics             Print the difficulty metrics of the songs as JSON lines, then exit"
+            << std::endl;
+  std::cout << "  --trajectories        Print the hand path stats and hot-spots of the songs as JSON lines, then exit"
+            << std::endl;
+  std::cout << "  --overlaps            Print what overlaps in the songs as JSON lines, then exit" << std::endl;
+  std::cout << "  --tempo               Check the tempo sections against the song audio as JSON lines, then exit"
+            << std::endl;
+  std::cout << "  --benchmark-metrics   Time the difficulty metrics on a large generated chart, then exit" << std::endl;
+  std::cout << "  --benchmark-overlaps  Time the overlap queries on a large generated chart, then exit" << std::endl;
+  std::cout << "  --benchmark-trajectories Time the hand paths on a large generated chart and check their speed, "
+               "then exit"
+            << std::endl;
+  std::cout << "  --benchmark-onsets    Time the onset detection on a generated click track, then exit" << std::endl;
+  std::cout << "  --benchmark-playback  Check the camera sync on a simulated audio device, then exit" << std::endl;
+  std::cout << "  --check-gpu-ribbons   Compare ribbons extruded on the GPU to their CPU meshes offscreen, then exit"
+            << std::endl;
+  std::cout << "  --check-quantized-vertices Compare the models and ribbons drawn from 16-bit and float vertices "
+               "offscreen, then exit"
+            << std::endl;
+}
+
 int main(int argc, const char *argv[]) {
   std::optional<std::string> filename = std::nullopt;
+  std::optional<std::string> indexDirectory = std::nullopt;
+  std::vector<std::string> positional;
+  bool lint = false;
+  bool metrics = false;
+  bool trajectories = false;
+  bool overlaps = false;
+  bool tempo = false;
+  bool benchmarkMetrics = false;
+  bool benchmarkOverlaps = false;
+  bool benchmarkTrajectories = false;
+  bool benchmarkOnsets = false;
+  bool benchmarkPlayback = false;
+  bool checkGpuRibbons = false;
+  bool checkQuantizedVertices = false;
+  bool trackAllocations = false;
+  ApplicationOptions options;
 
   //  chdir("/home/depau/CLionProjects/AudioTrip-LevelViewer");
 
-  if (argc > 1) {
-    if (std::string_view(argv[1]) == "-h" || std::string_view(argv[1]) == "--help") {
-      std::cout << "Usage: " << argv[0] << " [ats file] [--debug]" << std::endl;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg(argv[i]);
+
+    if (arg == "-h" || arg == "--help") {
+      printUsage(argv[0]);
       return 0;
+    } else if (arg == "--debug") {
+      options.debug = true;
+    } else if (arg == "--startup-report") {
+      options.startupReport = true;
+    } else if (arg == "--gpu-ribbons") {
+      options.gpuRibbons = true;
+    } else if (arg == "--quantize-vertices") {
+      options.quantizedVertices = true;
+    } else if (arg == "--lint") {
+      lint = true;
+    } else if (arg == "--metrics") {
+      metrics = true;
+    } else if (arg == "--trajectories") {
+      trajectories = true;
+    } else if (arg == "--overlaps") {
+      overlaps = true;
+    } else if (arg == "--tempo") {
+      tempo = true;
+    } else if (arg == "--benchmark-metrics") {
+      benchmarkMetrics = true;
+    } else if (arg == "--benchmark-overlaps") {
+      benchmarkOverlaps = true;
+    } else if (arg == "--benchmark-trajectories") {
+      benchmarkTrajectories = true;
+    } else if (arg == "--benchmark-onsets") {
+      benchmarkOnsets = true;
+    } else if (arg == "--benchmark-playback") {
+      benchmarkPlayback = true;
+    } else if (arg == "--check-gpu-ribbons") {
+      checkGpuRibbons = true;
+      options.gpuRibbons = true;
+      options.hiddenWindow = true;
+    } else if (arg == "--check-quantized-vertices") {
+      checkQuantizedVertices = true;
+      options.hiddenWindow = true;
+    } else if (arg == "--track-allocations") {
+      trackAllocations = true;
+    } else if (arg == "--mem-report") {
+      options.memReport = true;
+    } else if (arg == "--null-audio") {
+      options.nullAudio = true;
+    } else if (arg == "--audio-latency" && i + 1 < argc) {
+      std::string value = argv[++i];
+      size_t parsed = 0;
+      try {
+        options.audioLatency = std::stod(value, &parsed) / 1000.0;
+      } catch (const std::logic_error &) {
+        // Not a number, or out of range
+      }
+      if (parsed == 0 || parsed != value.size()) {
+        std::cerr << "Invalid audio latency: " << value << std::endl;
+        printUsage(argv[0]);
+        return 1;
+      }
+    } else if (arg == "--playback-log" && i + 1 < argc) {
+      options.playbackLog = argv[++i];
+    } else if ((arg == "--library" || arg == "--index") && i + 1 < argc) {
+      (arg == "--library" ? options.library : indexDirectory) = argv[++i];
+    } else if (arg.starts_with("--")) {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      printUsage(argv[0]);
+      return 1;
     } else {
-      filename = argv[1];
+      filename = argv[i];
+      positional.emplace_back(argv[i]);
     }
   }
 
-  bool debug = std::string_view(argv[argc - 1]) == "--debug";
+  if (lint)
+    return cli::lint(positional);
+  if (metrics)
+    return cli::metrics(positional);
+  if (trajectories)
+    return cli::trajectories(positional);
+  if (overlaps)
+    return cli::overlaps(positional);
+  if (tempo)
+    return cli::tempo(positional);
+  if (benchmarkMetrics)
+    return cli::benchmarkMetrics(200000);
+  if (benchmarkOverlaps)
+    return cli::benchmarkOverlaps(50000);
+  if (benchmarkTrajectories)
+    return cli::benchmarkTrajectories(50000);
+  if (benchmarkOnsets)
+    return cli::benchmarkOnsets({ 180, 600 });
+  if (benchmarkPlayback)
+    return cli::benchmarkPlayback(180, options.playbackLog);
+  if (indexDirectory.has_value())
+    return cli::indexLibrary(*indexDirectory);
 
-  Application app(debug);
+  if (checkGpuRibbons) {
+    Application app(options);
+    return app.checkGpuRibbons();
+  }
+  if (checkQuantizedVertices) {
+    Application app(options);
+    return app.checkQuantizedVertices();
+  }
+
+  if (trackAllocations)
+    AllocationTracker::enable();
+
+  Application app(options);
   app.main(filename);
+
+  if (trackAllocations)
+    AllocationTracker::report(std::cout);
   return 0;
-}
\ No newline at end of file
+}
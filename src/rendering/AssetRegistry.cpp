@@ -0,0 +1,474 @@
+#include "rendering/AssetRegistry.h"
+
+// STL includes
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+// Libraries
+#include <fmt/format.h>
+
+namespace rlgl {
+#include "rlgl.h"
+}
+
+// raylib config
+#include "config.h"
+
+template<typename T>
+static std::shared_ptr<T> lookup(std::unordered_map<std::string, std::weak_ptr<T>> &cache, const std::string &key) {
+  auto it = cache.find(key);
+  if (it == cache.end())
+    return nullptr;
+  return it->second.lock();
+}
+
+template<typename T>
+static T *copyToRlBuffer(const std::vector<T> &data) {
+  if (data.empty())
+    return nullptr;
+  auto *result = static_cast<T *>(RL_MALLOC(data.size() * sizeof(T)));
+  std::memcpy(result, data.data(), data.size() * sizeof(T));
+  return result;
+}
+
+static std::string textureKey(const std::string &path, bool mipmaps) {
+  return mipmaps ? path + "#mipmaps" : path;
+}
+
+std::shared_ptr<raylib::Model> AssetRegistry::model(const std::string &path) {
+  if (auto cached = lookup(models, path)) {
+    recordHit(AssetKindModel);
+    return cached;
+  }
+
+  try {
+    if (std::optional<std::string> baked = binmesh::bakedPathFor(path))
+      return model(path, binmesh::MeshFile(*baked, path));
+    return model(path, obj::parseFile(path));
+  } catch (const std::runtime_error &e) {
+    throw raylib::RaylibException(e.what());
+  }
+}
+
+std::shared_ptr<raylib::Model> AssetRegistry::model(const std::string &path,
+                                                    const obj::ObjData &data,
+                                                    const DecodedImages &images) {
+  if (auto cached = lookup(models, path)) {
+    recordHit(AssetKindModel);
+    return cached;
+  }
+
+  auto model = uploadModel(data, images);
+  models[path] = model;
+  recordLoad(AssetKindModel, path, modelBytes(*model));
+  return model;
+}
+
+std::shared_ptr<raylib::Model> AssetRegistry::model(const std::string &path,
+                                                    const binmesh::MeshFile &baked,
+                                                    const DecodedImages &images) {
+  if (auto cached = lookup(models, path)) {
+    recordHit(AssetKindModel);
+    return cached;
+  }
+
+  auto model = uploadModel(baked, images);
+  models[path] = model;
+  recordLoad(AssetKindModel, path, modelBytes(*model));
+  return model;
+}
+
+std::shared_ptr<raylib::Texture2D> AssetRegistry::texture(const std::string &path, bool mipmaps) {
+  if (auto cached = lookup(textures, textureKey(path, mipmaps))) {
+    recordHit(AssetKindTexture);
+    return cached;
+  }
+
+  raylib::Image image(path);
+  if (mipmaps)
+    image.Mipmaps();
+
+  return texture(path, mipmaps, image);
+}
+
+std::shared_ptr<raylib::Texture2D> AssetRegistry::texture(const std::string &path, bool mipmaps, const Image &decoded) {
+  std::string key = textureKey(path, mipmaps);
+  if (auto cached = lookup(textures, key)) {
+    recordHit(AssetKindTexture);
+    return cached;
+  }
+
+  auto texture = std::make_shared<raylib::Texture2D>(decoded);
+  textures[key] = texture;
+  recordLoad(AssetKindTexture, key, textureBytes(*texture));
+  return texture;
+}
+
+std::shared_ptr<raylib::Shader> AssetRegistry::shader(const std::string &vsPath, const std::string &fsPath) {
+  if (auto cached = lookup(shaders, vsPath + "|" + fsPath)) {
+    recordHit(AssetKindShader);
+    return cached;
+  }
+
+  char *vsCode = LoadFileText(vsPath.c_str());
+  char *fsCode = LoadFileText(fsPath.c_str());
+  std::shared_ptr<raylib::Shader> result =
+    shader(vsPath, fsPath, vsCode != nullptr ? vsCode : "", fsCode != nullptr ? fsCode : "");
+  UnloadFileText(vsCode);
+  UnloadFileText(fsCode);
+  return result;
+}
+
+std::shared_ptr<raylib::Shader> AssetRegistry::shader(const std::string &vsPath,
+                                                      const std::string &fsPath,
+                                                      const std::string &vsCode,
+                                                      const std::string &fsCode) {
+  std::string key = vsPath + "|" + fsPath;
+  if (auto cached = lookup(shaders, key)) {
+    recordHit(AssetKindShader);
+    return cached;
+  }
+
+  auto shader = std::make_shared<raylib::Shader>(LoadShaderFromMemory(vsCode.c_str(), fsCode.c_str()));
+  shaders[key] = shader;
+  recordLoad(AssetKindShader, key, vsCode.size() + fsCode.size());
+  return shader;
+}
+
+std::shared_ptr<Material> AssetRegistry::material(const std::string &modelPath, int materialIndex) {
+  std::string key = fmt::format("{}#{}", modelPath, materialIndex);
+  if (auto cached = lookup(materials, key)) {
+    recordHit(AssetKindMaterial);
+    return cached;
+  }
+
+  std::shared_ptr<raylib::Model> owner = model(modelPath);
+  if (materialIndex < 0 || materialIndex >= owner->materialCount)
+    throw raylib::RaylibException(fmt::format("Model {} has no material {}", modelPath, materialIndex));
+
+  // Aliasing constructor: the material handle keeps the whole model alive
+  std::shared_ptr<Material> material(owner, &owner->materials[materialIndex]);
+  materials[key] = material;
+
+  size_t bytes = 0;
+  for (int i = 0; i < MAX_MATERIAL_MAPS; i++) {
+    const Texture &texture = material->maps[i].texture;
+    if (texture.id != 0 && texture.id != rlgl::rlGetTextureIdDefault())
+      bytes += textureBytes(texture);
+  }
+  recordLoad(AssetKindMaterial, key, bytes);
+  return material;
+}
+
+size_t AssetRegistry::duplicateLoads() const {
+  size_t result = 0;
+  for (const auto &[path, loads] : loadsPerPath) {
+    if (loads > 1)
+      result++;
+  }
+  return result;
+}
+
+void AssetRegistry::printReport(std::ostream &os) const {
+  static const char *kindNames[AssetKindCount] = { "models", "textures", "shaders", "materials" };
+
+  os << "Asset registry report:" << std::endl;
+  for (int kind = 0; kind < AssetKindCount; kind++) {
+    const Stats &s = kindStats[kind];
+    os << fmt::format(
+            "  {:<10} {:>4} loads {:>6} hits {:>10.1f} KiB", kindNames[kind], s.loads, s.hits, s.bytes / 1024.0)
+       << std::endl;
+  }
+
+  for (const auto &[path, loads] : loadsPerPath) {
+    if (loads > 1)
+      os << fmt::format("  duplicate: {} loaded {} times", path, loads) << std::endl;
+  }
+}
+
+MemoryReport::Usage AssetRegistry::memoryUsage(AssetKind kind) const {
+  MemoryReport::Usage usage;
+  switch (kind) {
+  case AssetKindModel:
+    for (const auto &[path, handle] : models) {
+      std::shared_ptr<raylib::Model> model = handle.lock();
+      if (model == nullptr)
+        continue;
+      for (int i = 0; i < model->meshCount; i++) {
+        MemoryReport::Usage mesh = meshUsage(model->meshes[i]);
+        usage.cpuBytes += mesh.cpuBytes;
+        usage.gpuBytes += mesh.gpuBytes;
+      }
+      usage.objects++;
+    }
+    break;
+  case AssetKindTexture:
+    for (const auto &[key, handle] : textures) {
+      if (std::shared_ptr<raylib::Texture2D> texture = handle.lock()) {
+        usage.gpuBytes += textureBytes(*texture);
+        usage.objects++;
+      }
+    }
+    break;
+  case AssetKindShader:
+    for (const auto &[key, handle] : shaders)
+      usage.objects += handle.expired() ? 0 : 1;
+    break;
+  case AssetKindMaterial:
+    for (const auto &[key, handle] : materials)
+      usage.objects += handle.expired() ? 0 : 1;
+    break;
+  default:
+    break;
+  }
+  return usage;
+}
+
+size_t AssetRegistry::textureBytes(const Texture &texture) {
+  size_t bytes = GetPixelDataSize(texture.width, texture.height, texture.format);
+  // A full mipmap chain adds roughly one third of the base level
+  if (texture.mipmaps > 1)
+    bytes += bytes / 3;
+  return bytes;
+}
+
+size_t AssetRegistry::meshBytes(const Mesh &mesh) {
+  auto vertexCount = static_cast<size_t>(mesh.vertexCount);
+  size_t bytes = 0;
+
+  if (mesh.vertices != nullptr)
+    bytes += vertexCount * 3 * sizeof(float);
+  if (mesh.texcoords != nullptr)
+    bytes += vertexCount * 2 * sizeof(float);
+  if (mesh.texcoords2 != nullptr)
+    bytes += vertexCount * 2 * sizeof(float);
+  if (mesh.normals != nullptr)
+    bytes += vertexCount * 3 * sizeof(float);
+  if (mesh.tangents != nullptr)
+    bytes += vertexCount * 4 * sizeof(float);
+  if (mesh.colors != nullptr)
+    bytes += vertexCount * 4 * sizeof(unsigned char);
+  if (mesh.indices != nullptr)
+    bytes += static_cast<size_t>(mesh.triangleCount) * 3 * sizeof(unsigned short);
+
+  // Baked meshes live in a single interleaved buffer on the GPU only
+  if (mesh.vertices == nullptr && mesh.vboId != nullptr && mesh.vboId[0] != 0)
+    bytes += vertexCount * sizeof(binmesh::Vertex);
+
+  return bytes;
+}
+
+MemoryReport::Usage AssetRegistry::meshUsage(const Mesh &mesh) {
+  auto vertexCount = static_cast<size_t>(mesh.vertexCount);
+  size_t indexBytes =
+    mesh.indices != nullptr ? static_cast<size_t>(mesh.triangleCount) * 3 * sizeof(unsigned short) : 0;
+  bool uploaded = mesh.vboId != nullptr && mesh.vboId[0] != 0;
+
+  MemoryReport::Usage usage;
+  usage.objects = 1;
+  if (mesh.vertices == nullptr && uploaded) {
+    // Baked meshes only keep their indices on the CPU
+    usage.cpuBytes = indexBytes;
+    usage.gpuBytes = vertexCount * sizeof(binmesh::Vertex) + indexBytes;
+    return usage;
+  }
+
+  usage.cpuBytes = meshBytes(mesh);
+  if (uploaded)
+    usage.gpuBytes = usage.cpuBytes;
+  return usage;
+}
+
+size_t AssetRegistry::modelBytes(const Model &model) {
+  size_t bytes = 0;
+  for (int i = 0; i < model.meshCount; i++)
+    bytes += meshBytes(model.meshes[i]);
+  return bytes;
+}
+
+/// Keeps the textures used by the model materials alive as long as the model, since raylib doesn't own them
+struct ModelHolder {
+  raylib::Model model;
+  std::vector<std::shared_ptr<raylib::Texture2D>> textures;
+
+  ModelHolder(const ::Model &model, std::vector<std::shared_ptr<raylib::Texture2D>> &&textures) :
+    model(model), textures(std::move(textures)) {}
+};
+
+std::shared_ptr<raylib::Model> AssetRegistry::uploadModel(const obj::ObjData &data, const DecodedImages &images) {
+  ::Model model{};
+
+  // Empty meshes (unused materials) are skipped, the mesh -> material mapping takes care of the rest
+  for (const obj::MeshData &meshData : data.meshes) {
+    if (!meshData.indices.empty())
+      model.meshCount++;
+  }
+
+  model.meshes = static_cast<Mesh *>(RL_CALLOC(model.meshCount, sizeof(Mesh)));
+  model.meshMaterial = static_cast<int *>(RL_CALLOC(model.meshCount, sizeof(int)));
+
+  int meshIndex = 0;
+  for (size_t i = 0; i < data.meshes.size(); i++) {
+    const obj::MeshData &meshData = data.meshes[i];
+    if (meshData.indices.empty())
+      continue;
+
+    Mesh &mesh = model.meshes[meshIndex];
+    mesh.vertexCount = static_cast<int>(meshData.vertexCount());
+    mesh.triangleCount = static_cast<int>(meshData.triangleCount());
+    mesh.vertices = copyToRlBuffer(meshData.vertices);
+    mesh.normals = copyToRlBuffer(meshData.normals);
+    mesh.texcoords = copyToRlBuffer(meshData.texcoords);
+    mesh.indices = copyToRlBuffer(meshData.indices);
+    UploadMesh(&mesh, false);
+
+    model.meshMaterial[meshIndex] = data.materials.empty() ? 0 : static_cast<int>(i);
+    meshIndex++;
+  }
+
+  return assembleModel(model, data.materials, images);
+}
+
+/**
+ * Uploads the interleaved vertex data as a single vertex buffer. raylib's mesh functions work with it since they only
+ * look at the VAO when drawing and unload every buffer in `vboId`. Falls back to separate arrays when vertex array
+ * objects are not supported, since in that case raylib binds each attribute buffer by itself.
+ */
+static void uploadInterleavedMesh(Mesh &mesh, const binmesh::MeshView &view) {
+  mesh.vertexCount = static_cast<int>(view.record->vertexCount);
+  mesh.triangleCount = static_cast<int>(view.record->indexCount / 3);
+
+  // DrawMesh() decides whether to draw indexed based on the CPU-side indices, they must be kept
+  mesh.indices = static_cast<unsigned short *>(RL_MALLOC(view.record->indexCount * sizeof(unsigned short)));
+  std::memcpy(mesh.indices, view.indices, view.record->indexCount * sizeof(unsigned short));
+
+  mesh.vaoId = rlgl::rlLoadVertexArray();
+  if (mesh.vaoId == 0) {
+    mesh.vertices = static_cast<float *>(RL_MALLOC(mesh.vertexCount * 3 * sizeof(float)));
+    mesh.normals = static_cast<float *>(RL_MALLOC(mesh.vertexCount * 3 * sizeof(float)));
+    mesh.texcoords = static_cast<float *>(RL_MALLOC(mesh.vertexCount * 2 * sizeof(float)));
+    for (int i = 0; i < mesh.vertexCount; i++) {
+      std::memcpy(&mesh.vertices[i * 3], view.vertices[i].position, 3 * sizeof(float));
+      std::memcpy(&mesh.normals[i * 3], view.vertices[i].normal, 3 * sizeof(float));
+      std::memcpy(&mesh.texcoords[i * 2], view.vertices[i].texcoord, 2 * sizeof(float));
+    }
+    UploadMesh(&mesh, false);
+    return;
+  }
+
+  // rlgl default attribute locations
+  constexpr int positionLocation = 0, texcoordLocation = 1, normalLocation = 2, colorLocation = 3;
+  constexpr int stride = sizeof(binmesh::Vertex);
+  mesh.vboId = static_cast<unsigned int *>(RL_CALLOC(MAX_MESH_VERTEX_BUFFERS, sizeof(unsigned int)));
+
+  rlgl::rlEnableVertexArray(mesh.vaoId);
+
+  mesh.vboId[0] = rlgl::rlLoadVertexBuffer(view.vertices, mesh.vertexCount * stride, false);
+  auto attribute = [](int location, int components, size_t offset) {
+    rlgl::rlSetVertexAttribute(location, components, RL_FLOAT, false, stride, reinterpret_cast<const void *>(offset));
+    rlgl::rlEnableVertexAttribute(location);
+  };
+  attribute(positionLocation, 3, offsetof(binmesh::Vertex, position));
+  attribute(normalLocation, 3, offsetof(binmesh::Vertex, normal));
+  attribute(texcoordLocation, 2, offsetof(binmesh::Vertex, texcoord));
+
+  // Same as UploadMesh() when there are no vertex colors
+  float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+  rlgl::rlSetVertexAttributeDefault(colorLocation, white, SHADER_ATTRIB_VEC4, 4);
+  rlgl::rlDisableVertexAttribute(colorLocation);
+
+  mesh.vboId[6] =
+    rlgl::rlLoadVertexBufferElement(view.indices, static_cast<int>(view.record->indexCount * sizeof(uint16_t)), false);
+
+  rlgl::rlDisableVertexArray();
+}
+
+static std::vector<obj::MaterialData> materialData(const binmesh::MeshFile &baked) {
+  std::vector<obj::MaterialData> materials;
+  for (const binmesh::MaterialView &view : baked.materials) {
+    obj::MaterialData &material = materials.emplace_back();
+    std::copy_n(view.record->diffuse, 3, material.diffuse);
+    material.diffuseMap = view.diffuseMap;
+  }
+  return materials;
+}
+
+std::shared_ptr<raylib::Model> AssetRegistry::uploadModel(const binmesh::MeshFile &baked,
+                                                          const DecodedImages &images) {
+  ::Model model{};
+
+  for (const binmesh::MeshView &view : baked.meshes) {
+    if (view.record->indexCount > 0)
+      model.meshCount++;
+  }
+
+  model.meshes = static_cast<Mesh *>(RL_CALLOC(model.meshCount, sizeof(Mesh)));
+  model.meshMaterial = static_cast<int *>(RL_CALLOC(model.meshCount, sizeof(int)));
+
+  int meshIndex = 0;
+  for (size_t i = 0; i < baked.meshes.size(); i++) {
+    if (baked.meshes[i].record->indexCount == 0)
+      continue;
+
+    uploadInterleavedMesh(model.meshes[meshIndex], baked.meshes[i]);
+    model.meshMaterial[meshIndex] = baked.materials.empty() ? 0 : static_cast<int>(i);
+    meshIndex++;
+  }
+
+  return assembleModel(model, materialData(baked), images);
+}
+
+AssetRegistry::DecodedImages AssetRegistry::decodeMaterialImages(const std::vector<obj::MaterialData> &materials) {
+  DecodedImages images;
+  for (const obj::MaterialData &material : materials) {
+    if (!material.diffuseMap.empty() && images.find(material.diffuseMap) == images.end())
+      images.emplace(material.diffuseMap, raylib::Image(material.diffuseMap));
+  }
+  return images;
+}
+
+AssetRegistry::DecodedImages AssetRegistry::decodeMaterialImages(const binmesh::MeshFile &baked) {
+  return decodeMaterialImages(materialData(baked));
+}
+
+std::shared_ptr<raylib::Model> AssetRegistry::assembleModel(::Model &model,
+                                                            const std::vector<obj::MaterialData> &materials,
+                                                            const DecodedImages &images) {
+  model.transform = MatrixIdentity();
+
+  std::vector<std::shared_ptr<raylib::Texture2D>> textures;
+  model.materialCount = std::max(1, static_cast<int>(materials.size()));
+  model.materials = static_cast<Material *>(RL_CALLOC(model.materialCount, sizeof(Material)));
+
+  for (int i = 0; i < model.materialCount; i++) {
+    model.materials[i] = LoadMaterialDefault();
+    if (materials.empty())
+      continue;
+
+    const obj::MaterialData &materialData = materials[i];
+    MaterialMap &diffuse = model.materials[i].maps[MATERIAL_MAP_DIFFUSE];
+    diffuse.color = { static_cast<unsigned char>(materialData.diffuse[0] * 255.0f),
+                      static_cast<unsigned char>(materialData.diffuse[1] * 255.0f),
+                      static_cast<unsigned char>(materialData.diffuse[2] * 255.0f),
+                      255 };
+
+    if (!materialData.diffuseMap.empty()) {
+      auto decoded = images.find(materialData.diffuseMap);
+      textures.push_back(decoded != images.end() ? texture(decoded->first, false, decoded->second)
+                                                 : texture(materialData.diffuseMap));
+      diffuse.texture = *textures.back();
+    }
+  }
+
+  auto holder = std::make_shared<ModelHolder>(model, std::move(textures));
+  return { holder, &holder->model };
+}
+
+void AssetRegistry::recordLoad(AssetKind kind, const std::string &key, size_t bytes) {
+  kindStats[kind].loads++;
+  kindStats[kind].bytes += bytes;
+  loadsPerPath[key]++;
+}
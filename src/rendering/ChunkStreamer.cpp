@@ -0,0 +1,299 @@
+#include "rendering/ChunkStreamer.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Local includes
+#include "common_defs.h"
+
+static bool overlaps(const ChunkStreamer::ChunkSpec &spec, float begin, float end) {
+  return spec.zEnd >= begin && spec.zBegin <= end;
+}
+
+template<typename T>
+static T *copyToRlBuffer(const std::vector<T> &data) {
+  auto *result = static_cast<T *>(RL_MALLOC(data.size() * sizeof(T)));
+  std::memcpy(result, data.data(), data.size() * sizeof(T));
+  return result;
+}
+
+void ChunkStreamer::reset(std::vector<ChunkSpec> newSpecs) {
+  // Builds still running just finish on their own, they only hold on to their own spec
+  building.clear();
+  loaded.clear();
+
+  specs.clear();
+  specs.reserve(newSpecs.size());
+  for (ChunkSpec &spec : newSpecs)
+    specs.push_back(std::make_shared<const ChunkSpec>(std::move(spec)));
+}
+
+void ChunkStreamer::setVertexFormat(vertex_format::Format newFormat,
+                                    vertex_format::ShaderLocations litLocations,
+                                    vertex_format::ShaderLocations texturedLocations) {
+  locations = { litLocations, texturedLocations };
+  if (newFormat == format)
+    return;
+
+  format = newFormat;
+  building.clear();
+  loaded.clear();
+}
+
+void ChunkStreamer::setPalette(const Palette &newPalette) {
+  if (std::memcmp(newPalette.data(), palette.data(), sizeof(Palette)) == 0)
+    return;
+  palette = newPalette;
+
+  for (auto &[index, chunk] : loaded) {
+    for (LoadedMesh &loadedMesh : chunk.meshes) {
+      colorize(loadedMesh.layer, loadedMesh.roles, recolored);
+      // Buffer 3 is the vertex colors one
+      UpdateMeshBuffer(loadedMesh.mesh, 3, recolored.data(), static_cast<int>(recolored.size()), 0);
+    }
+  }
+}
+
+void ChunkStreamer::update(float cameraZ) {
+  visibleBegin = cameraZ - MAX_RENDER_DISTANCE;
+  visibleEnd = cameraZ + MAX_RENDER_DISTANCE;
+
+  // The camera can move both ways, keep a margin on both sides so that chunks aren't rebuilt while going back and forth
+  float keepBegin = visibleBegin - PrefetchDistance;
+  float keepEnd = visibleEnd + PrefetchDistance;
+
+  std::erase_if(loaded, [&](const auto &entry) { return !overlaps(*specs[entry.first], keepBegin, keepEnd); });
+  std::erase_if(building, [&](const auto &entry) { return !overlaps(*specs[entry.first], keepBegin, keepEnd); });
+
+  // Without threads, builds only make progress here
+  if (pool.size() == 0)
+    pool.runPending(1);
+
+  size_t uploads = 0;
+  for (auto it = building.begin(); it != building.end() && uploads < MaxUploadsPerFrame;) {
+    if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++it;
+      continue;
+    }
+
+    Built built = it->second.get();
+    loaded.emplace(it->first, upload(built));
+    uploads++;
+    it = building.erase(it);
+  }
+
+  // Build what's visible or coming up, closest first
+  missing.clear();
+  for (size_t i = 0; i < specs.size(); i++) {
+    if (overlaps(*specs[i], visibleBegin, keepEnd) && !loaded.contains(i) && !building.contains(i))
+      missing.push_back(i);
+  }
+
+  auto distance = [&](size_t i) { return std::abs((specs[i]->zBegin + specs[i]->zEnd) / 2.0f - cameraZ); };
+  std::sort(missing.begin(), missing.end(), [&](size_t a, size_t b) { return distance(a) < distance(b); });
+
+  for (size_t i : missing) {
+    building.emplace(i, pool.submit([geometry = geometry, spec = specs[i], format = format]() {
+      return build(geometry, *spec, format);
+    }));
+  }
+}
+
+void ChunkStreamer::enqueue(RenderQueue &queue, const Material &lit, const Material &textured) {
+  drawCalls = 0;
+
+  for (const auto &[index, chunk] : loaded) {
+    const ChunkSpec &spec = *specs[index];
+    if (!overlaps(spec, visibleBegin, visibleEnd))
+      continue;
+
+    // Chunk meshes are baked in world space, they are sorted by the middle of the chunk
+    Vector3 center = { 0, 0, (spec.zBegin + spec.zEnd) / 2.0f };
+
+    for (const LoadedMesh &loadedMesh : chunk.meshes) {
+      bool transparent = loadedMesh.layer == LayerLitTransparent || loadedMesh.layer == LayerTexturedTransparent;
+      bool isLit = loadedMesh.layer == LayerLitOpaque || loadedMesh.layer == LayerLitTransparent;
+
+      std::array<RenderQueue::Uniform, 3> uniforms = locations[isLit ? 0 : 1].uniforms(loadedMesh.dequantization);
+      std::span<const RenderQueue::Uniform> drawUniforms;
+      if (loadedMesh.format == vertex_format::FormatQuantized)
+        drawUniforms = uniforms;
+
+      queue.submit(transparent ? RenderQueue::PassTransparent : RenderQueue::PassOpaque,
+                   loadedMesh.mesh,
+                   isLit ? lit : textured,
+                   MatrixIdentity(),
+                   center,
+                   WHITE,
+                   drawUniforms);
+      drawCalls++;
+    }
+  }
+}
+
+ChunkStreamer::Stats ChunkStreamer::stats() const {
+  Stats result;
+  result.chunks = specs.size();
+  result.loaded = loaded.size();
+  result.building = building.size();
+  result.drawCalls = drawCalls;
+  for (const auto &[index, chunk] : loaded) {
+    result.meshes += chunk.meshes.size();
+    result.bytes += chunk.bytes;
+    for (const LoadedMesh &loadedMesh : chunk.meshes)
+      result.vertices += static_cast<size_t>(loadedMesh.mesh.vertexCount);
+  }
+  return result;
+}
+
+MemoryReport::Usage ChunkStreamer::memoryUsage() const {
+  MemoryReport::Usage usage;
+  usage.cpuBytes = MemoryReport::vectorBytes(specs) + MemoryReport::vectorBytes(missing) +
+                   MemoryReport::vectorBytes(recolored);
+  for (const std::shared_ptr<const ChunkSpec> &spec : specs)
+    usage.cpuBytes += sizeof(ChunkSpec) + MemoryReport::vectorBytes(spec->placements);
+
+  for (const auto &[index, chunk] : loaded) {
+    usage.cpuBytes += MemoryReport::MapNodeBytes + sizeof(std::pair<const size_t, LoadedChunk>) +
+                      MemoryReport::vectorBytes(chunk.meshes);
+    usage.gpuBytes += chunk.bytes;
+    for (const LoadedMesh &loadedMesh : chunk.meshes) {
+      // Only the indices are kept in the mesh, see upload()
+      usage.cpuBytes += MemoryReport::vectorBytes(loadedMesh.roles) +
+                        static_cast<size_t>(loadedMesh.mesh.triangleCount) * 3 * sizeof(uint16_t);
+      usage.objects++;
+    }
+  }
+  return usage;
+}
+
+ChunkStreamer::Built
+ChunkStreamer::build(const Geometry &geometry, const ChunkSpec &spec, vertex_format::Format format) {
+  Built result;
+
+  // Mesh currently being filled for each layer. A new one is started when the 16-bit indices would overflow.
+  std::array<size_t, LayerCount> current{};
+  current.fill(SIZE_MAX);
+
+  for (const placement::Placement &placed : spec.placements) {
+    const obj::ObjData *model = geometry[placed.model].get();
+    if (model == nullptr)
+      continue;
+
+    for (size_t i = 0; i < model->meshes.size(); i++) {
+      const obj::MeshData &source = model->meshes[i];
+      if (source.indices.empty())
+        continue;
+
+      // The first material is the one drawn with the lighting shader
+      Layer layer;
+      if (placed.transparent)
+        layer = i == 0 ? LayerLitTransparent : LayerTexturedTransparent;
+      else
+        layer = i == 0 ? LayerLitOpaque : LayerTexturedOpaque;
+
+      size_t &slot = current[layer];
+      if (slot == SIZE_MAX || result[slot].roles.size() + source.vertexCount() > UINT16_MAX) {
+        slot = result.size();
+        result.push_back({ layer });
+      }
+
+      BuiltMesh &mesh = result[slot];
+      auto base = static_cast<uint16_t>(mesh.roles.size());
+
+      for (size_t v = 0; v < source.vertexCount(); v++) {
+        Vector3 position = Vector3Transform(
+          { source.vertices[v * 3], source.vertices[v * 3 + 1], source.vertices[v * 3 + 2] }, placed.transform);
+        Vector3 normal = Vector3Normalize(Vector3Transform(
+          { source.normals[v * 3], source.normals[v * 3 + 1], source.normals[v * 3 + 2] }, placed.normal));
+
+        mesh.vertices.insert(mesh.vertices.end(), { position.x, position.y, position.z });
+        mesh.normals.insert(mesh.normals.end(), { normal.x, normal.y, normal.z });
+        mesh.texcoords.insert(mesh.texcoords.end(), &source.texcoords[v * 2], &source.texcoords[v * 2] + 2);
+        mesh.roles.push_back(static_cast<uint8_t>(placed.role));
+      }
+
+      for (uint16_t index : source.indices)
+        mesh.indices.push_back(base + index);
+    }
+  }
+
+  std::stable_sort(result.begin(), result.end(), [](const BuiltMesh &a, const BuiltMesh &b) {
+    return a.layer < b.layer;
+  });
+
+  if (format == vertex_format::FormatQuantized) {
+    for (BuiltMesh &mesh : result) {
+      mesh.quantized =
+        vertex_format::quantize(mesh.roles.size(), mesh.vertices.data(), mesh.normals.data(), mesh.texcoords.data());
+      mesh.vertices = {};
+      mesh.normals = {};
+      mesh.texcoords = {};
+    }
+  }
+  return result;
+}
+
+ChunkStreamer::LoadedChunk ChunkStreamer::upload(Built &built) const {
+  LoadedChunk chunk;
+  std::vector<unsigned char> colors;
+
+  for (BuiltMesh &source : built) {
+    auto vertexCount = static_cast<int>(source.roles.size());
+    auto triangleCount = static_cast<int>(source.indices.size() / 3);
+    colorize(source.layer, source.roles, colors);
+
+    vertex_format::Format meshFormat = source.quantized.positions.empty() ? vertex_format::FormatFloat
+                                                                          : vertex_format::FormatQuantized;
+    chunk.bytes += static_cast<size_t>(vertexCount) * (vertex_format::bytesPerVertex(meshFormat) + 4) +
+                   source.indices.size() * sizeof(uint16_t);
+
+    if (meshFormat == vertex_format::FormatQuantized) {
+      chunk.meshes.push_back({ source.layer,
+                               vertex_format::upload(source.quantized, source.indices, colors),
+                               std::move(source.roles),
+                               meshFormat,
+                               source.quantized.dequantization });
+      continue;
+    }
+
+    raylib::Mesh mesh(vertexCount, triangleCount);
+    mesh.vertices = copyToRlBuffer(source.vertices);
+    mesh.normals = copyToRlBuffer(source.normals);
+    mesh.texcoords = copyToRlBuffer(source.texcoords);
+    mesh.indices = copyToRlBuffer(source.indices);
+    mesh.colors = copyToRlBuffer(colors);
+
+    mesh.Upload();
+
+    // Only the indices are still needed, DrawMesh() checks them to tell indexed meshes apart
+    RL_FREE(mesh.vertices);
+    RL_FREE(mesh.normals);
+    RL_FREE(mesh.texcoords);
+    RL_FREE(mesh.colors);
+    mesh.vertices = nullptr;
+    mesh.normals = nullptr;
+    mesh.texcoords = nullptr;
+    mesh.colors = nullptr;
+
+    chunk.meshes.push_back({ source.layer, std::move(mesh), std::move(source.roles), meshFormat, {} });
+  }
+
+  return chunk;
+}
+
+void ChunkStreamer::colorize(Layer layer, const std::vector<uint8_t> &roles, std::vector<unsigned char> &colors) const {
+  bool transparent = layer == LayerLitTransparent || layer == LayerTexturedTransparent;
+
+  colors.resize(roles.size() * 4);
+  for (size_t i = 0; i < roles.size(); i++) {
+    const Color &color = palette[roles[i]];
+    colors[i * 4] = color.r;
+    colors[i * 4 + 1] = color.g;
+    colors[i * 4 + 2] = color.b;
+    colors[i * 4 + 3] = transparent ? 0x7f : color.a;
+  }
+}
@@ -0,0 +1,159 @@
+#include "rendering/GpuRibbons.h"
+
+// STL includes
+#include <algorithm>
+#include <stdexcept>
+
+// Local includes
+#include "rendering/ribbon_helpers.h"
+
+GpuRibbons::GpuRibbons(const std::vector<raylib::Vector3> &sliceShape,
+                       std::shared_ptr<raylib::Shader> ribbonShader,
+                       std::shared_ptr<Material> ribbonMaterial) :
+  shader(std::move(ribbonShader)),
+  baseMaterial(std::move(ribbonMaterial)),
+  material(*baseMaterial),
+  grids{ createGrid(ribbons::rotateShapeAroundZAxis(sliceShape, PI / 6.0)),
+         createGrid(ribbons::rotateShapeAroundZAxis(sliceShape, -PI / 6.0)) } {
+  auto quads = static_cast<int>(sliceShape.size() - 1);
+  trianglesPerSegment = static_cast<int>(SlicesPerSegment) * quads * 2;
+  capTriangles = 2 * quads;
+
+  material.shader = *shader;
+  splineXLoc = shader->GetLocation("splineX");
+  splineYLoc = shader->GetLocation("splineY");
+  splineZLoc = shader->GetLocation("splineZ");
+  paramsLoc = shader->GetLocation("ribbonParams");
+}
+
+raylib::Mesh GpuRibbons::createGrid(const std::vector<raylib::Vector3> &sliceShape) {
+  size_t stride = sliceShape.size();
+  size_t slices = MaxSegments * SlicesPerSegment + 1;
+  size_t vertexCount = slices * stride + 2;
+  size_t triangleCount = 2 * (stride - 1) + (slices - 1) * 2 * (stride - 1);
+  if (vertexCount > UINT16_MAX)
+    throw std::length_error("Ribbon grid has too many vertices for 16-bit indices");
+
+  raylib::Mesh mesh(static_cast<int>(vertexCount), static_cast<int>(triangleCount));
+  mesh.vertices = (float *) RL_MALLOC(vertexCount * 3 * sizeof(float));
+  mesh.texcoords = (float *) RL_MALLOC(vertexCount * 2 * sizeof(float));
+  mesh.indices = (unsigned short *) RL_MALLOC(triangleCount * 3 * sizeof(unsigned short));
+
+  float *points = mesh.vertices;
+  float *tcoords = mesh.texcoords;
+  for (size_t slice = 0; slice < slices; slice++) {
+    for (size_t vertex = 0; vertex < stride; vertex++) {
+      *points++ = sliceShape[vertex].x;
+      *points++ = sliceShape[vertex].y;
+      *points++ = sliceShape[vertex].z;
+
+      *tcoords++ = static_cast<float>(slice) / static_cast<float>(SlicesPerSegment);
+      *tcoords++ = static_cast<float>(vertex) / static_cast<float>(stride - 1);
+    }
+  }
+
+  // Cap centers, the shader clamps the end one to the last slice of each ribbon
+  auto startPoint = static_cast<unsigned short>(slices * stride);
+  auto endPoint = static_cast<unsigned short>(startPoint + 1);
+  for (float s : { 0.0f, static_cast<float>(MaxSegments) }) {
+    *points++ = 0;
+    *points++ = 0;
+    *points++ = 0;
+    *tcoords++ = s;
+    *tcoords++ = 0.5f;
+  }
+
+  // Same winding as ribbons::generateRibbonGeometry()
+  unsigned short *triangle = mesh.indices;
+  size_t lastSlice = (slices - 1) * stride;
+  for (size_t vertex = 0; vertex < stride - 1; vertex++) {
+    *triangle++ = vertex;
+    *triangle++ = startPoint;
+    *triangle++ = vertex + 1;
+  }
+  for (size_t vertex = 0; vertex < stride - 1; vertex++) {
+    *triangle++ = lastSlice + vertex + 1;
+    *triangle++ = endPoint;
+    *triangle++ = lastSlice + vertex;
+  }
+
+  for (size_t slice = 0; slice < lastSlice; slice += stride) {
+    for (size_t vertex = 0; vertex < stride - 1; vertex++) {
+      *triangle++ = slice + vertex;
+      *triangle++ = slice + vertex + 1;
+      *triangle++ = slice + vertex + stride + 1;
+
+      *triangle++ = slice + vertex;
+      *triangle++ = slice + vertex + stride + 1;
+      *triangle++ = slice + vertex + stride;
+    }
+  }
+
+  mesh.Upload();
+  return mesh;
+}
+
+bool GpuRibbons::add(uint64_t key, std::span<const splines::Spline3D> splines, bool rhs, float textureScale) {
+  if (splines.empty() || splines.size() > MaxSegments)
+    return false;
+  if (contains(key))
+    return true;
+
+  Ribbon &ribbon = ribbons[key];
+  for (const splines::Spline3D &spline : splines) {
+    for (auto [array, coords] : { std::make_pair(&ribbon.x, &spline.Xb()),
+                                  std::make_pair(&ribbon.y, &spline.Yb()),
+                                  std::make_pair(&ribbon.z, &spline.Zb()) })
+      array->insert(array->end(), { coords->x, coords->y, coords->z, coords->w });
+  }
+  ribbon.params = { static_cast<float>(splines.size()), textureScale, 0, 0 };
+  ribbon.rhs = rhs;
+
+  auto segments = static_cast<int>(splines.size());
+  ribbon.uniforms = { RenderQueue::Uniform{ splineXLoc, SHADER_UNIFORM_VEC4, segments, ribbon.x.data() },
+                      RenderQueue::Uniform{ splineYLoc, SHADER_UNIFORM_VEC4, segments, ribbon.y.data() },
+                      RenderQueue::Uniform{ splineZLoc, SHADER_UNIFORM_VEC4, segments, ribbon.z.data() },
+                      RenderQueue::Uniform{ paramsLoc, SHADER_UNIFORM_VEC4, 1, ribbon.params.data() } };
+  return true;
+}
+
+void GpuRibbons::submit(RenderQueue &queue, uint64_t key, const Matrix &transform, Vector3 center, Color tint) const {
+  const Ribbon &ribbon = ribbons.at(key);
+  int triangles = capTriangles + static_cast<int>(ribbon.params[0]) * trianglesPerSegment;
+  queue.submit(RenderQueue::PassTransparent,
+               grids[ribbon.rhs ? 1 : 0],
+               material,
+               transform,
+               center,
+               tint,
+               ribbon.uniforms,
+               { 0, triangles * 3 });
+}
+
+MemoryReport::Usage GpuRibbons::memoryUsage() const {
+  MemoryReport::Usage usage;
+  for (const raylib::Mesh &grid : grids) {
+    size_t gridBytes = static_cast<size_t>(grid.vertexCount) * (3 + 2) * sizeof(float) +
+                       static_cast<size_t>(grid.triangleCount) * 3 * sizeof(unsigned short);
+    // The grids keep their CPU arrays
+    usage.cpuBytes += gridBytes;
+    usage.gpuBytes += gridBytes;
+  }
+  for (const auto &[key, ribbon] : ribbons) {
+    usage.cpuBytes += sizeof(std::pair<const uint64_t, Ribbon>) + MemoryReport::HashNodeBytes +
+                      MemoryReport::vectorBytes(ribbon.x) + MemoryReport::vectorBytes(ribbon.y) +
+                      MemoryReport::vectorBytes(ribbon.z);
+    usage.objects++;
+  }
+  return usage;
+}
+
+size_t GpuRibbons::bytes() const {
+  size_t result = 0;
+  for (const raylib::Mesh &grid : grids)
+    result += static_cast<size_t>(grid.vertexCount) * (3 + 2) * sizeof(float) +
+              static_cast<size_t>(grid.triangleCount) * 3 * sizeof(unsigned short);
+  for (const auto &[key, ribbon] : ribbons)
+    result += (ribbon.x.size() + ribbon.y.size() + ribbon.z.size() + ribbon.params.size()) * sizeof(float);
+  return result;
+}
@@ -0,0 +1,268 @@
+#include "rendering/RenderQueue.h"
+
+// STL includes
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace rlgl {
+#include "rlgl.h"
+}
+
+// raylib config
+#include "config.h"
+
+static constexpr uint64_t DepthMask = (1ull << 24) - 1;
+
+template<typename K>
+uint64_t RenderQueue::IdTable<K>::idFor(const K &key, uint64_t frame, uint64_t max) {
+  auto [it, inserted] = entries.try_emplace(key, Entry{ frame, used });
+  if (inserted) {
+    used++;
+  } else if (it->second.frame != frame) {
+    it->second = { frame, used };
+    used++;
+  }
+  return std::min(it->second.id, max);
+}
+
+template<typename K>
+void RenderQueue::IdTable<K>::begin() {
+  // Meshes of unloaded chunks would otherwise pile up
+  constexpr size_t minStale = 1024;
+  if (entries.size() > std::max<size_t>(minStale, used * 4))
+    entries.clear();
+  used = 0;
+}
+
+void RenderQueue::begin(Vector3 newEye) {
+  eye = newEye;
+  commands.clear();
+  uniforms.clear();
+  keys.clear();
+  frame++;
+  shaderIds.begin();
+  textureIds.begin();
+  meshIds.begin();
+}
+
+void RenderQueue::submit(Pass pass,
+                         const Mesh &mesh,
+                         const Material &material,
+                         const Matrix &transform,
+                         Vector3 center,
+                         Color tint,
+                         std::span<const Uniform> drawUniforms,
+                         Range range) {
+  float depth = std::clamp(Vector3Distance(center, eye) / MaxDepth, 0.0f, 1.0f);
+  auto quantizedDepth = static_cast<uint64_t>(depth * static_cast<float>(DepthMask));
+
+  uint64_t shader = shaderIds.idFor(material.shader.id, frame, 0x3f);
+  uint64_t texture = textureIds.idFor(material.maps[MATERIAL_MAP_DIFFUSE].texture.id, frame, 0x3ff);
+  uint64_t meshId = meshIds.idFor(&mesh, frame, 0xffff);
+  uint64_t state = (shader << 26) | (texture << 16) | meshId;
+
+  uint64_t key = static_cast<uint64_t>(pass) << 62;
+  if (pass == PassOpaque)
+    key |= (state << 24) | quantizedDepth;
+  else
+    key |= ((DepthMask - quantizedDepth) << 32) | state;
+
+  commands.push_back({ &mesh,
+                       &material,
+                       transform,
+                       tint,
+                       static_cast<uint32_t>(uniforms.size()),
+                       static_cast<uint32_t>(drawUniforms.size()),
+                       range });
+  uniforms.insert(uniforms.end(), drawUniforms.begin(), drawUniforms.end());
+  keys.push_back(key);
+}
+
+/**
+ * LSD radix sort of the keys, one byte per pass, carrying the command indices along. Bytes that are the same for all
+ * keys (i.e. the unused high bits) are skipped.
+ */
+void RenderQueue::sort() {
+  size_t count = keys.size();
+  order.resize(count);
+  std::iota(order.begin(), order.end(), 0);
+  scratchKeys.resize(count);
+  scratchOrder.resize(count);
+
+  std::array<std::array<uint32_t, 256>, 8> histograms{};
+  for (uint64_t key : keys) {
+    for (int byte = 0; byte < 8; byte++)
+      histograms[byte][(key >> (byte * 8)) & 0xff]++;
+  }
+
+  for (int byte = 0; byte < 8; byte++) {
+    std::array<uint32_t, 256> &histogram = histograms[byte];
+    int shift = byte * 8;
+    if (histogram[(keys[0] >> shift) & 0xff] == count)
+      continue;
+
+    uint32_t offset = 0;
+    for (uint32_t &bucket : histogram) {
+      uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      uint32_t destination = histogram[(keys[i] >> shift) & 0xff]++;
+      scratchKeys[destination] = keys[i];
+      scratchOrder[destination] = order[i];
+    }
+
+    keys.swap(scratchKeys);
+    order.swap(scratchOrder);
+  }
+}
+
+void RenderQueue::setUniforms(const Command &command) const {
+  for (uint32_t i = command.firstUniform; i < command.firstUniform + command.uniformCount; i++) {
+    const Uniform &uniform = uniforms[i];
+    if (uniform.location != -1)
+      rlgl::rlSetUniform(uniform.location, uniform.value, uniform.type, uniform.count);
+  }
+}
+
+void RenderQueue::execute() {
+  Stats stats;
+  stats.commands = commands.size();
+  if (commands.empty()) {
+    lastStats = stats;
+    return;
+  }
+
+  sort();
+
+  // Whatever was drawn in immediate mode so far (floor, text...) must come first
+  rlgl::rlDrawRenderBatchActive();
+
+  Matrix view = rlgl::rlGetMatrixModelview();
+  Matrix projection = rlgl::rlGetMatrixProjection();
+  Matrix parent = rlgl::rlGetMatrixTransform();
+
+  unsigned int currentShader = 0;
+  unsigned int currentTexture = 0;
+  unsigned int currentVertexArray = 0;
+  std::array<float, 4> currentColor{};
+  bool colorSet = false;
+  bool depthMask = true;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    const Command &command = commands[order[i]];
+    const Mesh &mesh = *command.mesh;
+    const Material &material = *command.material;
+
+    // Transparent geometry is tested against the depth buffer but doesn't write to it
+    bool transparent = (keys[i] >> 62) == PassTransparent;
+    if (transparent == depthMask) {
+      if (transparent)
+        rlgl::rlDisableDepthMask();
+      else
+        rlgl::rlEnableDepthMask();
+      depthMask = !transparent;
+      stats.stateChanges++;
+    }
+
+    const Color &base = material.maps[MATERIAL_MAP_DIFFUSE].color;
+    const Color &tint = command.tint;
+
+    // Without vertex array objects, leave the per-attribute binding to raylib
+    if (mesh.vaoId == 0) {
+      std::array<MaterialMap, MAX_MATERIAL_MAPS> maps{};
+      std::copy_n(material.maps, MAX_MATERIAL_MAPS, maps.begin());
+      maps[MATERIAL_MAP_DIFFUSE].color = { static_cast<unsigned char>(base.r * tint.r / 255),
+                                           static_cast<unsigned char>(base.g * tint.g / 255),
+                                           static_cast<unsigned char>(base.b * tint.b / 255),
+                                           static_cast<unsigned char>(base.a * tint.a / 255) };
+      Material tinted = material;
+      tinted.maps = maps.data();
+
+      // DrawMesh() binds the same shader, so the uniforms stick. It always draws the whole mesh.
+      rlgl::rlEnableShader(material.shader.id);
+      setUniforms(command);
+      DrawMesh(mesh, tinted, command.transform);
+      currentShader = 0;
+      currentTexture = 0;
+      currentVertexArray = 0;
+      stats.drawCalls++;
+      stats.shaderBinds++;
+      stats.textureBinds++;
+      continue;
+    }
+
+    const int *locs = material.shader.locs;
+
+    if (material.shader.id != currentShader) {
+      rlgl::rlEnableShader(material.shader.id);
+      currentShader = material.shader.id;
+      colorSet = false;
+      stats.shaderBinds++;
+
+      if (locs[SHADER_LOC_MATRIX_VIEW] != -1)
+        rlgl::rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_VIEW], view);
+      if (locs[SHADER_LOC_MATRIX_PROJECTION] != -1)
+        rlgl::rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_PROJECTION], projection);
+
+      // Only the diffuse map is used by the materials in the queue, it is always on slot 0
+      int slot = 0;
+      if (locs[SHADER_LOC_MAP_DIFFUSE] != -1)
+        rlgl::rlSetUniform(locs[SHADER_LOC_MAP_DIFFUSE], &slot, SHADER_UNIFORM_INT, 1);
+    }
+
+    unsigned int texture = material.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+    if (texture != currentTexture) {
+      rlgl::rlActiveTextureSlot(0);
+      rlgl::rlEnableTexture(texture);
+      currentTexture = texture;
+      stats.textureBinds++;
+    }
+
+    std::array<float, 4> color = { static_cast<float>(base.r) / 255.0f * static_cast<float>(tint.r) / 255.0f,
+                                   static_cast<float>(base.g) / 255.0f * static_cast<float>(tint.g) / 255.0f,
+                                   static_cast<float>(base.b) / 255.0f * static_cast<float>(tint.b) / 255.0f,
+                                   static_cast<float>(base.a) / 255.0f * static_cast<float>(tint.a) / 255.0f };
+    if (locs[SHADER_LOC_COLOR_DIFFUSE] != -1 && (!colorSet || color != currentColor)) {
+      rlgl::rlSetUniform(locs[SHADER_LOC_COLOR_DIFFUSE], color.data(), SHADER_UNIFORM_VEC4, 1);
+      currentColor = color;
+      colorSet = true;
+    }
+
+    Matrix model = MatrixMultiply(command.transform, parent);
+    if (locs[SHADER_LOC_MATRIX_MODEL] != -1)
+      rlgl::rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_MODEL], model);
+    if (locs[SHADER_LOC_MATRIX_NORMAL] != -1)
+      rlgl::rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_NORMAL], MatrixTranspose(MatrixInvert(model)));
+    rlgl::rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_MVP], MatrixMultiply(MatrixMultiply(model, view), projection));
+    setUniforms(command);
+
+    if (mesh.vaoId != currentVertexArray) {
+      rlgl::rlEnableVertexArray(mesh.vaoId);
+      currentVertexArray = mesh.vaoId;
+      stats.vertexArrayBinds++;
+    }
+
+    const Range &range = command.range;
+    if (mesh.indices != nullptr)
+      rlgl::rlDrawVertexArrayElements(range.first, range.count > 0 ? range.count : mesh.triangleCount * 3, nullptr);
+    else
+      rlgl::rlDrawVertexArray(range.first, range.count > 0 ? range.count : mesh.vertexCount);
+    stats.drawCalls++;
+  }
+
+  rlgl::rlDisableVertexArray();
+  rlgl::rlActiveTextureSlot(0);
+  rlgl::rlDisableTexture();
+  rlgl::rlDisableShader();
+  if (!depthMask)
+    rlgl::rlEnableDepthMask();
+
+  commands.clear();
+  uniforms.clear();
+  keys.clear();
+  lastStats = stats;
+}
@@ -0,0 +1,241 @@
+#include "rendering/RibbonCache.h"
+
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+// Libraries
+#include <fmt/format.h>
+
+// Local includes
+#include "utils/AtomicFile.h"
+#include "utils/CacheDirectory.h"
+#include "utils/Fnv1a.h"
+
+static constexpr char PackMagic[4] = { 'A', 'T', 'R', 'C' };
+static constexpr uint32_t PackVersion = 1;
+static constexpr const char *PackExtension = ".atrc";
+
+static size_t geometryBytes(uint32_t vertexCount) {
+  return static_cast<size_t>(vertexCount) * (3 + 3 + 2) * sizeof(float);
+}
+
+RibbonCache::RibbonCache(std::filesystem::path cacheDirectory, const std::string &songPath, std::ostream &log) :
+  directory(std::move(cacheDirectory)), log(log) {
+  std::error_code error;
+  std::filesystem::path absolute = std::filesystem::absolute(songPath, error);
+  std::string songId = fmt::format("{:016x}", Fnv1a().add(error ? songPath : absolute.string()).digest());
+  packPath = directory / (songId + PackExtension);
+
+  std::filesystem::create_directories(directory, error);
+  open();
+}
+
+RibbonCache::~RibbonCache() {
+  log << fmt::format("Ribbon cache: {} hits, {} misses", counters.hits, counters.misses);
+  if (!added.empty())
+    log << fmt::format(", writing {} new ribbons ({} KiB)", added.size(), addedBytes / 1024);
+  log << std::endl;
+
+  write();
+  cleanup();
+}
+
+uint64_t RibbonCache::key(const audiotrip::ChoreoEvent &event, std::span<const float> subTimes, int gemSpeed) {
+  Fnv1a hash;
+  hash.add(GeneratorVersion).add(event.isRHS()).add(event.beatDivision).add(gemSpeed);
+  for (const audiotrip::Position &p : event.subPositions)
+    hash.add(p.x()).add(p.y()).add(p.z());
+  for (float time : subTimes)
+    hash.add(time);
+  return hash.digest();
+}
+
+std::optional<ribbons::RibbonGeometry> RibbonCache::find(uint64_t key) {
+  if (const PackEntry *entry = findEntry(key); entry != nullptr) {
+    counters.hits++;
+    return read(pack->data() + entry->offset, entry->vertexCount);
+  }
+
+  counters.misses++;
+  return std::nullopt;
+}
+
+void RibbonCache::store(uint64_t key, const ribbons::RibbonGeometry &geometry) {
+  size_t bytes = geometryBytes(static_cast<uint32_t>(geometry.vertexCount())) + sizeof(PackEntry);
+  size_t packBytes = pack != nullptr ? pack->size() : 0;
+  if (packBytes + addedBytes + bytes > MaxPackBytes || findEntry(key) != nullptr)
+    return;
+
+  if (added.emplace(key, geometry).second)
+    addedBytes += bytes;
+}
+
+MemoryReport::Usage RibbonCache::memoryUsage() const {
+  MemoryReport::Usage usage;
+  usage.cpuBytes = addedBytes + added.size() * (MemoryReport::MapNodeBytes + sizeof(decltype(added)::value_type));
+  usage.objects = added.size();
+  if (pack != nullptr) {
+    usage.cpuBytes += pack->size();
+    usage.objects++;
+  }
+  return usage;
+}
+
+std::optional<std::filesystem::path> RibbonCache::defaultDirectory() {
+#if defined(PLATFORM_WEB)
+  // The web build only has an in-memory filesystem
+  return std::nullopt;
+#else
+  const char *base = std::getenv("XDG_CACHE_HOME");
+  std::filesystem::path result;
+
+  if (base != nullptr && *base != '\0') {
+    result = base;
+#ifdef _WIN32
+  } else if (const char *localAppData = std::getenv("LOCALAPPDATA"); localAppData != nullptr) {
+    result = localAppData;
+#endif
+  } else if (const char *home = std::getenv("HOME"); home != nullptr) {
+    result = std::filesystem::path(home) / ".cache";
+  } else {
+    return std::nullopt;
+  }
+
+  return result / "audiotrip_choreo_viewer" / "ribbons";
+#endif
+}
+
+void RibbonCache::open() {
+  std::error_code error;
+  if (!std::filesystem::exists(packPath, error)) {
+    log << "Ribbon cache: no pack for this song yet (" << packPath.string() << ")" << std::endl;
+    return;
+  }
+
+  try {
+    pack = std::make_unique<binmesh::MappedFile>(packPath.string());
+  } catch (const std::runtime_error &e) {
+    log << "Ribbon cache: " << e.what() << std::endl;
+    return;
+  }
+
+  PackHeader header{};
+  bool valid = pack->size() >= sizeof(PackHeader);
+  if (valid) {
+    std::memcpy(&header, pack->data(), sizeof(PackHeader));
+    valid = std::memcmp(header.magic, PackMagic, sizeof(PackMagic)) == 0 && header.version == PackVersion &&
+            header.generatorVersion == GeneratorVersion &&
+            pack->size() >= sizeof(PackHeader) + static_cast<size_t>(header.entryCount) * sizeof(PackEntry);
+  }
+
+  if (valid) {
+    entries = reinterpret_cast<const PackEntry *>(pack->data() + sizeof(PackHeader));
+    entryCount = header.entryCount;
+    valid = std::all_of(entries, entries + entryCount, [&](const PackEntry &entry) {
+      return entry.offset % alignof(float) == 0 && entry.offset <= pack->size() &&
+             geometryBytes(entry.vertexCount) <= pack->size() - entry.offset;
+    });
+  }
+
+  if (!valid) {
+    // Stale or corrupted, it gets replaced when the song is closed
+    log << "Ribbon cache: discarding outdated pack " << packPath.string() << std::endl;
+    pack.reset();
+    entries = nullptr;
+    entryCount = 0;
+    return;
+  }
+
+  counters.packEntries = entryCount;
+  log << fmt::format("Ribbon cache: {} cached ribbons in {}", entryCount, packPath.string()) << std::endl;
+}
+
+const RibbonCache::PackEntry *RibbonCache::findEntry(uint64_t key) const {
+  const PackEntry *end = entries + entryCount;
+  const PackEntry *it =
+    std::lower_bound(entries, end, key, [](const PackEntry &entry, uint64_t k) { return entry.key < k; });
+  return it != end && it->key == key ? it : nullptr;
+}
+
+ribbons::RibbonGeometry RibbonCache::read(const uint8_t *data, uint32_t vertexCount) {
+  const auto *floats = reinterpret_cast<const float *>(data);
+  size_t count = vertexCount;
+
+  ribbons::RibbonGeometry geometry;
+  geometry.vertices.assign(floats, floats + count * 3);
+  geometry.normals.assign(floats + count * 3, floats + count * 6);
+  geometry.texcoords.assign(floats + count * 6, floats + count * 8);
+  return geometry;
+}
+
+void RibbonCache::write() {
+  if (added.empty())
+    return;
+
+  // Merge the entries already in the pack with the new ones, keeping them sorted by key
+  struct Source {
+    uint64_t key;
+    const uint8_t *data;
+    uint32_t vertexCount;
+    const ribbons::RibbonGeometry *geometry;
+  };
+
+  std::vector<Source> sources;
+  sources.reserve(entryCount + added.size());
+  for (size_t i = 0; i < entryCount; i++)
+    sources.push_back({ entries[i].key, pack->data() + entries[i].offset, entries[i].vertexCount, nullptr });
+  for (const auto &[key, geometry] : added)
+    sources.push_back({ key, nullptr, static_cast<uint32_t>(geometry.vertexCount()), &geometry });
+  std::sort(sources.begin(), sources.end(), [](const Source &a, const Source &b) { return a.key < b.key; });
+
+  PackHeader header{};
+  std::memcpy(header.magic, PackMagic, sizeof(PackMagic));
+  header.version = PackVersion;
+  header.generatorVersion = GeneratorVersion;
+  header.entryCount = static_cast<uint32_t>(sources.size());
+
+  std::vector<PackEntry> table;
+  table.reserve(sources.size());
+  uint64_t offset = sizeof(PackHeader) + sources.size() * sizeof(PackEntry);
+  for (const Source &source : sources) {
+    table.push_back({ source.key, offset, source.vertexCount, 0 });
+    offset += geometryBytes(source.vertexCount);
+  }
+
+  AtomicFile file(packPath);
+  std::ofstream &os = file.stream();
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  os.write(reinterpret_cast<const char *>(table.data()),
+           static_cast<std::streamsize>(table.size() * sizeof(PackEntry)));
+
+  for (const Source &source : sources) {
+    if (source.geometry == nullptr) {
+      os.write(reinterpret_cast<const char *>(source.data),
+               static_cast<std::streamsize>(geometryBytes(source.vertexCount)));
+      continue;
+    }
+
+    for (const std::vector<float> *array :
+         { &source.geometry->vertices, &source.geometry->normals, &source.geometry->texcoords }) {
+      os.write(reinterpret_cast<const char *>(array->data()),
+               static_cast<std::streamsize>(array->size() * sizeof(float)));
+    }
+  }
+
+  // The old pack must not be mapped anymore on platforms that can't replace open files
+  pack.reset();
+  entries = nullptr;
+  entryCount = 0;
+
+  if (std::optional<std::string> failure = file.commit())
+    log << "Ribbon cache: " << *failure << std::endl;
+}
+
+void RibbonCache::cleanup() {
+  for (const std::filesystem::path &evicted : trimCacheDirectory(directory, PackExtension, MaxCacheBytes, packPath))
+    log << "Ribbon cache: evicted " << evicted.string() << std::endl;
+}
@@ -0,0 +1,177 @@
+#include "rendering/RibbonPool.h"
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+
+namespace rlgl {
+#include "rlgl.h"
+}
+
+std::optional<RibbonPool::Id> RibbonPool::add(int vertexCount, std::array<const void *, 3> data) {
+  if (vertexCount <= 0 || vertexCount > BlockVertices)
+    return std::nullopt;
+
+  std::optional<int> first;
+  uint32_t blockIndex = 0;
+  for (; blockIndex < blocks.size(); blockIndex++) {
+    if ((first = allocate(*blocks[blockIndex], vertexCount)))
+      break;
+  }
+
+  // Fragmented, but a block may have enough free space once its ranges are moved together
+  if (!first.has_value()) {
+    for (blockIndex = 0; blockIndex < blocks.size(); blockIndex++) {
+      if (BlockVertices - blocks[blockIndex]->used >= vertexCount) {
+        compact(blockIndex);
+        first = allocate(*blocks[blockIndex], vertexCount);
+        break;
+      }
+    }
+  }
+
+  if (!first.has_value()) {
+    auto block = std::make_unique<Block>(Block{ vertex_format::allocate(format, BlockVertices), {}, {}, 0 });
+    std::array<vertex_format::Attribute, 3> layout = vertex_format::attributes(format);
+    for (size_t i = 0; i < layout.size(); i++)
+      block->vertices[i].resize(static_cast<size_t>(BlockVertices) * layout[i].bytesPerVertex);
+    block->freeRanges.emplace(0, BlockVertices);
+
+    blockIndex = static_cast<uint32_t>(blocks.size());
+    blocks.push_back(std::move(block));
+    first = allocate(*blocks[blockIndex], vertexCount);
+  }
+
+  write(*blocks[blockIndex], *first, vertexCount, data);
+
+  Allocation allocation = { blockIndex, *first, vertexCount };
+  if (!freeIds.empty()) {
+    Id id = freeIds.back();
+    freeIds.pop_back();
+    allocations[id] = allocation;
+    return id;
+  }
+
+  allocations.push_back(allocation);
+  return static_cast<Id>(allocations.size() - 1);
+}
+
+void RibbonPool::remove(Id id) {
+  Allocation &allocation = allocations.at(id);
+  if (allocation.count == 0)
+    return;
+
+  release(*blocks[allocation.block], allocation.first, allocation.count);
+  allocation.count = 0;
+  freeIds.push_back(id);
+}
+
+RibbonPool::Draw RibbonPool::draw(Id id) const {
+  const Allocation &allocation = allocations.at(id);
+  return { &blocks[allocation.block]->mesh, { allocation.first, allocation.count } };
+}
+
+RibbonPool::Stats RibbonPool::stats() const {
+  Stats result;
+  result.blocks = blocks.size();
+  result.capacity = blocks.size() * BlockVertices;
+  result.bytes = result.capacity * vertex_format::bytesPerVertex(format);
+  result.compactions = compactions;
+
+  for (const std::unique_ptr<Block> &block : blocks) {
+    result.used += static_cast<size_t>(block->used);
+    result.freeRanges += block->freeRanges.size();
+    for (const auto &[first, count] : block->freeRanges)
+      result.largestFreeRange = std::max(result.largestFreeRange, static_cast<size_t>(count));
+  }
+
+  result.allocations = allocations.size() - freeIds.size();
+  return result;
+}
+
+std::optional<int> RibbonPool::allocate(Block &block, int count) {
+  auto best = block.freeRanges.end();
+  for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+    if (it->second >= count && (best == block.freeRanges.end() || it->second < best->second))
+      best = it;
+  }
+  if (best == block.freeRanges.end())
+    return std::nullopt;
+
+  auto [first, size] = *best;
+  block.freeRanges.erase(best);
+  if (size > count)
+    block.freeRanges.emplace(first + count, size - count);
+
+  block.used += count;
+  return first;
+}
+
+void RibbonPool::release(Block &block, int first, int count) {
+  block.used -= count;
+  auto it = block.freeRanges.emplace(first, count).first;
+
+  // Merge with the following range, then with the previous one
+  if (auto next = std::next(it); next != block.freeRanges.end() && it->first + it->second == next->first) {
+    it->second += next->second;
+    block.freeRanges.erase(next);
+  }
+  if (it != block.freeRanges.begin()) {
+    auto previous = std::prev(it);
+    if (previous->first + previous->second == it->first) {
+      previous->second += it->second;
+      block.freeRanges.erase(it);
+    }
+  }
+}
+
+void RibbonPool::compact(uint32_t blockIndex) {
+  Block &block = *blocks[blockIndex];
+
+  std::vector<Allocation *> moved;
+  for (Allocation &allocation : allocations) {
+    if (allocation.block == blockIndex && allocation.count > 0)
+      moved.push_back(&allocation);
+  }
+  std::sort(moved.begin(), moved.end(), [](const Allocation *a, const Allocation *b) { return a->first < b->first; });
+
+  // Ranges only move towards the start, so copying them in order never overwrites one that hasn't moved yet
+  std::array<vertex_format::Attribute, 3> layout = vertex_format::attributes(format);
+  int end = 0;
+  for (Allocation *allocation : moved) {
+    if (allocation->first != end) {
+      for (size_t i = 0; i < layout.size(); i++) {
+        size_t bytes = layout[i].bytesPerVertex;
+        std::memmove(block.vertices[i].data() + end * bytes,
+                     block.vertices[i].data() + allocation->first * bytes,
+                     allocation->count * bytes);
+      }
+      allocation->first = end;
+    }
+    end += allocation->count;
+  }
+
+  for (size_t i = 0; i < layout.size(); i++) {
+    rlgl::rlUpdateVertexBuffer(block.mesh.vboId[layout[i].buffer],
+                               block.vertices[i].data(),
+                               static_cast<int>(end * layout[i].bytesPerVertex),
+                               0);
+  }
+
+  block.freeRanges.clear();
+  if (end < BlockVertices)
+    block.freeRanges.emplace(end, BlockVertices - end);
+  compactions++;
+}
+
+void RibbonPool::write(Block &block, int first, int count, std::array<const void *, 3> data) const {
+  std::array<vertex_format::Attribute, 3> layout = vertex_format::attributes(format);
+  for (size_t i = 0; i < layout.size(); i++) {
+    size_t bytes = layout[i].bytesPerVertex;
+    std::memcpy(block.vertices[i].data() + first * bytes, data[i], count * bytes);
+    rlgl::rlUpdateVertexBuffer(block.mesh.vboId[layout[i].buffer],
+                               data[i],
+                               static_cast<int>(count * bytes),
+                               static_cast<int>(first * bytes));
+  }
+}
@@ -4,6 +4,9 @@
 
 #include "rendering/SkyBox.h"
 
+// Local includes
+#include "rendering/AssetRegistry.h"
+
 void SkyBox::Draw() {
   // We are inside the cube, we need to disable backface culling!
   rlgl::rlDisableBackfaceCulling();
@@ -15,7 +18,29 @@ void SkyBox::Draw() {
   rlgl::rlEnableDepthMask();
 }
 
-SkyBox::SkyBox(const std::string &imagePath) {
+MemoryReport::Usage SkyBox::MemoryUsage() const {
+  MemoryReport::Usage usage = AssetRegistry::meshUsage(skybox.meshes[0]);
+  if (texture != nullptr) {
+    usage.gpuBytes += 6 * AssetRegistry::textureBytes(*texture);
+    usage.objects++;
+  }
+  return usage;
+}
+
+SkyBox::SkyBox(const std::string &imagePath) :
+  shader(::LoadShader(TextFormat("resources/shaders/glsl%i/skybox.vs", GLSL_VERSION),
+                      TextFormat("resources/shaders/glsl%i/skybox.fs", GLSL_VERSION))) {
+  SetupShader();
+  LoadTexture(imagePath);
+}
+
+SkyBox::SkyBox(const std::string &vsCode, const std::string &fsCode, const raylib::Image &faces) :
+  shader(::LoadShaderFromMemory(vsCode.c_str(), fsCode.c_str())) {
+  SetupShader();
+  LoadTexture(faces);
+}
+
+void SkyBox::SetupShader() {
   skybox.materials[0].shader = shader;
 
   int environmentMapVal[] = { MATERIAL_MAP_CUBEMAP };
@@ -24,12 +49,56 @@ SkyBox::SkyBox(const std::string &imagePath) {
   shader.SetValue(shader.GetLocation("environmentMap"), environmentMapVal, SHADER_UNIFORM_INT);
   shader.SetValue(shader.GetLocation("doGamma"), doGammaVal, SHADER_UNIFORM_INT);
   shader.SetValue(shader.GetLocation("vflipped"), vflippedVal, SHADER_UNIFORM_INT);
+}
 
-  LoadTexture(imagePath);
+raylib::Image SkyBox::ExtractFaces(const raylib::Image &image) {
+  // Same layout detection and face placement as raylib's LoadTextureCubemap()
+  int size;
+  Rectangle faceRecs[6] = {};
+
+  if (image.height / 6 == image.width) {
+    // Already a vertical line
+    return image;
+  } else if (image.width / 6 == image.height) {
+    size = image.height;
+    for (int i = 0; i < 6; i++)
+      faceRecs[i].x = static_cast<float>(size * i);
+  } else if (image.width / 3 == image.height / 4 || image.width / 4 == image.height / 3) {
+    bool threeByFour = image.width / 3 == image.height / 4;
+    size = threeByFour ? image.width / 3 : image.width / 4;
+
+    auto s = static_cast<float>(size);
+    faceRecs[0] = { s * 2, s };
+    faceRecs[1] = { 0, s };
+    faceRecs[2] = { s, 0 };
+    faceRecs[3] = { s, s * 2 };
+    faceRecs[4] = { s, s };
+    faceRecs[5] = threeByFour ? Rectangle{ s, s * 3 } : Rectangle{ s * 3, s };
+  } else {
+    throw raylib::RaylibException("Unsupported cubemap layout");
+  }
+
+  raylib::Image faces(GenImageColor(size, size * 6, MAGENTA));
+  ImageFormat(&faces, image.format);
+
+  for (int i = 0; i < 6; i++) {
+    faceRecs[i].width = static_cast<float>(size);
+    faceRecs[i].height = static_cast<float>(size);
+    ImageDraw(&faces,
+              image,
+              faceRecs[i],
+              { 0, static_cast<float>(size * i), static_cast<float>(size), static_cast<float>(size) },
+              WHITE);
+  }
+
+  return faces;
 }
 
 void SkyBox::LoadTexture(const std::string &imagePath) {
-  raylib::Image image(imagePath);
-  texture = std::make_unique<raylib::TextureCubemap>(image, CUBEMAP_LAYOUT_AUTO_DETECT);
+  LoadTexture(ExtractFaces(raylib::Image(imagePath)));
+}
+
+void SkyBox::LoadTexture(const raylib::Image &faces) {
+  texture = std::make_unique<raylib::TextureCubemap>(faces, CUBEMAP_LAYOUT_LINE_VERTICAL);
   skybox.materials[0].maps[MATERIAL_MAP_CUBEMAP].texture = *texture;
 }
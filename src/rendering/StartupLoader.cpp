@@ -0,0 +1,79 @@
+#include "rendering/StartupLoader.h"
+
+// STL includes
+#include <algorithm>
+
+// Libraries
+#include <fmt/format.h>
+
+StartupLoader::~StartupLoader() {
+  for (Job &job : jobs) {
+    if (!job.future.valid())
+      continue;
+    // Without worker threads the tasks would never run by themselves
+    while (job.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      if (pool.runPending(1) == 0)
+        job.future.wait();
+    }
+  }
+}
+
+void StartupLoader::add(const std::string &asset, Work work) {
+  Job &job = jobs.emplace_back();
+  job.asset = asset;
+  job.future = pool.submit([&job, work = std::move(work)]() { return work(job.stages); });
+}
+
+bool StartupLoader::poll() {
+  if (!ThreadPool::threadsAvailable()) {
+    // Decode one asset per frame so that the splash screen keeps being drawn
+    pool.runPending(1);
+  }
+
+  for (Job &job : jobs) {
+    if (job.done || job.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      continue;
+
+    // Rethrows exceptions from the worker on the main thread
+    Finisher finisher = job.future.get();
+
+    auto start = Clock::now();
+    if (finisher)
+      finisher();
+    job.uploadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    job.done = true;
+    finishedJobs++;
+    if (finished())
+      completed = Clock::now();
+  }
+
+  return finished();
+}
+
+void StartupLoader::printReport(std::ostream &os) const {
+  double cpuTotal = 0;
+  double uploadTotal = 0;
+
+  os << "Startup report:" << std::endl;
+  for (const auto &[stage, ms] : mainThreadStages)
+    os << fmt::format("  {:<32} {:<26} {:>9.2f} ms (main thread)", "", stage, ms) << std::endl;
+
+  for (const Job &job : jobs) {
+    for (const auto &[stage, ms] : job.stages.entries) {
+      os << fmt::format("  {:<32} {:<26} {:>9.2f} ms", job.asset, stage, ms) << std::endl;
+      cpuTotal += ms;
+    }
+    os << fmt::format("  {:<32} {:<26} {:>9.2f} ms (main thread)", job.asset, "gpu upload", job.uploadMs)
+       << std::endl;
+    uploadTotal += job.uploadMs;
+  }
+
+  double wallMs = std::chrono::duration<double, std::milli>((finished() ? completed : Clock::now()) - started).count();
+  os << fmt::format("  CPU work: {:.2f} ms on {} thread(s), GPU uploads: {:.2f} ms, wall time: {:.2f} ms",
+                    cpuTotal,
+                    std::max<size_t>(1, pool.size()),
+                    uploadTotal,
+                    wallMs)
+     << std::endl;
+}
@@ -0,0 +1,182 @@
+#include "rendering/WaveformStrip.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Libraries
+namespace rlgl {
+#include "rlgl.h"
+}
+
+// Local includes
+#include "common_defs.h"
+
+using audio::WaveformPyramid;
+
+/// Distance from the camera where the first piece of the strip ends, every next one is twice as long
+static constexpr float FirstPieceMeters = 1.0f;
+
+WaveformStrip::WaveformStrip(WaveformPyramid waveform) : pyramid(std::move(waveform)) {}
+
+WaveformStrip::~WaveformStrip() {
+  for (const auto &[key, page] : pages)
+    rlgl::rlUnloadTexture(page.texture);
+}
+
+MemoryReport::Usage WaveformStrip::memoryUsage() const {
+  MemoryReport::Usage usage;
+  usage.cpuBytes = MemoryReport::vectorBytes(pixels) + MemoryReport::vectorBytes(byAge) +
+                   pages.size() * (sizeof(std::pair<const uint64_t, Page>) + MemoryReport::HashNodeBytes);
+  for (size_t i = 0; i < pyramid.levelCount(); i++)
+    usage.cpuBytes += MemoryReport::vectorBytes(pyramid.level(i));
+  usage.gpuBytes = pages.size() * PageBins * PageHeight * 2;
+  usage.objects = pages.size();
+  return usage;
+}
+
+size_t WaveformStrip::levelAt(const Camera3D &camera, float metersPerSecond, float distance) const {
+  // The floor is seen at a grazing angle, so far away a pixel covers even more of it along the track
+  float pixelAngle = 2.0f * std::tan(camera.fovy * DEG2RAD / 2.0f) / static_cast<float>(std::max(1, GetScreenHeight()));
+  float height = std::max(camera.position.y, 0.1f);
+  float pixelMeters = pixelAngle * distance * std::max(1.0f, distance / height);
+
+  size_t level = 0;
+  while (level + 1 < pyramid.levelCount() && pyramid.binSeconds(level) * metersPerSecond < pixelMeters)
+    level++;
+  return level;
+}
+
+unsigned int WaveformStrip::texture(size_t level, size_t index) {
+  if (auto it = pages.find(pageKey(level, index)); it != pages.end()) {
+    it->second.lastDrawn = frame;
+    return it->second.texture;
+  }
+  if (uploads >= UploadsPerFrame)
+    return 0;
+  uploads++;
+
+  // Gray and alpha: white wherever the bin's peaks reach, rows from +127 at the top to -127 at the bottom
+  const std::vector<WaveformPyramid::Peak> &bins = pyramid.level(level);
+  pixels.assign(PageBins * PageHeight * 2, 0);
+  constexpr float rowAmplitude = 254.0f / PageHeight;
+  size_t first = index * PageBins;
+  size_t count = std::min(PageBins, bins.size() - first);
+
+  for (int row = 0; row < PageHeight; row++) {
+    float top = 127.0f - static_cast<float>(row) * rowAmplitude;
+    float bottom = top - rowAmplitude;
+    uint8_t *line = &pixels[static_cast<size_t>(row) * PageBins * 2];
+    for (size_t column = 0; column < count; column++) {
+      const WaveformPyramid::Peak &peak = bins[first + column];
+      if (bottom <= static_cast<float>(peak.max) && top >= static_cast<float>(peak.min)) {
+        line[column * 2] = 255;
+        line[column * 2 + 1] = 255;
+      }
+    }
+  }
+
+  unsigned int id = rlgl::rlLoadTexture(pixels.data(),
+                                        static_cast<int>(PageBins),
+                                        PageHeight,
+                                        PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+                                        1);
+  if (id == 0)
+    return 0;
+  rlgl::rlTextureParameters(id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_LINEAR);
+  rlgl::rlTextureParameters(id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_LINEAR);
+  rlgl::rlTextureParameters(id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
+  rlgl::rlTextureParameters(id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
+
+  pages.emplace(pageKey(level, index), Page{ id, frame });
+  return id;
+}
+
+void WaveformStrip::evict() {
+  if (pages.size() <= MaxPages)
+    return;
+
+  byAge.clear();
+  for (const auto &[key, page] : pages) {
+    if (page.lastDrawn != frame)
+      byAge.emplace_back(page.lastDrawn, key);
+  }
+  std::sort(byAge.begin(), byAge.end());
+
+  for (const auto &[lastDrawn, key] : byAge) {
+    if (pages.size() <= MaxPages)
+      break;
+    rlgl::rlUnloadTexture(pages.at(key).texture);
+    pages.erase(key);
+  }
+}
+
+void WaveformStrip::draw(const Camera3D &camera, float metersPerSecond, float x, float width, Color tint) {
+  if (pyramid.empty() || metersPerSecond <= 0)
+    return;
+  frame++;
+  uploads = 0;
+
+  auto drawRange = [&](float start, float end, size_t level) {
+    float pageSeconds = pyramid.binSeconds(level) * static_cast<float>(PageBins);
+    auto pageCount = (pyramid.level(level).size() + PageBins - 1) / PageBins;
+    auto firstPage = static_cast<size_t>(start / pageSeconds);
+    auto lastPage = std::min(static_cast<size_t>(end / pageSeconds), pageCount - 1);
+
+    for (size_t index = firstPage; index <= lastPage; index++) {
+      unsigned int id = texture(level, index);
+      if (id == 0)
+        continue;
+
+      float pageStart = static_cast<float>(index) * pageSeconds;
+      float from = std::max(start, pageStart);
+      float to = std::min(end, pageStart + pageSeconds);
+      float u0 = (from - pageStart) / pageSeconds;
+      float u1 = (to - pageStart) / pageSeconds;
+      float z0 = from * metersPerSecond;
+      float z1 = to * metersPerSecond;
+
+      rlgl::rlCheckRenderBatchLimit(4);
+      rlgl::rlSetTexture(id);
+
+      // clang-format off
+      rlgl::rlBegin(RL_QUADS);
+
+        rlgl::rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+        rlgl::rlNormal3f(0.0f, 1.0f, 0.0f);
+
+        rlgl::rlTexCoord2f(u0, 1);
+        rlgl::rlVertex3f(x, 0.0f, z0);
+
+        rlgl::rlTexCoord2f(u1, 1);
+        rlgl::rlVertex3f(x, 0.0f, z1);
+
+        rlgl::rlTexCoord2f(u1, 0);
+        rlgl::rlVertex3f(x + width, 0.0f, z1);
+
+        rlgl::rlTexCoord2f(u0, 0);
+        rlgl::rlVertex3f(x + width, 0.0f, z0);
+
+      rlgl::rlEnd();
+      // clang-format on
+    }
+  };
+
+  // Pieces doubling in length away from the camera, in front and behind it
+  float duration = pyramid.duration();
+  for (float direction : { 1.0f, -1.0f }) {
+    for (float inner = 0, outer = FirstPieceMeters; inner < MAX_RENDER_DISTANCE; inner = outer, outer *= 2) {
+      outer = std::min(outer, MAX_RENDER_DISTANCE);
+      float a = (camera.position.z + direction * inner) / metersPerSecond;
+      float b = (camera.position.z + direction * outer) / metersPerSecond;
+      float start = std::max(std::min(a, b), 0.0f);
+      float end = std::min(std::max(a, b), duration);
+      if (start < end)
+        drawRange(start, end, levelAt(camera, metersPerSecond, std::max(inner, FirstPieceMeters / 2)));
+    }
+  }
+
+  rlgl::rlSetTexture(0);
+  evict();
+}
@@ -0,0 +1,202 @@
+#include "rendering/binary_mesh.h"
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(PLATFORM_WEB)
+#define BINMESH_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Set by the build to the directory the models are baked into, OBJ paths are looked up relative to it
+#ifndef ATMESH_BAKED_DIR
+#define ATMESH_BAKED_DIR ""
+#endif
+
+namespace binmesh {
+
+static size_t padTo4(size_t size) {
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+MappedFile::MappedFile(const std::string &path) {
+#ifdef BINMESH_USE_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Unable to open " + path);
+
+  struct stat st {};
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      bytes = static_cast<const uint8_t *>(addr);
+      length = static_cast<size_t>(st.st_size);
+      mapped = true;
+    }
+  }
+  close(fd);
+
+  if (mapped)
+    return;
+#endif
+
+  std::ifstream is(path, std::ios::binary);
+  if (!is)
+    throw std::runtime_error("Unable to open " + path);
+  fallback.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+  bytes = fallback.data();
+  length = fallback.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef BINMESH_USE_MMAP
+  if (mapped)
+    munmap(const_cast<uint8_t *>(bytes), length);
+#endif
+}
+
+MeshFile::MeshFile(const std::string &path, const std::string &objPath) : file(std::make_unique<MappedFile>(path)) {
+  // Diffuse map paths are stored relative to the OBJ model, the mesh file itself lives in the build directory
+  std::string baseDir = std::filesystem::path(objPath).parent_path().string();
+  if (!baseDir.empty())
+    baseDir += "/";
+
+  const uint8_t *p = file->data();
+  const uint8_t *end = p + file->size();
+
+  // Records are padded to 4 bytes, the padding has to be in the file too or `p` would step past its end
+  auto take = [&](size_t size) {
+    auto left = static_cast<size_t>(end - p);
+    if (size > left || padTo4(size) > left)
+      throw std::runtime_error(path + ": truncated file");
+    const uint8_t *result = p;
+    p += padTo4(size);
+    return result;
+  };
+
+  const auto *header = reinterpret_cast<const FileHeader *>(take(sizeof(FileHeader)));
+  if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0)
+    throw std::runtime_error(path + ": not an atmesh file");
+  if (header->version != Version)
+    throw std::runtime_error(path + ": unsupported atmesh version " + std::to_string(header->version));
+
+  for (uint32_t i = 0; i < header->materialCount; i++) {
+    MaterialView &material = materials.emplace_back();
+    material.record = reinterpret_cast<const MaterialRecord *>(take(sizeof(MaterialRecord)));
+    const char *mapPath = reinterpret_cast<const char *>(take(material.record->diffuseMapLength));
+    if (material.record->diffuseMapLength > 0)
+      material.diffuseMap = baseDir + std::string(mapPath, material.record->diffuseMapLength);
+  }
+
+  for (uint32_t i = 0; i < header->meshCount; i++) {
+    MeshView &mesh = meshes.emplace_back();
+    mesh.record = reinterpret_cast<const MeshRecord *>(take(sizeof(MeshRecord)));
+    mesh.vertices = reinterpret_cast<const Vertex *>(take(mesh.record->vertexCount * sizeof(Vertex)));
+    mesh.indices = reinterpret_cast<const uint16_t *>(take(mesh.record->indexCount * sizeof(uint16_t)));
+  }
+}
+
+obj::ObjData MeshFile::toObjData() const {
+  obj::ObjData result;
+
+  for (const MaterialView &material : materials) {
+    obj::MaterialData &data = result.materials.emplace_back();
+    std::copy_n(material.record->diffuse, 3, data.diffuse);
+    data.diffuseMap = material.diffuseMap;
+  }
+
+  for (const MeshView &mesh : meshes) {
+    obj::MeshData &data = result.meshes.emplace_back();
+    for (uint32_t i = 0; i < mesh.record->vertexCount; i++) {
+      const Vertex &v = mesh.vertices[i];
+      data.vertices.insert(data.vertices.end(), v.position, v.position + 3);
+      data.normals.insert(data.normals.end(), v.normal, v.normal + 3);
+      data.texcoords.insert(data.texcoords.end(), v.texcoord, v.texcoord + 2);
+    }
+    data.indices.assign(mesh.indices, mesh.indices + mesh.record->indexCount);
+  }
+
+  return result;
+}
+
+template<typename T>
+static void append(std::vector<uint8_t> &out, const T *data, size_t count) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(data);
+  out.insert(out.end(), bytes, bytes + count * sizeof(T));
+  out.resize(padTo4(out.size()), 0);
+}
+
+std::vector<uint8_t> serialize(const obj::ObjData &data) {
+  std::vector<uint8_t> out;
+
+  FileHeader header{};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.materialCount = static_cast<uint32_t>(data.materials.size());
+  header.meshCount = static_cast<uint32_t>(data.meshes.size());
+  append(out, &header, 1);
+
+  for (const obj::MaterialData &material : data.materials) {
+    MaterialRecord record{};
+    std::copy_n(material.diffuse, 3, record.diffuse);
+    record.diffuseMapLength = static_cast<uint32_t>(material.diffuseMap.size());
+    append(out, &record, 1);
+    append(out, material.diffuseMap.data(), material.diffuseMap.size());
+  }
+
+  for (const obj::MeshData &mesh : data.meshes) {
+    MeshRecord record{};
+    record.vertexCount = static_cast<uint32_t>(mesh.vertexCount());
+    record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    for (int axis = 0; axis < 3; axis++) {
+      record.boundsMin[axis] = mesh.vertexCount() > 0 ? mesh.vertices[axis] : 0.0f;
+      record.boundsMax[axis] = record.boundsMin[axis];
+    }
+
+    std::vector<Vertex> vertices(mesh.vertexCount());
+    for (size_t i = 0; i < vertices.size(); i++) {
+      Vertex &v = vertices[i];
+      std::copy_n(&mesh.vertices[i * 3], 3, v.position);
+      std::copy_n(&mesh.normals[i * 3], 3, v.normal);
+      std::copy_n(&mesh.texcoords[i * 2], 2, v.texcoord);
+
+      for (int axis = 0; axis < 3; axis++) {
+        record.boundsMin[axis] = std::min(record.boundsMin[axis], v.position[axis]);
+        record.boundsMax[axis] = std::max(record.boundsMax[axis], v.position[axis]);
+      }
+    }
+
+    append(out, &record, 1);
+    append(out, vertices.data(), vertices.size());
+    append(out, mesh.indices.data(), mesh.indices.size());
+  }
+
+  return out;
+}
+
+std::optional<std::string> bakedPathFor(const std::string &objPath) {
+  namespace fs = std::filesystem;
+
+  fs::path baked = fs::path(ATMESH_BAKED_DIR) / objPath;
+  baked.replace_extension(Extension);
+
+  std::error_code ec;
+  auto bakedTime = fs::last_write_time(baked, ec);
+  if (ec)
+    return std::nullopt;
+
+  auto objTime = fs::last_write_time(objPath, ec);
+  if (!ec && objTime > bakedTime)
+    return std::nullopt;
+
+  return baked.string();
+}
+
+} // namespace binmesh
@@ -0,0 +1,126 @@
+#include "rendering/event_placement.h"
+
+// STL includes
+#include <algorithm>
+#include <cassert>
+
+// Local includes
+#include "rendering/matrix_batch.h"
+
+namespace placement {
+
+TransformOps &TransformOps::translate(float x, float y, float z) {
+  assert(count < MaxOps);
+  ops[count++] = { false, 0, { x, y, z } };
+  return *this;
+}
+
+TransformOps &TransformOps::rotate(float angleDeg, float x, float y, float z) {
+  assert(count < MaxOps);
+  ops[count++] = { true, angleDeg, { x, y, z } };
+  return *this;
+}
+
+Matrix TransformOps::op(size_t i) const {
+  const Op &o = ops[i];
+  if (o.rotation)
+    return MatrixRotate(Vector3Normalize(o.v), o.angleDeg * DEG2RAD);
+  return MatrixTranslate(o.v.x, o.v.y, o.v.z);
+}
+
+void PlacementBatch::placeGem(TransformOps ops, bool rhs, TintRole role) {
+  ops.rotate(rhs ? -30 : 30, 0, 0, 1).rotate(180, 0, 1, 0);
+  pending.push_back({ StaticModelGem, role, false, ops });
+}
+
+void PlacementBatch::placeEvent(const audiotrip::ChoreoEvent &event, float distance, Vector3 ribbonEnd) {
+  Vector3 v = event.position.vectorWithDistance(distance);
+
+  if (event.type == audiotrip::ChoreoEventTypeBarrier) {
+    TransformOps ops;
+    ops.translate(0, 1.20, v.z).rotate(-event.position.z(), 0, 0, 1).translate(0, 0.45f - v.y, 0);
+    pending.push_back({ StaticModelBarrier, TintRoleBarrier, false, ops });
+    return;
+  }
+
+  TransformOps ops;
+  ops.translate(v.x, v.y, v.z);
+  TintRole role = event.isRHS() ? TintRoleRight : TintRoleLeft;
+
+  switch (event.type) {
+  case audiotrip::ChoreoEventTypeGemL:
+  case audiotrip::ChoreoEventTypeGemR: {
+    placeGem(ops, event.isRHS(), role);
+    Pending trail = pending.back();
+    trail.model = StaticModelGemTrail;
+    trail.transparent = true;
+    pending.push_back(trail);
+    break;
+  }
+  case audiotrip::ChoreoEventTypeDrumL:
+  case audiotrip::ChoreoEventTypeDrumR:
+    // Somebody smarter than me please fix the angles, thanks!
+    ops.rotate(-event.subPositions.front().y(), 0, 1, 0)
+      .rotate(event.subPositions.front().x(), 1, 0, 0)
+      .rotate(180, 0, 1, 0);
+    pending.push_back({ StaticModelDrum, role, false, ops });
+    break;
+  case audiotrip::ChoreoEventTypeDirGemL:
+  case audiotrip::ChoreoEventTypeDirGemR:
+    ops.rotate(-event.subPositions.front().y(), 0, 1, 0)
+      .rotate(event.subPositions.front().x(), 1, 0, 0)
+      .rotate(180, 0, 1, 0)
+      .rotate(event.isRHS() ? 30 : -30, 0, 0, 1);
+    pending.push_back({ StaticModelDirGem, role, false, ops });
+    break;
+  case audiotrip::ChoreoEventTypeRibbonL:
+  case audiotrip::ChoreoEventTypeRibbonR: {
+    // Initial gem, moved 5cm back so it doesn't intersect the ribbon
+    TransformOps initial = ops;
+    placeGem(initial.translate(0, 0, -0.05), event.isRHS(), role);
+
+    // Final gem
+    TransformOps last = ops;
+    placeGem(last.translate(ribbonEnd.x, ribbonEnd.y, ribbonEnd.z), event.isRHS(), role);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+std::vector<Placement> PlacementBatch::compose() const {
+  size_t count = pending.size();
+  size_t longest = 0;
+  for (const Pending &p : pending)
+    longest = std::max(longest, p.ops.size());
+
+  matrix_batch::MatrixArray transforms(count);
+  matrix_batch::MatrixArray ops(count);
+  matrix_batch::MatrixArray scratch(count);
+
+  for (size_t i = 0; i < count; i++)
+    transforms.set(i, MatrixIdentity());
+
+  // One batched product per step of the chains, shorter chains are padded with identities
+  for (size_t step = 0; step < longest; step++) {
+    for (size_t i = 0; i < count; i++)
+      ops.set(i, step < pending[i].ops.size() ? pending[i].ops.op(step) : MatrixIdentity());
+
+    matrix_batch::multiply(ops, transforms, scratch);
+    std::swap(transforms, scratch);
+  }
+
+  matrix_batch::MatrixArray normals(count);
+  matrix_batch::normalMatrices(transforms, normals);
+
+  std::vector<Placement> result;
+  result.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    const Pending &p = pending[i];
+    result.push_back({ p.model, p.role, p.transparent, transforms.get(i), normals.get(i) });
+  }
+  return result;
+}
+
+} // namespace placement
@@ -0,0 +1,115 @@
+#include "rendering/matrix_batch.h"
+
+// STL includes
+#include <algorithm>
+
+namespace matrix_batch {
+
+void MatrixArray::resize(size_t newSize) {
+  count = newSize;
+  for (std::vector<float> &element : elements)
+    element.resize(newSize);
+}
+
+void MatrixArray::set(size_t i, const Matrix &matrix) {
+  float16 values = MatrixToFloatV(matrix);
+  for (size_t k = 0; k < 16; k++)
+    elements[k][i] = values.v[k];
+}
+
+Matrix MatrixArray::get(size_t i) const {
+  const auto &e = elements;
+  return { e[0][i], e[4][i], e[8][i],  e[12][i], e[1][i], e[5][i], e[9][i],  e[13][i],
+           e[2][i], e[6][i], e[10][i], e[14][i], e[3][i], e[7][i], e[11][i], e[15][i] };
+}
+
+// The kernels below take restrict-qualified parameters so that compilers know the arrays don't overlap, which is what
+// allows them to vectorize the loops without runtime alias checks.
+
+static void dotProducts(const float *__restrict l0,
+                        const float *__restrict l1,
+                        const float *__restrict l2,
+                        const float *__restrict l3,
+                        const float *__restrict r0,
+                        const float *__restrict r1,
+                        const float *__restrict r2,
+                        const float *__restrict r3,
+                        float *__restrict out,
+                        size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = l0[i] * r0[i] + l1[i] * r1[i] + l2[i] * r2[i] + l3[i] * r3[i];
+}
+
+/// `out = a * b - c * d`
+static void differenceOfProducts(const float *__restrict a,
+                                 const float *__restrict b,
+                                 const float *__restrict c,
+                                 const float *__restrict d,
+                                 float *__restrict out,
+                                 size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = a[i] * b[i] - c[i] * d[i];
+}
+
+/// Reciprocal of the determinant, from the first row and its cofactors
+static void inverseDeterminants(const float *__restrict a0,
+                                const float *__restrict a1,
+                                const float *__restrict a2,
+                                const float *__restrict c0,
+                                const float *__restrict c1,
+                                const float *__restrict c2,
+                                float *__restrict out,
+                                size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = 1.0f / (a0[i] * c0[i] + a1[i] * c1[i] + a2[i] * c2[i]);
+}
+
+static void scale(float *__restrict values, const float *__restrict factors, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    values[i] *= factors[i];
+}
+
+void multiply(const MatrixArray &left, const MatrixArray &right, MatrixArray &result) {
+  // Same as MatrixMultiply(): m[4a + b] = sum over j of left.m[4a + j] * right.m[4j + b]
+  for (size_t a = 0; a < 4; a++) {
+    for (size_t b = 0; b < 4; b++) {
+      dotProducts(left[4 * a],
+                  left[4 * a + 1],
+                  left[4 * a + 2],
+                  left[4 * a + 3],
+                  right[b],
+                  right[4 + b],
+                  right[8 + b],
+                  right[12 + b],
+                  result[4 * a + b],
+                  result.size());
+    }
+  }
+}
+
+void normalMatrices(const MatrixArray &transforms, MatrixArray &result) {
+  size_t count = result.size();
+  const MatrixArray &m = transforms;
+
+  // The inverse transpose is the cofactor matrix divided by the determinant
+  differenceOfProducts(m[5], m[10], m[6], m[9], result[0], count);
+  differenceOfProducts(m[6], m[8], m[4], m[10], result[1], count);
+  differenceOfProducts(m[4], m[9], m[5], m[8], result[2], count);
+  differenceOfProducts(m[2], m[9], m[1], m[10], result[4], count);
+  differenceOfProducts(m[0], m[10], m[2], m[8], result[5], count);
+  differenceOfProducts(m[1], m[8], m[0], m[9], result[6], count);
+  differenceOfProducts(m[1], m[6], m[2], m[5], result[8], count);
+  differenceOfProducts(m[2], m[4], m[0], m[6], result[9], count);
+  differenceOfProducts(m[0], m[5], m[1], m[4], result[10], count);
+
+  std::vector<float> inverseDeterminant(count);
+  inverseDeterminants(m[0], m[1], m[2], result[0], result[1], result[2], inverseDeterminant.data(), count);
+  for (size_t k : { 0, 1, 2, 4, 5, 6, 8, 9, 10 })
+    scale(result[k], inverseDeterminant.data(), count);
+
+  for (size_t k : { 3, 7, 11, 12, 13, 14 })
+    std::fill_n(result[k], count, 0.0f);
+  std::fill_n(result[15], count, 1.0f);
+}
+
+} // namespace matrix_batch
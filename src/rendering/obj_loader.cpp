@@ -0,0 +1,252 @@
+#include "rendering/obj_loader.h"
+
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace obj {
+
+static std::string readFile(const std::string &path) {
+  std::ifstream is(path, std::ios::binary);
+  if (!is)
+    throw std::runtime_error("Unable to open " + path);
+
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+static std::string directoryOf(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+/// Tiny cursor over a null-terminated buffer, since strtof/strtol need one
+class Cursor {
+  const char *p;
+
+public:
+  explicit Cursor(const char *p) : p(p) {}
+
+  [[nodiscard]] bool atEnd() const { return *p == '\0'; }
+
+  void skipSpaces() {
+    while (*p == ' ' || *p == '\t' || *p == '\r')
+      p++;
+  }
+
+  void skipLine() {
+    while (*p != '\0' && *p != '\n')
+      p++;
+    if (*p == '\n')
+      p++;
+  }
+
+  [[nodiscard]] bool atEol() const { return *p == '\0' || *p == '\n' || *p == '\r' || *p == '#'; }
+
+  std::string_view word() {
+    skipSpaces();
+    const char *start = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+      p++;
+    return { start, static_cast<size_t>(p - start) };
+  }
+
+  std::string_view rest() {
+    skipSpaces();
+    const char *start = p;
+    while (*p != '\0' && *p != '\r' && *p != '\n')
+      p++;
+    return { start, static_cast<size_t>(p - start) };
+  }
+
+  float number() {
+    skipSpaces();
+    char *end;
+    float result = std::strtof(p, &end);
+    if (end == p)
+      throw std::runtime_error("Expected a number");
+    p = end;
+    return result;
+  }
+
+  long integer() {
+    char *end;
+    long result = std::strtol(p, &end, 10);
+    if (end == p)
+      throw std::runtime_error("Expected an index");
+    p = end;
+    return result;
+  }
+
+  bool consume(char c) {
+    if (*p != c)
+      return false;
+    p++;
+    return true;
+  }
+};
+
+struct VertexRef {
+  long v = 0, vt = 0, vn = 0;
+
+  bool operator==(const VertexRef &o) const { return v == o.v && vt == o.vt && vn == o.vn; }
+};
+
+struct VertexRefHash {
+  size_t operator()(const VertexRef &r) const {
+    return std::hash<long>()(r.v) ^ (std::hash<long>()(r.vt) << 11) ^ (std::hash<long>()(r.vn) << 22);
+  }
+};
+
+// Resolves negative (relative) and 1-based indices into 0-based ones, -1 if absent
+static long resolveIndex(long index, size_t count) {
+  if (index > 0)
+    return index - 1;
+  if (index < 0)
+    return static_cast<long>(count) + index;
+  return -1;
+}
+
+std::vector<MaterialData> parseMtl(std::string_view text, const std::string &baseDir) {
+  std::string buffer(text);
+  Cursor c(buffer.c_str());
+  std::vector<MaterialData> result;
+
+  while (!c.atEnd()) {
+    std::string_view keyword = c.word();
+
+    if (keyword == "newmtl") {
+      result.emplace_back().name = std::string(c.rest());
+    } else if (!result.empty() && keyword == "Kd") {
+      for (float &channel : result.back().diffuse)
+        channel = c.number();
+    } else if (!result.empty() && keyword == "map_Kd") {
+      result.back().diffuseMap = baseDir + std::string(c.rest());
+    }
+
+    c.skipLine();
+  }
+
+  return result;
+}
+
+ObjData parse(std::string_view text, const std::string &baseDir) {
+  std::string buffer(text);
+  Cursor c(buffer.c_str());
+
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+
+  ObjData result;
+  std::vector<std::unordered_map<VertexRef, uint16_t, VertexRefHash>> vertexIndices(1);
+  result.meshes.resize(1);
+  size_t currentMesh = 0;
+
+  auto addVertex = [&](const VertexRef &ref) -> uint16_t {
+    auto it = vertexIndices[currentMesh].find(ref);
+    if (it != vertexIndices[currentMesh].end())
+      return it->second;
+
+    MeshData &mesh = result.meshes[currentMesh];
+    if (mesh.vertexCount() >= UINT16_MAX)
+      throw std::runtime_error("Too many vertices for 16-bit indices");
+
+    long v = resolveIndex(ref.v, positions.size() / 3);
+    long vt = resolveIndex(ref.vt, texcoords.size() / 2);
+    long vn = resolveIndex(ref.vn, normals.size() / 3);
+
+    if (v < 0 || static_cast<size_t>(v) * 3 >= positions.size())
+      throw std::runtime_error("Vertex index out of range");
+
+    mesh.vertices.insert(mesh.vertices.end(), &positions[v * 3], &positions[v * 3] + 3);
+
+    if (vn >= 0 && static_cast<size_t>(vn) * 3 < normals.size())
+      mesh.normals.insert(mesh.normals.end(), &normals[vn * 3], &normals[vn * 3] + 3);
+    else
+      mesh.normals.insert(mesh.normals.end(), { 0.0f, 1.0f, 0.0f });
+
+    if (vt >= 0 && static_cast<size_t>(vt) * 2 < texcoords.size()) {
+      mesh.texcoords.push_back(texcoords[vt * 2]);
+      // Flip vertically to account for raylib's upside-down textures, like raylib's own loader does
+      mesh.texcoords.push_back(1.0f - texcoords[vt * 2 + 1]);
+    } else {
+      mesh.texcoords.insert(mesh.texcoords.end(), { 0.0f, 0.0f });
+    }
+
+    auto index = static_cast<uint16_t>(mesh.vertexCount() - 1);
+    vertexIndices[currentMesh].emplace(ref, index);
+    return index;
+  };
+
+  while (!c.atEnd()) {
+    std::string_view keyword = c.word();
+
+    if (keyword == "v") {
+      for (int i = 0; i < 3; i++)
+        positions.push_back(c.number());
+    } else if (keyword == "vn") {
+      for (int i = 0; i < 3; i++)
+        normals.push_back(c.number());
+    } else if (keyword == "vt") {
+      texcoords.push_back(c.number());
+      texcoords.push_back(c.number());
+    } else if (keyword == "f") {
+      std::vector<uint16_t> polygon;
+      c.skipSpaces();
+      while (!c.atEol()) {
+        VertexRef ref;
+        ref.v = c.integer();
+        if (c.consume('/')) {
+          if (!c.consume('/')) {
+            ref.vt = c.integer();
+            if (c.consume('/'))
+              ref.vn = c.integer();
+          } else {
+            ref.vn = c.integer();
+          }
+        }
+        polygon.push_back(addVertex(ref));
+        c.skipSpaces();
+      }
+
+      // Triangle fan, OBJ polygons are convex
+      std::vector<uint16_t> &indices = result.meshes[currentMesh].indices;
+      for (size_t i = 1; i + 1 < polygon.size(); i++)
+        indices.insert(indices.end(), { polygon[0], polygon[i], polygon[i + 1] });
+    } else if (keyword == "mtllib") {
+      std::string mtlPath = baseDir + std::string(c.rest());
+      result.materials = parseMtl(readFile(mtlPath), directoryOf(mtlPath));
+      size_t meshCount = std::max<size_t>(1, result.materials.size());
+      result.meshes.resize(meshCount);
+      vertexIndices.resize(meshCount);
+    } else if (keyword == "usemtl") {
+      std::string_view name = c.rest();
+      // Faces with an unknown material go to the first mesh, like raylib does
+      currentMesh = 0;
+      for (size_t i = 0; i < result.materials.size(); i++) {
+        if (result.materials[i].name == name)
+          currentMesh = i;
+      }
+    }
+
+    c.skipLine();
+  }
+
+  return result;
+}
+
+ObjData parseFile(const std::string &path) {
+  try {
+    return parse(readFile(path), directoryOf(path));
+  } catch (const std::runtime_error &e) {
+    throw std::runtime_error(path + ": " + e.what());
+  }
+}
+
+} // namespace obj
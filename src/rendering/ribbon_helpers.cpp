@@ -4,12 +4,18 @@
 
 #include "rendering/ribbon_helpers.h"
 
+// STL includes
+#include <algorithm>
+#include <span>
+
 namespace ribbons {
 
-static std::vector<V3f> getRotatedShapeForNextPoint(const V3f &position,
-                                                    const V3f &normal,
-                                                    const std::vector<V3f> &shape,
-                                                    float epsilon = 1e-6) {
+/// Appends `shape` rotated to face `normal` and moved to `position` to `slices`
+static void appendRotatedShapeForNextPoint(std::vector<V3f> &slices,
+                                           const V3f &position,
+                                           const V3f &normal,
+                                           std::span<const V3f> shape,
+                                           float epsilon = 1e-6) {
   // Obtain the rotation matrix that rotates prevNormal into normal
   // Rotation matrix calculation algorithm from https://math.stackexchange.com/a/476311
   V3f a = { 0, 0, 1 };
@@ -28,13 +34,8 @@ static std::vector<V3f> getRotatedShapeForNextPoint(const V3f &position,
   Matrix3x3 rotationMatrix = Matrix3x3::identity() + Matrix3x3::skewSymmetricCrossProductMatrix(v) +
                              Matrix3x3::skewSymmetricCrossProductMatrix(v).power(2) * (1.0f / (1.0f + c));
 
-  std::vector<V3f> result;
-  result.reserve(shape.size());
-
   for (const V3f &vector : shape)
-    result.push_back((rotationMatrix * vector).Add(position));
-
-  return result;
+    slices.push_back((rotationMatrix * vector).Add(position));
 }
 
 std::vector<V3f> rotateShapeAroundZAxis(const std::vector<V3f> &shape, float angleInRadians) {
@@ -55,25 +56,19 @@ std::vector<V3f> rotateShapeAroundZAxis(const std::vector<V3f> &shape, float ang
   return result;
 }
 
-static std::vector<V3f> translateShape(const std::vector<V3f> &shape, V3f offset) {
-  std::vector<V3f> result;
-  result.reserve(shape.size());
-
-  for (const V3f &vector : shape)
-    result.push_back(vector + offset);
-
-  return result;
+/// Replaces `slice` with `shape` moved by `offset`
+static void translateShape(std::span<V3f> slice, std::span<const V3f> shape, V3f offset) {
+  for (size_t i = 0; i < shape.size(); i++)
+    slice[i] = shape[i] + offset;
 }
 
-raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
-                              const std::vector<Spline3D> &splines,
-                              size_t splineDivisions,
-                              float textureScale) {
+RibbonGeometry generateRibbonGeometry(std::span<const V3f> sliceShape,
+                                      std::span<const Spline3D> splines,
+                                      size_t splineDivisions,
+                                      float textureScale) {
 
   size_t maxNumberOfSlices = splines.size() * splineDivisions + 1;
 
-  // TODO: reduce number of copies
-
   // Generate vertices and texture coordinates
 
   const Spline3D &firstSpline = splines.front();
@@ -91,11 +86,15 @@ raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
   for (const Spline3D &spline : splines)
     totalRibbonLength += spline.Length();
 
-  std::vector<std::vector<V3f>> slices;
+  // Vertices of all the slices one after the other, `sliceShape.size()` each
+  std::vector<V3f> slices;
   std::vector<V3f> slicePositions;
   std::vector<float> sliceLengthWiseTCoords;
+  slices.reserve(maxNumberOfSlices * sliceShape.size());
+  slicePositions.reserve(maxNumberOfSlices);
+  sliceLengthWiseTCoords.reserve(maxNumberOfSlices);
 
-  slices.push_back(sliceShape);
+  slices.insert(slices.end(), sliceShape.begin(), sliceShape.end());
   slicePositions.push_back(firstSpline.Position(0));
   sliceLengthWiseTCoords.push_back(0);
 
@@ -114,7 +113,7 @@ raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
       if (!isLast && lastTangent.Normalize().Subtract(tangent.Normalize()).Length() < 0.005)
         continue;
 
-      slices.push_back(getRotatedShapeForNextPoint(spline.Position(t), tangent, sliceShape));
+      appendRotatedShapeForNextPoint(slices, spline.Position(t), tangent, sliceShape);
       slicePositions.push_back(spline.Position(t));
 
       float ribbonLengthAtT = ribbonLengthSoFar + spline.Length(0.0f, t);
@@ -124,9 +123,11 @@ raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
     ribbonLengthSoFar += spline.Length();
   }
 
-  slices.back() = translateShape(sliceShape, slicePositions.back());
+  size_t numberOfSlices = slicePositions.size();
+  translateShape(std::span(slices).subspan((numberOfSlices - 1) * sliceShape.size()),
+                 sliceShape,
+                 slicePositions.back());
 
-  size_t numberOfSlices = slices.size();
   size_t numberOfVertices = 2 + sliceShape.size() * numberOfSlices;
   size_t numberOfTriangles = 2 * (sliceShape.size() - 1) // ends
                              + (numberOfSlices - 1) * 2 * (sliceShape.size() - 1);
@@ -140,11 +141,10 @@ raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
   float *normals = normalsArr;
   float *tcoords = tcoordsArr;
 
-  sliceNum = 0;
-  for (const std::vector<V3f> &slice : slices) {
+  for (sliceNum = 0; sliceNum < numberOfSlices; sliceNum++) {
     float vertexNum = 0;
 
-    for (const V3f &vertex : slice) {
+    for (const V3f &vertex : std::span(slices).subspan(sliceNum * sliceShape.size(), sliceShape.size())) {
       V3f normal = (vertex - slicePositions.at(sliceNum)).Normalize();
 
       *points++ = vertex.x;
@@ -160,7 +160,6 @@ raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
 
       vertexNum++;
     }
-    sliceNum++;
   }
 
   // Start/end shape center points, to close off the face
@@ -230,28 +229,48 @@ raylib::Mesh createRibbonMesh(const std::vector<V3f> &sliceShape,
   assert(tcoords == tcoordsArr + (sizeof(tcoordsArr) / sizeof(float)));
   assert(triangle == trianglesArr + (sizeof(trianglesArr) / sizeof(uint16_t)));
 
-  // Now create a raylib mesh from the points we calculated
   // Raylib annoyingly requires to duplicate vertices for the triangles
-  raylib::Mesh mesh(static_cast<int>(numberOfTriangles) * 3, static_cast<int>(numberOfTriangles));
+  RibbonGeometry geometry;
+  size_t vertexCount = numberOfTriangles * 3;
+  geometry.vertices.resize(vertexCount * 3);
+  geometry.normals.resize(vertexCount * 3);
+  geometry.texcoords.resize(vertexCount * 2);
+
+  for (size_t k = 0; k < vertexCount; k++) {
+    geometry.vertices[k * 3] = verticesArr[trianglesArr[k] * 3];
+    geometry.vertices[k * 3 + 1] = verticesArr[trianglesArr[k] * 3 + 1];
+    geometry.vertices[k * 3 + 2] = verticesArr[trianglesArr[k] * 3 + 2];
+
+    geometry.normals[k * 3] = normalsArr[trianglesArr[k] * 3];
+    geometry.normals[k * 3 + 1] = normalsArr[trianglesArr[k] * 3 + 1];
+    geometry.normals[k * 3 + 2] = normalsArr[trianglesArr[k] * 3 + 2];
+
+    geometry.texcoords[k * 2] = tcoordsArr[trianglesArr[k] * 2];
+    geometry.texcoords[k * 2 + 1] = tcoordsArr[trianglesArr[k] * 2 + 1];
+  }
 
-  mesh.vertices = (float *) RL_MALLOC(numberOfTriangles * 3 * 3 * sizeof(float));
-  mesh.texcoords = (float *) RL_MALLOC(numberOfTriangles * 3 * 2 * sizeof(float));
-  mesh.normals = (float *) RL_MALLOC(numberOfTriangles * 3 * 3 * sizeof(float));
+  return geometry;
+}
 
-  for (int k = 0; k < mesh.vertexCount; k++) {
-    mesh.vertices[k * 3] = verticesArr[trianglesArr[k] * 3];
-    mesh.vertices[k * 3 + 1] = verticesArr[trianglesArr[k] * 3 + 1];
-    mesh.vertices[k * 3 + 2] = verticesArr[trianglesArr[k] * 3 + 2];
+raylib::Mesh uploadRibbonMesh(const RibbonGeometry &geometry) {
+  int vertexCount = static_cast<int>(geometry.vertexCount());
+  raylib::Mesh mesh(vertexCount, vertexCount / 3);
 
-    mesh.normals[k * 3] = normalsArr[trianglesArr[k] * 3];
-    mesh.normals[k * 3 + 1] = normalsArr[trianglesArr[k] * 3 + 1];
-    mesh.normals[k * 3 + 2] = normalsArr[trianglesArr[k] * 3 + 2];
-
-    mesh.texcoords[k * 2] = tcoordsArr[trianglesArr[k] * 2];
-    mesh.texcoords[k * 2 + 1] = tcoordsArr[trianglesArr[k] * 2 + 1];
-  }
+  mesh.vertices = (float *) RL_MALLOC(geometry.vertices.size() * sizeof(float));
+  mesh.normals = (float *) RL_MALLOC(geometry.normals.size() * sizeof(float));
+  mesh.texcoords = (float *) RL_MALLOC(geometry.texcoords.size() * sizeof(float));
+  std::copy(geometry.vertices.begin(), geometry.vertices.end(), mesh.vertices);
+  std::copy(geometry.normals.begin(), geometry.normals.end(), mesh.normals);
+  std::copy(geometry.texcoords.begin(), geometry.texcoords.end(), mesh.texcoords);
 
   mesh.Upload();
   return mesh;
 }
+
+raylib::Mesh createRibbonMesh(std::span<const V3f> sliceShape,
+                              std::span<const Spline3D> splines,
+                              size_t splineDivisions,
+                              float textureScale) {
+  return uploadRibbonMesh(generateRibbonGeometry(sliceShape, splines, splineDivisions, textureScale));
+}
 } // namespace ribbons
\ No newline at end of file
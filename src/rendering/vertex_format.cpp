@@ -0,0 +1,239 @@
+#include "rendering/vertex_format.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace rlgl {
+#include "rlgl.h"
+}
+
+// raylib config
+#include "config.h"
+
+namespace vertex_format {
+
+// rlgl only has defines for some of the GL types
+static constexpr int GlShort = 0x1402;
+static constexpr int GlUnsignedShort = 0x1403;
+
+// Same buffer slots as UploadMesh(), so that UpdateMeshBuffer() and UnloadMesh() work on quantized meshes too
+static constexpr int BufferPositions = 0;
+static constexpr int BufferTexcoords = 1;
+static constexpr int BufferNormals = 2;
+static constexpr int BufferColors = 3;
+static constexpr int BufferIndices = 6;
+
+static uint16_t quantizeUnsigned(float value, float offset, float scale) {
+  if (scale == 0.0f)
+    return 0;
+  return static_cast<uint16_t>(std::lround(std::clamp((value - offset) / scale, 0.0f, 1.0f) * 65535.0f));
+}
+
+static int16_t quantizeSigned(float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+std::array<int16_t, 2> encodeNormal(Vector3 normal) {
+  float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (sum == 0.0f)
+    return { 0, 0 };
+
+  // Project on the octahedron, then fold the lower half over the upper one
+  float x = normal.x / sum;
+  float y = normal.y / sum;
+  if (normal.z < 0.0f) {
+    float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+
+  return { quantizeSigned(x), quantizeSigned(y) };
+}
+
+Vector3 decodeNormal(std::array<int16_t, 2> encoded) {
+  // Same as decodeNormal() in base_lighting.vs
+  float x = static_cast<float>(encoded[0]) / 32767.0f;
+  float y = static_cast<float>(encoded[1]) / 32767.0f;
+  float z = 1.0f - std::abs(x) - std::abs(y);
+  if (z < 0.0f) {
+    float unfoldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float unfoldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = unfoldedX;
+    y = unfoldedY;
+  }
+  return Vector3Normalize({ x, y, z });
+}
+
+QuantizedAttributes quantize(size_t vertexCount, const float *positions, const float *normals, const float *texcoords) {
+  QuantizedAttributes result{};
+  Dequantization &dq = result.dequantization;
+
+  // Bounding boxes of the positions and of the texture coordinates
+  std::array<float, 3> min;
+  std::array<float, 3> max;
+  min.fill(std::numeric_limits<float>::max());
+  max.fill(std::numeric_limits<float>::lowest());
+  std::array<float, 2> texcoordMin = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+  std::array<float, 2> texcoordMax = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+
+  for (size_t v = 0; v < vertexCount; v++) {
+    for (size_t k = 0; k < 3; k++) {
+      min[k] = std::min(min[k], positions[v * 3 + k]);
+      max[k] = std::max(max[k], positions[v * 3 + k]);
+    }
+    for (size_t k = 0; k < 2; k++) {
+      texcoordMin[k] = std::min(texcoordMin[k], texcoords[v * 2 + k]);
+      texcoordMax[k] = std::max(texcoordMax[k], texcoords[v * 2 + k]);
+    }
+  }
+
+  if (vertexCount == 0)
+    return result;
+
+  for (size_t k = 0; k < 3; k++) {
+    dq.positionOffset[k] = min[k];
+    dq.positionScale[k] = max[k] - min[k];
+  }
+  dq.texcoordTransform = { texcoordMin[0], texcoordMin[1], texcoordMax[0] - texcoordMin[0],
+                           texcoordMax[1] - texcoordMin[1] };
+
+  result.positions.resize(vertexCount * 4);
+  result.normals.resize(vertexCount * 2);
+  result.texcoords.resize(vertexCount * 2);
+
+  for (size_t v = 0; v < vertexCount; v++) {
+    for (size_t k = 0; k < 3; k++)
+      result.positions[v * 4 + k] = quantizeUnsigned(positions[v * 3 + k], dq.positionOffset[k], dq.positionScale[k]);
+
+    std::array<int16_t, 2> normal = encodeNormal({ normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2] });
+    result.normals[v * 2] = normal[0];
+    result.normals[v * 2 + 1] = normal[1];
+
+    for (size_t k = 0; k < 2; k++) {
+      result.texcoords[v * 2 + k] =
+        quantizeUnsigned(texcoords[v * 2 + k], dq.texcoordTransform[k], dq.texcoordTransform[k + 2]);
+    }
+  }
+
+  return result;
+}
+
+bool supported() {
+  static const bool result = []() {
+    unsigned int vaoId = rlgl::rlLoadVertexArray();
+    if (vaoId == 0)
+      return false;
+    rlgl::rlUnloadVertexArray(vaoId);
+    return true;
+  }();
+  return result;
+}
+
+std::array<Attribute, 3> attributes(Format format) {
+  if (format == FormatFloat) {
+    return { Attribute{ BufferPositions, 3, RL_FLOAT, false, 3 * sizeof(float) },
+             Attribute{ BufferTexcoords, 2, RL_FLOAT, false, 2 * sizeof(float) },
+             Attribute{ BufferNormals, 3, RL_FLOAT, false, 3 * sizeof(float) } };
+  }
+
+  // The positions are padded to 4 components to keep them aligned
+  return { Attribute{ BufferPositions, 3, GlUnsignedShort, true, 4 * sizeof(uint16_t) },
+           Attribute{ BufferTexcoords, 2, GlUnsignedShort, true, 2 * sizeof(uint16_t) },
+           Attribute{ BufferNormals, 2, GlShort, true, 2 * sizeof(int16_t) } };
+}
+
+/// Creates a vertex array with the attributes of `format`, `data` is in the same order or null to leave them empty
+static Mesh createVertexArray(Format format,
+                              int vertexCount,
+                              std::array<const void *, 3> data,
+                              std::span<const unsigned char> colors,
+                              bool dynamic) {
+  Mesh mesh{};
+  mesh.vertexCount = vertexCount;
+  mesh.triangleCount = vertexCount / 3;
+  mesh.vboId = static_cast<unsigned int *>(RL_CALLOC(MAX_MESH_VERTEX_BUFFERS, sizeof(unsigned int)));
+
+  mesh.vaoId = rlgl::rlLoadVertexArray();
+  rlgl::rlEnableVertexArray(mesh.vaoId);
+
+  std::array<Attribute, 3> layout = attributes(format);
+  for (size_t i = 0; i < layout.size(); i++) {
+    const Attribute &attribute = layout[i];
+    auto bytes = static_cast<int>(static_cast<size_t>(vertexCount) * attribute.bytesPerVertex);
+    mesh.vboId[attribute.buffer] = rlgl::rlLoadVertexBuffer(data[i], bytes, dynamic);
+    rlgl::rlSetVertexAttribute(attribute.buffer,
+                               attribute.components,
+                               attribute.type,
+                               attribute.normalized,
+                               static_cast<int>(attribute.bytesPerVertex),
+                               nullptr);
+    rlgl::rlEnableVertexAttribute(attribute.buffer);
+  }
+
+  if (!colors.empty()) {
+    mesh.vboId[BufferColors] = rlgl::rlLoadVertexBuffer(colors.data(), static_cast<int>(colors.size()), dynamic);
+    rlgl::rlSetVertexAttribute(BufferColors, 4, RL_UNSIGNED_BYTE, true, 0, nullptr);
+    rlgl::rlEnableVertexAttribute(BufferColors);
+  } else {
+    // Same default as UploadMesh()
+    float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    rlgl::rlSetVertexAttributeDefault(BufferColors, white, SHADER_ATTRIB_VEC4, 4);
+    rlgl::rlDisableVertexAttribute(BufferColors);
+  }
+
+  return mesh;
+}
+
+raylib::Mesh upload(const QuantizedAttributes &attributes,
+                    std::span<const uint16_t> indices,
+                    std::span<const unsigned char> colors) {
+  Mesh mesh = createVertexArray(FormatQuantized,
+                                static_cast<int>(attributes.positions.size() / 4),
+                                { attributes.positions.data(), attributes.texcoords.data(), attributes.normals.data() },
+                                colors,
+                                false);
+
+  if (!indices.empty()) {
+    mesh.triangleCount = static_cast<int>(indices.size() / 3);
+    mesh.vboId[BufferIndices] =
+      rlgl::rlLoadVertexBufferElement(indices.data(), static_cast<int>(indices.size() * sizeof(uint16_t)), false);
+
+    // The draw code checks the indices to tell indexed meshes apart
+    mesh.indices = static_cast<unsigned short *>(RL_MALLOC(indices.size() * sizeof(uint16_t)));
+    std::memcpy(mesh.indices, indices.data(), indices.size() * sizeof(uint16_t));
+  }
+
+  rlgl::rlDisableVertexArray();
+  return mesh;
+}
+
+raylib::Mesh allocate(Format format, int vertexCount) {
+  Mesh mesh = createVertexArray(format, vertexCount, { nullptr, nullptr, nullptr }, {}, true);
+  rlgl::rlDisableVertexArray();
+  return mesh;
+}
+
+ShaderLocations ShaderLocations::of(const Shader &shader) {
+  return { GetShaderLocation(shader, "quantized"),
+           GetShaderLocation(shader, "positionOffset"),
+           GetShaderLocation(shader, "positionScale"),
+           GetShaderLocation(shader, "texcoordTransform") };
+}
+
+void ShaderLocations::setFormat(const Shader &shader, Format format) const {
+  float value = format == FormatQuantized ? 1.0f : 0.0f;
+  if (quantized != -1)
+    SetShaderValue(shader, quantized, &value, SHADER_UNIFORM_FLOAT);
+}
+
+std::array<RenderQueue::Uniform, 3> ShaderLocations::uniforms(const Dequantization &dequantization) const {
+  return { RenderQueue::Uniform{ positionOffset, SHADER_UNIFORM_VEC3, 1, dequantization.positionOffset.data() },
+           RenderQueue::Uniform{ positionScale, SHADER_UNIFORM_VEC3, 1, dequantization.positionScale.data() },
+           RenderQueue::Uniform{ texcoordTransform, SHADER_UNIFORM_VEC4, 1, dequantization.texcoordTransform.data() } };
+}
+
+} // namespace vertex_format
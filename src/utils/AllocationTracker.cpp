@@ -0,0 +1,387 @@
+#include "utils/AllocationTracker.h"
+
+// STL includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Libraries
+#include <fmt/format.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CALLER_ADDRESS() _ReturnAddress()
+#else
+#define CALLER_ADDRESS() __builtin_return_address(0)
+#endif
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#define HAVE_DLADDR
+#endif
+
+namespace {
+
+struct SiteSlot {
+  std::atomic<uint64_t> key{ 0 }; // Of the address and the scope, zero while the slot is free
+  std::atomic<uintptr_t> address{ 0 };
+  std::atomic<const char *> scope{ nullptr };
+  std::atomic<uint64_t> allocations{ 0 };
+  std::atomic<uint64_t> bytes{ 0 };
+  std::atomic<uint64_t> frame{ 0 }; // Allocations in the current frame
+  std::atomic<uint64_t> lastFrame{ 0 };
+};
+
+struct AtomicCounts {
+  std::atomic<uint64_t> allocations{ 0 };
+  std::atomic<uint64_t> bytes{ 0 };
+  std::atomic<uint64_t> frees{ 0 };
+};
+
+std::atomic<bool> tracking{ false };
+std::array<SiteSlot, AllocationTracker::MaxSites> sites;
+AtomicCounts currentFrame;
+AtomicCounts previousFrame;
+AtomicCounts totals;
+std::atomic<uint64_t> frameCount{ 0 };
+std::atomic<uint64_t> allocatingFrames{ 0 };
+
+thread_local const char *currentScope = nullptr;
+
+constexpr auto Relaxed = std::memory_order_relaxed;
+
+uint64_t siteKey(uintptr_t address, const char *scope) {
+  uint64_t key = static_cast<uint64_t>(address) * 0x9e3779b97f4a7c15ull ^ reinterpret_cast<uintptr_t>(scope);
+  return key != 0 ? key : 1;
+}
+
+SiteSlot *findSite(uintptr_t address, const char *scope) {
+  uint64_t key = siteKey(address, scope);
+  size_t first = (key >> 17) % sites.size();
+  for (size_t probe = 0; probe < sites.size(); probe++) {
+    SiteSlot &slot = sites[(first + probe) % sites.size()];
+    uint64_t current = slot.key.load(Relaxed);
+    if (current == key)
+      return &slot;
+    if (current != 0)
+      continue;
+
+    uint64_t expected = 0;
+    if (slot.key.compare_exchange_strong(expected, key, Relaxed) || expected == key) {
+      slot.address.store(address, Relaxed);
+      slot.scope.store(scope, Relaxed);
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+AllocationTracker::Counts load(const AtomicCounts &counts) {
+  return { counts.allocations.load(Relaxed), counts.bytes.load(Relaxed), counts.frees.load(Relaxed) };
+}
+
+void *allocate(size_t size, const void *caller) {
+  if (size == 0)
+    size = 1;
+  void *pointer;
+  while ((pointer = std::malloc(size)) == nullptr) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+  AllocationTracker::recordAllocation(caller, size);
+  return pointer;
+}
+
+void *allocateAligned(size_t size, std::align_val_t alignment, const void *caller) {
+  if (size == 0)
+    size = 1;
+  auto align = std::max(static_cast<size_t>(alignment), sizeof(void *));
+  void *pointer;
+  while (true) {
+#if defined(_WIN32)
+    pointer = _aligned_malloc(size, align);
+#else
+    if (posix_memalign(&pointer, align, size) != 0)
+      pointer = nullptr;
+#endif
+    if (pointer != nullptr)
+      break;
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+  AllocationTracker::recordAllocation(caller, size);
+  return pointer;
+}
+
+void release(void *pointer) noexcept {
+  if (pointer == nullptr)
+    return;
+  AllocationTracker::recordFree();
+  std::free(pointer);
+}
+
+void releaseAligned(void *pointer) noexcept {
+  if (pointer == nullptr)
+    return;
+  AllocationTracker::recordFree();
+#if defined(_WIN32)
+  _aligned_free(pointer);
+#else
+  std::free(pointer);
+#endif
+}
+
+} // namespace
+
+AllocationTracker::Scope::Scope(const char *name) : previous(currentScope) {
+  currentScope = name;
+}
+
+AllocationTracker::Scope::~Scope() {
+  currentScope = previous;
+}
+
+void AllocationTracker::enable() {
+  tracking.store(true, Relaxed);
+}
+
+bool AllocationTracker::enabled() {
+  return tracking.load(Relaxed);
+}
+
+void AllocationTracker::recordAllocation(const void *caller, size_t bytes) noexcept {
+  if (!tracking.load(Relaxed))
+    return;
+
+  currentFrame.allocations.fetch_add(1, Relaxed);
+  currentFrame.bytes.fetch_add(bytes, Relaxed);
+  totals.allocations.fetch_add(1, Relaxed);
+  totals.bytes.fetch_add(bytes, Relaxed);
+
+  if (SiteSlot *slot = findSite(reinterpret_cast<uintptr_t>(caller), currentScope)) {
+    slot->allocations.fetch_add(1, Relaxed);
+    slot->bytes.fetch_add(bytes, Relaxed);
+    slot->frame.fetch_add(1, Relaxed);
+  }
+}
+
+void AllocationTracker::recordFree() noexcept {
+  if (!tracking.load(Relaxed))
+    return;
+  currentFrame.frees.fetch_add(1, Relaxed);
+  totals.frees.fetch_add(1, Relaxed);
+}
+
+void AllocationTracker::endFrame() {
+  if (!enabled())
+    return;
+
+  uint64_t allocations = currentFrame.allocations.exchange(0, Relaxed);
+  previousFrame.allocations.store(allocations, Relaxed);
+  previousFrame.bytes.store(currentFrame.bytes.exchange(0, Relaxed), Relaxed);
+  previousFrame.frees.store(currentFrame.frees.exchange(0, Relaxed), Relaxed);
+  frameCount.fetch_add(1, Relaxed);
+  if (allocations > 0)
+    allocatingFrames.fetch_add(1, Relaxed);
+
+  for (SiteSlot &slot : sites) {
+    if (slot.key.load(Relaxed) != 0)
+      slot.lastFrame.store(slot.frame.exchange(0, Relaxed), Relaxed);
+  }
+}
+
+AllocationTracker::Counts AllocationTracker::lastFrame() {
+  return load(previousFrame);
+}
+
+AllocationTracker::Counts AllocationTracker::total() {
+  return load(totals);
+}
+
+uint64_t AllocationTracker::frames() {
+  return frameCount.load(Relaxed);
+}
+
+uint64_t AllocationTracker::framesWithAllocations() {
+  return allocatingFrames.load(Relaxed);
+}
+
+size_t AllocationTracker::topSites(std::span<Site> result, bool lastFrameOnly) {
+  auto weight = [&](const Site &site) { return lastFrameOnly ? site.lastFrame : site.allocations; };
+
+  // Insertion into the few slots of the result, kept sorted
+  size_t filled = 0;
+  for (const SiteSlot &slot : sites) {
+    if (slot.key.load(Relaxed) == 0)
+      continue;
+
+    Site site = { slot.address.load(Relaxed),
+                  slot.scope.load(Relaxed),
+                  slot.allocations.load(Relaxed),
+                  slot.bytes.load(Relaxed),
+                  slot.lastFrame.load(Relaxed) };
+    if (weight(site) == 0)
+      continue;
+
+    size_t position = filled;
+    while (position > 0 && weight(result[position - 1]) < weight(site))
+      position--;
+    if (position >= result.size())
+      continue;
+
+    size_t last = std::min(filled, result.size() - 1);
+    for (size_t i = last; i > position; i--)
+      result[i] = result[i - 1];
+    result[position] = site;
+    filled = std::min(filled + 1, result.size());
+  }
+  return filled;
+}
+
+/// Function containing `address` and the offset into its binary, for addr2line
+static std::string symbolize(uintptr_t address) {
+#ifdef HAVE_DLADDR
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void *>(address), &info) != 0) {
+    auto offset = address - reinterpret_cast<uintptr_t>(info.dli_fbase);
+    std::string name = "?";
+    if (info.dli_sname != nullptr) {
+      int status = 0;
+      char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+      name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+      std::free(demangled);
+    }
+    return fmt::format("{} ({}+{:#x})", name, info.dli_fname != nullptr ? info.dli_fname : "?", offset);
+  }
+#endif
+  return fmt::format("{:#x}", address);
+}
+
+void AllocationTracker::report(std::ostream &out, size_t count) {
+  Counts counts = total();
+  out << fmt::format("Allocations: {} ({:.1f} MiB), {} frees; {} of {} frames allocated",
+                     counts.allocations,
+                     static_cast<double>(counts.bytes) / (1024.0 * 1024.0),
+                     counts.frees,
+                     framesWithAllocations(),
+                     frames())
+      << std::endl;
+
+  std::vector<Site> top(count);
+  top.resize(topSites(top, false));
+  for (const Site &site : top) {
+    out << fmt::format("  {:>9} allocations, {:>10.1f} KiB  {}: {}",
+                       site.allocations,
+                       static_cast<double>(site.bytes) / 1024.0,
+                       site.scope != nullptr ? site.scope : "(no scope)",
+                       symbolize(site.address))
+        << std::endl;
+  }
+}
+
+// The replaceable global allocation functions, all of them so that none is left to the default implementation
+
+void *operator new(size_t size) {
+  return allocate(size, CALLER_ADDRESS());
+}
+
+void *operator new[](size_t size) {
+  return allocate(size, CALLER_ADDRESS());
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return allocate(size, CALLER_ADDRESS());
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return allocate(size, CALLER_ADDRESS());
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  return allocateAligned(size, alignment, CALLER_ADDRESS());
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return allocateAligned(size, alignment, CALLER_ADDRESS());
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  try {
+    return allocateAligned(size, alignment, CALLER_ADDRESS());
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  try {
+    return allocateAligned(size, alignment, CALLER_ADDRESS());
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *pointer) noexcept {
+  release(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  release(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+  release(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+  release(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  release(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  release(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  releaseAligned(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  releaseAligned(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+  releaseAligned(pointer);
+}
+
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept {
+  releaseAligned(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+  releaseAligned(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+  releaseAligned(pointer);
+}
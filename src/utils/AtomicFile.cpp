@@ -0,0 +1,39 @@
+#include "utils/AtomicFile.h"
+
+// STL includes
+#include <system_error>
+#include <utility>
+
+// Libraries
+#include <fmt/format.h>
+
+static std::filesystem::path tmpPathFor(std::filesystem::path path) {
+  path += ".tmp";
+  return path;
+}
+
+AtomicFile::AtomicFile(std::filesystem::path path) :
+  path(std::move(path)), tmpPath(tmpPathFor(this->path)), os(tmpPath, std::ios::binary | std::ios::trunc) {}
+
+AtomicFile::~AtomicFile() {
+  if (committed)
+    return;
+
+  os.close();
+  std::error_code error;
+  std::filesystem::remove(tmpPath, error);
+}
+
+std::optional<std::string> AtomicFile::commit() {
+  os.close();
+  if (!os)
+    return fmt::format("unable to write {}", tmpPath.string());
+
+  std::error_code error;
+  std::filesystem::rename(tmpPath, path, error);
+  if (error)
+    return fmt::format("unable to replace {}: {}", path.string(), error.message());
+
+  committed = true;
+  return std::nullopt;
+}
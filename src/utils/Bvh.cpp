@@ -0,0 +1,71 @@
+#include "utils/Bvh.h"
+
+// STL includes
+#include <algorithm>
+#include <numeric>
+
+static BoundingBox merge(const BoundingBox &a, const BoundingBox &b) {
+  return { { std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z) },
+           { std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z) } };
+}
+
+static float center(const BoundingBox &box, int axis) {
+  switch (axis) {
+  case 0:
+    return box.min.x + box.max.x;
+  case 1:
+    return box.min.y + box.max.y;
+  default:
+    return box.min.z + box.max.z;
+  }
+}
+
+Bvh::Bvh(const std::vector<BoundingBox> &input) {
+  if (input.empty())
+    return;
+
+  indices.resize(input.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  // A full binary tree with at least one box per leaf
+  nodes.reserve(2 * ((input.size() + LeafSize - 1) / LeafSize));
+  build(input, 0, static_cast<uint32_t>(input.size()));
+
+  boxes.reserve(indices.size());
+  for (uint32_t index : indices)
+    boxes.push_back(input[index]);
+}
+
+// NOLINTNEXTLINE(misc-no-recursion)
+uint32_t Bvh::build(const std::vector<BoundingBox> &input, uint32_t first, uint32_t count) {
+  auto begin = indices.begin() + first;
+  auto end = begin + count;
+
+  BoundingBox bounds = input[*begin];
+  BoundingBox centers = { { center(bounds, 0), center(bounds, 1), center(bounds, 2) },
+                          { center(bounds, 0), center(bounds, 1), center(bounds, 2) } };
+  for (auto it = begin + 1; it != end; ++it) {
+    const BoundingBox &box = input[*it];
+    bounds = merge(bounds, box);
+    Vector3 c = { center(box, 0), center(box, 1), center(box, 2) };
+    centers = merge(centers, { c, c });
+  }
+
+  auto node = static_cast<uint32_t>(nodes.size());
+  nodes.push_back({ bounds, first, count, 0 });
+  if (count <= LeafSize)
+    return node;
+
+  Vector3 extent = { centers.max.x - centers.min.x, centers.max.y - centers.min.y, centers.max.z - centers.min.z };
+  int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+  uint32_t half = count / 2;
+  std::nth_element(begin, begin + half, end, [&](uint32_t a, uint32_t b) {
+    return center(input[a], axis) < center(input[b], axis);
+  });
+
+  build(input, first, half);
+  uint32_t right = build(input, first + half, count - half);
+  nodes[node].count = 0;
+  nodes[node].right = right;
+  return node;
+}
@@ -0,0 +1,55 @@
+#include "utils/CacheDirectory.h"
+
+// STL includes
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+std::vector<std::filesystem::path> trimCacheDirectory(const std::filesystem::path &directory,
+                                                      const std::string &extension,
+                                                      uintmax_t maxBytes,
+                                                      const std::filesystem::path &keep) {
+  struct CacheFile {
+    std::filesystem::path path;
+    std::filesystem::file_time_type time;
+    uintmax_t size;
+  };
+
+  std::error_code error;
+  std::vector<CacheFile> files;
+  uintmax_t total = 0;
+
+  for (const auto &file : std::filesystem::directory_iterator(directory, error)) {
+    if (file.path().extension() != extension)
+      continue;
+
+    std::error_code fileError;
+    CacheFile cacheFile = { file.path(), file.last_write_time(fileError), file.file_size(fileError) };
+    if (fileError)
+      continue;
+
+    total += cacheFile.size;
+    files.push_back(std::move(cacheFile));
+  }
+
+  std::vector<std::filesystem::path> deleted;
+  if (total <= maxBytes)
+    return deleted;
+
+  // Least recently written first
+  std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) { return a.time < b.time; });
+
+  for (const CacheFile &cacheFile : files) {
+    if (total <= maxBytes)
+      break;
+    if (cacheFile.path == keep)
+      continue;
+
+    if (std::filesystem::remove(cacheFile.path, error)) {
+      total -= cacheFile.size;
+      deleted.push_back(cacheFile.path);
+    }
+  }
+
+  return deleted;
+}
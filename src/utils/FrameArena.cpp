@@ -0,0 +1,52 @@
+#include "utils/FrameArena.h"
+
+// STL includes
+#include <algorithm>
+
+void *FrameArena::allocate(size_t bytes, size_t alignment) {
+  bytes = std::max<size_t>(bytes, 1);
+  while (current < blocks.size()) {
+    Block &block = blocks[current];
+    size_t start = (offset + alignment - 1) / alignment * alignment;
+    if (start + bytes <= block.size) {
+      offset = start + bytes;
+      peakBytes = std::max(peakBytes, used());
+      return block.data.get() + start;
+    }
+    // Kept for the next reset, which merges the blocks
+    current++;
+    offset = 0;
+  }
+
+  // Blocks are aligned for any type
+  size_t size = std::max(blockSize, bytes + alignment);
+  blocks.push_back({ std::make_unique<std::byte[]>(size), size });
+  current = blocks.size() - 1;
+  offset = 0;
+  return allocate(bytes, alignment);
+}
+
+void FrameArena::reset() {
+  if (blocks.size() > 1) {
+    size_t size = capacity();
+    blocks.clear();
+    blocks.push_back({ std::make_unique<std::byte[]>(size), size });
+  }
+  current = 0;
+  offset = 0;
+  peakBytes = 0;
+}
+
+size_t FrameArena::capacity() const {
+  size_t result = 0;
+  for (const Block &block : blocks)
+    result += block.size;
+  return result;
+}
+
+size_t FrameArena::used() const {
+  size_t result = offset;
+  for (size_t i = 0; i < current && i < blocks.size(); i++)
+    result += blocks[i].size;
+  return result;
+}
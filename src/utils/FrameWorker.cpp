@@ -0,0 +1,77 @@
+#include "utils/FrameWorker.h"
+
+// STL includes
+#include <utility>
+
+// Local includes
+#include "utils/ThreadPool.h"
+
+FrameWorker::FrameWorker(std::function<void()> job) : job(std::move(job)) {
+  if (ThreadPool::threadsAvailable())
+    thread = std::thread(&FrameWorker::loop, this);
+}
+
+FrameWorker::~FrameWorker() {
+  if (!thread.joinable())
+    return;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !pending; });
+    stopping = true;
+  }
+  cv.notify_all();
+  thread.join();
+}
+
+void FrameWorker::start() {
+  if (!thread.joinable()) {
+    job();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending = true;
+  }
+  cv.notify_all();
+}
+
+void FrameWorker::wait() {
+  if (!thread.joinable())
+    return;
+
+  std::exception_ptr thrown;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !pending; });
+    thrown = std::exchange(error, nullptr);
+  }
+  if (thrown != nullptr)
+    std::rethrow_exception(thrown);
+}
+
+void FrameWorker::loop() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this]() { return stopping || pending; });
+      if (stopping)
+        return;
+    }
+
+    std::exception_ptr thrown;
+    try {
+      job();
+    } catch (...) {
+      thrown = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = thrown;
+      pending = false;
+    }
+    cv.notify_all();
+  }
+}
@@ -0,0 +1,90 @@
+#include "utils/MemoryReport.h"
+
+// STL includes
+#include <atomic>
+
+// Libraries
+#include <fmt/format.h>
+
+static std::atomic<bool> tracking{ false };
+static thread_local size_t *scopePeak = nullptr; // Of the innermost `ParseScope` of the thread
+
+MemoryReport::Usage MemoryReport::total() const {
+  Usage result;
+  for (size_t i = SubsystemJsonDom + 1; i < SubsystemCount; i++)
+    result += usages[i];
+  return result;
+}
+
+const char *MemoryReport::name(Subsystem subsystem) {
+  switch (subsystem) {
+  case SubsystemJsonDom:
+    return "JSON DOM (peak)";
+  case SubsystemSongJson:
+    return "Song JSON";
+  case SubsystemEvents:
+    return "Events";
+  case SubsystemBeats:
+    return "Beats";
+  case SubsystemPlacements:
+    return "Placements";
+  case SubsystemChunks:
+    return "Chunks";
+  case SubsystemRibbons:
+    return "Ribbons";
+  case SubsystemRibbonCache:
+    return "Ribbon cache";
+  case SubsystemModels:
+    return "Models";
+  case SubsystemTextures:
+    return "Textures";
+  case SubsystemWaveform:
+    return "Waveform";
+  default:
+    return "?";
+  }
+}
+
+void MemoryReport::print(std::ostream &out) const {
+  constexpr double mebibyte = 1024.0 * 1024.0;
+
+  out << fmt::format("{:<16} {:>10} {:>10} {:>10}", "Memory", "CPU MiB", "GPU MiB", "Objects") << std::endl;
+  for (size_t i = 0; i < SubsystemCount; i++) {
+    const Usage &usage = usages[i];
+    out << fmt::format("{:<16} {:>10.2f} {:>10.2f} {:>10}",
+                       name(static_cast<Subsystem>(i)),
+                       static_cast<double>(usage.cpuBytes) / mebibyte,
+                       static_cast<double>(usage.gpuBytes) / mebibyte,
+                       usage.objects)
+        << std::endl;
+  }
+
+  Usage sum = total();
+  out << fmt::format("{:<16} {:>10.2f} {:>10.2f} {:>10}",
+                     "Total",
+                     static_cast<double>(sum.cpuBytes) / mebibyte,
+                     static_cast<double>(sum.gpuBytes) / mebibyte,
+                     sum.objects)
+      << std::endl;
+}
+
+void MemoryReport::trackParsing() {
+  tracking = true;
+}
+
+bool MemoryReport::trackingParsing() {
+  return tracking && scopePeak != nullptr;
+}
+
+void MemoryReport::recordJsonDom(size_t bytes) {
+  if (scopePeak != nullptr && bytes > *scopePeak)
+    *scopePeak = bytes;
+}
+
+MemoryReport::ParseScope::ParseScope(size_t &peak) : outer(scopePeak) {
+  scopePeak = &peak;
+}
+
+MemoryReport::ParseScope::~ParseScope() {
+  scopePeak = outer;
+}
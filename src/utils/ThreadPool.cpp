@@ -0,0 +1,72 @@
+#include "utils/ThreadPool.h"
+
+// STL includes
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (!threadsAvailable())
+    return;
+
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  workers.reserve(threads);
+  for (size_t i = 0; i < threads; i++)
+    workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+size_t ThreadPool::runPending(size_t maxTasks) {
+  size_t ran = 0;
+  while (ran < maxTasks) {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (queue.empty())
+        break;
+      task = std::move(queue.front());
+      queue.pop_front();
+    }
+    task();
+    ran++;
+  }
+  return ran;
+}
+
+bool ThreadPool::threadsAvailable() {
+#if defined(PLATFORM_WEB) && !defined(__EMSCRIPTEN_PTHREADS__)
+  return false;
+#else
+  return true;
+#endif
+}
+
+ThreadPool &ThreadPool::global() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+      if (stopping && queue.empty())
+        return;
+      task = std::move(queue.front());
+      queue.pop_front();
+    }
+    task();
+  }
+}
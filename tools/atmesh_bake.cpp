@@ -0,0 +1,54 @@
+/**
+ * Build-time tool: converts OBJ models into the binary .atmesh format loaded by the viewer.
+ *
+ * Usage: atmesh_bake <input.obj> <output.atmesh>
+ */
+
+// STL includes
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Local includes
+#include "rendering/binary_mesh.h"
+#include "rendering/obj_loader.h"
+
+int main(int argc, const char *argv[]) {
+  namespace fs = std::filesystem;
+
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <input.obj> <output.atmesh>" << std::endl;
+    return 1;
+  }
+
+  fs::path input(argv[1]);
+  fs::path output(argv[2]);
+
+  obj::ObjData data;
+  try {
+    data = obj::parseFile(input.string());
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  // Texture paths are resolved relative to the OBJ model at load time, wherever the mesh file is written
+  fs::path inputDir = fs::absolute(input).parent_path();
+  for (obj::MaterialData &material : data.materials) {
+    if (!material.diffuseMap.empty())
+      material.diffuseMap = fs::absolute(material.diffuseMap).lexically_relative(inputDir).generic_string();
+  }
+
+  std::vector<uint8_t> bytes = binmesh::serialize(data);
+
+  std::ofstream os(output, std::ios::binary | std::ios::trunc);
+  os.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!os) {
+    std::cerr << "Unable to write " << output << std::endl;
+    return 1;
+  }
+
+  std::cout << input.filename().string() << " -> " << output.filename().string() << ": " << fs::file_size(input)
+            << " -> " << bytes.size() << " bytes" << std::endl;
+  return 0;
+}